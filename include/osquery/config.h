@@ -19,6 +19,7 @@
 #include <osquery/expected.h>
 #include <osquery/plugin.h>
 #include <osquery/query.h>
+#include <osquery/system.h>
 
 namespace osquery {
 
@@ -29,7 +30,7 @@ class Schedule;
 class ConfigParserPlugin;
 class ConfigRefreshRunner;
 
-/// The name of the executing query within the single-threaded schedule.
+/// The key prefix used to record each executing scheduled query.
 extern const std::string kExecutingQuery;
 
 /**
@@ -83,16 +84,16 @@ class Config : private boost::noncopyable {
    * to the updates/changes reflected in the schedule, from the config.
    *
    * @param name The unique name of the scheduled item
-   * @param delay Number of seconds (wall time) taken by the query
+   * @param r0 the resource usage sampled before the query
+   * @param r1 the resource usage sampled after the query
+   * @param rows Number of rows generated by query
    * @param size Number of characters generated by query
-   * @param r0 the process row before the query
-   * @param r1 the process row after the query
    */
   void recordQueryPerformance(const std::string& name,
-                              size_t delay,
-                              size_t size,
-                              const Row& r0,
-                              const Row& r1);
+                              const ResourceUsage& r0,
+                              const ResourceUsage& r1,
+                              size_t rows,
+                              size_t size);
 
   /**
    * @brief Record a query 'initialization', meaning the query will run.
@@ -102,11 +103,25 @@ class Config : private boost::noncopyable {
    * status set by this method. This status is saved in the backing database
    * store. On process start, or worker state, if any dirty bit is set then
    * it is assumed that the current start is a result of a previous abort.
+   * Every query with a dirty bit set is blacklisted.
    *
    * @param name THe unique name of the scheduled item
    */
   void recordQueryStart(const std::string& name);
 
+  /**
+   * @brief The name of the scheduled query executing on the calling thread.
+   *
+   * Scheduled queries may run concurrently on scheduler workers, each
+   * records its start on the worker thread. Callers that need the query
+   * driving the current table generation, such as event subscriber
+   * optimizations, should use this method.
+   *
+   * If the calling thread has not recorded a query start, an empty string is
+   * returned.
+   */
+  std::string getExecutingQuery() const;
+
   /**
    * @brief Calculate the hash of the osquery config
    *
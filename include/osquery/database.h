@@ -53,11 +53,14 @@ extern const std::string kEvents;
 /// The "domain" where the results of carve queries are stored.
 extern const std::string kCarves;
 
+/// The "domain" where file content hashes are cached, keyed by inode.
+extern const std::string kFileHashes;
+
 /// The key for the DB version
 extern const std::string kDbVersionKey;
 
 /// The running version of our database schema
-const int kDbCurrentVersion = 2;
+const int kDbCurrentVersion = 3;
 
 /**
  * @brief The "domain" where buffered log results are stored.
@@ -126,6 +129,22 @@ class DatabasePlugin : public Plugin {
   virtual Status putBatch(const std::string& domain,
                           const DatabaseStringValueList& data) = 0;
 
+  /**
+   * @brief Append bytes to the value stored at a domain and key index.
+   *
+   * A missing key is treated as an empty value. The default implementation is
+   * a read-modify-write; backing stores with native merge or append support
+   * should override this to avoid reading the existing value.
+   *
+   * @param domain A string value representing abstract storage indexing.
+   * @param key A string value representing the lookup/retrieval key.
+   * @param value The bytes to append to the existing value.
+   * @return Failure if the data could not be stored.
+   */
+  virtual Status append(const std::string& domain,
+                        const std::string& key,
+                        const std::string& value);
+
   virtual void dumpDatabase() const = 0;
 
   /// Data removal method.
@@ -136,11 +155,44 @@ class DatabasePlugin : public Plugin {
                              const std::string& low,
                              const std::string& high) = 0;
 
+  /**
+   * @brief Remove a set of keys from a domain.
+   *
+   * The default implementation removes each key in turn; backing stores with
+   * write batches should override this to remove the keys in one write.
+   *
+   * @param domain A string value representing abstract storage indexing.
+   * @param keys The keys to remove, missing keys are ignored.
+   * @return Failure if a key could not be removed.
+   */
+  virtual Status removeBatch(const std::string& domain,
+                             const std::vector<std::string>& keys);
+
   virtual Status scan(const std::string& domain,
                       std::vector<std::string>& results,
                       const std::string& prefix,
                       size_t max) const;
 
+  /**
+   * @brief Read keys and their values, in key order, in a single pass.
+   *
+   * Only keys beginning with prefix and ordered at or after start are read.
+   * The default implementation scans the keys and gets each value; backing
+   * stores with ordered iterators should override this to seek to start.
+   *
+   * @param domain A string value representing abstract storage indexing.
+   * @param results The output list of key and value pairs, appended to.
+   * @param prefix Only read keys beginning with this prefix.
+   * @param start Only read keys ordered at or after this key.
+   * @param max The maximum number of pairs to read, 0 is unlimited.
+   * @return Failure if the domain could not be read.
+   */
+  virtual Status scanValues(const std::string& domain,
+                            DatabaseStringValueList& results,
+                            const std::string& prefix,
+                            const std::string& start,
+                            size_t max) const;
+
   /**
    * @brief Shutdown the database and release initialization resources.
    *
@@ -256,6 +308,20 @@ Status setDatabaseValue(const std::string& domain,
 Status setDatabaseBatch(const std::string& domain,
                         const DatabaseStringValueList& data);
 
+/**
+ * @brief Append bytes to a value in the active osquery DatabasePlugin storage.
+ *
+ * See DatabasePlugin::append. Appending to a missing key creates it.
+ *
+ * @param domain A string value representing abstract storage indexing.
+ * @param key A string value representing the lookup/retrieval key.
+ * @param value The bytes to append.
+ * @return Storage operation status.
+ */
+Status appendDatabaseValue(const std::string& domain,
+                           const std::string& key,
+                           const std::string& value);
+
 /// Remove a domain/key identified value from backing-store.
 Status deleteDatabaseValue(const std::string& domain, const std::string& key);
 
@@ -264,6 +330,10 @@ Status deleteDatabaseRange(const std::string& domain,
                            const std::string& low,
                            const std::string& high);
 
+/// Remove a set of keys in domain, see DatabasePlugin::removeBatch.
+Status deleteDatabaseBatch(const std::string& domain,
+                           const std::vector<std::string>& keys);
+
 /// Get a list of keys for a given domain.
 Status scanDatabaseKeys(const std::string& domain,
                         std::vector<std::string>& keys,
@@ -275,6 +345,24 @@ Status scanDatabaseKeys(const std::string& domain,
                         const std::string& prefix,
                         size_t max = 0);
 
+/**
+ * @brief Get keys and values for a given domain in key order.
+ *
+ * See DatabasePlugin::scanValues.
+ *
+ * @param domain A string value representing abstract storage indexing.
+ * @param results The output list of key and value pairs.
+ * @param prefix Only read keys beginning with this prefix.
+ * @param start Only read keys ordered at or after this key.
+ * @param max The maximum number of pairs to read, 0 is unlimited.
+ * @return Storage operation status.
+ */
+Status scanDatabaseValues(const std::string& domain,
+                          DatabaseStringValueList& results,
+                          const std::string& prefix,
+                          const std::string& start = "",
+                          size_t max = 0);
+
 /// Allow callers to reload or reset the database plugin.
 void resetDatabase();
 
@@ -230,7 +230,13 @@ class Distributed {
   /// Serialize result data into a JSON string and clear the results
   Status serializeResults(std::string& json);
 
-  /// Process and execute queued queries
+  /**
+   * @brief Process and execute queued queries
+   *
+   * Up to distributed_concurrency queries run at once. Completed results are
+   * written through the distributed plugin whenever they exceed
+   * distributed_write_chunk_bytes, and the remainder once all queries ran.
+   */
   Status runQueries();
 
   // Getter for ID of currently executing request
@@ -255,28 +261,56 @@ class Distributed {
    */
   DistributedQueryRequest popRequest();
 
+  /**
+   * @brief Execute a request within the distributed query limits
+   *
+   * The query is stopped, and no rows are returned, if it runs longer than
+   * distributed_query_timeout or its results exceed distributed_max_rows or
+   * distributed_max_bytes. The limits apply to this query only, concurrent
+   * queries each hold their own results.
+   *
+   * @param request the request to execute
+   * @param bytes output, the approximate size of the result rows
+   * @return the result, with a failure status if a limit was reached
+   */
+  DistributedQueryResult runQuery(const DistributedQueryRequest& request,
+                                  size_t& bytes);
+
   /**
    * @brief Queue a result to be batch sent to the server
    *
    * @param result is a DistributedQueryResult object to be sent to the server
    */
-  void addResult(const DistributedQueryResult& result);
+  void addResult(DistributedQueryResult result);
 
   /**
    * @brief Flush all of the collected results to the server
    */
   Status flushCompleted();
 
+  /// Serialize and write a set of results through the distributed plugin.
+  static Status writeResults(
+      const std::vector<DistributedQueryResult>& results);
+
+  /// Serialize a set of results into the writeResults JSON document.
+  static Status serializeResults(
+      const std::vector<DistributedQueryResult>& results, std::string& json);
+
   // Setter for ID of currently executing request
   static void setCurrentRequestId(const std::string& cReqId);
 
   std::vector<DistributedQueryResult> results_;
 
-  // ID of the currently executing query
-  static std::string currentRequestId_;
+  /// Approximate size of the queued results.
+  size_t results_bytes_{0};
+
+  // ID of the query executing on the calling thread
+  static thread_local std::string currentRequestId_;
 
  private:
   friend class DistributedTests;
   FRIEND_TEST(DistributedTests, test_workflow);
+  FRIEND_TEST(DistributedTests, test_query_limits);
+  FRIEND_TEST(DistributedTests, test_concurrent_chunked_writes);
 };
 }
@@ -36,7 +36,33 @@ class EventFactory;
 using EventID = const std::string;
 using EventContextID = uint64_t;
 using EventTime = uint64_t;
-using EventRecord = std::pair<std::string, EventTime>;
+using EventRecord = std::pair<size_t, EventTime>;
+
+/**
+ * @brief Inclusive time and EventID bounds for selecting buffered events.
+ *
+ * An EventSubscriber table pushes its 'time' and 'eid' constraints into a
+ * range so only the matching index bins and records are read. A stop of 0 is
+ * unbounded.
+ */
+struct EventRange {
+  EventTime start{0};
+  EventTime stop{0};
+  size_t eid_start{0};
+  size_t eid_stop{0};
+
+  /// Yield events ordered by time instead of in storage order.
+  bool sorted{false};
+
+  /// When sorted, yield the newest events first.
+  bool descending{false};
+
+  /// Check if a buffered (eid, time) record falls within the range.
+  bool contains(size_t eid, EventTime time) const {
+    return time >= start && (stop == 0 || time <= stop) && eid >= eid_start &&
+           (eid_stop == 0 || eid <= eid_stop);
+  }
+};
 
 /**
  * @brief An EventPublisher will define a SubscriptionContext for
@@ -415,6 +441,19 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
    */
   Status add(const Row& r);
 
+  /**
+   * @brief Store an event with the time it occurred.
+   *
+   * Use this when a row is added some time after its event was received, for
+   * example after work that was deferred to another thread.
+   *
+   * @param r The row to add
+   * @param time The time the event occurred.
+   *
+   * @return Was the element added to the backing store.
+   */
+  Status add(const Row& r, EventTime time);
+
   /**
    * @brief Store parsed event data from an EventCallback in a backing store.
    *
@@ -466,6 +505,14 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
   std::vector<EventRecord> getRecords(const std::vector<std::string>& indexes,
                                       bool optimize = true);
 
+  /// Get the EventID, EventTime%s from indexes that fall within a range.
+  std::vector<EventRecord> getRecords(const std::vector<std::string>& indexes,
+                                      const EventRange& range,
+                                      bool optimize = true);
+
+  /// Yield the buffered events within a time and EventID range, see get.
+  void getEvents(RowYield& yield, const EventRange& range);
+
   /**
    * @brief Get a unique storage-related EventID.
    *
@@ -481,9 +528,15 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
    */
   const std::string getEventID();
 
+  /// Get a unique storage-related EventID, see getEventID.
+  size_t nextEventID();
+
   /**
    * @brief Plan the best set of indexes for event record access.
    *
+   * The bin index is kept in ascending order, the bins overlapping the time
+   * range and the expired bins are found with a binary search.
+   *
    * @param start an inclusive time to begin searching.
    * @param stop an inclusive time to end searching.
    * @param sort if true the indexes will be sorted.
@@ -510,6 +563,27 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
                      const std::string& index,
                      bool all);
 
+  /**
+   * @brief Get the column-ordinal dictionary used to store event rows.
+   *
+   * The dictionary is persisted under "columns.<namespace>" and seeded from
+   * the subscriber's table schema. Rows containing unknown columns extend the
+   * dictionary; existing ordinals never change.
+   *
+   * @param row An optional row whose columns must exist in the dictionary.
+   * @return A snapshot of the dictionary, safe to use without locking.
+   */
+  std::shared_ptr<const ColumnDictionary> getColumnDictionary(
+      const Row* row = nullptr);
+
+  /// Serialize an event row using the binary or JSON row format.
+  Status serializeEventRow(const Row& row, std::string& out);
+
+  /// Deserialize an event row stored with either row format.
+  static Status deserializeEventRow(const std::string& data,
+                                    const ColumnDictionary& dictionary,
+                                    Row& r);
+
   /**
    * @brief Inspect the number of events, expire those overflowing events_max.
    *
@@ -530,13 +604,15 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
    * 60 seconds and 3600 seconds and `time` is 92, this pair will be added to
    * list type 1 bin 4 and list type 2 bin 1.
    *
+   * Records are appended to the bin as fixed-width binary (eid, time) pairs
+   * so the existing bin is never read back while recording.
+   *
    * @param event_id_list A vector of (unique) EventIDs
    * @param event_time The event time for this batch
    *
    * @return Were the indexes recorded.
    */
-
-  Status recordEvents(const std::vector<std::string>& event_id_list,
+  Status recordEvents(const std::vector<size_t>& event_id_list,
                       EventTime event_time);
 
   /**
@@ -654,6 +730,9 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
   /// Cached value of last generated EventID.
   size_t last_eid_{0};
 
+  /// The last record bin (plus one) known to exist within the bin index.
+  std::atomic<EventTime> record_bin_{0};
+
   /**
    * @brief Optimize subscriber selects by tracking the last select time.
    *
@@ -690,6 +769,21 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
   /// Lock used when recording queries executing against this subscriber.
   mutable Mutex event_query_record_;
 
+  /**
+   * @brief Lock held while a query selects from this subscriber.
+   *
+   * The optimize time and EventID are loaded for the executing query, used to
+   * filter records, and then persisted. Scheduled queries may select from the
+   * same subscriber concurrently and must not share these values.
+   */
+  Mutex optimize_lock_;
+
+  /// Column-ordinal dictionary for binary event rows, see getColumnDictionary.
+  std::shared_ptr<const ColumnDictionary> column_dictionary_{nullptr};
+
+  /// Lock used when loading or extending the column dictionary.
+  Mutex column_dictionary_lock_;
+
  private:
   friend class EventFactory;
   friend class EventPublisherPlugin;
@@ -698,11 +792,14 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
   FRIEND_TEST(EventsDatabaseTests, test_event_module_id);
   FRIEND_TEST(EventsDatabaseTests, test_record_indexing);
   FRIEND_TEST(EventsDatabaseTests, test_record_range);
+  FRIEND_TEST(EventsDatabaseTests, test_record_index_order);
+  FRIEND_TEST(EventsDatabaseTests, test_record_range_pushdown);
   FRIEND_TEST(EventsDatabaseTests, test_record_expiration);
   FRIEND_TEST(EventsDatabaseTests, test_gentable);
   FRIEND_TEST(EventsDatabaseTests, test_expire_check);
   FRIEND_TEST(EventsDatabaseTests, test_optimize);
   FRIEND_TEST(EventsDatabaseTests, test_record_corruption);
+  FRIEND_TEST(EventsDatabaseTests, test_record_append_after_corruption);
   FRIEND_TEST(EventsTests, test_event_subscriber_configure);
   friend class DBFakeEventSubscriber;
   friend class BenchmarkEventSubscriber;
@@ -838,6 +935,9 @@ class EventFactory : private boost::noncopyable {
   /// Optionally forward events to loggers.
   static void forwardEvent(const std::string& event);
 
+  /// Check if any logger receives forwarded events.
+  static bool hasForwarders();
+
   /**
    * @brief The event factory, subscribers, and publishers respond to updates.
    *
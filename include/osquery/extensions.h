@@ -160,6 +160,50 @@ Status callExtension(const std::string& extension_path,
                      const PluginRequest& request,
                      PluginResponse& response);
 
+/**
+ * @brief Generate the rows of an Extension's table as typed columns.
+ *
+ * The query context is sent as a structure and the rows are returned as typed
+ * columns, so column names are sent once rather than within every row.
+ * Extensions built with an earlier SDK are called using callExtension.
+ *
+ * @param uuid Route UUID of the matched Extension.
+ * @param table The Extension's table name.
+ * @param context The query context.
+ * @param results [output] Rows are added by matching each column's name.
+ * @return Success indicates Extension API call success and table generation.
+ */
+Status callExtensionTable(const RouteUUID uuid,
+                          const std::string& table,
+                          const QueryContext& context,
+                          TableRows& results);
+
+/// Internal callExtensionTable implementation using a UNIX domain socket path.
+Status callExtensionTable(const std::string& extension_path,
+                          const std::string& table,
+                          const QueryContext& context,
+                          TableRows& results);
+
+/**
+ * @brief Stream the rows of an Extension's table through a table cursor.
+ *
+ * Rows are read from the Extension in typed batches and passed to the yield
+ * function, which is bound to the TableRowsGenerator of a table scan.
+ * Destroying the generator before the last row closes the Extension's cursor.
+ *
+ * @param uuid Route UUID of the matched Extension.
+ * @param table The Extension's table name.
+ * @param context The query context.
+ * @param columns The table's columns, used to read each batch.
+ * @param yield Called with each batch of rows.
+ * @return Success indicates every row was read.
+ */
+Status callExtensionTable(const RouteUUID uuid,
+                          const std::string& table,
+                          const QueryContext& context,
+                          const TableColumns& columns,
+                          TableRowsYield& yield);
+
 /// The main runloop entered by an Extension, start an ExtensionRunner thread.
 Status startExtension(const std::string& name, const std::string& version);
 
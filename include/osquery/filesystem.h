@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <functional>
 #include <map>
 #include <set>
 #include <string>
@@ -202,6 +203,27 @@ Status resolveFilePattern(const boost::filesystem::path& pattern,
                           std::vector<std::string>& results,
                           GlobLimits setting);
 
+/// Called with each resolved path, return false to stop resolving.
+using GlobCallback = std::function<bool(const std::string& path)>;
+
+/**
+ * @brief Given a filesystem globbing patten, pass each matching path.
+ *
+ * See resolveFilePattern, but paths are passed to a callback as they are
+ * found, so a generator table may yield rows before the pattern is resolved.
+ * A recursive pattern, ending in '%%', is expanded with a single walk of the
+ * directories below the paths matching the pattern.
+ *
+ * @param pattern filesystem globbing pattern.
+ * @param callback called with each matching path on the calling thread.
+ * @param setting a bit list of match types, e.g., files, folders.
+ *
+ * @return an instance of Status, indicating success or failure.
+ */
+Status resolveFilePattern(const boost::filesystem::path& pattern,
+                          const GlobCallback& callback,
+                          GlobLimits setting = GLOB_ALL);
+
 /**
  * @brief Transform a path with SQL wildcards to globbing wildcard.
  *
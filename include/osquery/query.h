@@ -88,6 +88,61 @@ Status deserializeRow(const rapidjson::Value& obj, Row& r);
  */
 Status deserializeRowJSON(const std::string& json, Row& r);
 
+/**
+ * @brief A column-ordinal dictionary used for binary Row serialization.
+ *
+ * Each column name is assigned a stable ordinal when it is added. Binary rows
+ * refer to columns by ordinal so column names are not repeated per row. The
+ * dictionary is append-only: existing ordinals never change.
+ */
+struct ColumnDictionary {
+  /// Column names indexed by ordinal.
+  ColumnNames names;
+
+  /// Reverse lookup from column name to ordinal.
+  std::map<std::string, size_t> ordinals;
+
+  /// Add a column name if it does not exist, return its ordinal.
+  size_t add(const std::string& name);
+};
+
+/**
+ * @brief Serialize a Row into a compact, length-prefixed binary string.
+ *
+ * Columns are written as varint dictionary ordinals. Values that are
+ * canonical base-10 integers are written as zigzag varints, all other values
+ * as varint length-prefixed bytes. Columns missing from the dictionary are
+ * written with their name inline.
+ *
+ * The first byte of the output is never '{', allowing callers to store
+ * binary and JSON rows side by side.
+ *
+ * @param r the Row to serialize.
+ * @param dict the column dictionary used to resolve column ordinals.
+ * @param out [output] the output binary string.
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status serializeRowBinary(const Row& r,
+                          const ColumnDictionary& dict,
+                          std::string& out);
+
+/**
+ * @brief Deserialize a Row from a binary string, see serializeRowBinary.
+ *
+ * @param data the input binary string.
+ * @param dict the column dictionary used when the row was serialized.
+ * @param r [output] the output Row structure.
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status deserializeRowBinary(const std::string& data,
+                            const ColumnDictionary& dict,
+                            Row& r);
+
+/// Check if a serialized row was produced by serializeRowBinary.
+bool isRowBinary(const std::string& data);
+
 /**
  * @brief The result set returned from a osquery SQL query
  *
@@ -211,6 +266,54 @@ Status serializeDiffResultsJSON(const DiffResults& d, std::string& json);
  */
 DiffResults diff(QueryDataSet& old_, QueryData& new_);
 
+/**
+ * @brief Compute a stable 64-bit content hash of a Row.
+ *
+ * The hash covers every column name and value. It is persisted alongside
+ * scheduled query results, so it must not change between releases.
+ */
+uint64_t hashRow(const Row& r);
+
+/**
+ * @brief Serialize a QueryData object with a per-row hash index.
+ *
+ * The output contains a column dictionary, the 64-bit hash of each row, and
+ * each row encoded with serializeRowBinary. A later differential only needs
+ * the hash index, the rows are only decoded if they were removed.
+ *
+ * @param q the QueryData to serialize.
+ * @param out [output] the output binary string.
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status serializeQueryDataHashed(const QueryData& q, std::string& out);
+
+/// Inverse of serializeQueryDataHashed, convert to a QueryDataSet.
+Status deserializeQueryDataHashed(const std::string& data, QueryDataSet& qd);
+
+/// Check if serialized query data was produced by serializeQueryDataHashed.
+bool isQueryDataHashed(const std::string& data);
+
+/**
+ * @brief Diff hash-indexed previous results and the current QueryData.
+ *
+ * This produces the same DiffResults as diff() without materializing the
+ * previous results: current rows are matched by hash-set membership and only
+ * removed rows are decoded. Rows with colliding 64-bit hashes are treated as
+ * equal.
+ *
+ * @param old_ the "old" results, see serializeQueryDataHashed.
+ * @param new_ the "new" set of results.
+ * @param hashes [output] the hash of each row in new_, in order.
+ * @param dr [output] the change from old_ to new_.
+ *
+ * @return Status indicating the success or failure of the operation.
+ */
+Status diffHashed(const std::string& old_,
+                  const QueryData& new_,
+                  std::vector<uint64_t>& hashes,
+                  DiffResults& dr);
+
 /**
  * @brief Add a Row to a QueryData if the Row hasn't appeared in the QueryData
  * already
@@ -251,20 +354,32 @@ struct QueryPerformance {
   /// Last UNIX time in seconds the query was executed successfully.
   size_t last_executed{0};
 
-  /// Total wall time taken
+  /// Total wall time taken in seconds
   unsigned long long int wall_time{0};
 
-  /// Total user time (cycles)
+  /// Total wall time taken in nanoseconds
+  unsigned long long int wall_time_ns{0};
+
+  /// Total user time in milliseconds
   unsigned long long int user_time{0};
 
-  /// Total system time (cycles)
+  /// Total user time in nanoseconds
+  unsigned long long int user_time_ns{0};
+
+  /// Total system time in milliseconds
   unsigned long long int system_time{0};
 
+  /// Total system time in nanoseconds
+  unsigned long long int system_time_ns{0};
+
   /// Average memory differentials. This should be near 0.
   unsigned long long int average_memory{0};
 
   /// Total characters, bytes, generated by query.
   unsigned long long int output_size{0};
+
+  /// Total rows generated by query.
+  unsigned long long int output_rows{0};
 };
 
 /**
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <csignal>
+#include <cstdint>
 #include <mutex>
 #include <string>
 
@@ -339,6 +340,31 @@ Status createPidFile();
  */
 bool isUserAdmin();
 
+/// A sample of the resources used by the calling thread and its process.
+struct ResourceUsage {
+  /// Monotonic wall time in nanoseconds.
+  uint64_t wall_time_ns{0};
+
+  /// CPU time spent by the calling thread in user mode, in nanoseconds.
+  uint64_t user_time_ns{0};
+
+  /// CPU time spent by the calling thread in kernel mode, in nanoseconds.
+  uint64_t system_time_ns{0};
+
+  /// Resident memory of the process in bytes, 0 if not available.
+  uint64_t resident_size{0};
+};
+
+/**
+ * @brief Sample the resource usage of the calling thread.
+ *
+ * This does not use tables or SQL, it is cheap enough to sample around every
+ * scheduled query. CPU times are per-thread so concurrent work on other
+ * threads is not attributed to the caller. Where a per-thread clock is not
+ * available the process-wide times are used.
+ */
+ResourceUsage getResourceUsage();
+
 /**
  * @brief Set the name of the thread
  *
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -28,6 +29,7 @@
 #include <boost/optional.hpp>
 
 #include <osquery/core.h>
+#include <osquery/mutex.h>
 #include <osquery/plugin.h>
 #include <osquery/query.h>
 
@@ -459,6 +461,12 @@ using ConstraintSet = std::vector<std::pair<std::string, struct Constraint>>;
 /// Keep track of which columns are used
 using UsedColumns = std::unordered_set<std::string>;
 
+/// A column name and true if the rows are ordered descending by the column.
+using ColumnOrder = std::pair<std::string, bool>;
+
+/// The row order requested by a query, the most significant column first.
+using ColumnOrdering = std::vector<ColumnOrder>;
+
 /**
  * @brief osquery table content descriptor.
  *
@@ -499,6 +507,9 @@ struct VirtualTableContent {
   /// Transient set of virtual table used columns
   std::unordered_map<size_t, UsedColumns> colsUsed;
 
+  /// Transient set of row orderings the table agreed to produce
+  std::unordered_map<size_t, ColumnOrdering> orderBy;
+
   /*
    * @brief A table implementation specific query result cache.
    *
@@ -520,6 +531,166 @@ struct VirtualTableContent {
 using RowGenerator = boost::coroutines2::coroutine<Row&>;
 using RowYield = RowGenerator::push_type;
 
+/**
+ * @brief A typed buffer of table rows addressed by column ordinal.
+ *
+ * Tables declared with `implementation("...", typed=True)` fill this buffer
+ * instead of returning QueryData. Each cell is stored in the native type of
+ * its column: an integer, a double, or text within a shared arena, and a
+ * bitmap tracks NULL (unset) cells. The SQLite cursor then reads each cell by
+ * row and column index without name lookups or re-parsing strings.
+ *
+ * Values set using a different type than the column's affinity are converted
+ * once, when set, following the same rules the cursor applies to Row values.
+ * A numeric cell set from text that is not the number's rendering, such as
+ * "010", "1e-9", or text that does not convert, keeps that text. It is
+ * returned unchanged by getRow, so Row consumers see what the table set.
+ */
+class TableRows : private boost::noncopyable {
+ public:
+  /// Create an empty buffer for a table's columns, in schema order.
+  explicit TableRows(const TableColumns& columns);
+
+  /// The ordinal of a column by name, or columns() if it does not exist.
+  size_t column(const std::string& name) const;
+
+  /// Begin a new row, every cell is NULL until set.
+  void addRow();
+
+  /// Append a Row, matching columns by name. Unknown columns are ignored.
+  void addRow(const Row& row);
+
+  /// Append each Row within a QueryData.
+  void append(const QueryData& rows);
+
+  /// Set a cell in the current row to an integer.
+  void setInteger(size_t column, long long value);
+
+  /// Set a cell in the current row to a double.
+  void setDouble(size_t column, double value);
+
+  /// Set a cell in the current row from a string, as a Row would store it.
+  void setText(size_t column, const char* value, size_t size);
+
+  /// Set a cell in the current row from a string, as a Row would store it.
+  void setText(size_t column, const std::string& value) {
+    setText(column, value.data(), value.size());
+  }
+
+  /// The number of rows.
+  size_t rows() const {
+    return rows_;
+  }
+
+  /// The number of columns.
+  size_t columns() const {
+    return columns_;
+  }
+
+  /// The name of a column.
+  const std::string& name(size_t column) const {
+    return names_[column];
+  }
+
+  /// The affinity used to store a column's cells.
+  ColumnType type(size_t column) const {
+    return types_[column];
+  }
+
+  /// Check if a cell was not set or failed conversion.
+  bool isNull(size_t row, size_t column) const {
+    return nulls_[row * columns_ + column];
+  }
+
+  /// Read an INTEGER, BIGINT, or UNSIGNED_BIGINT cell.
+  long long getInteger(size_t row, size_t column) const {
+    return cells_[row * columns_ + column].integer;
+  }
+
+  /// Read a DOUBLE cell.
+  double getDouble(size_t row, size_t column) const {
+    return cells_[row * columns_ + column].real;
+  }
+
+  /// Read a TEXT, BLOB, or UNKNOWN cell, valid while the buffer is unchanged.
+  const char* getText(size_t row, size_t column, size_t& size) const {
+    const auto& cell = cells_[row * columns_ + column];
+    size = cell.text.size;
+    return arena_.data() + cell.text.offset;
+  }
+
+  /**
+   * @brief Read the text a numeric cell was set from.
+   *
+   * @return nullptr unless the cell keeps text that differs from the rendering
+   * of its number, or that could not be converted.
+   */
+  const char* getSource(size_t row, size_t column, size_t& size) const;
+
+  /// Convert a row into the string representation used by Row.
+  Row getRow(size_t row) const;
+
+  /// Convert every row, for registry callers and caching.
+  QueryData toQueryData() const;
+
+  /// Copy a subset of the rows, in the given order, into a new set.
+  std::unique_ptr<TableRows> select(const std::vector<size_t>& rows) const;
+
+ private:
+  /// A range of the text arena.
+  struct Text {
+    size_t offset;
+    size_t size;
+  };
+
+  /// A typed cell, the column affinity selects the member.
+  union Cell {
+    long long integer;
+    double real;
+    Text text;
+  };
+
+  /// Keep or drop the source text of a numeric cell by its index.
+  void setSource(size_t index, bool keep, const char* value, size_t size);
+
+  /// Storage affinity of each column.
+  std::vector<ColumnType> types_;
+
+  /// Column names, in schema order.
+  std::vector<std::string> names_;
+
+  /// Column ordinals by name.
+  std::unordered_map<std::string, size_t> ordinals_;
+
+  /// Cells in row-major order.
+  std::vector<Cell> cells_;
+
+  /// Set for each cell that is NULL.
+  std::vector<bool> nulls_;
+
+  /// Text cell content.
+  std::string arena_;
+
+  /// Source text of numeric cells by index, only if it is not canonical.
+  std::unordered_map<size_t, Text> sources_;
+
+  /// Number of columns in each row.
+  size_t columns_{0};
+
+  /// Number of rows.
+  size_t rows_{0};
+};
+
+/**
+ * @brief A generator of typed row batches.
+ *
+ * Extension tables stream their rows in batches, each batch is read by the
+ * SQLite cursor in place.
+ */
+using TableRowsGenerator =
+    boost::coroutines2::coroutine<std::shared_ptr<const TableRows>>;
+using TableRowsYield = TableRowsGenerator::push_type;
+
 /**
  * @brief A QueryContext is provided to every table generator for optimization
  * on query components like predicate constraints and limits.
@@ -697,6 +868,16 @@ struct QueryContext : private only_movable {
 
   boost::optional<UsedColumns> colsUsed;
 
+  /**
+   * @brief The order the table must produce rows in.
+   *
+   * This is only set when the table can produce rows in the order the query
+   * requested, SQLite does not sort them again. Event subscriber tables
+   * produce rows ordered by time, such that a newest-first query with a LIMIT
+   * stops reading once SQLite has the newest events.
+   */
+  ColumnOrdering orderBy;
+
  private:
   /// If false then the context is maintaining an ephemeral cache.
   bool enable_cache_{false};
@@ -832,6 +1013,26 @@ class TablePlugin : public Plugin {
     return false;
   }
 
+  /**
+   * @brief Generate typed rows for a query context, see TableRows.
+   *
+   * Tables that override usesTypedRows are read by SQLite through this
+   * method. Their generate method converts the typed rows to QueryData for
+   * registry and extension callers.
+   *
+   * @param context a query context filled in by SQLite's virtual table API.
+   * @param results [output] the typed rows, created with this table's columns.
+   */
+  virtual void generateTypedRows(QueryContext& context, TableRows& results) {
+    (void)context;
+    (void)results;
+  }
+
+  /// Override and return true to use generateTypedRows.
+  virtual bool usesTypedRows() const {
+    return false;
+  }
+
  protected:
   /// An SQL table containing the table definition/syntax.
   std::string columnDefinition(bool is_extension = false) const;
@@ -858,6 +1059,9 @@ class TablePlugin : public Plugin {
    * a database call API and re-serialization to the virtual table APIs. In
    * practice this does not perform well and is explicitly disabled.
    *
+   * Results are also not fresh if they were generated without a column that
+   * the query context uses.
+   *
    * @param interval The interval this query expects the tables results.
    * @param ctx The query context.
    * @return True if the cache contains fresh results, otherwise false.
@@ -881,12 +1085,22 @@ class TablePlugin : public Plugin {
    * Set will serialize and save the results as JSON to be retrieved later.
    * It will inspect the query context, if any required/indexed/optimized or
    * additional columns are used then the cache will not be saved.
+   *
+   * The columns used by the context are saved with the results. Tables may
+   * skip generating unused columns, so the results are only served to later
+   * queries that use a subset of these columns.
    */
   void setCache(size_t step,
                 size_t interval,
                 const QueryContext& ctx,
                 const QueryData& results);
 
+  /// See setCache, typed rows are only converted if the cache is saved.
+  void setCache(size_t step,
+                size_t interval,
+                const QueryContext& ctx,
+                const TableRows& results);
+
  private:
   /// The last time in seconds the table data results were saved to cache.
   size_t last_cached_{0};
@@ -894,18 +1108,25 @@ class TablePlugin : public Plugin {
   /// The last interval in seconds when the table data was cached.
   size_t last_interval_{0};
 
+  /// The columns generated in the cached results, none if every column.
+  boost::optional<UsedColumns> cached_columns_;
+
+  /// Protects the cache details, scheduled queries may run concurrently.
+  mutable Mutex cache_lock_;
+
  public:
   /**
    * @brief The scheduled interval for the executing query.
    *
-   * Scheduled queries execute within a pseudo-mutex, and each may communicate
-   * their scheduled interval to internal TablePlugin implementations. If the
-   * table is cachable then the interval can be used to calculate freshness.
+   * Scheduled queries may execute concurrently on scheduler workers, each
+   * communicates its scheduled interval to internal TablePlugin implementations
+   * running on the same thread. If the table is cachable then the interval can
+   * be used to calculate freshness.
    */
-  static size_t kCacheInterval;
+  static thread_local size_t kCacheInterval;
 
   /// The schedule step, this is the current position of the schedule.
-  static size_t kCacheStep;
+  static thread_local size_t kCacheStep;
 
  public:
   /**
@@ -955,7 +1176,9 @@ class TablePlugin : public Plugin {
   FRIEND_TEST(VirtualTableTests, test_tableplugin_statement);
   FRIEND_TEST(VirtualTableTests, test_indexing_costs);
   FRIEND_TEST(VirtualTableTests, test_table_results_cache);
+  FRIEND_TEST(VirtualTableTests, test_tick_cache);
   FRIEND_TEST(VirtualTableTests, test_yield_generator);
+  FRIEND_TEST(VirtualTableTests, test_order_by_consumed);
 };
 
 /// Helper method to generate the virtual table CREATE statement.
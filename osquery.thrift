@@ -51,6 +51,60 @@ struct ExtensionResponse {
   2:ExtensionPluginResponse response,
 }
 
+/// A constraint on a column, the op is an osquery ConstraintOperator.
+struct ExtensionConstraint {
+  1:i32 op,
+  2:string expr,
+}
+
+/// The constraints on a column and the column's SQLite affinity.
+struct ExtensionConstraintList {
+  1:string affinity,
+  2:list<ExtensionConstraint> constraints,
+}
+
+/// A column used to order a query's results.
+struct ExtensionOrderBy {
+  1:string name,
+  2:bool desc,
+}
+
+/// A structured query context, replacing the JSON "context" request.
+struct ExtensionQueryContext {
+  1:map<string, ExtensionConstraintList> constraints,
+  /// The columns used by the query, every column is used if unset.
+  2:optional set<string> colsUsed,
+  3:list<ExtensionOrderBy> orderBy,
+}
+
+/// The cells of a table column, only the list matching the type is used.
+struct ExtensionColumn {
+  1:string name,
+  /// The column type name, such as TEXT, BIGINT, or DOUBLE.
+  2:string type,
+  /// Set for each NULL cell, empty if the column has no NULL cells.
+  3:list<bool> nulls,
+  4:list<i64> integers,
+  5:list<double> doubles,
+  6:list<string> texts,
+  /// Text that numeric cells were set from, by row, see TableRows::getSource.
+  7:map<i64, string> sources,
+}
+
+/// Unique ID for each open table cursor.
+typedef i64 ExtensionTableCursor
+
+/// Table rows as typed columns, each column name is sent once.
+struct ExtensionTableResponse {
+  1:ExtensionStatus status,
+  2:i64 rows,
+  3:list<ExtensionColumn> columns,
+  /// The table cursor returning the rows, used by openTable and nextRows.
+  4:ExtensionTableCursor cursor,
+  /// Set when the cursor has no more rows, it is then closed.
+  5:bool done,
+}
+
 exception ExtensionException {
   1:i32 code,
   2:string message,
@@ -70,6 +124,25 @@ service Extension {
     3:ExtensionPluginRequest request),
   /// Request that an extension shutdown (does not apply to managers).
   void shutdown(),
+  /// Generate a table's rows as typed columns.
+  ExtensionTableResponse generateTable(
+    /// The table name (table registry plugin name).
+    1:string table,
+    /// The query context used to generate the rows.
+    2:ExtensionQueryContext context),
+  /// Open a cursor over a table's rows and return the first batch.
+  ExtensionTableResponse openTable(
+    1:string table,
+    2:ExtensionQueryContext context,
+    /// The most rows to return.
+    3:i64 batch),
+  /// Return the next batch of rows from an open table cursor.
+  ExtensionTableResponse nextRows(
+    1:ExtensionTableCursor cursor,
+    2:i64 batch),
+  /// Close a table cursor before all of its rows were read.
+  ExtensionStatus closeTable(
+    1:ExtensionTableCursor cursor),
 }
 
 /// The extension manager is run by the osquery core process.
@@ -12,6 +12,7 @@
 #include <chrono>
 #include <functional>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -103,6 +104,10 @@ DECLARE_string(pack_delimiter);
  * The config maintains schedule statistics and tracks failed executions.
  * On process or worker resume an initializer or config may check if the
  * resume was the result of a failure during an executing query.
+ *
+ * Each executing query is stored as a key with this prefix followed by a '.'
+ * and the query name. The bare key is only read, as it was written by
+ * versions that ran a single query at a time.
  */
 const std::string kExecutingQuery{"executing_query"};
 const std::string kFailedQueries{"failed_queries"};
@@ -110,6 +115,9 @@ const std::string kFailedQueries{"failed_queries"};
 /// The time osquery was started.
 std::atomic<size_t> kStartTime;
 
+/// The scheduled query executing on the current thread.
+thread_local std::string kThreadExecutingQuery;
+
 // The config may be accessed and updated asynchronously; use mutexes.
 Mutex config_hash_mutex_;
 Mutex config_refresh_mutex_;
@@ -180,10 +188,10 @@ class Schedule : private boost::noncopyable {
   /**
    * @brief The schedule will check and record previously executing queries.
    *
-   * If a query is found on initialization, the name will be recorded, it is
-   * possible to skip previously failed queries.
+   * If queries are found on initialization, their names will be recorded, it
+   * is possible to skip previously failed queries.
    */
-  std::string failed_query_;
+  std::set<std::string> failed_queries_;
 
   /**
    * @brief List of blacklisted queries.
@@ -304,6 +312,26 @@ void saveScheduleBlacklist(const std::map<std::string, size_t>& blacklist) {
   setDatabaseValue(kPersistentSettings, kFailedQueries, content);
 }
 
+void restoreExecutingQueries(std::set<std::string>& queries) {
+  // Scheduled queries run concurrently, each has its own executing key.
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kPersistentSettings, keys, kExecutingQuery + ".");
+  for (const auto& key : keys) {
+    auto name = key.substr(kExecutingQuery.size() + 1);
+    if (!name.empty()) {
+      queries.insert(name);
+    }
+  }
+
+  std::string query_name;
+  getDatabaseValue(kPersistentSettings, kExecutingQuery, query_name);
+  if (!query_name.empty()) {
+    queries.insert(query_name);
+    keys.push_back(kExecutingQuery);
+  }
+  deleteDatabaseBatch(kPersistentSettings, keys);
+}
+
 Schedule::Schedule() {
   if (RegistryFactory::get().external()) {
     // Extensions should not restore or save schedule details.
@@ -313,12 +341,14 @@ Schedule::Schedule() {
   restoreScheduleBlacklist(blacklist_);
 
   // Check if any queries were executing when the tool last stopped.
-  getDatabaseValue(kPersistentSettings, kExecutingQuery, failed_query_);
-  if (!failed_query_.empty()) {
-    LOG(WARNING) << "Scheduled query may have failed: " << failed_query_;
-    setDatabaseValue(kPersistentSettings, kExecutingQuery, "");
-    // Add this query name to the blacklist and save the blacklist.
-    blacklist_[failed_query_] = getUnixTime() + 86400;
+  restoreExecutingQueries(failed_queries_);
+  if (!failed_queries_.empty()) {
+    auto expire = getUnixTime() + 86400;
+    for (const auto& query_name : failed_queries_) {
+      LOG(WARNING) << "Scheduled query may have failed: " << query_name;
+      // Add this query name to the blacklist.
+      blacklist_[query_name] = expire;
+    }
     saveScheduleBlacklist(blacklist_);
   }
 }
@@ -909,10 +939,10 @@ void ConfigParserPlugin::reset() {
 }
 
 void Config::recordQueryPerformance(const std::string& name,
-                                    size_t delay,
-                                    size_t size,
-                                    const Row& r0,
-                                    const Row& r1) {
+                                    const ResourceUsage& r0,
+                                    const ResourceUsage& r1,
+                                    size_t rows,
+                                    size_t size) {
   RecursiveLock lock(config_performance_mutex_);
   if (performance_.count(name) == 0) {
     performance_[name] = QueryPerformance();
@@ -920,47 +950,43 @@ void Config::recordQueryPerformance(const std::string& name,
 
   // Grab access to the non-const schedule item.
   auto& query = performance_.at(name);
-  if (!r1.at("user_time").empty() && !r0.at("user_time").empty()) {
-    auto ut1 = tryTo<long long>(r1.at("user_time"));
-    auto ut0 = tryTo<long long>(r0.at("user_time"));
-    auto diff = (ut1 && ut0) ? ut1.take() - ut0.take() : 0;
-    if (diff > 0) {
-      query.user_time += diff;
-    }
+  if (r1.user_time_ns > r0.user_time_ns) {
+    query.user_time_ns += r1.user_time_ns - r0.user_time_ns;
   }
 
-  if (!r1.at("system_time").empty() && !r0.at("system_time").empty()) {
-    auto st1 = tryTo<long long>(r1.at("system_time"));
-    auto st0 = tryTo<long long>(r0.at("system_time"));
-    auto diff = (st1 && st0) ? st1.take() - st0.take() : 0;
-    if (diff > 0) {
-      query.system_time += diff;
-    }
+  if (r1.system_time_ns > r0.system_time_ns) {
+    query.system_time_ns += r1.system_time_ns - r0.system_time_ns;
   }
 
-  if (!r1.at("resident_size").empty() && !r0.at("resident_size").empty()) {
-    auto rs1 = tryTo<long long>(r1.at("resident_size"));
-    auto rs0 = tryTo<long long>(r0.at("resident_size"));
-    auto diff = (rs1 && rs0) ? rs1.take() - rs0.take() : 0;
-    if (diff > 0) {
-      // Memory is stored as an average of RSS changes between query executions.
-      query.average_memory = (query.average_memory * query.executions) + diff;
-      query.average_memory = (query.average_memory / (query.executions + 1));
-    }
+  if (r1.wall_time_ns > r0.wall_time_ns) {
+    query.wall_time_ns += r1.wall_time_ns - r0.wall_time_ns;
   }
 
-  query.wall_time += delay;
+  if (r0.resident_size > 0 && r1.resident_size > r0.resident_size) {
+    // Memory is stored as an average of RSS changes between query executions.
+    auto diff = r1.resident_size - r0.resident_size;
+    query.average_memory = (query.average_memory * query.executions) + diff;
+    query.average_memory = (query.average_memory / (query.executions + 1));
+  }
+
+  // The coarse totals are derived from the nanosecond totals.
+  query.wall_time = query.wall_time_ns / 1000000000ULL;
+  query.user_time = query.user_time_ns / 1000000ULL;
+  query.system_time = query.system_time_ns / 1000000ULL;
   query.output_size += size;
+  query.output_rows += rows;
   query.executions += 1;
   query.last_executed = getUnixTime();
 
   // Clear the executing query (remove the dirty bit).
-  setDatabaseValue(kPersistentSettings, kExecutingQuery, "");
+  deleteDatabaseValue(kPersistentSettings, kExecutingQuery + "." + name);
+  kThreadExecutingQuery.clear();
 }
 
 void Config::recordQueryStart(const std::string& name) {
-  // There should only ever be a single executing query in the schedule.
-  setDatabaseValue(kPersistentSettings, kExecutingQuery, name);
+  // Set a dirty bit for this query, other queries may be executing.
+  setDatabaseValue(kPersistentSettings, kExecutingQuery + "." + name, "");
+  kThreadExecutingQuery = name;
   // Store the time this query name last executed for later results eviction.
   // When configuration updates occur the previous schedule is searched for
   // 'stale' query names, aka those that have week-old or longer last execute
@@ -969,6 +995,10 @@ void Config::recordQueryStart(const std::string& name) {
       kPersistentSettings, "timestamp." + name, std::to_string(getUnixTime()));
 }
 
+std::string Config::getExecutingQuery() const {
+  return kThreadExecutingQuery;
+}
+
 void Config::getPerformanceStats(
     const std::string& name,
     std::function<void(const QueryPerformance& query)> predicate) const {
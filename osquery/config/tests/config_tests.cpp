@@ -9,12 +9,14 @@
  */
 
 #include <memory>
+#include <set>
 #include <vector>
 
 #include <gtest/gtest.h>
 
 #include <osquery/config.h>
 #include <osquery/core.h>
+#include <osquery/database.h>
 #include <osquery/filesystem.h>
 #include <osquery/flags.h>
 #include <osquery/packs.h>
@@ -38,6 +40,7 @@ const std::string kConfigTestNonBlacklistQuery{
 extern void restoreScheduleBlacklist(std::map<std::string, size_t>& blacklist);
 extern void saveScheduleBlacklist(
     const std::map<std::string, size_t>& blacklist);
+extern void restoreExecutingQueries(std::set<std::string>& queries);
 
 class ConfigTests : public testing::Test {
  public:
@@ -199,6 +202,33 @@ TEST_F(ConfigTests, test_schedule_blacklist) {
   EXPECT_EQ(blacklist.size(), 1U);
 }
 
+TEST_F(ConfigTests, test_executing_queries) {
+  // Queries started concurrently each leave a dirty bit.
+  get().recordQueryStart("test_executing_1");
+  get().recordQueryStart("test_executing_2");
+  get().recordQueryStart("test_executing_3");
+  EXPECT_EQ(get().getExecutingQuery(), "test_executing_3");
+
+  // A completed query clears only its own dirty bit.
+  get().recordQueryPerformance("test_executing_2", {}, {}, 0, 0);
+  EXPECT_TRUE(get().getExecutingQuery().empty());
+
+  // A dirty bit written by a single-threaded schedule is also restored.
+  setDatabaseValue(kPersistentSettings, kExecutingQuery, "test_executing_4");
+
+  std::set<std::string> queries;
+  restoreExecutingQueries(queries);
+  EXPECT_EQ(queries.size(), 3U);
+  EXPECT_EQ(queries.count("test_executing_1"), 1U);
+  EXPECT_EQ(queries.count("test_executing_3"), 1U);
+  EXPECT_EQ(queries.count("test_executing_4"), 1U);
+
+  // The dirty bits are removed once restored.
+  queries.clear();
+  restoreExecutingQueries(queries);
+  EXPECT_TRUE(queries.empty());
+}
+
 TEST_F(ConfigTests, test_pack_noninline) {
   auto& rf = RegistryFactory::get();
   rf.registry("config")->add("test", std::make_shared<TestConfigPlugin>());
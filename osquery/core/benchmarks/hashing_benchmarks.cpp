@@ -0,0 +1,138 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <osquery/filesystem.h>
+
+#include "osquery/core/hashing.h"
+#include "osquery/tests/test_util.h"
+
+namespace fs = boost::filesystem;
+
+namespace osquery {
+
+/// All of the supported digests, as the hash table requests.
+const int kBenchmarkHashMask =
+    HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256;
+
+/// Write count files of size bytes and return their paths.
+static std::vector<std::string> benchmarkHashFiles(size_t count, size_t size) {
+  auto directory = fs::path(kTestWorkingDirectory) / "benchmark-hashing";
+  fs::create_directories(directory);
+
+  std::vector<std::string> paths;
+  std::string content(size, 'A');
+  for (size_t i = 0; i < count; i++) {
+    auto path = directory / std::to_string(i);
+    content[i % size] = static_cast<char>(i);
+    writeTextFile(path, content);
+    paths.push_back(path.string());
+  }
+  return paths;
+}
+
+static void benchmarkHashCleanup() {
+  removePath(fs::path(kTestWorkingDirectory) / "benchmark-hashing");
+}
+
+/// The previous implementation, 4k reads updating each digest in turn.
+static MultiHashes legacyHashMultiFromFile(int mask, const std::string& path) {
+  Hash md5(HASH_TYPE_MD5);
+  Hash sha1(HASH_TYPE_SHA1);
+  Hash sha256(HASH_TYPE_SHA256);
+
+  auto s = readFile(path,
+                    0,
+                    4096,
+                    false,
+                    true,
+                    ([&](std::string& buffer, size_t size) {
+                      md5.update(&buffer[0], size);
+                      sha1.update(&buffer[0], size);
+                      sha256.update(&buffer[0], size);
+                    }),
+                    false);
+
+  MultiHashes mh = {};
+  if (s.ok()) {
+    mh.mask = mask;
+    mh.md5 = md5.digest();
+    mh.sha1 = sha1.digest();
+    mh.sha256 = sha256.digest();
+  }
+  return mh;
+}
+
+static void CORE_hash_file_legacy(benchmark::State& state) {
+  auto size = static_cast<size_t>(state.range(0));
+  auto paths = benchmarkHashFiles(1, size);
+
+  while (state.KeepRunning()) {
+    auto hashes = legacyHashMultiFromFile(kBenchmarkHashMask, paths[0]);
+    benchmark::DoNotOptimize(hashes);
+  }
+
+  state.SetBytesProcessed(state.iterations() * size);
+  benchmarkHashCleanup();
+}
+
+BENCHMARK(CORE_hash_file_legacy)->Arg(64 * 1024)->Arg(16 * 1024 * 1024);
+
+static void CORE_hash_file(benchmark::State& state) {
+  auto size = static_cast<size_t>(state.range(0));
+  auto paths = benchmarkHashFiles(1, size);
+
+  while (state.KeepRunning()) {
+    auto hashes = hashMultiFromFile(kBenchmarkHashMask, paths[0]);
+    benchmark::DoNotOptimize(hashes);
+  }
+
+  state.SetBytesProcessed(state.iterations() * size);
+  benchmarkHashCleanup();
+}
+
+BENCHMARK(CORE_hash_file)->Arg(64 * 1024)->Arg(16 * 1024 * 1024);
+
+static void CORE_hash_files_legacy(benchmark::State& state) {
+  size_t size = 256 * 1024;
+  auto paths = benchmarkHashFiles(64, size);
+
+  while (state.KeepRunning()) {
+    for (const auto& path : paths) {
+      auto hashes = legacyHashMultiFromFile(kBenchmarkHashMask, path);
+      benchmark::DoNotOptimize(hashes);
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * paths.size() * size);
+  benchmarkHashCleanup();
+}
+
+BENCHMARK(CORE_hash_files_legacy);
+
+static void CORE_hash_files(benchmark::State& state) {
+  size_t size = 256 * 1024;
+  auto paths = benchmarkHashFiles(64, size);
+  auto threads = static_cast<size_t>(state.range(0));
+
+  while (state.KeepRunning()) {
+    auto hashes = hashMultiFromFiles(kBenchmarkHashMask, paths, threads);
+    benchmark::DoNotOptimize(hashes);
+  }
+
+  state.SetBytesProcessed(state.iterations() * paths.size() * size);
+  benchmarkHashCleanup();
+}
+
+BENCHMARK(CORE_hash_files)->Arg(1)->Arg(4)->Arg(8);
+} // namespace osquery
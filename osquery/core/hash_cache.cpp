@@ -0,0 +1,343 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+// clang-format off
+#include <sys/types.h>
+#include <sys/stat.h>
+// clang-format on
+
+#include <ctime>
+#include <vector>
+
+#include <osquery/database.h>
+#include <osquery/flags.h>
+#include <osquery/logger.h>
+
+#include "osquery/core/conversions.h"
+#include "osquery/core/hash_cache.h"
+
+namespace osquery {
+
+FLAG(bool,
+     disable_hash_cache,
+     false,
+     "Cache calculated file hashes, re-calculate only if inode times change");
+
+FLAG(uint32, hash_cache_max, 500, "Size of LRU file hash cache");
+
+FLAG(bool,
+     hash_cache_persist,
+     true,
+     "Store calculated file hashes in the database across restarts");
+
+FLAG(uint64,
+     hash_cache_expiry,
+     7 * 24 * 60 * 60,
+     "Seconds before an unused stored file hash is removed");
+
+/// Stored entries are marked as used at most this often, in seconds.
+const int64_t kHashCacheTouchInterval{24 * 60 * 60};
+
+/// How often stored entries are checked for expiration.
+const std::chrono::hours kHashCacheExpireInterval{1};
+
+/// The number of stored entries read at once while expiring.
+const size_t kHashCacheScanSize{1024};
+
+#if defined(WIN32)
+
+#define stat _stat
+
+#endif
+
+Status getFileIdentity(const std::string& path, FileIdentity& identity) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return Status(1, "Cannot stat file: " + path);
+  }
+
+  if (st.st_ino == 0) {
+    identity.key = "path." + path;
+  } else {
+    identity.key = std::to_string(st.st_dev) + "." + std::to_string(st.st_ino);
+  }
+
+  identity.mtime = static_cast<int64_t>(st.st_mtime);
+  identity.ctime = static_cast<int64_t>(st.st_ctime);
+#if defined(__APPLE__)
+  identity.mtime_nsec = static_cast<int64_t>(st.st_mtimespec.tv_nsec);
+  identity.ctime_nsec = static_cast<int64_t>(st.st_ctimespec.tv_nsec);
+#elif !defined(WIN32)
+  identity.mtime_nsec = static_cast<int64_t>(st.st_mtim.tv_nsec);
+  identity.ctime_nsec = static_cast<int64_t>(st.st_ctim.tv_nsec);
+#endif
+  identity.size = static_cast<int64_t>(st.st_size);
+  return Status(0);
+}
+
+/// Serialize an entry's identity, times, and hashes for the database.
+static std::string serializeEntry(const FileIdentity& identity,
+                                  int64_t hashed,
+                                  int64_t used,
+                                  const MultiHashes& hashes) {
+  return std::to_string(identity.mtime) + "," +
+         std::to_string(identity.mtime_nsec) + "," +
+         std::to_string(identity.ctime) + "," +
+         std::to_string(identity.ctime_nsec) + "," +
+         std::to_string(identity.size) + "," + std::to_string(hashed) + "," +
+         std::to_string(used) + "," + hashes.md5 + "," + hashes.sha1 + "," +
+         hashes.sha256;
+}
+
+/// Parse a stored entry, the identity key is not part of the value.
+static bool deserializeEntry(const std::string& value,
+                             FileIdentity& identity,
+                             int64_t& hashed,
+                             int64_t& used,
+                             MultiHashes& hashes) {
+  // Entries stored before the ctime was part of the identity do not parse,
+  // they are hashed again and removed by expire.
+  auto fields = split(value, ",");
+  if (fields.size() != 10) {
+    return false;
+  }
+
+  int64_t numbers[7];
+  for (size_t i = 0; i < 7; i++) {
+    auto number = tryTo<int64_t>(fields[i]);
+    if (number.isError()) {
+      return false;
+    }
+    numbers[i] = number.take();
+  }
+
+  identity.mtime = numbers[0];
+  identity.mtime_nsec = numbers[1];
+  identity.ctime = numbers[2];
+  identity.ctime_nsec = numbers[3];
+  identity.size = numbers[4];
+  hashed = numbers[5];
+  used = numbers[6];
+  hashes.mask = HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256;
+  hashes.md5 = std::move(fields[7]);
+  hashes.sha1 = std::move(fields[8]);
+  hashes.sha256 = std::move(fields[9]);
+  return true;
+}
+
+/// Hashes are stored only while the database is available.
+static bool persistHashes() {
+  return FLAGS_hash_cache_persist && DatabasePlugin::kDBInitialized;
+}
+
+FileHashCache& FileHashCache::get() {
+  static FileHashCache cache;
+  return cache;
+}
+
+FileHashCache::FileHashCache()
+    : last_expire_(std::chrono::steady_clock::now()) {}
+
+bool FileHashCache::lookup(const FileIdentity& identity,
+                           bool exact,
+                           MultiHashes& hashes,
+                           bool& touch,
+                           Entry& touched) {
+  auto now = static_cast<int64_t>(std::time(nullptr));
+  auto it = index_.find(identity.key);
+  if (it != index_.end()) {
+    auto& entry = *it->second;
+    if (entry.identity != identity) {
+      entries_.erase(it->second);
+      index_.erase(it);
+      return false;
+    }
+
+    if (exact && entry.hashed <= entry.identity.mtime) {
+      return false;
+    }
+
+    hashes = entry.hashes;
+    if (now - entry.used >= kHashCacheTouchInterval) {
+      entry.used = now;
+      touched = entry;
+      touch = true;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return true;
+  }
+
+  if (!persistHashes()) {
+    return false;
+  }
+
+  std::string value;
+  if (!getDatabaseValue(kFileHashes, identity.key, value).ok()) {
+    return false;
+  }
+
+  Entry entry;
+  entry.identity.key = identity.key;
+  if (!deserializeEntry(
+          value, entry.identity, entry.hashed, entry.used, entry.hashes) ||
+      entry.identity != identity) {
+    return false;
+  }
+
+  if (exact && entry.hashed <= entry.identity.mtime) {
+    return false;
+  }
+
+  hashes = entry.hashes;
+  if (now - entry.used >= kHashCacheTouchInterval) {
+    entry.used = now;
+    touched = entry;
+    touch = true;
+  }
+  remember(std::move(entry));
+  return true;
+}
+
+void FileHashCache::remember(Entry entry) {
+  auto it = index_.find(entry.identity.key);
+  if (it != index_.end()) {
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+
+  if (FLAGS_hash_cache_max == 0) {
+    return;
+  }
+
+  while (entries_.size() >= FLAGS_hash_cache_max) {
+    index_.erase(entries_.back().identity.key);
+    entries_.pop_back();
+  }
+
+  auto key = entry.identity.key;
+  entries_.push_front(std::move(entry));
+  index_[key] = entries_.begin();
+}
+
+void FileHashCache::store(const Entry& entry) {
+  if (!persistHashes()) {
+    return;
+  }
+
+  auto value =
+      serializeEntry(entry.identity, entry.hashed, entry.used, entry.hashes);
+  auto status = setDatabaseValue(kFileHashes, entry.identity.key, value);
+  if (!status.ok()) {
+    VLOG(1) << "Cannot store file hash: " << status.getMessage();
+  }
+}
+
+Status FileHashCache::load(const std::string& path,
+                           MultiHashes& hashes,
+                           bool exact) {
+  FileIdentity identity;
+  auto status = getFileIdentity(path, identity);
+  if (!status.ok()) {
+    return status;
+  }
+
+  bool expire_due = false;
+  {
+    bool touch = false;
+    Entry touched;
+    WriteLock lock(mutex_);
+    if (lookup(identity, exact, hashes, touch, touched)) {
+      lock.unlock();
+      if (touch) {
+        store(touched);
+      }
+      return Status(0);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (persistHashes() && now - last_expire_ >= kHashCacheExpireInterval) {
+      last_expire_ = now;
+      expire_due = true;
+    }
+  }
+
+  if (expire_due) {
+    expire();
+  }
+
+  // Hash without holding the lock so several files may be hashed at once.
+  auto hashed = static_cast<int64_t>(std::time(nullptr));
+  hashes = hashMultiFromFile(
+      HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
+  misses_++;
+  if (hashes.md5.empty()) {
+    return Status(0);
+  }
+
+  // Only cache the hashes if the file did not change while it was read.
+  FileIdentity after;
+  if (!getFileIdentity(path, after).ok() || after != identity) {
+    return Status(0);
+  }
+
+  Entry entry;
+  entry.identity = std::move(identity);
+  entry.hashes = hashes;
+  entry.hashed = hashed;
+  entry.used = hashed;
+
+  store(entry);
+
+  WriteLock lock(mutex_);
+  remember(std::move(entry));
+  return Status(0);
+}
+
+void FileHashCache::expire() {
+  auto expired_before = static_cast<int64_t>(std::time(nullptr)) -
+                        static_cast<int64_t>(FLAGS_hash_cache_expiry);
+
+  std::string start;
+  while (true) {
+    DatabaseStringValueList values;
+    {
+      WriteLock lock(mutex_);
+      auto status = scanDatabaseValues(
+          kFileHashes, values, "", start, kHashCacheScanSize);
+      if (!status.ok() || values.empty()) {
+        break;
+      }
+
+      for (const auto& key_value : values) {
+        FileIdentity identity;
+        MultiHashes hashes;
+        int64_t hashed = 0;
+        int64_t used = 0;
+        if (!deserializeEntry(
+                key_value.second, identity, hashed, used, hashes) ||
+            used < expired_before) {
+          deleteDatabaseValue(kFileHashes, key_value.first);
+        }
+      }
+    }
+
+    if (values.size() < kHashCacheScanSize) {
+      break;
+    }
+    start = values.back().first + '\0';
+  }
+}
+
+void FileHashCache::clear() {
+  WriteLock lock(mutex_);
+  entries_.clear();
+  index_.clear();
+}
+} // namespace osquery
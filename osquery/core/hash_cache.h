@@ -0,0 +1,166 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/noncopyable.hpp>
+
+#include <osquery/core.h>
+#include <osquery/mutex.h>
+
+#include "osquery/core/hashing.h"
+
+namespace osquery {
+
+/**
+ * @brief The identity of a file's content as seen by stat.
+ *
+ * Files are keyed by device and inode. A cached hash is used only while the
+ * file's mtime, ctime, and size match the values seen when it was hashed.
+ * The mtime may be set by users and is kept by package managers and copies,
+ * the ctime is updated by the kernel on every write and cannot be set.
+ */
+struct FileIdentity {
+  /// The device and inode, or the path if the platform has no inodes.
+  std::string key;
+
+  /// The modification time in seconds.
+  int64_t mtime{0};
+
+  /// The nanoseconds within the modification time, if available.
+  int64_t mtime_nsec{0};
+
+  /// The inode change time in seconds.
+  int64_t ctime{0};
+
+  /// The nanoseconds within the inode change time, if available.
+  int64_t ctime_nsec{0};
+
+  /// The file size.
+  int64_t size{0};
+
+  bool operator==(const FileIdentity& other) const {
+    return key == other.key && mtime == other.mtime &&
+           mtime_nsec == other.mtime_nsec && ctime == other.ctime &&
+           ctime_nsec == other.ctime_nsec && size == other.size;
+  }
+
+  bool operator!=(const FileIdentity& other) const {
+    return !(*this == other);
+  }
+};
+
+/// Stat a path and fill in its identity.
+Status getFileIdentity(const std::string& path, FileIdentity& identity);
+
+/**
+ * @brief A two tier cache of file content hashes.
+ *
+ * The hash table and file event hashing share this cache. Recently used hashes
+ * are kept in a memory tier of at most hash_cache_max entries. Every hash is
+ * also stored in the kFileHashes database domain, so unchanged files are not
+ * hashed again after a restart. Stored hashes that have not been used within
+ * hash_cache_expiry seconds are removed.
+ *
+ * The cache is thread safe, files are hashed without holding its lock.
+ */
+class FileHashCache : private boost::noncopyable {
+ public:
+  /// The process-wide cache.
+  static FileHashCache& get();
+
+  /**
+   * @brief Return the MD5, SHA1, and SHA256 hashes of a file.
+   *
+   * The file is hashed only when its identity has no cached hashes.
+   *
+   * The mtime has a resolution of seconds, a file written again within the
+   * second it was hashed keeps its identity. File events request exact hashes,
+   * which ignore cached hashes taken within the second of the file's mtime.
+   *
+   * @param path The file to hash.
+   * @param hashes The output hashes.
+   * @param exact Do not use hashes that may predate a write in the same second.
+   * @return Failure if the file could not be stat'd.
+   */
+  Status load(const std::string& path,
+              MultiHashes& hashes,
+              bool exact = false);
+
+  /// Remove stored hashes not used within hash_cache_expiry seconds.
+  void expire();
+
+  /// Drop the memory tier, stored hashes are kept.
+  void clear();
+
+  /// The number of files hashed, that were not found in either tier.
+  size_t misses() const {
+    return misses_;
+  }
+
+ private:
+  FileHashCache();
+
+  struct Entry {
+    FileIdentity identity;
+    MultiHashes hashes;
+
+    /// When the file was hashed.
+    int64_t hashed{0};
+
+    /// When the stored copy was last marked as used.
+    int64_t used{0};
+  };
+
+  using EntryList = std::list<Entry>;
+
+  /**
+   * @brief Find a valid entry and mark it as recently used.
+   *
+   * If the stored copy should be marked as used, touch is set and touched is
+   * a copy of the entry to store once the lock is released.
+   */
+  bool lookup(const FileIdentity& identity,
+              bool exact,
+              MultiHashes& hashes,
+              bool& touch,
+              Entry& touched);
+
+  /// Add an entry to the memory tier, evicting the least recently used.
+  void remember(Entry entry);
+
+  /// Persist an entry to the database domain, without holding the lock.
+  void store(const Entry& entry);
+
+ private:
+  /// Entries ordered by use, the most recent first.
+  EntryList entries_;
+
+  /// Entries by identity key.
+  std::unordered_map<std::string, EntryList::iterator> index_;
+
+  /// When stored hashes were last expired.
+  std::chrono::steady_clock::time_point last_expire_;
+
+  /// The number of files hashed.
+  std::atomic<size_t> misses_{0};
+
+  /// Protects the memory tier and access to the database domain.
+  Mutex mutex_;
+};
+} // namespace osquery
@@ -8,25 +8,138 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#ifdef __linux__
+#include <fcntl.h>
+#endif
+
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <iomanip>
+#include <memory>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include <boost/noncopyable.hpp>
+
 #include <openssl/md5.h>
 #include <openssl/sha.h>
 
 #include <osquery/core.h>
 #include <osquery/filesystem.h>
+#include <osquery/flags.h>
+#include <osquery/logger.h>
 #include <osquery/status.h>
 
 #include "osquery/core/hashing.h"
+#include "osquery/filesystem/fileops.h"
 
 namespace osquery {
 
+DECLARE_uint64(read_max);
+DECLARE_bool(disable_forensic);
+
 /// The buffer read size from file IO to hashing structures.
-const size_t kHashChunkSize{4096};
+const size_t kHashChunkSize{256 * 1024};
+
+/// The alignment of the read buffers.
+const size_t kHashBufferAlignment{4096};
+
+/// Files of at least this size update each digest in a separate lane.
+const size_t kHashLaneMinSize{4 * kHashChunkSize};
+
+/**
+ * @brief Return one of a thread's two page-aligned read buffers.
+ *
+ * The buffers are kept for the life of the thread so hashing many small files
+ * does not allocate and fault a new buffer per file.
+ */
+static char* getHashBuffer(size_t index) {
+  static thread_local std::vector<char> storage;
+  if (storage.empty()) {
+    storage.resize(2 * kHashChunkSize + kHashBufferAlignment);
+  }
+
+  void* buffer = storage.data();
+  auto space = storage.size();
+  std::align(kHashBufferAlignment, 2 * kHashChunkSize, buffer, space);
+  return static_cast<char*>(buffer) + (index % 2) * kHashChunkSize;
+}
+
+/// Set on the workers of hashMultiFromFiles, which hash digests in turn.
+static thread_local bool kHashPoolWorker{false};
+
+namespace {
+
+/**
+ * @brief A digest updated on its own thread, one chunk at a time.
+ *
+ * The thread is started once per file and is handed each chunk, rather than
+ * starting a thread for every chunk.
+ */
+class HashLane : private boost::noncopyable {
+ public:
+  explicit HashLane(Hash& hash) : hash_(hash), thread_([this]() { run(); }) {}
+
+  ~HashLane() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+  }
+
+  /// Start updating the digest, the buffer must not change until wait.
+  void update(const char* buffer, size_t size) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      buffer_ = buffer;
+      size_ = size;
+      busy_ = true;
+    }
+    condition_.notify_all();
+  }
+
+  /// Wait for the last update to finish.
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() { return !busy_; });
+  }
+
+ private:
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      condition_.wait(lock, [this]() { return busy_ || stop_; });
+      if (!busy_) {
+        return;
+      }
+
+      lock.unlock();
+      hash_.update(buffer_, size_);
+      lock.lock();
+      busy_ = false;
+      condition_.notify_all();
+    }
+  }
+
+ private:
+  Hash& hash_;
+  const char* buffer_{nullptr};
+  size_t size_{0};
+  bool busy_{false};
+  bool stop_{false};
+  std::mutex mutex_;
+  std::condition_variable condition_;
+
+  /// Started last, once the other members are initialized.
+  std::thread thread_;
+};
+} // namespace
 
 Hash::~Hash() {
   if (ctx_ != nullptr) {
@@ -92,45 +205,141 @@ std::string hashFromBuffer(HashType hash_type,
 }
 
 MultiHashes hashMultiFromFile(int mask, const std::string& path) {
-  std::map<HashType, std::shared_ptr<Hash>> hashes = {
-      {HASH_TYPE_MD5, std::make_shared<Hash>(HASH_TYPE_MD5)},
-      {HASH_TYPE_SHA1, std::make_shared<Hash>(HASH_TYPE_SHA1)},
-      {HASH_TYPE_SHA256, std::make_shared<Hash>(HASH_TYPE_SHA256)},
-  };
+  MultiHashes mh = {};
 
-  auto blocking = isPlatform(PlatformType::TYPE_WINDOWS);
-  auto s = readFile(path,
-                    0,
-                    kHashChunkSize,
-                    false,
-                    true,
-                    ([&hashes, &mask](std::string& buffer, size_t size) {
-                      for (auto& hash : hashes) {
-                        if (mask & hash.first) {
-                          hash.second->update(&buffer[0], size);
-                        }
-                      }
-                    }),
-                    blocking);
+  // Windows reads are only synchronous when the file is opened blocking.
+  int mode = PF_OPEN_EXISTING | PF_READ;
+  if (!isPlatform(PlatformType::TYPE_WINDOWS)) {
+    mode |= PF_NONBLOCK;
+  }
 
-  MultiHashes mh = {};
-  if (!s.ok()) {
+  PlatformFile file(path, mode);
+  if (!file.isValid()) {
     return mh;
   }
 
-  mh.mask = mask;
-  if (mask & HASH_TYPE_MD5) {
-    mh.md5 = hashes.at(HASH_TYPE_MD5)->digest();
+  auto file_size = file.size();
+  if (file_size > FLAGS_read_max) {
+    LOG(WARNING) << "Cannot read file that exceeds size limit: " << path;
+    VLOG(1) << "Cannot read " << path << " size exceeds limit: " << file_size
+            << " > " << FLAGS_read_max;
+    return mh;
+  }
+
+#ifdef __linux__
+  // Ask for an aggressive readahead, the file is read once from start to end.
+  ::posix_fadvise(file.nativeHandle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  PlatformTime times;
+  file.getFileTimes(times);
+
+  std::vector<std::unique_ptr<Hash>> lanes;
+  for (auto type : {HASH_TYPE_MD5, HASH_TYPE_SHA1, HASH_TYPE_SHA256}) {
+    if (mask & type) {
+      lanes.emplace_back(new Hash(type));
+    }
+  }
+
+  // Large files update each digest after the first on its own thread, while
+  // the calling thread updates the first and reads the next chunk into the
+  // second buffer. Workers of a hashing pool already use the other cores.
+  bool parallel = lanes.size() > 1 && file_size >= kHashLaneMinSize &&
+                  !kHashPoolWorker &&
+                  std::thread::hardware_concurrency() > lanes.size();
+  std::vector<std::unique_ptr<HashLane>> workers;
+  if (parallel) {
+    for (size_t i = 1; i < lanes.size(); i++) {
+      workers.emplace_back(new HashLane(*lanes[i]));
+    }
+  }
+
+  size_t total_bytes = 0;
+  auto buffer = getHashBuffer(0);
+  auto bytes = file.read(buffer, kHashChunkSize);
+  for (size_t chunk = 1; bytes > 0; chunk++) {
+    auto size = static_cast<size_t>(bytes);
+    total_bytes += size;
+    if (total_bytes >= FLAGS_read_max) {
+      return mh;
+    }
+
+    // Do not hash content appended after the size was inspected.
+    bool overflow = file_size > 0 && total_bytes > file_size;
+    if (overflow) {
+      size -= total_bytes - file_size;
+    }
+
+    if (!parallel) {
+      for (auto& lane : lanes) {
+        lane->update(buffer, size);
+      }
+      bytes = (overflow) ? 0 : file.read(buffer, kHashChunkSize);
+      continue;
+    }
+
+    for (auto& worker : workers) {
+      worker->update(buffer, size);
+    }
+    lanes[0]->update(buffer, size);
+
+    auto next = getHashBuffer(chunk);
+    bytes = (overflow) ? 0 : file.read(next, kHashChunkSize);
+    for (auto& worker : workers) {
+      worker->wait();
+    }
+    buffer = next;
   }
-  if (mask & HASH_TYPE_SHA1) {
-    mh.sha1 = hashes.at(HASH_TYPE_SHA1)->digest();
+  workers.clear();
+
+  // Attempt to restore the atime and mtime before the file read.
+  if (!FLAGS_disable_forensic) {
+    file.setFileTimes(times);
   }
-  if (mask & HASH_TYPE_SHA256) {
-    mh.sha256 = hashes.at(HASH_TYPE_SHA256)->digest();
+
+  mh.mask = mask;
+  for (auto& lane : lanes) {
+    if (lane->algorithm() == HASH_TYPE_MD5) {
+      mh.md5 = lane->digest();
+    } else if (lane->algorithm() == HASH_TYPE_SHA1) {
+      mh.sha1 = lane->digest();
+    } else {
+      mh.sha256 = lane->digest();
+    }
   }
   return mh;
 }
 
+std::vector<MultiHashes> hashMultiFromFiles(
+    int mask,
+    const std::vector<std::string>& paths,
+    size_t threads,
+    const FileHashFunction& hasher) {
+  std::vector<MultiHashes> results(paths.size());
+  threads = std::max<size_t>(1, std::min(threads, paths.size()));
+
+  // Each worker takes the next path when it finishes one, so a few large
+  // files do not hold up the rest of the list.
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    kHashPoolWorker = threads > 1;
+    for (size_t i = next++; i < paths.size(); i = next++) {
+      results[i] = hasher(mask, paths[i]);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; i++) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  kHashPoolWorker = false;
+  for (auto& thread : workers) {
+    thread.join();
+  }
+  return results;
+}
+
 std::string hashFromFile(HashType hash_type, const std::string& path) {
   auto hashes = hashMultiFromFile(hash_type, path);
   if (hash_type == HASH_TYPE_MD5) {
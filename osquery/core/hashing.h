@@ -10,7 +10,9 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
+#include <vector>
 
 #include <boost/noncopyable.hpp>
 
@@ -81,6 +83,11 @@ class Hash : private boost::noncopyable {
    */
   std::string digest();
 
+  /// The hashing algorithm used by this context.
+  HashType algorithm() const {
+    return algorithm_;
+  }
+
  private:
   /**
    * @brief Private default constructor
@@ -113,6 +120,10 @@ std::string hashFromFile(HashType hash_type, const std::string& path);
 /**
  * @brief Compute multiple hashes from a files contents simultaneously.
  *
+ * The file is streamed through a page-aligned buffer with a sequential
+ * readahead hint. For large files each requested digest is updated on its own
+ * thread while the next chunk is read.
+ *
  * @param mask Bitmask specifying target osquery-supported algorithms.
  * @param path Filesystem path (the hash target).
  * @return A struct containing string (hex) representations
@@ -120,6 +131,25 @@ std::string hashFromFile(HashType hash_type, const std::string& path);
  */
 MultiHashes hashMultiFromFile(int mask, const std::string& path);
 
+/// A function that computes the hashes for a single file.
+using FileHashFunction =
+    std::function<MultiHashes(int mask, const std::string& path)>;
+
+/**
+ * @brief Compute multiple hashes for a list of files using several threads.
+ *
+ * @param mask Bitmask specifying target osquery-supported algorithms.
+ * @param paths Filesystem paths (the hash targets).
+ * @param threads The maximum number of files hashed at the same time.
+ * @param hasher Computes the hashes for each path, such as through a cache.
+ * @return The hashes for each path, in the order of paths.
+ */
+std::vector<MultiHashes> hashMultiFromFiles(
+    int mask,
+    const std::vector<std::string>& paths,
+    size_t threads,
+    const FileHashFunction& hasher = hashMultiFromFile);
+
 /**
  * @brief Compute a hash digest from the contents of a buffer.
  *
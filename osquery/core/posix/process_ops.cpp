@@ -8,10 +8,13 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <chrono>
+#include <cstdio>
 #include <string>
 
 #include <dlfcn.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <sys/resource.h>
 #include <sys/syscall.h>
@@ -19,6 +22,10 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
 #include <boost/optional.hpp>
 
 #include <osquery/flags.h>
@@ -84,6 +91,72 @@ bool isUserAdmin() {
   return getuid() == 0;
 }
 
+ResourceUsage getResourceUsage() {
+  ResourceUsage usage;
+  usage.wall_time_ns = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+
+#if defined(__APPLE__)
+  thread_basic_info_data_t thread_basic;
+  mach_msg_type_number_t thread_count = THREAD_BASIC_INFO_COUNT;
+  auto thread = mach_thread_self();
+  if (thread_info(thread,
+                  THREAD_BASIC_INFO,
+                  reinterpret_cast<thread_info_t>(&thread_basic),
+                  &thread_count) == KERN_SUCCESS) {
+    usage.user_time_ns =
+        static_cast<uint64_t>(thread_basic.user_time.seconds) * 1000000000ULL +
+        static_cast<uint64_t>(thread_basic.user_time.microseconds) * 1000ULL;
+    usage.system_time_ns =
+        static_cast<uint64_t>(thread_basic.system_time.seconds) *
+            1000000000ULL +
+        static_cast<uint64_t>(thread_basic.system_time.microseconds) * 1000ULL;
+  }
+  mach_port_deallocate(mach_task_self(), thread);
+#else
+  struct rusage ru;
+#ifdef RUSAGE_THREAD
+  auto who = RUSAGE_THREAD;
+#else
+  auto who = RUSAGE_SELF;
+#endif
+  if (getrusage(who, &ru) == 0) {
+    usage.user_time_ns =
+        static_cast<uint64_t>(ru.ru_utime.tv_sec) * 1000000000ULL +
+        static_cast<uint64_t>(ru.ru_utime.tv_usec) * 1000ULL;
+    usage.system_time_ns =
+        static_cast<uint64_t>(ru.ru_stime.tv_sec) * 1000000000ULL +
+        static_cast<uint64_t>(ru.ru_stime.tv_usec) * 1000ULL;
+  }
+#endif
+
+#if defined(__linux__)
+  // The second field of statm is the resident page count.
+  FILE* statm = fopen("/proc/self/statm", "r");
+  if (statm != nullptr) {
+    unsigned long long size = 0;
+    unsigned long long resident = 0;
+    if (fscanf(statm, "%llu %llu", &size, &resident) == 2) {
+      usage.resident_size =
+          resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+    fclose(statm);
+  }
+#elif defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(),
+                MACH_TASK_BASIC_INFO,
+                reinterpret_cast<task_info_t>(&info),
+                &count) == KERN_SUCCESS) {
+    usage.resident_size = info.resident_size;
+  }
+#endif
+  return usage;
+}
+
 int platformGetPid() {
   return static_cast<int>(getpid());
 }
@@ -9,7 +9,9 @@
  */
 
 #include <algorithm>
+#include <limits>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <osquery/database.h>
@@ -23,8 +25,17 @@ namespace rj = rapidjson;
 
 namespace osquery {
 
+FLAG(bool,
+     hashed_differentials,
+     true,
+     "Store scheduled query results with per-row hashes for differentials");
+
 DECLARE_bool(decorations_top_level);
 
+static Status serializeQueryDataHashed(const QueryData& q,
+                                       const std::vector<uint64_t>& hashes,
+                                       std::string& out);
+
 uint64_t Query::getPreviousEpoch() const {
   uint64_t epoch = 0;
   std::string raw;
@@ -56,7 +67,11 @@ Status Query::getPreviousQueryResults(QueryDataSet& results) const {
     return status;
   }
 
-  status = deserializeQueryDataJSON(raw, results);
+  if (isQueryDataHashed(raw)) {
+    status = deserializeQueryDataHashed(raw, results);
+  } else {
+    status = deserializeQueryDataJSON(raw, results);
+  }
   if (!status.ok()) {
     return status;
   }
@@ -121,16 +136,29 @@ Status Query::addNewResults(QueryData current_qd,
   // query data, otherwise the content is moved to the differential's added set.
   const auto* target_gd = &current_qd;
   bool update_db = true;
+  // Row hashes computed by the differential are reused when storing.
+  std::vector<uint64_t> hashes;
   if (!fresh_results && calculate_diff) {
     // Get the rows from the last run of this query name.
-    QueryDataSet previous_qd;
-    auto status = getPreviousQueryResults(previous_qd);
+    std::string previous;
+    auto status = getDatabaseValue(kQueries, name_, previous);
     if (!status.ok()) {
       return status;
     }
 
     // Calculate the differential between previous and current query results.
-    dr = diff(previous_qd, current_qd);
+    if (isQueryDataHashed(previous)) {
+      status = diffHashed(previous, current_qd, hashes, dr);
+    } else {
+      QueryDataSet previous_qd;
+      status = deserializeQueryDataJSON(previous, previous_qd);
+      if (status.ok()) {
+        dr = diff(previous_qd, current_qd);
+      }
+    }
+    if (!status.ok()) {
+      return status;
+    }
 
     update_db = (!dr.added.empty() || !dr.removed.empty());
   } else {
@@ -147,13 +175,17 @@ Status Query::addNewResults(QueryData current_qd,
 
   if (update_db) {
     // Replace the "previous" query data with the current.
-    std::string json;
-    status = serializeQueryDataJSON(*target_gd, json);
+    std::string content;
+    if (FLAGS_hashed_differentials) {
+      status = serializeQueryDataHashed(*target_gd, hashes, content);
+    } else {
+      status = serializeQueryDataJSON(*target_gd, content);
+    }
     if (!status.ok()) {
       return status;
     }
 
-    status = setDatabaseValue(kQueries, name_, json);
+    status = setDatabaseValue(kQueries, name_, content);
     if (!status.ok()) {
       return status;
     }
@@ -221,6 +253,380 @@ Status deserializeRowJSON(const std::string& json, Row& r) {
   return deserializeRow(doc.doc(), r);
 }
 
+/// Leading byte of a binary-serialized Row, never a JSON '{'.
+const char kRowBinaryVersion = 0x01;
+
+/// Binary Row value tags.
+enum RowBinaryTag : char {
+  kRowBinaryString = 0,
+  kRowBinaryInteger = 1,
+};
+
+size_t ColumnDictionary::add(const std::string& name) {
+  auto it = ordinals.find(name);
+  if (it != ordinals.end()) {
+    return it->second;
+  }
+
+  names.push_back(name);
+  ordinals[name] = names.size() - 1;
+  return names.size() - 1;
+}
+
+static inline void writeVarint(uint64_t value, std::string& out) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+static inline bool readVarint(const std::string& data,
+                              size_t& pos,
+                              uint64_t& value) {
+  value = 0;
+  for (size_t shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+    auto byte = static_cast<unsigned char>(data[pos++]);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static inline void writeBytes(const std::string& value, std::string& out) {
+  writeVarint(value.size(), out);
+  out.append(value);
+}
+
+static inline bool readBytes(const std::string& data,
+                             size_t& pos,
+                             std::string& value) {
+  uint64_t size = 0;
+  if (!readVarint(data, pos, size) || size > data.size() - pos) {
+    return false;
+  }
+  value.assign(data, pos, static_cast<size_t>(size));
+  pos += static_cast<size_t>(size);
+  return true;
+}
+
+/**
+ * @brief Parse a value that round-trips exactly as a base-10 int64.
+ *
+ * Leading zeros, a '+' sign, and "-0" are not canonical and must be stored
+ * as bytes to preserve the original string.
+ */
+static inline bool canonicalInteger(const std::string& value, int64_t& out) {
+  if (value.empty() || value.size() > 19) {
+    return false;
+  }
+
+  size_t i = (value[0] == '-') ? 1 : 0;
+  if (i == value.size() || (value[i] == '0' && value.size() > i + 1) ||
+      (i == 1 && value[i] == '0')) {
+    return false;
+  }
+
+  uint64_t magnitude = 0;
+  for (; i < value.size(); i++) {
+    if (value[i] < '0' || value[i] > '9') {
+      return false;
+    }
+    magnitude = magnitude * 10 + static_cast<uint64_t>(value[i] - '0');
+  }
+
+  if (magnitude > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+    return false;
+  }
+
+  out = (value[0] == '-') ? -static_cast<int64_t>(magnitude)
+                          : static_cast<int64_t>(magnitude);
+  return true;
+}
+
+Status serializeRowBinary(const Row& r,
+                          const ColumnDictionary& dict,
+                          std::string& out) {
+  out.clear();
+  out.push_back(kRowBinaryVersion);
+  for (const auto& column : r) {
+    // Ordinal 0 is reserved for columns outside of the dictionary.
+    auto it = dict.ordinals.find(column.first);
+    if (it != dict.ordinals.end()) {
+      writeVarint(it->second + 1, out);
+    } else {
+      writeVarint(0, out);
+      writeBytes(column.first, out);
+    }
+
+    int64_t integer = 0;
+    if (canonicalInteger(column.second, integer)) {
+      out.push_back(kRowBinaryInteger);
+      // Zigzag encode so small negative values remain small.
+      writeVarint((static_cast<uint64_t>(integer) << 1) ^
+                      static_cast<uint64_t>(integer >> 63),
+                  out);
+    } else {
+      out.push_back(kRowBinaryString);
+      writeBytes(column.second, out);
+    }
+  }
+  return Status();
+}
+
+Status deserializeRowBinary(const std::string& data,
+                            const ColumnDictionary& dict,
+                            Row& r) {
+  if (!isRowBinary(data)) {
+    return Status(1, "Cannot deserialize binary row");
+  }
+
+  size_t pos = 1;
+  while (pos < data.size()) {
+    uint64_t ordinal = 0;
+    if (!readVarint(data, pos, ordinal)) {
+      return Status(1, "Truncated binary row column");
+    }
+
+    std::string name;
+    if (ordinal == 0) {
+      if (!readBytes(data, pos, name)) {
+        return Status(1, "Truncated binary row column name");
+      }
+    } else if (ordinal > dict.names.size()) {
+      return Status(1, "Unknown binary row column: " + std::to_string(ordinal));
+    }
+
+    if (pos >= data.size()) {
+      return Status(1, "Truncated binary row value");
+    }
+
+    auto& value = r[(ordinal == 0) ? name : dict.names[ordinal - 1]];
+    auto tag = data[pos++];
+    if (tag == kRowBinaryInteger) {
+      uint64_t zigzag = 0;
+      if (!readVarint(data, pos, zigzag)) {
+        return Status(1, "Truncated binary row integer");
+      }
+      value = std::to_string(static_cast<int64_t>(zigzag >> 1) ^
+                             -static_cast<int64_t>(zigzag & 1));
+    } else if (tag != kRowBinaryString || !readBytes(data, pos, value)) {
+      return Status(1, "Invalid binary row value");
+    }
+  }
+  return Status();
+}
+
+bool isRowBinary(const std::string& data) {
+  return !data.empty() && data[0] == kRowBinaryVersion;
+}
+
+/// Leading byte of hash-indexed query data, never a JSON '['.
+const char kQueryDataHashedVersion = 0x02;
+
+static inline void hashBytes(const std::string& value, uint64_t& hash) {
+  // FNV-1a, prefixed with the length so adjacent fields cannot alias.
+  auto size = static_cast<uint64_t>(value.size());
+  for (size_t i = 0; i < sizeof(size); i++) {
+    hash ^= (size >> (i * 8)) & 0xff;
+    hash *= 0x100000001b3ULL;
+  }
+  for (const auto& c : value) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+}
+
+uint64_t hashRow(const Row& r) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const auto& column : r) {
+    hashBytes(column.first, hash);
+    hashBytes(column.second, hash);
+  }
+  return hash;
+}
+
+static inline void writeHash(uint64_t hash, std::string& out) {
+  for (size_t i = 0; i < sizeof(hash); i++) {
+    out.push_back(static_cast<char>((hash >> (i * 8)) & 0xff));
+  }
+}
+
+static inline uint64_t readHash(const char* data) {
+  uint64_t hash = 0;
+  for (size_t i = 0; i < sizeof(hash); i++) {
+    hash |= static_cast<uint64_t>(static_cast<unsigned char>(data[i]))
+            << (i * 8);
+  }
+  return hash;
+}
+
+static Status serializeQueryDataHashed(const QueryData& q,
+                                       const std::vector<uint64_t>& hashes,
+                                       std::string& out) {
+  ColumnDictionary dict;
+  for (const auto& r : q) {
+    for (const auto& column : r) {
+      dict.add(column.first);
+    }
+  }
+
+  out.clear();
+  out.push_back(kQueryDataHashedVersion);
+  writeVarint(dict.names.size(), out);
+  for (const auto& name : dict.names) {
+    writeBytes(name, out);
+  }
+
+  writeVarint(q.size(), out);
+  for (size_t i = 0; i < q.size(); i++) {
+    writeHash((i < hashes.size()) ? hashes[i] : hashRow(q[i]), out);
+  }
+
+  std::string row;
+  for (const auto& r : q) {
+    serializeRowBinary(r, dict, row);
+    writeBytes(row, out);
+  }
+  return Status();
+}
+
+Status serializeQueryDataHashed(const QueryData& q, std::string& out) {
+  return serializeQueryDataHashed(q, {}, out);
+}
+
+bool isQueryDataHashed(const std::string& data) {
+  return !data.empty() && data[0] == kQueryDataHashedVersion;
+}
+
+/// The parsed header of hash-indexed query data.
+struct QueryDataHashedIndex {
+  ColumnDictionary dict;
+
+  /// Number of rows.
+  size_t count{0};
+
+  /// Offset of the first row hash.
+  size_t hashes{0};
+
+  /// Offset of the first encoded row.
+  size_t rows{0};
+};
+
+static Status readQueryDataHashedIndex(const std::string& data,
+                                       QueryDataHashedIndex& index) {
+  if (!isQueryDataHashed(data)) {
+    return Status(1, "Cannot deserialize hashed query data");
+  }
+
+  size_t pos = 1;
+  uint64_t columns = 0;
+  if (!readVarint(data, pos, columns)) {
+    return Status(1, "Truncated hashed query data columns");
+  }
+  for (uint64_t i = 0; i < columns; i++) {
+    std::string name;
+    if (!readBytes(data, pos, name)) {
+      return Status(1, "Truncated hashed query data column");
+    }
+    index.dict.add(name);
+  }
+
+  uint64_t count = 0;
+  if (!readVarint(data, pos, count) ||
+      count > (data.size() - pos) / sizeof(uint64_t)) {
+    return Status(1, "Truncated hashed query data index");
+  }
+  index.count = static_cast<size_t>(count);
+  index.hashes = pos;
+  index.rows = pos + index.count * sizeof(uint64_t);
+  return Status();
+}
+
+Status deserializeQueryDataHashed(const std::string& data, QueryDataSet& qd) {
+  QueryDataHashedIndex index;
+  auto status = readQueryDataHashedIndex(data, index);
+  if (!status.ok()) {
+    return status;
+  }
+
+  size_t pos = index.rows;
+  std::string encoded;
+  for (size_t i = 0; i < index.count; i++) {
+    Row r;
+    if (!readBytes(data, pos, encoded)) {
+      return Status(1, "Truncated hashed query data row");
+    }
+    status = deserializeRowBinary(encoded, index.dict, r);
+    if (!status.ok()) {
+      return status;
+    }
+    qd.insert(std::move(r));
+  }
+  return Status();
+}
+
+Status diffHashed(const std::string& old,
+                  const QueryData& current,
+                  std::vector<uint64_t>& hashes,
+                  DiffResults& dr) {
+  QueryDataHashedIndex index;
+  auto status = readQueryDataHashedIndex(old, index);
+  if (!status.ok()) {
+    return status;
+  }
+
+  // Count the previous rows by hash, duplicate rows share a hash.
+  std::unordered_map<uint64_t, size_t> previous;
+  previous.reserve(index.count);
+  for (size_t i = 0; i < index.count; i++) {
+    previous[readHash(old.data() + index.hashes + i * sizeof(uint64_t))]++;
+  }
+
+  hashes.clear();
+  hashes.reserve(current.size());
+  for (const auto& r : current) {
+    auto hash = hashRow(r);
+    hashes.push_back(hash);
+
+    auto it = previous.find(hash);
+    if (it != previous.end() && it->second > 0) {
+      it->second--;
+    } else {
+      dr.added.push_back(r);
+    }
+  }
+
+  // Only the unmatched previous rows are decoded.
+  size_t pos = index.rows;
+  std::string encoded;
+  for (size_t i = 0; i < index.count; i++) {
+    if (!readBytes(old, pos, encoded)) {
+      return Status(1, "Truncated hashed query data row");
+    }
+
+    auto it = previous.find(
+        readHash(old.data() + index.hashes + i * sizeof(uint64_t)));
+    if (it->second == 0) {
+      continue;
+    }
+    it->second--;
+
+    Row r;
+    status = deserializeRowBinary(encoded, index.dict, r);
+    if (!status.ok()) {
+      return status;
+    }
+    dr.removed.push_back(std::move(r));
+  }
+
+  // Match the ordering of diff(), where removed rows come from a set.
+  std::sort(dr.removed.begin(), dr.removed.end());
+  return Status();
+}
+
 Status serializeQueryDataJSON(const QueryData& q, std::string& json) {
   auto doc = JSON::newArray();
 
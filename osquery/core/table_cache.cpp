@@ -0,0 +1,334 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <utility>
+#include <vector>
+
+#include <osquery/flags.h>
+
+#include "osquery/core/conversions.h"
+#include "osquery/core/table_cache.h"
+
+namespace osquery {
+
+DECLARE_bool(disable_caching);
+
+/// The most scans kept for one table within a step.
+const size_t kTableCacheMaxEntries{8};
+
+namespace {
+
+/// Equality constraints applied to reused rows, keyed by column.
+using RowFilters = std::vector<std::pair<std::string, const ConstraintList*>>;
+
+/// Serialize the constraints of a scan, in column order.
+std::string serializeConstraints(const QueryContext& context) {
+  std::string serialized;
+  for (const auto& column : context.constraints) {
+    for (const auto& constraint : column.second.getAll()) {
+      serialized += column.first + ' ' + std::to_string(constraint.op) + ' ' +
+                    constraint.expr + '\n';
+    }
+  }
+  return serialized;
+}
+
+/// Check if a scan's columns were generated by an earlier scan.
+bool hasColumns(const boost::optional<UsedColumns>& generated,
+                const boost::optional<UsedColumns>& used) {
+  if (!generated) {
+    return true;
+  } else if (!used) {
+    return false;
+  }
+
+  for (const auto& column : *used) {
+    if (generated->count(column) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Check if an unconstrained scan contains every row of a scan.
+ *
+ * Constraints on index, required, additional, or optimized columns, and on the
+ * user of a user-based table, may change the rows a table generates. For
+ * example users answers a uid with getpwuid, which finds directory users that
+ * are not enumerated. These are the columns TablePlugin does not cache.
+ */
+bool isSubset(const VirtualTableContent& content, const QueryContext& context) {
+  if (content.attributes & TableAttributes::USER_BASED) {
+    return false;
+  }
+
+  auto options = ColumnOptions::INDEX | ColumnOptions::REQUIRED |
+                 ColumnOptions::ADDITIONAL | ColumnOptions::OPTIMIZED;
+  for (const auto& column : content.columns) {
+    if ((std::get<2>(column) & options) == 0) {
+      continue;
+    }
+    auto constraints = context.constraints.find(std::get<0>(column));
+    if (constraints != context.constraints.end() &&
+        constraints->second.exists()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Check if an expression compares the same way as the column's values.
+bool castsToAffinity(const std::string& expr, ColumnType affinity) {
+  switch (affinity) {
+  case TEXT_TYPE:
+    return true;
+  case INTEGER_TYPE:
+    return static_cast<bool>(tryTo<INTEGER_LITERAL>(expr));
+  case BIGINT_TYPE:
+    return static_cast<bool>(tryTo<BIGINT_LITERAL>(expr));
+  default:
+    return false;
+  }
+}
+
+/// Select columns constrained only by equality, SQLite applies the rest.
+RowFilters getRowFilters(const QueryContext& context) {
+  RowFilters filters;
+  for (const auto& column : context.constraints) {
+    const auto& list = column.second;
+    if (!list.exists()) {
+      continue;
+    }
+
+    bool usable = true;
+    for (const auto& constraint : list.getAll()) {
+      if (constraint.op != EQUALS ||
+          !castsToAffinity(constraint.expr, list.affinity)) {
+        usable = false;
+        break;
+      }
+    }
+    if (usable) {
+      filters.push_back(std::make_pair(column.first, &list));
+    }
+  }
+  return filters;
+}
+
+/// Apply equality constraints to reused results.
+TableCacheResults filterResults(const TableCacheResults& results,
+                                const RowFilters& filters) {
+  if (filters.empty()) {
+    return results;
+  }
+
+  TableCacheResults filtered;
+  if (results.typed != nullptr) {
+    const auto& typed = *results.typed;
+    std::vector<std::pair<size_t, const ConstraintList*>> columns;
+    for (const auto& filter : filters) {
+      columns.push_back(
+          std::make_pair(typed.column(filter.first), filter.second));
+    }
+
+    std::vector<size_t> selected;
+    for (size_t row = 0; row < typed.rows(); row++) {
+      bool matches = true;
+      for (const auto& column : columns) {
+        if (column.first >= typed.columns() ||
+            typed.isNull(row, column.first)) {
+          matches = false;
+        } else if (column.second->affinity == TEXT_TYPE) {
+          size_t size = 0;
+          const auto* text = typed.getText(row, column.first, size);
+          matches = column.second->matches(std::string(text, size));
+        } else {
+          matches = column.second->matches(
+              std::to_string(typed.getInteger(row, column.first)));
+        }
+        if (!matches) {
+          break;
+        }
+      }
+      if (matches) {
+        selected.push_back(row);
+      }
+    }
+    filtered.typed = typed.select(selected);
+    return filtered;
+  }
+
+  auto rows = std::make_shared<QueryData>();
+  for (const auto& row : *results.rows) {
+    bool matches = true;
+    for (const auto& filter : filters) {
+      auto value = row.find(filter.first);
+      if (value == row.end() || !filter.second->matches(value->second)) {
+        matches = false;
+        break;
+      }
+    }
+    if (matches) {
+      rows->push_back(row);
+    }
+  }
+  filtered.rows = std::move(rows);
+  return filtered;
+}
+} // namespace
+
+TableTickCache::Claim::~Claim() {
+  if (entry_ != nullptr) {
+    TableTickCache::get().abandon(entry_);
+  }
+}
+
+TableTickCache& TableTickCache::get() {
+  static TableTickCache cache;
+  return cache;
+}
+
+bool TableTickCache::lookup(size_t step,
+                            const VirtualTableContent& content,
+                            const QueryContext& context,
+                            TableCacheResults& results,
+                            Claim& claim) {
+  if (FLAGS_disable_caching || step == 0 || !context.useCache() ||
+      !(content.attributes & TableAttributes::CACHEABLE)) {
+    return false;
+  }
+
+  auto constraints = serializeConstraints(context);
+  auto subset = isSubset(content, context);
+
+  EntryRef found = nullptr;
+  bool filter = false;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    advance(step);
+
+    while (found == nullptr) {
+      if (step != step_) {
+        // The query started in an earlier step, its results are not shared.
+        stats_[content.name].misses++;
+        return false;
+      }
+
+      auto& entries = entries_[content.name];
+      for (const auto& entry : entries) {
+        if (!hasColumns(entry->columns, context.colsUsed)) {
+          continue;
+        }
+        if (entry->constraints == constraints) {
+          found = entry;
+          filter = false;
+          break;
+        }
+        if (entry->constraints.empty() && subset) {
+          found = entry;
+          filter = true;
+        }
+      }
+
+      if (found == nullptr) {
+        stats_[content.name].misses++;
+        auto entry = std::make_shared<Entry>();
+        entry->table = content.name;
+        entry->constraints = std::move(constraints);
+        entry->columns = context.colsUsed;
+        if (entries.size() >= kTableCacheMaxEntries) {
+          remove(entries.front());
+        }
+        entries.push_back(entry);
+        claim.entry_ = std::move(entry);
+        return false;
+      }
+
+      if (!found->ready) {
+        // Another scan is generating the rows, wait and look again.
+        auto entry = found;
+        condition_.wait(
+            lock, [&entry]() { return entry->ready || entry->abandoned; });
+        if (!entry->ready) {
+          found = nullptr;
+        }
+      }
+    }
+    stats_[content.name].hits++;
+  }
+
+  // Results are not changed once stored, they are filtered without the lock.
+  results = (filter) ? filterResults(found->results, getRowFilters(context))
+                     : found->results;
+  return true;
+}
+
+void TableTickCache::store(Claim& claim, TableCacheResults results) {
+  if (claim.entry_ == nullptr) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    claim.entry_->results = std::move(results);
+    claim.entry_->ready = true;
+  }
+  claim.entry_ = nullptr;
+  condition_.notify_all();
+}
+
+void TableTickCache::abandon(const EntryRef& entry) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  remove(entry);
+}
+
+void TableTickCache::advance(size_t step) {
+  if (step <= step_) {
+    return;
+  }
+
+  step_ = step;
+  for (auto& table : entries_) {
+    for (auto& entry : table.second) {
+      entry->abandoned = true;
+    }
+  }
+  entries_.clear();
+  condition_.notify_all();
+}
+
+void TableTickCache::remove(const EntryRef& entry) {
+  entry->abandoned = true;
+  auto table = entries_.find(entry->table);
+  if (table != entries_.end()) {
+    table->second.remove(entry);
+  }
+  condition_.notify_all();
+}
+
+std::map<std::string, TableCacheStats> TableTickCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void TableTickCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& table : entries_) {
+    for (auto& entry : table.second) {
+      entry->abandoned = true;
+    }
+  }
+  entries_.clear();
+  stats_.clear();
+  step_ = 0;
+  condition_.notify_all();
+}
+} // namespace osquery
@@ -0,0 +1,159 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+#include <osquery/tables.h>
+
+namespace osquery {
+
+/// The rows generated by a table scan, either typed or row data.
+struct TableCacheResults {
+  std::shared_ptr<const QueryData> rows{nullptr};
+  std::shared_ptr<const TableRows> typed{nullptr};
+};
+
+/// The number of scans of a table answered by, or missing, the tick cache.
+struct TableCacheStats {
+  size_t hits{0};
+  size_t misses{0};
+};
+
+/**
+ * @brief Share the results of cacheable tables within a schedule step.
+ *
+ * Scheduled queries that run in the same step, the scheduler's tick, often
+ * read the same tables. The first scan of a cacheable table generates its
+ * rows, later scans within the step reuse them:
+ *  - A scan with the same constraints reuses the rows as they are.
+ *  - An unconstrained scan answers scans that constrain columns which do not
+ *    change what the table generates, such as INDEX columns. The rows are
+ *    filtered by the equality constraints and SQLite applies the rest.
+ *
+ * A scan that would be answered by one still generating waits for it, so
+ * queries running on several scheduler workers generate a table once.
+ * Results are dropped when a later step starts. The cache is thread safe.
+ */
+class TableTickCache : private boost::noncopyable {
+ private:
+  struct Entry;
+
+ public:
+  /// A scan that missed the cache and should store its results.
+  class Claim : private boost::noncopyable {
+   public:
+    Claim() = default;
+
+    /// Release the scan, waiting scans generate their own rows.
+    ~Claim();
+
+    /// True if the scan's results should be stored.
+    explicit operator bool() const {
+      return entry_ != nullptr;
+    }
+
+   private:
+    std::shared_ptr<Entry> entry_{nullptr};
+
+   private:
+    friend class TableTickCache;
+  };
+
+ public:
+  /// The process-wide cache.
+  static TableTickCache& get();
+
+  /**
+   * @brief Find the results of a scan generated earlier in the step.
+   *
+   * Only scheduled queries, which request the query cache, of tables with the
+   * CACHEABLE attribute use the tick cache.
+   *
+   * @param step The schedule step of the query.
+   * @param content The scanned table.
+   * @param context The scan's constraints and used columns.
+   * @param results The output results if there is a hit.
+   * @param claim Set on a miss when the scan should store its results.
+   * @return true if the results were found.
+   */
+  bool lookup(size_t step,
+              const VirtualTableContent& content,
+              const QueryContext& context,
+              TableCacheResults& results,
+              Claim& claim);
+
+  /// Store the results of a claimed scan and wake any waiting scans.
+  void store(Claim& claim, TableCacheResults results);
+
+  /// The hits and misses of each table using the cache.
+  std::map<std::string, TableCacheStats> stats() const;
+
+  /// Drop every result and reset the counters.
+  void clear();
+
+ private:
+  TableTickCache() = default;
+
+  struct Entry {
+    std::string table;
+
+    /// The scan's constraints, serialized.
+    std::string constraints;
+
+    /// The columns the scan generated, all of them if not set.
+    boost::optional<UsedColumns> columns;
+
+    /// Set when the results are stored.
+    bool ready{false};
+
+    /// Set when the scan is released without results or dropped.
+    bool abandoned{false};
+
+    TableCacheResults results;
+  };
+
+  using EntryRef = std::shared_ptr<Entry>;
+
+  /// Release a claimed scan without storing results.
+  void abandon(const EntryRef& entry);
+
+  /// Drop the results of earlier steps, the lock must be held.
+  void advance(size_t step);
+
+  /// Remove an entry, waking scans waiting for it, the lock must be held.
+  void remove(const EntryRef& entry);
+
+ private:
+  /// Scans of each table within the current step, the oldest first.
+  std::map<std::string, std::list<EntryRef>> entries_;
+
+  /// The hits and misses of each table.
+  std::map<std::string, TableCacheStats> stats_;
+
+  /// The newest schedule step seen.
+  size_t step_{0};
+
+  /// Protects the entries, counters, and step.
+  mutable std::mutex mutex_;
+
+  /// Wakes scans waiting for results.
+  std::condition_variable condition_;
+};
+} // namespace osquery
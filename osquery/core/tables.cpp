@@ -33,8 +33,8 @@ FLAG(bool, disable_caching, false, "Disable scheduled query caching");
 
 CREATE_LAZY_REGISTRY(TablePlugin, "table");
 
-size_t TablePlugin::kCacheInterval = 0;
-size_t TablePlugin::kCacheStep = 0;
+thread_local size_t TablePlugin::kCacheInterval = 0;
+thread_local size_t TablePlugin::kCacheStep = 0;
 
 const std::map<ColumnType, std::string> kColumnTypeNames = {
     {UNKNOWN_TYPE, "UNKNOWN"},
@@ -90,6 +90,17 @@ void TablePlugin::setRequestFromContext(const QueryContext& context,
     doc.add("colsUsed", colsUsed);
   }
 
+  if (!context.orderBy.empty()) {
+    auto orderBy = doc.getArray();
+    for (const auto& order : context.orderBy) {
+      auto child = doc.getObject();
+      doc.addRef("name", order.first, child);
+      doc.add("desc", order.second, child);
+      doc.push(child, orderBy);
+    }
+    doc.add("orderBy", orderBy);
+  }
+
   doc.toString(request["context"]);
 }
 
@@ -104,6 +115,16 @@ void TablePlugin::setContextFromRequest(const PluginRequest& request,
     }
     context.colsUsed = colsUsed;
   }
+  if (doc.doc().HasMember("orderBy") && doc.doc()["orderBy"].IsArray()) {
+    for (const auto& order : doc.doc()["orderBy"].GetArray()) {
+      if (order.IsObject() && order.HasMember("name") &&
+          order["name"].IsString() && order.HasMember("desc") &&
+          order["desc"].IsBool()) {
+        context.orderBy.push_back(
+            std::make_pair(order["name"].GetString(), order["desc"].GetBool()));
+      }
+    }
+  }
   if (!doc.doc().HasMember("constraints") ||
       !doc.doc()["constraints"].IsArray()) {
     return;
@@ -184,7 +205,7 @@ PluginResponse TablePlugin::routeInfo() const {
 }
 
 static bool cacheAllowed(const TableColumns& cols, const QueryContext& ctx) {
-  if (!ctx.useCache()) {
+  if (FLAGS_disable_caching || !ctx.useCache()) {
     // The query execution did not request use of the warm cache.
     return false;
   }
@@ -200,13 +221,35 @@ static bool cacheAllowed(const TableColumns& cols, const QueryContext& ctx) {
   return true;
 }
 
+/// Check that the cached results include every column the query uses.
+static bool cacheCovers(const boost::optional<UsedColumns>& cached,
+                        const QueryContext& ctx) {
+  if (!cached) {
+    // The cached results were generated with every column.
+    return true;
+  }
+
+  if (!ctx.colsUsed) {
+    return false;
+  }
+
+  for (const auto& column : *ctx.colsUsed) {
+    if (cached->count(column) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool TablePlugin::isCached(size_t step, const QueryContext& ctx) const {
   if (FLAGS_disable_caching) {
     return false;
   }
 
   // Perform the step comparison first, because it's easy.
-  return (step < last_cached_ + last_interval_ && cacheAllowed(columns(), ctx));
+  ReadLock lock(cache_lock_);
+  return (step < last_cached_ + last_interval_ &&
+          cacheAllowed(columns(), ctx) && cacheCovers(cached_columns_, ctx));
 }
 
 QueryData TablePlugin::getCache() const {
@@ -223,19 +266,275 @@ void TablePlugin::setCache(size_t step,
                            size_t interval,
                            const QueryContext& ctx,
                            const QueryData& results) {
-  if (FLAGS_disable_caching || !cacheAllowed(columns(), ctx)) {
+  if (!cacheAllowed(columns(), ctx)) {
     return;
   }
 
   // Serialize QueryData and save to database.
   std::string content;
   if (serializeQueryDataJSON(results, content)) {
+    // The results only contain the columns used by the generating query.
+    WriteLock lock(cache_lock_);
     last_cached_ = step;
     last_interval_ = interval;
+    cached_columns_ = ctx.colsUsed;
     setDatabaseValue(kQueries, "cache." + getName(), content);
   }
 }
 
+void TablePlugin::setCache(size_t step,
+                           size_t interval,
+                           const QueryContext& ctx,
+                           const TableRows& results) {
+  if (!cacheAllowed(columns(), ctx)) {
+    return;
+  }
+  setCache(step, interval, ctx, results.toQueryData());
+}
+
+TableRows::TableRows(const TableColumns& columns) {
+  for (const auto& column : columns) {
+    ordinals_[std::get<0>(column)] = names_.size();
+    names_.push_back(std::get<0>(column));
+    types_.push_back(std::get<1>(column));
+  }
+  columns_ = names_.size();
+}
+
+size_t TableRows::column(const std::string& name) const {
+  auto it = ordinals_.find(name);
+  return (it == ordinals_.end()) ? columns_ : it->second;
+}
+
+void TableRows::addRow() {
+  cells_.resize(cells_.size() + columns_);
+  nulls_.resize(nulls_.size() + columns_, true);
+  rows_++;
+}
+
+void TableRows::addRow(const Row& row) {
+  addRow();
+  for (const auto& column : row) {
+    setText(this->column(column.first), column.second);
+  }
+}
+
+void TableRows::append(const QueryData& rows) {
+  cells_.reserve(cells_.size() + rows.size() * columns_);
+  for (const auto& row : rows) {
+    addRow(row);
+  }
+}
+
+void TableRows::setInteger(size_t column, long long value) {
+  if (rows_ == 0 || column >= columns_) {
+    return;
+  }
+
+  auto index = (rows_ - 1) * columns_ + column;
+  switch (types_[column]) {
+  case INTEGER_TYPE:
+  case BIGINT_TYPE:
+  case UNSIGNED_BIGINT_TYPE:
+    cells_[index].integer = value;
+    nulls_[index] = false;
+    setSource(index, false, nullptr, 0);
+    break;
+  case DOUBLE_TYPE:
+    cells_[index].real = static_cast<double>(value);
+    nulls_[index] = false;
+    setSource(index, false, nullptr, 0);
+    break;
+  default:
+    setText(column, std::to_string(value));
+    break;
+  }
+}
+
+void TableRows::setDouble(size_t column, double value) {
+  if (rows_ == 0 || column >= columns_) {
+    return;
+  }
+
+  auto index = (rows_ - 1) * columns_ + column;
+  if (types_[column] == DOUBLE_TYPE) {
+    cells_[index].real = value;
+    nulls_[index] = false;
+    setSource(index, false, nullptr, 0);
+  } else {
+    setText(column, DOUBLE(value));
+  }
+}
+
+void TableRows::setText(size_t column, const char* value, size_t size) {
+  if (rows_ == 0 || column >= columns_) {
+    return;
+  }
+
+  // Conversions match those the SQLite cursor applies to Row values.
+  auto index = (rows_ - 1) * columns_ + column;
+  auto& cell = cells_[index];
+  switch (types_[column]) {
+  case INTEGER_TYPE:
+  case BIGINT_TYPE:
+  case UNSIGNED_BIGINT_TYPE: {
+    std::string content(value, size);
+    auto integer = tryTo<long long>(content, 0);
+    bool canonical = false;
+    if (integer.isValue()) {
+      cell.integer = integer.take();
+      nulls_[index] = false;
+      canonical = (BIGINT(cell.integer) == content);
+    }
+    setSource(index, !canonical, value, size);
+    break;
+  }
+  case DOUBLE_TYPE: {
+    std::string content(value, size);
+    char* end = nullptr;
+    double real = strtod(content.c_str(), &end);
+    bool canonical = false;
+    if (end != nullptr && end != content.c_str() && *end == '\0') {
+      cell.real = real;
+      nulls_[index] = false;
+      canonical = (DOUBLE(real) == content);
+    }
+    setSource(index, !canonical, value, size);
+    break;
+  }
+  default:
+    cell.text.offset = arena_.size();
+    cell.text.size = size;
+    arena_.append(value, size);
+    nulls_[index] = false;
+    break;
+  }
+}
+
+void TableRows::setSource(size_t index,
+                          bool keep,
+                          const char* value,
+                          size_t size) {
+  if (!keep) {
+    if (!sources_.empty()) {
+      sources_.erase(index);
+    }
+    return;
+  }
+
+  sources_[index] = {arena_.size(), size};
+  arena_.append(value, size);
+}
+
+const char* TableRows::getSource(size_t row,
+                                 size_t column,
+                                 size_t& size) const {
+  if (sources_.empty()) {
+    return nullptr;
+  }
+
+  auto source = sources_.find(row * columns_ + column);
+  if (source == sources_.end()) {
+    return nullptr;
+  }
+  size = source->second.size;
+  return arena_.data() + source->second.offset;
+}
+
+Row TableRows::getRow(size_t row) const {
+  Row r;
+  for (size_t column = 0; column < columns_; column++) {
+    size_t source_size = 0;
+    const auto* source = getSource(row, column, source_size);
+    if (source != nullptr) {
+      r[names_[column]] = std::string(source, source_size);
+      continue;
+    }
+
+    if (isNull(row, column)) {
+      continue;
+    }
+
+    switch (types_[column]) {
+    case INTEGER_TYPE:
+    case BIGINT_TYPE:
+    case UNSIGNED_BIGINT_TYPE:
+      r[names_[column]] = BIGINT(getInteger(row, column));
+      break;
+    case DOUBLE_TYPE:
+      r[names_[column]] = DOUBLE(getDouble(row, column));
+      break;
+    default: {
+      size_t size = 0;
+      const auto* text = getText(row, column, size);
+      r[names_[column]] = std::string(text, size);
+      break;
+    }
+    }
+  }
+  return r;
+}
+
+QueryData TableRows::toQueryData() const {
+  QueryData results;
+  results.reserve(rows_);
+  for (size_t row = 0; row < rows_; row++) {
+    results.push_back(getRow(row));
+  }
+  return results;
+}
+
+std::unique_ptr<TableRows> TableRows::select(
+    const std::vector<size_t>& rows) const {
+  auto selected = std::make_unique<TableRows>(TableColumns());
+  selected->types_ = types_;
+  selected->names_ = names_;
+  selected->ordinals_ = ordinals_;
+  selected->columns_ = columns_;
+  selected->cells_.reserve(rows.size() * columns_);
+
+  for (auto row : rows) {
+    if (row >= rows_) {
+      continue;
+    }
+
+    selected->addRow();
+    for (size_t column = 0; column < columns_; column++) {
+      size_t source_size = 0;
+      const auto* source = getSource(row, column, source_size);
+      if (source != nullptr) {
+        // Converting the source again sets the same number and source.
+        selected->setText(column, source, source_size);
+        continue;
+      }
+
+      if (isNull(row, column)) {
+        continue;
+      }
+
+      // Numbers are copied in place, text is copied into the new arena.
+      switch (types_[column]) {
+      case INTEGER_TYPE:
+      case BIGINT_TYPE:
+      case UNSIGNED_BIGINT_TYPE:
+      case DOUBLE_TYPE: {
+        auto index = (selected->rows_ - 1) * columns_ + column;
+        selected->cells_[index] = cells_[row * columns_ + column];
+        selected->nulls_[index] = false;
+        break;
+      }
+      default: {
+        size_t size = 0;
+        const auto* text = getText(row, column, size);
+        selected->setText(column, text, size);
+        break;
+      }
+      }
+    }
+  }
+  return selected;
+}
+
 std::string columnDefinition(const TableColumns& columns, bool is_extension) {
   std::map<std::string, bool> epilog;
   bool indexed = false;
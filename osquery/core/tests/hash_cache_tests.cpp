@@ -0,0 +1,180 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <chrono>
+#include <ctime>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include <gtest/gtest.h>
+
+#include <osquery/database.h>
+#include <osquery/filesystem.h>
+#include <osquery/flags.h>
+
+#include "osquery/core/hash_cache.h"
+#include "osquery/tests/test_util.h"
+
+namespace fs = boost::filesystem;
+
+namespace osquery {
+
+DECLARE_uint64(hash_cache_expiry);
+
+class HashCacheTests : public testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = fs::temp_directory_path() /
+            fs::unique_path("osquery.hash_cache.%%%%.%%%%");
+    writeTextFile(path_, "31337 hax0r");
+    // Move the mtime into the past so hashes are exact.
+    fs::last_write_time(path_, std::time(nullptr) - 60);
+
+    FileHashCache::get().clear();
+    std::vector<std::string> keys;
+    scanDatabaseKeys(kFileHashes, keys);
+    for (const auto& key : keys) {
+      deleteDatabaseValue(kFileHashes, key);
+    }
+  }
+
+  void TearDown() override {
+    removePath(path_);
+  }
+
+ protected:
+  fs::path path_;
+};
+
+TEST_F(HashCacheTests, test_load) {
+  auto& cache = FileHashCache::get();
+  auto misses = cache.misses();
+
+  MultiHashes hashes;
+  ASSERT_TRUE(cache.load(path_.string(), hashes).ok());
+  EXPECT_EQ(hashes.md5, "2adfc0fd337a144cb2f8abd7cb0bf98e");
+  EXPECT_EQ(hashes.sha1, "21bd89f4580ef635e87f655fab5807a01e0ff2e9");
+  EXPECT_EQ(
+      hashes.sha256,
+      "6f1c16ac918f64721d14ff4bb3c51fe25ffde92f795ce6dbeb45722ce9d6e05c");
+  EXPECT_EQ(cache.misses(), misses + 1);
+
+  // The memory tier answers the second request.
+  MultiHashes cached;
+  ASSERT_TRUE(cache.load(path_.string(), cached, true).ok());
+  EXPECT_EQ(cached.sha256, hashes.sha256);
+  EXPECT_EQ(cache.misses(), misses + 1);
+
+  EXPECT_FALSE(cache.load(path_.string() + ".missing", cached).ok());
+}
+
+TEST_F(HashCacheTests, test_persistent) {
+  auto& cache = FileHashCache::get();
+
+  MultiHashes hashes;
+  ASSERT_TRUE(cache.load(path_.string(), hashes).ok());
+
+  FileIdentity identity;
+  ASSERT_TRUE(getFileIdentity(path_.string(), identity).ok());
+  std::string value;
+  ASSERT_TRUE(getDatabaseValue(kFileHashes, identity.key, value).ok());
+  EXPECT_NE(value.find(hashes.sha256), std::string::npos);
+
+  // Without the memory tier, as after a restart, the stored hash is used.
+  cache.clear();
+  auto misses = cache.misses();
+  MultiHashes stored;
+  ASSERT_TRUE(cache.load(path_.string(), stored).ok());
+  EXPECT_EQ(stored.md5, hashes.md5);
+  EXPECT_EQ(stored.sha1, hashes.sha1);
+  EXPECT_EQ(stored.sha256, hashes.sha256);
+  EXPECT_EQ(cache.misses(), misses);
+}
+
+TEST_F(HashCacheTests, test_changed) {
+  auto& cache = FileHashCache::get();
+
+  MultiHashes hashes;
+  ASSERT_TRUE(cache.load(path_.string(), hashes).ok());
+
+  // A write that changes the size changes the identity.
+  writeTextFile(path_, "random n00b!");
+  fs::last_write_time(path_, std::time(nullptr) - 30);
+  auto misses = cache.misses();
+  MultiHashes changed;
+  ASSERT_TRUE(cache.load(path_.string(), changed).ok());
+  EXPECT_NE(changed.md5, hashes.md5);
+  EXPECT_EQ(cache.misses(), misses + 1);
+}
+
+TEST_F(HashCacheTests, test_changed_restored_mtime) {
+  auto& cache = FileHashCache::get();
+
+  MultiHashes hashes;
+  ASSERT_TRUE(cache.load(path_.string(), hashes).ok());
+  auto mtime = fs::last_write_time(path_);
+
+  // A write of the same size with the mtime restored, as with touch -d or
+  // cp -p, still changes the ctime. It may have a resolution of seconds.
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  writeTextFile(path_, "31337 hax0R");
+  fs::last_write_time(path_, mtime);
+
+  auto misses = cache.misses();
+  MultiHashes changed;
+  ASSERT_TRUE(cache.load(path_.string(), changed).ok());
+  EXPECT_NE(changed.md5, hashes.md5);
+  EXPECT_EQ(cache.misses(), misses + 1);
+}
+
+TEST_F(HashCacheTests, test_exact) {
+  auto& cache = FileHashCache::get();
+
+  // A file hashed within the second of its mtime may be written again without
+  // changing its identity.
+  fs::last_write_time(path_, std::time(nullptr) + 60);
+  MultiHashes hashes;
+  ASSERT_TRUE(cache.load(path_.string(), hashes).ok());
+
+  auto misses = cache.misses();
+  ASSERT_TRUE(cache.load(path_.string(), hashes).ok());
+  EXPECT_EQ(cache.misses(), misses);
+
+  ASSERT_TRUE(cache.load(path_.string(), hashes, true).ok());
+  EXPECT_EQ(cache.misses(), misses + 1);
+}
+
+TEST_F(HashCacheTests, test_expire) {
+  auto& cache = FileHashCache::get();
+  MultiHashes hashes;
+  ASSERT_TRUE(cache.load(path_.string(), hashes).ok());
+  setDatabaseValue(kFileHashes, "0.1", "invalid");
+
+  std::vector<std::string> keys;
+  scanDatabaseKeys(kFileHashes, keys);
+  EXPECT_EQ(keys.size(), 2U);
+
+  // Only the entry that cannot be parsed is removed.
+  cache.expire();
+  keys.clear();
+  scanDatabaseKeys(kFileHashes, keys);
+  EXPECT_EQ(keys.size(), 1U);
+
+  // With no expiry every entry used before now is removed.
+  auto expiry = FLAGS_hash_cache_expiry;
+  FLAGS_hash_cache_expiry = 0;
+  setDatabaseValue(kFileHashes, "0.1", "0,0,0,0,0,0,0,a,b,c");
+  cache.expire();
+  std::string value;
+  EXPECT_FALSE(getDatabaseValue(kFileHashes, "0.1", value).ok());
+  FLAGS_hash_cache_expiry = expiry;
+}
+} // namespace osquery
@@ -105,6 +105,25 @@ TEST_F(ProcessTests, test_getpid) {
   EXPECT_EQ(process->pid(), pid);
 }
 
+TEST_F(ProcessTests, test_resource_usage) {
+  auto r0 = getResourceUsage();
+
+  // Spin on this thread so it accumulates CPU time.
+  volatile size_t counter = 0;
+  auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+  while (std::chrono::steady_clock::now() < until) {
+    counter = counter + 1;
+  }
+
+  auto r1 = getResourceUsage();
+  EXPECT_GT(r1.wall_time_ns, r0.wall_time_ns);
+  EXPECT_GT(r1.user_time_ns + r1.system_time_ns,
+            r0.user_time_ns + r0.system_time_ns);
+#if !defined(FREEBSD)
+  EXPECT_GT(r1.resident_size, 0U);
+#endif
+}
+
 TEST_F(ProcessTests, test_envVar) {
   auto val = getEnvVar("GTEST_OSQUERY");
   EXPECT_FALSE(val);
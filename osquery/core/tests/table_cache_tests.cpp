@@ -0,0 +1,202 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "osquery/core/table_cache.h"
+
+namespace osquery {
+
+class TableCacheTests : public testing::Test {
+ protected:
+  void SetUp() override {
+    TableTickCache::get().clear();
+
+    content_.name = "cached";
+    content_.attributes = TableAttributes::CACHEABLE;
+    content_.columns = {
+        std::make_tuple("pid", INTEGER_TYPE, ColumnOptions::INDEX),
+        std::make_tuple("name", TEXT_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("user", TEXT_TYPE, ColumnOptions::ADDITIONAL),
+    };
+  }
+
+  void TearDown() override {
+    TableTickCache::get().clear();
+  }
+
+  /// Create a scheduled query context with the table's affinities.
+  QueryContext getContext() {
+    QueryContext context;
+    context.useCache(true);
+    for (const auto& column : content_.columns) {
+      context.constraints[std::get<0>(column)].affinity = std::get<1>(column);
+    }
+    return context;
+  }
+
+  /// Store rows for a scan that missed the cache.
+  void storeRows(TableTickCache::Claim& claim) {
+    ASSERT_TRUE(static_cast<bool>(claim));
+    auto rows = std::make_shared<QueryData>();
+    for (size_t i = 1; i <= 3; i++) {
+      rows->push_back({{"pid", std::to_string(i)},
+                       {"name", "process" + std::to_string(i)},
+                       {"user", "root"}});
+    }
+    TableTickCache::get().store(claim, {std::move(rows), nullptr});
+  }
+
+  size_t hits() {
+    return TableTickCache::get().stats()["cached"].hits;
+  }
+
+  size_t misses() {
+    return TableTickCache::get().stats()["cached"].misses;
+  }
+
+ protected:
+  VirtualTableContent content_;
+};
+
+TEST_F(TableCacheTests, test_exact) {
+  auto& cache = TableTickCache::get();
+  auto context = getContext();
+
+  TableCacheResults results;
+  {
+    TableTickCache::Claim claim;
+    EXPECT_FALSE(cache.lookup(10, content_, context, results, claim));
+    storeRows(claim);
+  }
+  EXPECT_EQ(1U, misses());
+
+  TableTickCache::Claim claim;
+  EXPECT_TRUE(cache.lookup(10, content_, context, results, claim));
+  EXPECT_FALSE(static_cast<bool>(claim));
+  ASSERT_NE(nullptr, results.rows);
+  EXPECT_EQ(3U, results.rows->size());
+  EXPECT_EQ(1U, hits());
+
+  // Queries that do not use the query cache are not shared.
+  QueryContext uncached;
+  EXPECT_FALSE(cache.lookup(10, content_, uncached, results, claim));
+  EXPECT_FALSE(static_cast<bool>(claim));
+  EXPECT_EQ(1U, hits());
+  EXPECT_EQ(1U, misses());
+}
+
+TEST_F(TableCacheTests, test_superset) {
+  auto& cache = TableTickCache::get();
+  TableCacheResults results;
+  {
+    auto context = getContext();
+    TableTickCache::Claim claim;
+    EXPECT_FALSE(cache.lookup(10, content_, context, results, claim));
+    storeRows(claim);
+  }
+
+  // An equality constraint is filtered from the unconstrained scan.
+  auto context = getContext();
+  context.constraints["name"].add(Constraint(EQUALS, "process2"));
+  TableTickCache::Claim claim;
+  EXPECT_TRUE(cache.lookup(10, content_, context, results, claim));
+  ASSERT_NE(nullptr, results.rows);
+  ASSERT_EQ(1U, results.rows->size());
+  EXPECT_EQ("2", results.rows->at(0).at("pid"));
+
+  // Other operators are left for SQLite to apply.
+  auto like = getContext();
+  like.constraints["name"].add(Constraint(LIKE, "process%"));
+  EXPECT_TRUE(cache.lookup(10, content_, like, results, claim));
+  EXPECT_EQ(3U, results.rows->size());
+  EXPECT_EQ(2U, hits());
+
+  // Additional columns may generate rows not in the unconstrained scan.
+  auto additional = getContext();
+  additional.constraints["user"].add(Constraint(EQUALS, "nobody"));
+  EXPECT_FALSE(cache.lookup(10, content_, additional, results, claim));
+  EXPECT_TRUE(static_cast<bool>(claim));
+  EXPECT_EQ(2U, misses());
+
+  // So may indexed columns, the table may look up rows it does not list.
+  auto index = getContext();
+  index.constraints["pid"].add(Constraint(EQUALS, "4"));
+  TableTickCache::Claim index_claim;
+  EXPECT_FALSE(cache.lookup(10, content_, index, results, index_claim));
+  EXPECT_EQ(3U, misses());
+}
+
+TEST_F(TableCacheTests, test_columns) {
+  auto& cache = TableTickCache::get();
+  TableCacheResults results;
+  {
+    auto context = getContext();
+    context.colsUsed = UsedColumns({"pid"});
+    TableTickCache::Claim claim;
+    EXPECT_FALSE(cache.lookup(10, content_, context, results, claim));
+    storeRows(claim);
+  }
+
+  // A scan using more columns than were generated is a miss.
+  auto context = getContext();
+  TableTickCache::Claim claim;
+  EXPECT_FALSE(cache.lookup(10, content_, context, results, claim));
+  EXPECT_TRUE(static_cast<bool>(claim));
+}
+
+TEST_F(TableCacheTests, test_steps) {
+  auto& cache = TableTickCache::get();
+  auto context = getContext();
+  TableCacheResults results;
+  {
+    TableTickCache::Claim claim;
+    EXPECT_FALSE(cache.lookup(10, content_, context, results, claim));
+    storeRows(claim);
+  }
+
+  // Results are dropped when the next step starts.
+  {
+    TableTickCache::Claim claim;
+    EXPECT_FALSE(cache.lookup(11, content_, context, results, claim));
+    EXPECT_TRUE(static_cast<bool>(claim));
+  }
+
+  // A query from an earlier step does not store results.
+  TableTickCache::Claim claim;
+  EXPECT_FALSE(cache.lookup(10, content_, context, results, claim));
+  EXPECT_FALSE(static_cast<bool>(claim));
+  EXPECT_EQ(3U, misses());
+}
+
+TEST_F(TableCacheTests, test_wait) {
+  auto& cache = TableTickCache::get();
+  auto context = getContext();
+  TableCacheResults results;
+  TableTickCache::Claim claim;
+  EXPECT_FALSE(cache.lookup(10, content_, context, results, claim));
+
+  // A concurrent scan waits for the claimed scan's results.
+  bool found = false;
+  std::thread waiter([this, &found]() {
+    auto waiting = getContext();
+    TableCacheResults shared;
+    TableTickCache::Claim none;
+    found = TableTickCache::get().lookup(10, content_, waiting, shared, none);
+  });
+  storeRows(claim);
+  waiter.join();
+  EXPECT_TRUE(found);
+  EXPECT_EQ(1U, hits());
+  EXPECT_EQ(1U, misses());
+}
+} // namespace osquery
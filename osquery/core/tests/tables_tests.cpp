@@ -179,4 +179,129 @@ TEST_F(TablesTests, test_caching) {
   EXPECT_TRUE(test.testIsCached(6));
   EXPECT_FALSE(test.testIsCached(7));
 }
+
+class TestColumnsTablePlugin : public TablePlugin {
+ public:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("a", TEXT_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("b", TEXT_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+  void testSetCache(size_t step, size_t interval, QueryContext& ctx) {
+    QueryData r;
+    setCache(step, interval, ctx, r);
+  }
+
+  bool testIsCached(size_t interval, QueryContext& ctx) {
+    return isCached(interval, ctx);
+  }
+};
+
+TEST_F(TablesTests, test_caching_used_columns) {
+  TestColumnsTablePlugin test;
+  TablePlugin::kCacheInterval = 5;
+  TablePlugin::kCacheStep = 10;
+
+  QueryContext ctx;
+  ctx.useCache(true);
+  ctx.colsUsed = UsedColumns({"a"});
+
+  // Results generated for some columns are cached with those columns.
+  test.testSetCache(TablePlugin::kCacheStep, TablePlugin::kCacheInterval, ctx);
+  EXPECT_TRUE(test.testIsCached(11, ctx));
+
+  // They are not served to a query using other columns.
+  QueryContext other;
+  other.useCache(true);
+  other.colsUsed = UsedColumns({"a", "b"});
+  EXPECT_FALSE(test.testIsCached(11, other));
+
+  QueryContext all;
+  all.useCache(true);
+  EXPECT_FALSE(test.testIsCached(11, all));
+
+  // Results generated with every column are served to any query.
+  test.testSetCache(TablePlugin::kCacheStep, TablePlugin::kCacheInterval, all);
+  EXPECT_TRUE(test.testIsCached(11, all));
+  EXPECT_TRUE(test.testIsCached(11, other));
+  EXPECT_TRUE(test.testIsCached(11, ctx));
+}
+
+TEST_F(TablesTests, test_table_rows) {
+  TableColumns columns = {
+      std::make_tuple("int", INTEGER_TYPE, ColumnOptions::DEFAULT),
+      std::make_tuple("big", BIGINT_TYPE, ColumnOptions::DEFAULT),
+      std::make_tuple("real", DOUBLE_TYPE, ColumnOptions::DEFAULT),
+      std::make_tuple("text", TEXT_TYPE, ColumnOptions::DEFAULT),
+  };
+  TableRows rows(columns);
+  EXPECT_EQ(rows.columns(), 4U);
+  EXPECT_EQ(rows.column("real"), 2U);
+  EXPECT_EQ(rows.column("missing"), rows.columns());
+
+  rows.addRow();
+  rows.setInteger(rows.column("int"), 1);
+  rows.setText(rows.column("big"), "9000000000");
+  rows.setText(rows.column("real"), "1.5");
+  rows.setInteger(rows.column("text"), 7);
+
+  // Unset cells and strings that cannot be converted are NULL.
+  rows.addRow({{"int", "bad"}, {"text", "hello"}, {"unknown", "1"}});
+
+  ASSERT_EQ(rows.rows(), 2U);
+  EXPECT_EQ(rows.getInteger(0, 0), 1);
+  EXPECT_EQ(rows.getInteger(0, 1), 9000000000LL);
+  EXPECT_EQ(rows.getDouble(0, 2), 1.5);
+  size_t size = 0;
+  auto text = rows.getText(0, 3, size);
+  EXPECT_EQ(std::string(text, size), "7");
+
+  EXPECT_TRUE(rows.isNull(1, 0));
+  EXPECT_TRUE(rows.isNull(1, 1));
+  EXPECT_TRUE(rows.isNull(1, 2));
+  text = rows.getText(1, 3, size);
+  EXPECT_EQ(std::string(text, size), "hello");
+
+  auto results = rows.toQueryData();
+  ASSERT_EQ(results.size(), 2U);
+  Row expected = {
+      {"int", "1"}, {"big", "9000000000"}, {"real", "1.5"}, {"text", "7"}};
+  EXPECT_EQ(results[0], expected);
+  expected = {{"int", "bad"}, {"text", "hello"}};
+  EXPECT_EQ(results[1], expected);
+}
+
+TEST_F(TablesTests, test_table_rows_source) {
+  TableColumns columns = {
+      std::make_tuple("big", BIGINT_TYPE, ColumnOptions::DEFAULT),
+      std::make_tuple("real", DOUBLE_TYPE, ColumnOptions::DEFAULT),
+  };
+  TableRows rows(columns);
+
+  // Numbers convert as the SQLite cursor would, Row consumers see the text.
+  rows.addRow({{"big", "010"}, {"real", "1e-9"}});
+  EXPECT_EQ(rows.getInteger(0, 0), 8);
+  EXPECT_EQ(rows.getDouble(0, 1), 1e-9);
+  size_t size = 0;
+  EXPECT_NE(nullptr, rows.getSource(0, 0, size));
+  Row expected = {{"big", "010"}, {"real", "1e-9"}};
+  EXPECT_EQ(rows.getRow(0), expected);
+
+  // Canonical text, and values set as numbers, do not keep a source.
+  rows.addRow({{"big", "-12"}, {"real", "0.250000"}});
+  EXPECT_EQ(nullptr, rows.getSource(1, 0, size));
+  EXPECT_EQ(nullptr, rows.getSource(1, 1, size));
+  rows.setInteger(0, 3);
+  expected = {{"big", "3"}, {"real", "0.250000"}};
+  EXPECT_EQ(rows.getRow(1), expected);
+
+  // Selected rows keep their sources.
+  auto selected = rows.select({1, 0});
+  ASSERT_EQ(2U, selected->rows());
+  EXPECT_EQ(selected->getRow(0), expected);
+  expected = {{"big", "010"}, {"real", "1e-9"}};
+  EXPECT_EQ(selected->getRow(1), expected);
+}
 }
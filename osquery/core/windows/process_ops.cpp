@@ -8,9 +8,14 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <chrono>
+
 #include "osquery/core/windows/process_ops.h"
 #include "osquery/core/conversions.h"
 
+// Psapi.h requires the Windows.h types included by process_ops.h.
+#include <Psapi.h>
+
 namespace osquery {
 
 std::string psidToString(PSID sid) {
@@ -284,6 +289,38 @@ int platformGetPid() {
   return static_cast<int>(GetCurrentProcessId());
 }
 
+/// Convert a FILETIME duration, in 100-nanosecond intervals, to nanoseconds.
+static inline uint64_t fileTimeToNanoseconds(const FILETIME& ft) {
+  ULARGE_INTEGER value;
+  value.LowPart = ft.dwLowDateTime;
+  value.HighPart = ft.dwHighDateTime;
+  return static_cast<uint64_t>(value.QuadPart) * 100ULL;
+}
+
+ResourceUsage getResourceUsage() {
+  ResourceUsage usage;
+  usage.wall_time_ns = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (GetThreadTimes(GetCurrentThread(),
+                     &creation_time,
+                     &exit_time,
+                     &kernel_time,
+                     &user_time)) {
+    usage.user_time_ns = fileTimeToNanoseconds(user_time);
+    usage.system_time_ns = fileTimeToNanoseconds(kernel_time);
+  }
+
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    usage.resident_size = static_cast<uint64_t>(counters.WorkingSetSize);
+  }
+  return usage;
+}
+
 int platformGetTid() {
   return static_cast<int>(GetCurrentThreadId());
 }
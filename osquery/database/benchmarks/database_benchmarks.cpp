@@ -12,13 +12,22 @@
 
 #include <osquery/database.h>
 #include <osquery/filesystem.h>
+#include <osquery/flags.h>
 #include <osquery/query.h>
+#include <osquery/system.h>
 
+#include "osquery/core/conversions.h"
 #include "osquery/core/json.h"
+#include "osquery/database/plugins/rocksdb.h"
 #include "osquery/tests/test_util.h"
 
 namespace osquery {
 
+DECLARE_string(database_path);
+
+/// Subscribers writing events in the RocksDB benchmarks.
+const size_t kBenchmarkSubscribers{8};
+
 QueryData getExampleQueryData(size_t x, size_t y) {
   QueryData qd;
   Row r;
@@ -49,6 +58,25 @@ QueryDataSet getExampleQueryDataSet(size_t x, size_t y) {
   return qds;
 }
 
+/// Rows shaped like the file table, each with distinct content.
+QueryData getExampleFileQueryData(size_t y) {
+  QueryData qd;
+  for (size_t i = 0; i < y; i++) {
+    auto id = std::to_string(i);
+    qd.push_back({{"path", "/usr/share/osquery/packs/" + id + ".conf"},
+                  {"directory", "/usr/share/osquery/packs"},
+                  {"filename", id + ".conf"},
+                  {"inode", std::to_string(1048576 + i)},
+                  {"uid", "0"},
+                  {"gid", "0"},
+                  {"mode", "0644"},
+                  {"size", std::to_string(4096 + i)},
+                  {"mtime", "1537457208"},
+                  {"type", "regular"}});
+  }
+  return qd;
+}
+
 ColumnNames getExampleColumnNames(size_t x) {
   ColumnNames cn;
   for (size_t i = 0; i < x; i++) {
@@ -57,6 +85,96 @@ ColumnNames getExampleColumnNames(size_t x) {
   return cn;
 }
 
+/// A row shaped like process_events, including the time and eid columns.
+Row getExampleProcessEventRow() {
+  return {
+      {"pid", "31337"},
+      {"path", "/usr/bin/python3.6"},
+      {"mode", "0100755"},
+      {"cmdline", "/usr/bin/python3 /usr/lib/command-not-found -- --no-fail"},
+      {"cmdline_size", "56"},
+      {"env", ""},
+      {"env_count", "0"},
+      {"env_size", "0"},
+      {"cwd", "/home/osquery"},
+      {"auid", "1000"},
+      {"uid", "1000"},
+      {"euid", "1000"},
+      {"gid", "1000"},
+      {"egid", "1000"},
+      {"owner_uid", "0"},
+      {"owner_gid", "0"},
+      {"atime", "1538521370"},
+      {"mtime", "1537457208"},
+      {"ctime", "1537899843"},
+      {"btime", "0"},
+      {"overflows", ""},
+      {"parent", "31300"},
+      {"time", "1538521370"},
+      {"uptime", "865131"},
+      {"eid", "0000012345"},
+  };
+}
+
+ColumnDictionary getExampleColumnDictionary(const Row& r) {
+  ColumnDictionary dict;
+  for (const auto& column : r) {
+    dict.add(column.first);
+  }
+  return dict;
+}
+
+static void DATABASE_serialize_row_json(benchmark::State& state) {
+  auto r = getExampleProcessEventRow();
+  size_t bytes = 0;
+  while (state.KeepRunning()) {
+    std::string content;
+    serializeRowJSON(r, content);
+    bytes += content.size();
+  }
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK(DATABASE_serialize_row_json);
+
+static void DATABASE_serialize_row_binary(benchmark::State& state) {
+  auto r = getExampleProcessEventRow();
+  auto dict = getExampleColumnDictionary(r);
+  size_t bytes = 0;
+  while (state.KeepRunning()) {
+    std::string content;
+    serializeRowBinary(r, dict, content);
+    bytes += content.size();
+  }
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK(DATABASE_serialize_row_binary);
+
+static void DATABASE_deserialize_row_json(benchmark::State& state) {
+  std::string content;
+  serializeRowJSON(getExampleProcessEventRow(), content);
+  while (state.KeepRunning()) {
+    Row r;
+    deserializeRowJSON(content, r);
+  }
+}
+
+BENCHMARK(DATABASE_deserialize_row_json);
+
+static void DATABASE_deserialize_row_binary(benchmark::State& state) {
+  auto r = getExampleProcessEventRow();
+  auto dict = getExampleColumnDictionary(r);
+  std::string content;
+  serializeRowBinary(r, dict, content);
+  while (state.KeepRunning()) {
+    Row output;
+    deserializeRowBinary(content, dict, output);
+  }
+}
+
+BENCHMARK(DATABASE_deserialize_row_binary);
+
 static void DATABASE_serialize(benchmark::State& state) {
   auto qd = getExampleQueryData(state.range(0), state.range(1));
   while (state.KeepRunning()) {
@@ -105,6 +223,63 @@ static void DATABASE_diff(benchmark::State& state) {
 
 BENCHMARK(DATABASE_diff)->ArgPair(1, 1)->ArgPair(10, 10)->ArgPair(10, 100);
 
+/// Report the largest RSS growth observed while a differential was live.
+static void recordDiffMemory(benchmark::State& state,
+                             uint64_t before,
+                             uint64_t& peak) {
+  auto after = getResourceUsage().resident_size;
+  if (after > before && after - before > peak) {
+    peak = after - before;
+  }
+  state.counters["peak_rss_delta"] = static_cast<double>(peak);
+}
+
+static void DATABASE_diff_stored_json(benchmark::State& state) {
+  auto previous_qd = getExampleFileQueryData(state.range(0));
+  std::string previous;
+  serializeQueryDataJSON(previous_qd, previous);
+
+  // One row changed, one row removed, and one row added.
+  auto current = getExampleFileQueryData(state.range(0));
+  current[0]["size"] = "0";
+  current.pop_back();
+  current.push_back({{"path", "/tmp/new"}});
+
+  uint64_t peak = 0;
+  while (state.KeepRunning()) {
+    auto before = getResourceUsage().resident_size;
+    QueryDataSet qds;
+    deserializeQueryDataJSON(previous, qds);
+    auto d = diff(qds, current);
+    recordDiffMemory(state, before, peak);
+  }
+}
+
+BENCHMARK(DATABASE_diff_stored_json)->Arg(1000)->Arg(10000)->Arg(50000);
+
+static void DATABASE_diff_stored_hashed(benchmark::State& state) {
+  auto previous_qd = getExampleFileQueryData(state.range(0));
+  std::string previous;
+  serializeQueryDataHashed(previous_qd, previous);
+
+  // One row changed, one row removed, and one row added.
+  auto current = getExampleFileQueryData(state.range(0));
+  current[0]["size"] = "0";
+  current.pop_back();
+  current.push_back({{"path", "/tmp/new"}});
+
+  uint64_t peak = 0;
+  while (state.KeepRunning()) {
+    auto before = getResourceUsage().resident_size;
+    DiffResults d;
+    std::vector<uint64_t> hashes;
+    diffHashed(previous, current, hashes, d);
+    recordDiffMemory(state, before, peak);
+  }
+}
+
+BENCHMARK(DATABASE_diff_stored_hashed)->Arg(1000)->Arg(10000)->Arg(50000);
+
 static void DATABASE_query_results(benchmark::State& state) {
   auto qd = getExampleQueryData(state.range(0), state.range(1));
   auto query = getOsqueryScheduledQuery();
@@ -178,4 +353,167 @@ static void DATABASE_store_append(benchmark::State& state) {
 }
 
 BENCHMARK(DATABASE_store_append);
+
+/// Open a RocksDB database apart from the shared benchmark handle.
+static std::shared_ptr<RocksDBDatabasePlugin> openRocksDB(
+    const std::string& name) {
+  auto existing = FLAGS_database_path;
+  FLAGS_database_path = kTestWorkingDirectory + "benchmark." + name + ".db";
+  removePath(FLAGS_database_path);
+
+  auto plugin = std::make_shared<RocksDBDatabasePlugin>();
+  auto s = plugin->setUp();
+  FLAGS_database_path = existing;
+  return (s.ok()) ? plugin : nullptr;
+}
+
+static void closeRocksDB(std::shared_ptr<RocksDBDatabasePlugin>& plugin,
+                         const std::string& name) {
+  plugin->tearDown();
+  plugin = nullptr;
+  removePath(kTestWorkingDirectory + "benchmark." + name + ".db");
+}
+
+/// An events data key, as written by a subscriber.
+static std::string getEventKey(size_t subscriber, size_t eid) {
+  auto id = std::to_string(eid);
+  return "data.inotify.subscriber" + std::to_string(subscriber) + "." +
+         std::string(10 - id.size(), '0') + id;
+}
+
+/// Write events for each subscriber, interleaved like concurrent publishers.
+static void writeEvents(RocksDBDatabasePlugin& plugin,
+                        size_t count,
+                        size_t& eid) {
+  std::string content(256, 'e');
+  for (size_t i = 0; i < count; i++, eid++) {
+    DatabaseStringValueList batch;
+    for (size_t j = 0; j < kBenchmarkSubscribers; j++) {
+      batch.push_back(std::make_pair(getEventKey(j, eid), content));
+    }
+    plugin.putBatch(kEvents, batch);
+  }
 }
+
+/// Report the write and space amplification of a domain.
+static void recordAmplification(benchmark::State& state,
+                                RocksDBDatabasePlugin& plugin,
+                                const std::string& domain) {
+  std::map<std::string, std::string> stats;
+  if (!plugin.getStatistics(domain, stats).ok()) {
+    return;
+  }
+
+  const auto& write_amp = stats["compaction.Sum.WriteAmp"];
+  if (!write_amp.empty()) {
+    state.counters["write_amp"] = std::strtod(write_amp.c_str(), nullptr);
+  }
+
+  auto files = tryTo<unsigned long long>(stats["rocksdb.total-sst-files-size"]);
+  auto live =
+      tryTo<unsigned long long>(stats["rocksdb.estimate-live-data-size"]);
+  if (files && live && *live > 0) {
+    state.counters["space_amp"] =
+        static_cast<double>(*files) / static_cast<double>(*live);
+  }
+}
+
+static void DATABASE_rocksdb_events_write(benchmark::State& state) {
+  auto plugin = openRocksDB("events_write");
+  if (plugin == nullptr) {
+    state.SkipWithError("Cannot open RocksDB");
+    return;
+  }
+
+  size_t eid = 0;
+  while (state.KeepRunning()) {
+    writeEvents(*plugin, state.range(0), eid);
+
+    // Expire the oldest half of the events, as the subscribers would.
+    for (size_t j = 0; j < kBenchmarkSubscribers; j++) {
+      plugin->removeRange(
+          kEvents, getEventKey(j, 0), getEventKey(j, eid - state.range(0) / 2));
+    }
+  }
+
+  plugin->compact(kEvents);
+  recordAmplification(state, *plugin, kEvents);
+  closeRocksDB(plugin, "events_write");
+}
+
+BENCHMARK(DATABASE_rocksdb_events_write)->Arg(1000);
+
+static void DATABASE_rocksdb_events_scan(benchmark::State& state) {
+  auto plugin = openRocksDB("events_scan");
+  if (plugin == nullptr) {
+    state.SkipWithError("Cannot open RocksDB");
+    return;
+  }
+
+  size_t eid = 0;
+  writeEvents(*plugin, state.range(0), eid);
+  plugin->compact(kEvents);
+
+  // Each query scans the events of one subscriber.
+  size_t subscriber = 0;
+  while (state.KeepRunning()) {
+    DatabaseStringValueList values;
+    auto prefix = "data.inotify.subscriber" +
+                  std::to_string(subscriber++ % kBenchmarkSubscribers) + ".";
+    plugin->scanValues(kEvents, values, prefix, "", 0);
+  }
+  closeRocksDB(plugin, "events_scan");
+}
+
+BENCHMARK(DATABASE_rocksdb_events_scan)->Arg(1000)->Arg(10000);
+
+static void DATABASE_rocksdb_events_get_missing(benchmark::State& state) {
+  auto plugin = openRocksDB("events_get_missing");
+  if (plugin == nullptr) {
+    state.SkipWithError("Cannot open RocksDB");
+    return;
+  }
+
+  size_t eid = 0;
+  writeEvents(*plugin, state.range(0), eid);
+  plugin->compact(kEvents);
+
+  // Lookups of events that were not written are answered by the filters.
+  size_t k = 0;
+  while (state.KeepRunning()) {
+    std::string value;
+    plugin->get(kEvents, getEventKey(kBenchmarkSubscribers, k++), value);
+  }
+  closeRocksDB(plugin, "events_get_missing");
+}
+
+BENCHMARK(DATABASE_rocksdb_events_get_missing)->Arg(10000);
+
+static void DATABASE_rocksdb_logs_queue(benchmark::State& state) {
+  auto plugin = openRocksDB("logs_queue");
+  if (plugin == nullptr) {
+    state.SkipWithError("Cannot open RocksDB");
+    return;
+  }
+
+  // Buffer results then read and remove them, like a logger plugin.
+  std::string content(512, 'l');
+  size_t k = 0;
+  while (state.KeepRunning()) {
+    for (int i = 0; i < state.range(0); i++) {
+      plugin->put(kLogs, "result." + std::to_string(k++), content);
+    }
+
+    std::vector<std::string> keys;
+    plugin->scan(kLogs, keys, "result.", 0);
+    for (const auto& key : keys) {
+      plugin->remove(kLogs, key);
+    }
+  }
+
+  recordAmplification(state, *plugin, kLogs);
+  closeRocksDB(plugin, "logs_queue");
+}
+
+BENCHMARK(DATABASE_rocksdb_logs_queue)->Arg(100);
+} // namespace osquery
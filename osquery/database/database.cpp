@@ -8,6 +8,8 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <algorithm>
+
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
@@ -19,6 +21,7 @@
 #include "osquery/core/conversions.h"
 #include "osquery/core/flagalias.h"
 #include "osquery/core/json.h"
+#include "osquery/events/event_records.h"
 
 namespace pt = boost::property_tree;
 namespace rj = rapidjson;
@@ -44,6 +47,7 @@ const std::string kQueries = "queries";
 const std::string kEvents = "events";
 const std::string kCarves = "carves";
 const std::string kLogs = "logs";
+const std::string kFileHashes = "file_hashes";
 
 const std::string kDbEpochSuffix = "epoch";
 const std::string kDbCounterSuffix = "counter";
@@ -51,7 +55,7 @@ const std::string kDbCounterSuffix = "counter";
 const std::string kDbVersionKey = "results_version";
 
 const std::vector<std::string> kDomains = {
-    kPersistentSettings, kQueries, kEvents, kLogs, kCarves};
+    kPersistentSettings, kQueries, kEvents, kLogs, kCarves, kFileHashes};
 
 std::atomic<bool> DatabasePlugin::kDBAllowOpen(false);
 std::atomic<bool> DatabasePlugin::kDBRequireWrite(false);
@@ -117,6 +121,54 @@ Status DatabasePlugin::scan(const std::string& domain,
   return Status(0, "Not used");
 }
 
+Status DatabasePlugin::scanValues(const std::string& domain,
+                                  DatabaseStringValueList& results,
+                                  const std::string& prefix,
+                                  const std::string& start,
+                                  size_t max) const {
+  std::vector<std::string> keys;
+  auto status = scan(domain, keys, prefix, 0);
+  if (!status.ok()) {
+    return status;
+  }
+
+  std::sort(keys.begin(), keys.end());
+  auto it = std::lower_bound(keys.begin(), keys.end(), start);
+  for (size_t count = 0; it != keys.end(); ++it) {
+    std::string value;
+    if (!get(domain, *it, value).ok()) {
+      // The key was removed since the scan.
+      continue;
+    }
+    results.emplace_back(std::move(*it), std::move(value));
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
+  return Status(0, "OK");
+}
+
+Status DatabasePlugin::append(const std::string& domain,
+                              const std::string& key,
+                              const std::string& value) {
+  std::string existing;
+  // A missing key is an empty value.
+  get(domain, key, existing);
+  existing.append(value);
+  return put(domain, key, existing);
+}
+
+Status DatabasePlugin::removeBatch(const std::string& domain,
+                                   const std::vector<std::string>& keys) {
+  for (const auto& key : keys) {
+    auto status = remove(domain, key);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return Status(0, "OK");
+}
+
 Status DatabasePlugin::call(const PluginRequest& request,
                             PluginResponse& response) {
   if (request.count("action") == 0) {
@@ -186,8 +238,32 @@ Status DatabasePlugin::call(const PluginRequest& request,
     }
 
     return this->putBatch(domain, data);
+  } else if (request.at("action") == "append") {
+    if (request.count("value") == 0) {
+      return Status(1, "Database plugin append action requires a value");
+    }
+    return this->append(domain, key, request.at("value"));
   } else if (request.at("action") == "remove") {
     return this->remove(domain, key);
+  } else if (request.at("action") == "remove_batch") {
+    if (request.count("json") == 0) {
+      return Status(1, "Database plugin remove_batch action requires keys");
+    }
+
+    auto json_object = JSON::newArray();
+    auto status = json_object.fromString(request.at("json"));
+    if (!status.ok() || !json_object.doc().IsArray()) {
+      return Status(1, "Database plugin remove_batch action has invalid keys");
+    }
+
+    std::vector<std::string> keys;
+    for (const auto& item : json_object.doc().GetArray()) {
+      if (!item.IsString()) {
+        return Status(1, "Database plugin remove_batch keys must be strings");
+      }
+      keys.push_back(item.GetString());
+    }
+    return this->removeBatch(domain, keys);
   } else if (request.at("action") == "remove_range") {
     auto key_high = (request.count("high") > 0) ? request.at("key_high") : "";
     if (!key_high.empty() && !key.empty()) {
@@ -207,6 +283,19 @@ Status DatabasePlugin::call(const PluginRequest& request,
       response.push_back({{"k", k}});
     }
     return status;
+  } else if (request.at("action") == "scanValues") {
+    DatabaseStringValueList values;
+    size_t max = 0;
+    if (request.count("max") > 0) {
+      max = std::stoul(request.at("max"));
+    }
+    auto start = (request.count("start") > 0) ? request.at("start") : "";
+    auto status =
+        this->scanValues(domain, values, request.at("prefix"), start, max);
+    for (const auto& kv : values) {
+      response.push_back({{"k", kv.first}, {"v", kv.second}});
+    }
+    return status;
   }
 
   return Status(1, "Unknown database plugin action");
@@ -349,6 +438,30 @@ Status setDatabaseValue(const std::string& domain,
   return setDatabaseBatch(domain, {std::make_pair(key, std::to_string(value))});
 }
 
+Status appendDatabaseValue(const std::string& domain,
+                           const std::string& key,
+                           const std::string& value) {
+  if (domain.empty()) {
+    return Status(1, "Missing domain");
+  }
+
+  if (RegistryFactory::get().external()) {
+    // External registries (extensions) do not have databases active.
+    // It is not possible to use an extension-based database.
+    PluginRequest request = {
+        {"action", "append"}, {"domain", domain}, {"key", key}, {"value", value}};
+    return Registry::call("database", request);
+  }
+
+  ReadLock lock(kDatabaseReset);
+  if (!DatabasePlugin::kDBInitialized) {
+    throw std::runtime_error("Cannot append database value: " + key);
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->append(domain, key, value);
+  }
+}
+
 Status deleteDatabaseValue(const std::string& domain, const std::string& key) {
   if (domain.empty()) {
     return Status(1, "Missing domain");
@@ -398,6 +511,45 @@ Status deleteDatabaseRange(const std::string& domain,
   }
 }
 
+Status deleteDatabaseBatch(const std::string& domain,
+                           const std::vector<std::string>& keys) {
+  if (domain.empty()) {
+    return Status(1, "Missing domain");
+  }
+
+  if (keys.empty()) {
+    return Status(0, "OK");
+  }
+
+  if (RegistryFactory::get().external()) {
+    // External registries (extensions) do not have databases active.
+    // It is not possible to use an extension-based database.
+    auto json_object = JSON::newArray();
+    for (const auto& key : keys) {
+      json_object.pushCopy(key);
+    }
+
+    std::string serialized_keys;
+    auto status = json_object.toString(serialized_keys);
+    if (!status.ok()) {
+      return status;
+    }
+
+    PluginRequest request = {{"action", "remove_batch"},
+                             {"domain", domain},
+                             {"json", std::move(serialized_keys)}};
+    return Registry::call("database", request);
+  }
+
+  ReadLock lock(kDatabaseReset);
+  if (!DatabasePlugin::kDBInitialized) {
+    throw std::runtime_error("Cannot delete database values: " + keys.front());
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->removeBatch(domain, keys);
+  }
+}
+
 Status scanDatabaseKeys(const std::string& domain,
                         std::vector<std::string>& keys,
                         size_t max) {
@@ -440,6 +592,43 @@ Status scanDatabaseKeys(const std::string& domain,
   }
 }
 
+Status scanDatabaseValues(const std::string& domain,
+                          DatabaseStringValueList& results,
+                          const std::string& prefix,
+                          const std::string& start,
+                          size_t max) {
+  if (domain.empty()) {
+    return Status(1, "Missing domain");
+  }
+
+  if (RegistryFactory::get().external()) {
+    // External registries (extensions) do not have databases active.
+    // It is not possible to use an extension-based database.
+    PluginRequest request = {{"action", "scanValues"},
+                             {"domain", domain},
+                             {"prefix", prefix},
+                             {"start", start},
+                             {"max", std::to_string(max)}};
+    PluginResponse response;
+    auto status = Registry::call("database", request, response);
+
+    for (const auto& item : response) {
+      if (item.count("k") > 0 && item.count("v") > 0) {
+        results.emplace_back(item.at("k"), item.at("v"));
+      }
+    }
+    return status;
+  }
+
+  ReadLock lock(kDatabaseReset);
+  if (!DatabasePlugin::kDBInitialized) {
+    throw std::runtime_error("Cannot scan database values: " + prefix);
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->scanValues(domain, results, prefix, start, max);
+  }
+}
+
 void resetDatabase() {
   PluginRequest request = {{"action", "reset"}};
   Registry::call("database", request);
@@ -559,6 +748,54 @@ static Status migrateV1V2(void) {
   return Status::success();
 }
 
+static Status migrateV2V3(void) {
+  std::vector<std::string> keys;
+
+  // Event record lists moved from "eid:time,eid:time" strings to fixed-width
+  // binary records, see osquery/events/event_records.h.
+  Status s = scanDatabaseKeys(kEvents, keys, "records.");
+  if (!s.ok()) {
+    return Status::failure(
+        1, "Failed to scan event record keys from database: " + s.what());
+  }
+
+  for (const auto& key : keys) {
+    std::string value;
+    s = getDatabaseValue(kEvents, key, value);
+    if (!s.ok()) {
+      LOG(ERROR) << "Failed to read value for key '" << key
+                 << "'. Key will be kept but won't be migrated!";
+      continue;
+    }
+
+    std::string records;
+    records.reserve((value.size() / 22 + 1) * kEventRecordSize);
+    for (const auto& record : split(value, ",")) {
+      auto sep = record.find(':');
+      if (sep == std::string::npos) {
+        continue;
+      }
+
+      auto eid = tryTo<unsigned long long>(record.substr(0, sep), 10);
+      auto time = tryTo<unsigned long long>(record.substr(sep + 1), 10);
+      if (eid.isError() || time.isError()) {
+        LOG(WARNING) << "Dropping corrupted event record '" << record
+                     << "' in key '" << key << "'";
+        continue;
+      }
+      encodeEventRecord(eid.get(), time.get(), records);
+    }
+
+    s = setDatabaseValue(kEvents, key, records);
+    if (!s.ok()) {
+      LOG(ERROR) << "Failed to set migrated records for key '" << key << "'";
+      return Status::failure(1, "Failed to migrate event records");
+    }
+  }
+
+  return Status::success();
+}
+
 Status upgradeDatabase(int to_version) {
   LOG(INFO) << "Checking database version for migration";
 
@@ -596,6 +833,10 @@ Status upgradeDatabase(int to_version) {
       migrate_status = migrateV1V2();
       break;
 
+    case 2:
+      migrate_status = migrateV2V3();
+      break;
+
     default:
       LOG(ERROR) << "Logic error: the migration code is broken!";
       migrate_status = Status(1);
@@ -8,6 +8,7 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <algorithm>
 #include <iostream>
 
 #include "osquery/database/plugins/ephemeral.h"
@@ -142,4 +143,34 @@ Status EphemeralDatabasePlugin::scan(const std::string& domain,
   }
   return Status(0);
 }
+
+Status EphemeralDatabasePlugin::scanValues(const std::string& domain,
+                                           DatabaseStringValueList& results,
+                                           const std::string& prefix,
+                                           const std::string& start,
+                                           size_t max) const {
+  if (db_.count(domain) == 0) {
+    return Status(0);
+  }
+
+  const auto& values = db_.at(domain);
+  size_t count = 0;
+  for (auto it = values.lower_bound(std::max(prefix, start));
+       it != values.end();
+       ++it) {
+    if (it->first.compare(0, prefix.size(), prefix) != 0) {
+      break;
+    }
+    // Integer values are not readable as strings, see get.
+    auto value = boost::get<std::string>(&it->second);
+    if (value == nullptr) {
+      continue;
+    }
+    results.emplace_back(it->first, *value);
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
+  return Status(0);
+}
 } // namespace osquery
@@ -69,6 +69,13 @@ class EphemeralDatabasePlugin : public DatabasePlugin {
               const std::string& prefix,
               size_t max) const override;
 
+  /// Ordered key and value lookup method.
+  Status scanValues(const std::string& domain,
+                    DatabaseStringValueList& results,
+                    const std::string& prefix,
+                    const std::string& start,
+                    size_t max) const override;
+
  public:
   /// Database workflow: open and setup.
   Status setUp() override {
@@ -10,9 +10,15 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <memory>
+
 #include <rocksdb/db.h>
 #include <rocksdb/env.h>
+#include <rocksdb/filter_policy.h>
 #include <rocksdb/options.h>
+#include <rocksdb/slice_transform.h>
+#include <rocksdb/table.h>
 
 #include <osquery/filesystem.h>
 #include <osquery/logger.h>
@@ -74,6 +80,83 @@ void GlogRocksDBLogger::Logv(const char* format, va_list ap) {
   }
 }
 
+bool AppendMergeOperator::Merge(const rocksdb::Slice& key,
+                                const rocksdb::Slice* existing_value,
+                                const rocksdb::Slice& value,
+                                std::string* new_value,
+                                rocksdb::Logger* logger) const {
+  new_value->clear();
+  if (existing_value != nullptr) {
+    new_value->reserve(existing_value->size() + value.size());
+    new_value->assign(existing_value->data(), existing_value->size());
+  }
+  new_value->append(value.data(), value.size());
+  return true;
+}
+
+const char* EventsKeyPrefix::Name() const {
+  return "osquery.EventsKeyPrefix";
+}
+
+rocksdb::Slice EventsKeyPrefix::Transform(const rocksdb::Slice& key) const {
+  return rocksdb::Slice(key.data(), size(key));
+}
+
+bool EventsKeyPrefix::InDomain(const rocksdb::Slice& key) const {
+  return size(key) > 0;
+}
+
+bool EventsKeyPrefix::InRange(const rocksdb::Slice& prefix) const {
+  return size(prefix) == prefix.size();
+}
+
+size_t EventsKeyPrefix::size(const rocksdb::Slice& key) {
+  // The prefix is the key type and the subscriber's publisher and name.
+  size_t separators = 0;
+  for (size_t i = 0; i < key.size(); i++) {
+    if (key[i] == '.' && ++separators == 3) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Check if writes to a domain should force a sync.
+ *
+ * Events and file hashes are written often and may be lost in a crash, file
+ * hashes are calculated again. Syncing each write would serialize them.
+ */
+static bool syncDomain(const std::string& domain) {
+  return domain != kEvents && domain != kFileHashes;
+}
+
+rocksdb::ColumnFamilyOptions getDomainOptions(
+    const std::string& domain, const rocksdb::ColumnFamilyOptions& base) {
+  rocksdb::ColumnFamilyOptions options(base);
+  if (domain == kEvents) {
+    // Event rows and records are read by prefix scans and point lookups.
+    // Bloom filters let both skip files without the subscriber's keys.
+    options.prefix_extractor = std::make_shared<EventsKeyPrefix>();
+    options.memtable_prefix_bloom_size_ratio = 0.1;
+    rocksdb::BlockBasedTableOptions table_options;
+    table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
+    table_options.whole_key_filtering = true;
+    options.table_factory.reset(
+        rocksdb::NewBlockBasedTableFactory(table_options));
+
+    // Keys are written in time order and expired by ranges, the oldest files
+    // are compacted first so expired ranges are dropped early.
+    options.compaction_pri = rocksdb::kOldestSmallestSeqFirst;
+  } else if (domain == kLogs) {
+    // Buffered logs are a queue, written once then read in order and removed.
+    // Compact early so reads do not step over the removed entries.
+    options.level0_file_num_compaction_trigger = 2;
+    options.compaction_pri = rocksdb::kOldestSmallestSeqFirst;
+  }
+  return options;
+}
+
 Status RocksDBDatabasePlugin::setUp() {
   if (!DatabasePlugin::kDBAllowOpen) {
     LOG(WARNING) << RLOG(1629) << "Not allowed to set up database plugin";
@@ -107,18 +190,26 @@ Status RocksDBDatabasePlugin::setUp() {
     options_.max_background_flushes =
         static_cast<int>(FLAGS_rocksdb_background_flushes);
 
+    // Allow appends, such as event records, without a read-modify-write.
+    options_.merge_operator = std::make_shared<AppendMergeOperator>();
+
     // Create an environment to replace the default logger.
     if (logger_ == nullptr) {
       logger_ = std::make_shared<GlogRocksDBLogger>();
     }
     options_.info_log = logger_;
 
-    column_families_.push_back(rocksdb::ColumnFamilyDescriptor(
-        rocksdb::kDefaultColumnFamilyName, options_));
-
-    for (const auto& cf_name : kDomains) {
+    // A domain uses the handle at its index in kDomains, the column family
+    // names are offset by the default column family. Each column family is
+    // tuned for the domain that uses it, the last one is not used.
+    for (size_t i = 0; i <= kDomains.size(); i++) {
+      const auto& cf_name =
+          (i == 0) ? rocksdb::kDefaultColumnFamilyName : kDomains[i - 1];
+      auto cf_options = (i < kDomains.size())
+                            ? getDomainOptions(kDomains[i], options_)
+                            : rocksdb::ColumnFamilyOptions(options_);
       column_families_.push_back(
-          rocksdb::ColumnFamilyDescriptor(cf_name, options_));
+          rocksdb::ColumnFamilyDescriptor(cf_name, cf_options));
     }
   }
 
@@ -288,7 +379,7 @@ Status RocksDBDatabasePlugin::putBatch(const std::string& domain,
   if (kEvents == domain) {
     options.disableWAL = true;
   } else {
-    options.sync = true;
+    options.sync = syncDomain(domain);
   }
 
   rocksdb::WriteBatch batch;
@@ -313,6 +404,30 @@ Status RocksDBDatabasePlugin::putBatch(const std::string& domain,
   return Status(s.code(), s.ToString());
 }
 
+Status RocksDBDatabasePlugin::append(const std::string& domain,
+                                     const std::string& key,
+                                     const std::string& value) {
+  if (read_only_) {
+    return Status(0, "Database in readonly mode");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+
+  // See putBatch, events do not force syncs.
+  auto options = rocksdb::WriteOptions();
+  if (kEvents == domain) {
+    options.disableWAL = true;
+  } else {
+    options.sync = syncDomain(domain);
+  }
+
+  auto s = getDB()->Merge(options, cfh, key, value);
+  return Status(s.code(), s.ToString());
+}
+
 Status RocksDBDatabasePlugin::put(const std::string& domain,
                                   const std::string& key,
                                   int value) {
@@ -335,13 +450,33 @@ Status RocksDBDatabasePlugin::remove(const std::string& domain,
 
   // We could sync here, but large deletes will cause multi-syncs.
   // For example: event record expirations found in an expired index.
-  if (kEvents != domain) {
-    options.sync = true;
-  }
+  options.sync = syncDomain(domain);
   auto s = getDB()->Delete(options, cfh, key);
   return Status(s.code(), s.ToString());
 }
 
+Status RocksDBDatabasePlugin::removeBatch(
+    const std::string& domain, const std::vector<std::string>& keys) {
+  if (read_only_) {
+    return Status(0, "Database in readonly mode");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+
+  rocksdb::WriteBatch batch;
+  for (const auto& key : keys) {
+    batch.Delete(cfh, key);
+  }
+
+  auto options = rocksdb::WriteOptions();
+  options.sync = syncDomain(domain);
+  auto s = getDB()->Write(options, &batch);
+  return Status(s.code(), s.ToString());
+}
+
 Status RocksDBDatabasePlugin::removeRange(const std::string& domain,
                                           const std::string& low,
                                           const std::string& high) {
@@ -357,9 +492,7 @@ Status RocksDBDatabasePlugin::removeRange(const std::string& domain,
 
   // We could sync here, but large deletes will cause multi-syncs.
   // For example: event record expirations found in an expired index.
-  if (kEvents != domain) {
-    options.sync = true;
-  }
+  options.sync = syncDomain(domain);
   auto s = getDB()->DeleteRange(options, cfh, low, high);
   if (low <= high) {
     s = getDB()->Delete(options, cfh, high);
@@ -379,25 +512,116 @@ Status RocksDBDatabasePlugin::scan(const std::string& domain,
   if (cfh == nullptr) {
     return Status(1, "Could not get column family for " + domain);
   }
-  auto options = rocksdb::ReadOptions();
-  options.verify_checksums = false;
-  options.fill_cache = false;
-  auto it = getDB()->NewIterator(options, cfh);
+  auto options = getScanOptions(domain, prefix);
+  std::unique_ptr<rocksdb::Iterator> it(getDB()->NewIterator(options, cfh));
+  if (it == nullptr) {
+    return Status(1, "Could not get iterator for " + domain);
+  }
+
+  // Keys are ordered, seek to the prefix and stop after it.
+  size_t count = 0;
+  for (it->Seek(prefix); it->Valid(); it->Next()) {
+    if (!it->key().starts_with(prefix)) {
+      break;
+    }
+    results.push_back(it->key().ToString());
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
+  return Status(0, "OK");
+}
+
+Status RocksDBDatabasePlugin::scanValues(const std::string& domain,
+                                         DatabaseStringValueList& results,
+                                         const std::string& prefix,
+                                         const std::string& start,
+                                         size_t max) const {
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+  auto options = getScanOptions(domain, prefix);
+  std::unique_ptr<rocksdb::Iterator> it(getDB()->NewIterator(options, cfh));
   if (it == nullptr) {
     return Status(1, "Could not get iterator for " + domain);
   }
 
+  // Keys are ordered, seek to the first candidate and stop after the prefix.
   size_t count = 0;
-  for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    auto key = it->key().ToString();
-    if (key.find(prefix) == 0) {
-      results.push_back(std::move(key));
-      if (max > 0 && ++count >= max) {
-        break;
-      }
+  for (it->Seek(std::max(prefix, start)); it->Valid(); it->Next()) {
+    if (!it->key().starts_with(prefix)) {
+      break;
+    }
+    results.emplace_back(it->key().ToString(), it->value().ToString());
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
+  return Status(it->status().code(), it->status().ToString());
+}
+
+rocksdb::ReadOptions RocksDBDatabasePlugin::getScanOptions(
+    const std::string& domain, const std::string& prefix) const {
+  auto options = rocksdb::ReadOptions();
+  options.verify_checksums = false;
+  options.fill_cache = false;
+
+  // Only scans within one events key prefix may use the prefix bloom filters.
+  if (domain == kEvents && EventsKeyPrefix::size(prefix) > 0) {
+    options.prefix_same_as_start = true;
+  } else {
+    options.total_order_seek = true;
+  }
+  return options;
+}
+
+Status RocksDBDatabasePlugin::compact(const std::string& domain) {
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+
+  auto s = getDB()->Flush(rocksdb::FlushOptions(), cfh);
+  if (s.ok()) {
+    s = getDB()->CompactRange(
+        rocksdb::CompactRangeOptions(), cfh, nullptr, nullptr);
+  }
+  return Status(s.code(), s.ToString());
+}
+
+Status RocksDBDatabasePlugin::getStatistics(
+    const std::string& domain,
+    std::map<std::string, std::string>& stats) const {
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+
+  if (!getDB()->GetMapProperty(cfh, "rocksdb.cfstats", &stats)) {
+    return Status(1, "Could not get statistics for " + domain);
+  }
+
+  for (const auto& property : {"rocksdb.estimate-live-data-size",
+                               "rocksdb.total-sst-files-size",
+                               "rocksdb.estimate-num-keys"}) {
+    uint64_t value = 0;
+    if (getDB()->GetIntProperty(cfh, property, &value)) {
+      stats[property] = std::to_string(value);
     }
   }
-  delete it;
   return Status(0, "OK");
 }
 } // namespace osquery
@@ -9,8 +9,12 @@
  */
 
 #include <atomic>
+#include <map>
 
 #include <rocksdb/db.h>
+#include <rocksdb/merge_operator.h>
+#include <rocksdb/options.h>
+#include <rocksdb/slice_transform.h>
 
 #include <osquery/core.h>
 #include <osquery/database.h>
@@ -33,6 +37,58 @@ class GlogRocksDBLogger : public rocksdb::Logger {
   void Logv(const char* format, va_list ap) override;
 };
 
+/**
+ * @brief A RocksDB merge operator that concatenates operands.
+ *
+ * This backs RocksDBDatabasePlugin::append, allowing writers to append to a
+ * value without reading the existing value. The operands are combined during
+ * reads and compactions.
+ */
+class AppendMergeOperator : public rocksdb::AssociativeMergeOperator {
+ public:
+  bool Merge(const rocksdb::Slice& key,
+             const rocksdb::Slice* existing_value,
+             const rocksdb::Slice& value,
+             std::string* new_value,
+             rocksdb::Logger* logger) const override;
+
+  const char* Name() const override {
+    return "osquery.AppendMergeOperator";
+  }
+};
+
+/**
+ * @brief A RocksDB prefix extractor for the events domain.
+ *
+ * Events keys start with a key type and the subscriber's namespace, such as
+ * 'data.inotify.file_events.' followed by an EventID. Keys with a shorter
+ * prefix, such as the per-subscriber EventID counters, are not in the
+ * extractor's domain.
+ */
+class EventsKeyPrefix : public rocksdb::SliceTransform {
+ public:
+  const char* Name() const override;
+
+  rocksdb::Slice Transform(const rocksdb::Slice& key) const override;
+
+  bool InDomain(const rocksdb::Slice& key) const override;
+
+  bool InRange(const rocksdb::Slice& prefix) const override;
+
+  /// The size of a key's prefix, 0 if the key has no prefix.
+  static size_t size(const rocksdb::Slice& key);
+};
+
+/**
+ * @brief Return the column family options for a domain.
+ *
+ * The events domain uses prefix bloom filters and compacts its oldest files
+ * first. The logs domain is tuned for queue access. Other domains use the
+ * base options.
+ */
+rocksdb::ColumnFamilyOptions getDomainOptions(
+    const std::string& domain, const rocksdb::ColumnFamilyOptions& base);
+
 class RocksDBDatabasePlugin : public DatabasePlugin {
  public:
   /// Data retrieval method.
@@ -56,12 +112,21 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
   Status putBatch(const std::string& domain,
                   const DatabaseStringValueList& data) override;
 
+  /// Data append method, uses a RocksDB merge instead of a read and write.
+  Status append(const std::string& domain,
+                const std::string& key,
+                const std::string& value) override;
+
   void dumpDatabase() const override;
 
   /// Data removal method.
   Status remove(const std::string& domain, const std::string& k) override;
 
   /// Data range removal method.
+  /// Data removal method for a set of keys, uses one write batch.
+  Status removeBatch(const std::string& domain,
+                     const std::vector<std::string>& keys) override;
+
   Status removeRange(const std::string& domain,
                      const std::string& low,
                      const std::string& high) override;
@@ -72,6 +137,13 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
               const std::string& prefix,
               size_t max) const override;
 
+  /// Ordered key and value lookup method.
+  Status scanValues(const std::string& domain,
+                    DatabaseStringValueList& results,
+                    const std::string& prefix,
+                    const std::string& start,
+                    size_t max) const override;
+
  public:
   /// Database workflow: open and setup.
   Status setUp() override;
@@ -84,6 +156,18 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
     close();
   }
 
+  /// Flush a domain's memtables and compact all of its files.
+  Status compact(const std::string& domain);
+
+  /**
+   * @brief Read the RocksDB statistics for a domain.
+   *
+   * The statistics include the compaction statistics, such as
+   * 'compaction.Sum.WriteAmp', and the live data and file sizes.
+   */
+  Status getStatistics(const std::string& domain,
+                       std::map<std::string, std::string>& stats) const;
+
  private:
   /// Obtain a close lock and release resources.
   void close();
@@ -110,8 +194,9 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
    */
   void repairDB();
 
-  /// Flush memtables and trigger compaction.
-  void flush();
+  /// Read options for a scan, allowing prefix filtering when possible.
+  rocksdb::ReadOptions getScanOptions(const std::string& domain,
+                                      const std::string& prefix) const;
 
  private:
   /**
@@ -8,6 +8,7 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <algorithm>
 #include <sstream>
 
 #include <sqlite3.h>
@@ -126,20 +127,24 @@ static int getData(void* argument, int argc, char* argv[], char* column[]) {
 Status SQLiteDatabasePlugin::get(const std::string& domain,
                                  const std::string& key,
                                  std::string& value) const {
-  QueryData results;
-  char* err = nullptr;
-  std::string q = "select value from " + domain + " where key = '" + key + "';";
-  sqlite3_exec(db_, q.c_str(), getData, &results, &err);
-  if (err != nullptr) {
-    sqlite3_free(err);
+  // Values may be binary (event records), read them using their byte size.
+  std::string q = "select value from " + domain + " where key = ?1;";
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, q.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_finalize(stmt);
+    return Status(1);
   }
 
-  // Only assign value if the query found a result.
-  if (results.size() > 0) {
-    value = std::move(results[0]["value"]);
-    return Status(0);
+  sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_STATIC);
+  auto found = (sqlite3_step(stmt) == SQLITE_ROW);
+  if (found) {
+    // Only assign value if the query found a result.
+    auto data = static_cast<const char*>(sqlite3_column_blob(stmt, 0));
+    auto size = static_cast<size_t>(sqlite3_column_bytes(stmt, 0));
+    value.assign((data != nullptr) ? data : "", size);
   }
-  return Status(1);
+  sqlite3_finalize(stmt);
+  return Status((found) ? 0 : 1);
 }
 
 Status SQLiteDatabasePlugin::get(const std::string& domain,
@@ -220,7 +225,11 @@ Status SQLiteDatabasePlugin::putBatch(const std::string& domain,
       const auto& value = p.second;
 
       sqlite3_bind_text(stmt, i, key.c_str(), -1, SQLITE_STATIC);
-      sqlite3_bind_text(stmt, i + 1, value.c_str(), -1, SQLITE_STATIC);
+      sqlite3_bind_text(stmt,
+                        i + 1,
+                        value.data(),
+                        static_cast<int>(value.size()),
+                        SQLITE_STATIC);
 
       i += 2;
     }
@@ -313,4 +322,37 @@ Status SQLiteDatabasePlugin::scan(const std::string& domain,
 
   return Status(0, "OK");
 }
+
+Status SQLiteDatabasePlugin::scanValues(const std::string& domain,
+                                        DatabaseStringValueList& results,
+                                        const std::string& prefix,
+                                        const std::string& start,
+                                        size_t max) const {
+  // The key column is the primary key, an ordered range uses the index.
+  std::string q = "select key, value from " + domain +
+                  " where key >= ?1 and substr(key, 1, ?2) = ?3 order by key";
+  if (max > 0) {
+    q += " limit " + std::to_string(max);
+  }
+
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, q.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_finalize(stmt);
+    return Status(1, "Could not scan " + domain);
+  }
+
+  auto first = std::max(prefix, start);
+  sqlite3_bind_text(stmt, 1, first.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 2, static_cast<int>(prefix.size()));
+  sqlite3_bind_text(stmt, 3, prefix.c_str(), -1, SQLITE_STATIC);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    auto key = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    auto data = static_cast<const char*>(sqlite3_column_blob(stmt, 1));
+    auto size = static_cast<size_t>(sqlite3_column_bytes(stmt, 1));
+    results.emplace_back((key != nullptr) ? key : "",
+                         std::string((data != nullptr) ? data : "", size));
+  }
+  sqlite3_finalize(stmt);
+  return Status(0, "OK");
+}
 } // namespace osquery
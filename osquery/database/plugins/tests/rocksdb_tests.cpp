@@ -9,6 +9,7 @@
  */
 
 #include <osquery/filesystem.h>
+#include <osquery/registry_factory.h>
 #include <osquery/sql.h>
 
 #include "osquery/database/plugins/rocksdb.h"
@@ -55,4 +56,40 @@ TEST_F(RocksDBDatabasePluginTests, test_corruption) {
   resetDatabase();
   EXPECT_FALSE(pathExists(path_ + ".backup"));
 }
+
+TEST_F(RocksDBDatabasePluginTests, test_events_prefix) {
+  auto plugin = std::dynamic_pointer_cast<RocksDBDatabasePlugin>(
+      RegistryFactory::get().plugin("database", "rocksdb"));
+  ASSERT_NE(nullptr, plugin);
+
+  plugin->put(kEvents, "data.a.x.1", "1");
+  plugin->put(kEvents, "data.a.x.2", "2");
+  plugin->put(kEvents, "data.a.xy.1", "3");
+  plugin->put(kEvents, "data.b.x.1", "4");
+  plugin->put(kEvents, "eid.a.x", "2");
+
+  // Prefix scans do not return keys of other subscribers.
+  std::vector<std::string> keys;
+  ASSERT_TRUE(plugin->scan(kEvents, keys, "data.a.x.", 0).ok());
+  EXPECT_EQ(std::vector<std::string>({"data.a.x.1", "data.a.x.2"}), keys);
+
+  // The same holds for keys written before a compaction.
+  ASSERT_TRUE(plugin->compact(kEvents).ok());
+  keys.clear();
+  ASSERT_TRUE(plugin->scan(kEvents, keys, "data.a.x.2", 0).ok());
+  EXPECT_EQ(std::vector<std::string>({"data.a.x.2"}), keys);
+
+  DatabaseStringValueList values;
+  ASSERT_TRUE(plugin->scanValues(kEvents, values, "data.a.", "", 0).ok());
+  EXPECT_EQ(3U, values.size());
+
+  // Prefixes shorter than a subscriber's prefix scan in key order.
+  keys.clear();
+  ASSERT_TRUE(plugin->scan(kEvents, keys, "", 0).ok());
+  EXPECT_EQ(5U, keys.size());
+
+  std::map<std::string, std::string> stats;
+  EXPECT_TRUE(plugin->getStatistics(kEvents, stats).ok());
+  EXPECT_EQ(1U, stats.count("rocksdb.total-sst-files-size"));
 }
+} // namespace osquery
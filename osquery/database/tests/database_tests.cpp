@@ -13,6 +13,7 @@
 #include <osquery/database.h>
 
 #include "osquery/core/json.h"
+#include "osquery/events/event_records.h"
 #include "osquery/tests/test_util.h"
 
 #include <osquery/logger.h>
@@ -289,4 +290,37 @@ TEST_F(DatabaseTests, test_migration_v1v2) {
   EXPECT_EQ(value, "event_data");
 }
 
+TEST_F(DatabaseTests, test_migration_v2v3) {
+  /* Testing migration from 2 to 3 */
+  Status status = setDatabaseValue(kPersistentSettings, kDbVersionKey, "2");
+  ASSERT_TRUE(status.ok());
+
+  status = setDatabaseValue(kEvents,
+                            "records.auditeventpublisher.process_events.60.1",
+                            "0000000001:61,0000000002:62,bad,0000000003:119");
+  ASSERT_TRUE(status.ok());
+
+  status = upgradeDatabase(3);
+  ASSERT_TRUE(status.ok());
+
+  std::string value;
+  status = getDatabaseValue(kPersistentSettings, kDbVersionKey, value);
+  EXPECT_EQ(value, "3");
+
+  status = getDatabaseValue(
+      kEvents, "records.auditeventpublisher.process_events.60.1", value);
+  EXPECT_TRUE(status.ok());
+  ASSERT_EQ(3 * kEventRecordSize, value.size());
+
+  std::vector<std::pair<uint64_t, uint64_t>> records;
+  decodeEventRecords(value, [&records](uint64_t eid, uint64_t time) {
+    records.push_back(std::make_pair(eid, time));
+  });
+  ASSERT_EQ(3U, records.size());
+  EXPECT_EQ(1U, records[0].first);
+  EXPECT_EQ(61U, records[0].second);
+  EXPECT_EQ(3U, records[2].first);
+  EXPECT_EQ(119U, records[2].second);
+}
+
 } // namespace osquery
@@ -172,6 +172,26 @@ void DatabasePluginTests::testGet() {
   reset.get();
 }
 
+void DatabasePluginTests::testAppend() {
+  getPlugin()->remove(kEvents, "test_append");
+  auto s = getPlugin()->append(kEvents, "test_append", "foo");
+  EXPECT_TRUE(s.ok());
+
+  s = getPlugin()->append(kEvents, "test_append", std::string("\0bar", 4));
+  EXPECT_TRUE(s.ok());
+
+  std::string r;
+  s = getPlugin()->get(kEvents, "test_append", r);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(r, std::string("foo\0bar", 7));
+
+  // An append following a put extends the put value.
+  getPlugin()->put(kEvents, "test_append", "baz");
+  getPlugin()->append(kEvents, "test_append", "1");
+  getPlugin()->get(kEvents, "test_append", r);
+  EXPECT_EQ(r, "baz1");
+}
+
 void DatabasePluginTests::testDelete() {
   getPlugin()->put(kQueries, "test_delete", "baz");
   auto s = getPlugin()->remove(kQueries, "test_delete");
@@ -179,6 +199,21 @@ void DatabasePluginTests::testDelete() {
   EXPECT_EQ(s.getMessage(), "OK");
 }
 
+void DatabasePluginTests::testDeleteBatch() {
+  getPlugin()->put(kQueries, "batch1", "1");
+  getPlugin()->put(kQueries, "batch2", "2");
+  getPlugin()->put(kQueries, "batch3", "3");
+  auto s = getPlugin()->removeBatch(kQueries, {"batch1", "batch3", "missing"});
+  EXPECT_TRUE(s.ok());
+
+  // Keys between the removed keys are kept.
+  std::string r;
+  EXPECT_FALSE(getPlugin()->get(kQueries, "batch1", r).ok());
+  EXPECT_TRUE(getPlugin()->get(kQueries, "batch2", r).ok());
+  EXPECT_EQ(r, "2");
+  EXPECT_FALSE(getPlugin()->get(kQueries, "batch3", r).ok());
+}
+
 void DatabasePluginTests::testDeleteRange() {
   getPlugin()->put(kQueries, "test_delete", "baz");
   getPlugin()->put(kQueries, "test1", "1");
@@ -248,4 +283,35 @@ void DatabasePluginTests::testScanLimit() {
   EXPECT_EQ(s.getMessage(), "OK");
   EXPECT_EQ(keys.size(), 2U);
 }
+
+void DatabasePluginTests::testScanValues() {
+  getPlugin()->put(kQueries, "test_values_a1", "1");
+  getPlugin()->put(kQueries, "test_values_a3", "3");
+  getPlugin()->put(kQueries, "test_values_a2", "2");
+  getPlugin()->put(kQueries, "test_values_b1", "4");
+  getPlugin()->put(kQueries, "test_values_0", "0");
+
+  // Pairs are returned in key order and only within the prefix.
+  DatabaseStringValueList values;
+  auto s = getPlugin()->scanValues(kQueries, values, "test_values_a", "", 0);
+  EXPECT_TRUE(s.ok());
+  DatabaseStringValueList expected = {{"test_values_a1", "1"},
+                                      {"test_values_a2", "2"},
+                                      {"test_values_a3", "3"}};
+  EXPECT_EQ(values, expected);
+
+  // The start key is inclusive and the max is respected.
+  values.clear();
+  s = getPlugin()->scanValues(
+      kQueries, values, "test_values_a", "test_values_a2", 1);
+  EXPECT_TRUE(s.ok());
+  expected = {{"test_values_a2", "2"}};
+  EXPECT_EQ(values, expected);
+
+  // A start after the prefix yields nothing.
+  values.clear();
+  s = getPlugin()->scanValues(kQueries, values, "test_values_a", "test_z", 0);
+  EXPECT_TRUE(s.ok());
+  EXPECT_TRUE(values.empty());
+}
 } // namespace osquery
@@ -33,17 +33,26 @@
   TEST_F(n, test_get) {                                                        \
     testGet();                                                                 \
   }                                                                            \
+  TEST_F(n, test_append) {                                                     \
+    testAppend();                                                              \
+  }                                                                            \
   TEST_F(n, test_delete) {                                                     \
     testDelete();                                                              \
   }                                                                            \
   TEST_F(n, test_delete_range) {                                               \
     testDeleteRange();                                                         \
   }                                                                            \
+  TEST_F(n, test_delete_batch) {                                               \
+    testDeleteBatch();                                                         \
+  }                                                                            \
   TEST_F(n, test_scan) {                                                       \
     testScan();                                                                \
   }                                                                            \
   TEST_F(n, test_scan_limit) {                                                 \
     testScanLimit();                                                           \
+  }                                                                            \
+  TEST_F(n, test_scan_values) {                                                \
+    testScanValues();                                                          \
   }
 
 namespace osquery {
@@ -91,9 +100,12 @@ class DatabasePluginTests : public testing::Test {
   void testPut();
   void testPutBatch();
   void testGet();
+  void testAppend();
   void testDelete();
   void testDeleteRange();
+  void testDeleteBatch();
   void testScan();
   void testScanLimit();
+  void testScanValues();
 };
 } // namespace osquery
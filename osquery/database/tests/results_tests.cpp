@@ -37,6 +37,44 @@ TEST_F(ResultsTests, test_simple_diff) {
   EXPECT_EQ(results.removed, o);
 }
 
+TEST_F(ResultsTests, test_hashed_diff) {
+  QueryData previous;
+  previous.push_back({{"foo", "bar"}, {"size", "1"}});
+  previous.push_back({{"foo", "baz"}, {"size", "2"}});
+  previous.push_back({{"foo", "baz"}, {"size", "2"}});
+
+  std::string stored;
+  EXPECT_TRUE(serializeQueryDataHashed(previous, stored).ok());
+  EXPECT_TRUE(isQueryDataHashed(stored));
+
+  // The stored rows can be read back as a set.
+  QueryDataSet stored_qds;
+  EXPECT_TRUE(deserializeQueryDataHashed(stored, stored_qds).ok());
+  EXPECT_EQ(stored_qds, QueryDataSet(previous.begin(), previous.end()));
+
+  // One duplicate is removed and one row is added.
+  QueryData current;
+  current.push_back({{"foo", "baz"}, {"size", "2"}});
+  current.push_back({{"foo", "bar"}, {"size", "1"}});
+  current.push_back({{"foo", "qux"}, {"size", "-3"}});
+
+  std::vector<uint64_t> hashes;
+  DiffResults results;
+  EXPECT_TRUE(diffHashed(stored, current, hashes, results).ok());
+  EXPECT_EQ(hashes.size(), current.size());
+  EXPECT_EQ(hashes[1], hashRow(previous[0]));
+
+  // The results match the set-based differential.
+  QueryDataSet previous_qds(previous.begin(), previous.end());
+  EXPECT_EQ(results, diff(previous_qds, current));
+  ASSERT_EQ(results.removed.size(), 1U);
+  EXPECT_EQ(results.removed[0].at("foo"), "baz");
+
+  // Column names and values cannot alias across fields.
+  EXPECT_NE(hashRow({{"a", "bc"}}), hashRow({{"ab", "c"}}));
+  EXPECT_FALSE(diffHashed("[]", current, hashes, results).ok());
+}
+
 TEST_F(ResultsTests, test_serialize_row) {
   auto results = getSerializedRow();
   auto doc = JSON::newObject();
@@ -60,6 +98,41 @@ TEST_F(ResultsTests, test_deserialize_row_json) {
   EXPECT_EQ(output, results.second);
 }
 
+TEST_F(ResultsTests, test_deserialize_row_binary) {
+  ColumnDictionary dict;
+  dict.add("pid");
+  dict.add("path");
+
+  Row r;
+  r["pid"] = "-42";
+  r["path"] = "/usr/bin/ls";
+  // Values that do not round-trip as integers are kept as bytes.
+  r["mode"] = "0755";
+  r["empty"] = "";
+  r["binary"] = std::string("a\0b", 3);
+
+  std::string output;
+  auto s = serializeRowBinary(r, dict, output);
+  EXPECT_TRUE(s.ok());
+  EXPECT_TRUE(isRowBinary(output));
+  EXPECT_NE('{', output[0]);
+
+  Row input;
+  s = deserializeRowBinary(output, dict, input);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(r, input);
+
+  // A dictionary missing the ordinals cannot decode the row.
+  input.clear();
+  s = deserializeRowBinary(output, ColumnDictionary(), input);
+  EXPECT_FALSE(s.ok());
+
+  // Truncated rows are detected.
+  input.clear();
+  s = deserializeRowBinary(output.substr(0, output.size() - 1), dict, input);
+  EXPECT_FALSE(s.ok());
+}
+
 TEST_F(ResultsTests, test_serialize_query_data) {
   auto results = getSerializedQueryData();
   auto doc = JSON::newArray();
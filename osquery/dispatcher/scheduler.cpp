@@ -26,7 +26,6 @@
 #include <osquery/system.h>
 
 #include "osquery/config/parsers/decorators.h"
-#include "osquery/core/process.h"
 #include "osquery/dispatcher/scheduler.h"
 #include "osquery/sql/sqlite_util.h"
 
@@ -51,6 +50,11 @@ FLAG(uint64,
 
 FLAG(uint64, schedule_epoch, 0, "Epoch for scheduled queries");
 
+FLAG(uint64,
+     schedule_workers,
+     1,
+     "Number of threads executing due scheduled queries, 1 to run serially");
+
 HIDDEN_FLAG(bool, enable_monitor, true, "Enable the schedule monitor");
 
 HIDDEN_FLAG(bool,
@@ -61,46 +65,39 @@ HIDDEN_FLAG(bool,
 /// Used to bypass (optimize-out) the set-differential of query results.
 DECLARE_bool(events_optimize);
 
-SQLInternal monitor(const std::string& name, const ScheduledQuery& query) {
+SQLInternal monitor(const std::string& name,
+                    const ScheduledQuery& query,
+                    const SQLiteDBInstanceRef& instance) {
   // Snapshot the performance and times for the worker before running.
-  auto pid = std::to_string(PlatformProcess::getCurrentPid());
-  auto r0 = SQL::selectFrom({"resident_size", "user_time", "system_time"},
-                            "processes",
-                            "pid",
-                            EQUALS,
-                            pid);
-  auto t0 = getUnixTime();
+  // CPU times are per-thread, both samples are taken on the worker running
+  // the query so concurrent workers are not charged for each other.
+  auto r0 = getResourceUsage();
   Config::get().recordQueryStart(name);
-  SQLInternal sql(query.query, true);
+  SQLInternal sql(query.query, instance, true);
   // Snapshot the performance after, and compare.
-  auto t1 = getUnixTime();
-  auto r1 = SQL::selectFrom({"resident_size", "user_time", "system_time"},
-                            "processes",
-                            "pid",
-                            EQUALS,
-                            pid);
-  if (r0.size() > 0 && r1.size() > 0) {
-    // Calculate a size as the expected byte output of results.
-    // This does not dedup result differentials and is not aware of snapshots.
-    size_t size = 0;
-    for (const auto& row : sql.rows()) {
-      for (const auto& column : row) {
-        size += column.first.size();
-        size += column.second.size();
-      }
+  auto r1 = getResourceUsage();
+
+  // Calculate a size as the expected byte output of results.
+  // This does not dedup result differentials and is not aware of snapshots.
+  size_t size = 0;
+  for (const auto& row : sql.rows()) {
+    for (const auto& column : row) {
+      size += column.first.size();
+      size += column.second.size();
     }
-    // Always called while processes table is working.
-    Config::get().recordQueryPerformance(name, t1 - t0, size, r0[0], r1[0]);
   }
+  Config::get().recordQueryPerformance(name, r0, r1, sql.rows().size(), size);
   return sql;
 }
 
-Status launchQuery(const std::string& name, const ScheduledQuery& query) {
+Status launchQuery(const std::string& name,
+                   const ScheduledQuery& query,
+                   const SQLiteDBInstanceRef& instance) {
   // Execute the scheduled query and create a named query object.
   LOG(INFO) << "Executing scheduled query " << name << ": " << query.query;
   runDecorators(DECORATE_ALWAYS);
 
-  auto sql = monitor(name, query);
+  auto sql = monitor(name, query, instance);
   if (!sql.ok()) {
     LOG(ERROR) << "Error executing scheduled query " << name << ": "
                << sql.getMessageString();
@@ -175,29 +172,162 @@ Status launchQuery(const std::string& name, const ScheduledQuery& query) {
   return status;
 }
 
+/// Execute a due scheduled query on the calling thread.
+static void runScheduledQuery(const ScheduledQueryJob& job,
+                              const SQLiteDBInstanceRef& instance) {
+  TablePlugin::kCacheInterval = job.query.splayed_interval;
+  TablePlugin::kCacheStep = job.step;
+
+  CodeProfiler codeProfiler(
+      (boost::format("scheduler.executing_query.%s") % job.name).str());
+  const auto status = launchQuery(job.name, job.query, instance);
+  codeProfiler.appendName(status.ok() ? ".success" : ".failure");
+}
+
+SchedulerWorkerPool::SchedulerWorkerPool(size_t workers) {
+  for (size_t i = 0; i < workers; i++) {
+    workers_.emplace_back(&SchedulerWorkerPool::work, this);
+  }
+}
+
+SchedulerWorkerPool::~SchedulerWorkerPool() {
+  stop();
+}
+
+bool SchedulerWorkerPool::enqueue(ScheduledQueryJob job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ || !pending_.insert(job.name).second) {
+      return false;
+    }
+    queue_.push_back(std::move(job));
+    std::push_heap(queue_.begin(), queue_.end(), ScheduledQueryJobCompare());
+  }
+  queued_.notify_one();
+  return true;
+}
+
+void SchedulerWorkerPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  completed_.wait(lock, [this]() { return pending_.empty() || stopping_; });
+}
+
+void SchedulerWorkerPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    // Drop queued queries, executing queries are allowed to complete.
+    for (const auto& job : queue_) {
+      pending_.erase(job.name);
+    }
+    queue_.clear();
+  }
+  queued_.notify_all();
+  completed_.notify_all();
+
+  for (auto& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  workers_.clear();
+}
+
+void SchedulerWorkerPool::work() {
+  // Each worker uses a private connection so queries do not contend for, or
+  // fall back to transient copies of, the primary database.
+  SQLiteDBInstanceRef instance;
+  size_t generation = 0;
+
+  while (true) {
+    ScheduledQueryJob job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queued_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+      if (stopping_) {
+        break;
+      }
+      std::pop_heap(queue_.begin(), queue_.end(), ScheduledQueryJobCompare());
+      job = std::move(queue_.back());
+      queue_.pop_back();
+    }
+
+    if (instance == nullptr || generation != SQLiteDBManager::generation()) {
+      generation = SQLiteDBManager::generation();
+      instance = SQLiteDBManager::getUnique();
+    }
+    runScheduledQuery(job, instance);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.erase(job.name);
+    }
+    completed_.notify_all();
+  }
+}
+
+/// Estimate the cost of a scheduled query from its previous executions.
+static size_t getScheduledQueryCost(const std::string& name) {
+  size_t cost = 0;
+  Config::get().getPerformanceStats(
+      name, ([&cost](const QueryPerformance& perf) {
+        if (perf.executions > 0) {
+          cost = static_cast<size_t>(perf.wall_time_ns / perf.executions);
+        }
+      }));
+  return cost;
+}
+
 void SchedulerRunner::start() {
+  if (FLAGS_schedule_workers > 1) {
+    workers_ = std::make_unique<SchedulerWorkerPool>(
+        static_cast<size_t>(FLAGS_schedule_workers));
+  }
+
   // Start the counter at the second.
   auto i = osquery::getUnixTime();
   for (; (timeout_ == 0) || (i <= timeout_); ++i) {
     auto start_time_point = std::chrono::steady_clock::now();
+    std::vector<ScheduledQueryJob> due;
     Config::get().scheduledQueries(
-        ([&i](std::string name, const ScheduledQuery& query) {
+        ([&i, &due](std::string name, const ScheduledQuery& query) {
           if (query.splayed_interval > 0 && i % query.splayed_interval == 0) {
-            TablePlugin::kCacheInterval = query.splayed_interval;
-            TablePlugin::kCacheStep = i;
-            {
-              CodeProfiler codeProfiler(
-                  (boost::format("scheduler.executing_query.%s") % name).str());
-              const auto status = launchQuery(name, query);
-              codeProfiler.appendName(status.ok() ? ".success" : ".failure");
-            };
+            ScheduledQueryJob job;
+            job.name = std::move(name);
+            job.query.query = query.query;
+            job.query.interval = query.interval;
+            job.query.splayed_interval = query.splayed_interval;
+            job.query.options = query.options;
+            job.step = i;
+            job.deadline = i + query.splayed_interval;
+            due.push_back(std::move(job));
           }
         }));
+
+    if (workers_ == nullptr) {
+      for (const auto& job : due) {
+        runScheduledQuery(job, nullptr);
+      }
+    } else {
+      for (auto& job : due) {
+        job.cost = getScheduledQueryCost(job.name);
+        auto name = job.name;
+        if (!workers_->enqueue(std::move(job))) {
+          VLOG(1) << "Scheduled query " << name
+                  << " is still pending, skipping this interval";
+        }
+      }
+    }
+
     // Configuration decorators run on 60 second intervals only.
     if ((i % 60) == 0) {
       runDecorators(DECORATE_INTERVAL, i);
     }
     if (FLAGS_schedule_reload > 0 && (i % FLAGS_schedule_reload) == 0) {
+      if (workers_ != nullptr) {
+        // Do not reset the SQL implementation or database under a query.
+        workers_->wait();
+      }
       if (FLAGS_schedule_reload_sql) {
         SQLiteDBManager::resetPrimary();
       }
@@ -226,6 +356,15 @@ void SchedulerRunner::start() {
       break;
     }
   }
+
+  if (workers_ != nullptr) {
+    // A bounded schedule completes the queries it dispatched.
+    if (!interrupted()) {
+      workers_->wait();
+    }
+    workers_->stop();
+    workers_.reset();
+  }
 }
 
 std::chrono::milliseconds SchedulerRunner::getCurrentTimeDrift() const
@@ -11,7 +11,13 @@
 #pragma once
 
 #include <chrono>
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include <osquery/dispatcher.h>
 
@@ -19,6 +25,98 @@
 
 namespace osquery {
 
+/// A scheduled query that is due and waiting for a scheduler worker.
+struct ScheduledQueryJob {
+  /// The unique name of the scheduled query.
+  std::string name;
+
+  /// A copy of the scheduled query, the schedule may change while queued.
+  ScheduledQuery query;
+
+  /// The schedule step when the query became due.
+  size_t step{0};
+
+  /// The schedule step when the query will become due again.
+  size_t deadline{0};
+
+  /// The average wall time of previous executions.
+  size_t cost{0};
+};
+
+/**
+ * @brief Order scheduled query jobs, the first to run compares greatest.
+ *
+ * Jobs with the nearest deadline run first, so short-interval queries are not
+ * delayed behind long-interval scans. Equal deadlines run the cheapest query
+ * first. A queued job's deadline does not move, so expensive queries are not
+ * starved by a stream of cheap ones.
+ */
+struct ScheduledQueryJobCompare {
+  bool operator()(const ScheduledQueryJob& lhs,
+                  const ScheduledQueryJob& rhs) const {
+    if (lhs.deadline != rhs.deadline) {
+      return lhs.deadline > rhs.deadline;
+    }
+    if (lhs.cost != rhs.cost) {
+      return lhs.cost > rhs.cost;
+    }
+    return lhs.step > rhs.step;
+  }
+};
+
+/**
+ * @brief A bounded pool of threads executing due scheduled queries.
+ *
+ * A query name is never queued or executed more than once at a time. If a
+ * query is still queued or executing when it becomes due again, that step is
+ * skipped. Each worker executes queries using its own SQLite connection,
+ * recreated when the set of attached virtual tables changes.
+ */
+class SchedulerWorkerPool : private boost::noncopyable {
+ public:
+  explicit SchedulerWorkerPool(size_t workers);
+  ~SchedulerWorkerPool();
+
+  /**
+   * @brief Queue a due scheduled query.
+   *
+   * @return false if the query name is already queued or executing.
+   */
+  bool enqueue(ScheduledQueryJob job);
+
+  /// Block until every queued and executing query completes.
+  void wait();
+
+  /// Stop and join the workers, queued queries are dropped.
+  void stop();
+
+ private:
+  /// The worker thread entry point.
+  void work();
+
+ private:
+  /// Worker threads.
+  std::vector<std::thread> workers_;
+
+  /// Due queries, a heap ordered by ScheduledQueryJobCompare.
+  std::vector<ScheduledQueryJob> queue_;
+
+  /// Names of queued and executing queries.
+  std::set<std::string> pending_;
+
+  /// Protects the queue, pending names, and stop request.
+  std::mutex mutex_;
+
+  /// Signaled when a query is queued or stop is requested.
+  std::condition_variable queued_;
+
+  /// Signaled when a query completes.
+  std::condition_variable completed_;
+
+  /// Set when the workers should exit.
+  bool stopping_{false};
+};
+
 /// A Dispatcher service thread that watches an ExtensionManagerHandler.
 class SchedulerRunner : public InternalRunnable {
  public:
@@ -55,9 +153,21 @@ class SchedulerRunner : public InternalRunnable {
   std::chrono::milliseconds time_drift_;
 
   const std::chrono::milliseconds max_time_drift_;
+
+  /// Workers executing due queries, when the schedule runs concurrently.
+  std::unique_ptr<SchedulerWorkerPool> workers_;
 };
 
-SQLInternal monitor(const std::string& name, const ScheduledQuery& query);
+/**
+ * @brief Execute a scheduled query and record its performance.
+ *
+ * @param name The unique name of the scheduled query.
+ * @param query The scheduled query.
+ * @param instance [optional] The SQLite connection, nullptr for a managed one.
+ */
+SQLInternal monitor(const std::string& name,
+                    const ScheduledQuery& query,
+                    const SQLiteDBInstanceRef& instance = nullptr);
 
 /// Start querying according to the config's schedule
 void startScheduler();
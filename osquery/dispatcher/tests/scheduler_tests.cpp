@@ -21,6 +21,7 @@ namespace osquery {
 
 DECLARE_bool(disable_logging);
 DECLARE_uint64(schedule_reload);
+DECLARE_uint64(schedule_workers);
 
 class SchedulerTests : public testing::Test {
   void SetUp() override {
@@ -63,6 +64,8 @@ TEST_F(SchedulerTests, test_monitor) {
   // performance stats are tracked independently.
   EXPECT_EQ(perf.executions, 1U);
   EXPECT_GT(perf.output_size, 0U);
+  EXPECT_EQ(perf.output_rows, 1U);
+  EXPECT_GT(perf.wall_time_ns, 0U);
 
   // A bit more testing, potentially redundant, check the database results.
   // Since we are only monitoring, no 'actual' results are stored.
@@ -259,4 +262,78 @@ TEST_F(SchedulerTests, test_scheduler_reload) {
   SchedulerRunner runner(expire, 1);
   FLAGS_schedule_reload = backup_reload;
 }
+
+TEST_F(SchedulerTests, test_scheduler_job_order) {
+  ScheduledQueryJobCompare compare;
+
+  // The nearest deadline runs first.
+  ScheduledQueryJob soon;
+  soon.deadline = 10;
+  soon.cost = 5;
+  ScheduledQueryJob later;
+  later.deadline = 20;
+  later.cost = 0;
+  EXPECT_TRUE(compare(later, soon));
+  EXPECT_FALSE(compare(soon, later));
+
+  // With equal deadlines the cheapest query runs first.
+  later.deadline = 10;
+  EXPECT_TRUE(compare(soon, later));
+}
+
+TEST_F(SchedulerTests, test_scheduler_workers_exclusive) {
+  // A pool without workers keeps everything queued.
+  SchedulerWorkerPool pool(0);
+
+  ScheduledQueryJob job;
+  job.name = "exclusive";
+  EXPECT_TRUE(pool.enqueue(std::move(job)));
+
+  // The same name may not be queued until the first completes.
+  ScheduledQueryJob again;
+  again.name = "exclusive";
+  EXPECT_FALSE(pool.enqueue(std::move(again)));
+
+  ScheduledQueryJob other;
+  other.name = "other";
+  EXPECT_TRUE(pool.enqueue(std::move(other)));
+
+  // Stopping drops queued queries and then rejects new ones.
+  pool.stop();
+  ScheduledQueryJob stopped;
+  stopped.name = "exclusive";
+  EXPECT_FALSE(pool.enqueue(std::move(stopped)));
+}
+
+TEST_F(SchedulerTests, test_scheduler_workers) {
+  std::string config = R"config(
+  {
+    "packs": {
+      "scheduler": {
+        "queries": {
+          "1": {"query": "select 1 as number", "interval": 1},
+          "2": {"query": "select * from time", "interval": 1},
+          "3": {"query": "select * from osquery_info", "interval": 1}
+        }
+      }
+    }
+  })config";
+  Config::get().update({{"data", config}});
+
+  auto backup_workers = FLAGS_schedule_workers;
+  FLAGS_schedule_workers = 2;
+
+  // Run the scheduler for a single step, dispatched queries are completed.
+  auto now = osquery::getUnixTime();
+  SchedulerRunner runner(static_cast<unsigned long int>(now), 1);
+  runner.start();
+  FLAGS_schedule_workers = backup_workers;
+
+  for (const auto& name : {"pack_scheduler_1", "pack_scheduler_2"}) {
+    QueryPerformance perf;
+    Config::get().getPerformanceStats(
+        name, ([&perf](const QueryPerformance& r) { perf = r; }));
+    EXPECT_EQ(perf.executions, 1U) << name;
+  }
+}
 }
@@ -8,7 +8,12 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <utility>
 
 #include <osquery/database.h>
@@ -20,6 +25,7 @@
 
 #include "osquery/core/conversions.h"
 #include "osquery/core/json.h"
+#include "osquery/sql/sqlite_util.h"
 
 namespace rj = rapidjson;
 
@@ -34,9 +40,37 @@ FLAG(bool,
      true,
      "Disable distributed queries (default true)");
 
+FLAG(uint64,
+     distributed_concurrency,
+     4,
+     "Maximum number of distributed queries to run at once (default 4)");
+
+FLAG(uint64,
+     distributed_query_timeout,
+     600,
+     "Seconds a distributed query may run, 0 is unlimited (default 600). "
+     "Checked between rows, a table still generating is not interrupted");
+
+FLAG(uint64,
+     distributed_max_rows,
+     0,
+     "Maximum rows in a distributed query result, 0 is unlimited (default 0)");
+
+FLAG(uint64,
+     distributed_max_bytes,
+     16 * 1024 * 1024,
+     "Maximum bytes in each distributed query result (default 16MB). "
+     "Concurrent queries may each hold this much");
+
+FLAG(uint64,
+     distributed_write_chunk_bytes,
+     1024 * 1024,
+     "Write completed distributed results once they exceed this size. "
+     "Results are not split, a chunk may be larger");
+
 const std::string kDistributedQueryPrefix{"distributed."};
 
-std::string Distributed::currentRequestId_{""};
+thread_local std::string Distributed::currentRequestId_{""};
 
 Status DistributedPlugin::call(const PluginRequest& request,
                                PluginResponse& response) {
@@ -91,10 +125,16 @@ size_t Distributed::getCompletedCount() {
 }
 
 Status Distributed::serializeResults(std::string& json) {
+  return serializeResults(results_, json);
+}
+
+Status Distributed::serializeResults(
+    const std::vector<DistributedQueryResult>& results, std::string& json) {
   auto doc = JSON::newObject();
   auto queries_obj = doc.getObject();
   auto statuses_obj = doc.getObject();
-  for (const auto& result : results_) {
+  auto messages_obj = doc.getObject();
+  for (const auto& result : results) {
     auto arr = doc.getArray();
     auto s = serializeQueryData(result.results, result.columns, doc, arr);
     if (!s.ok()) {
@@ -102,41 +142,131 @@ Status Distributed::serializeResults(std::string& json) {
     }
     doc.add(result.request.id, arr, queries_obj);
     doc.add(result.request.id, result.status.getCode(), statuses_obj);
+    if (!result.status.ok()) {
+      doc.addCopy(result.request.id, result.status.getMessage(), messages_obj);
+    }
   }
 
   doc.add("queries", queries_obj);
   doc.add("statuses", statuses_obj);
+  doc.add("messages", messages_obj);
   return doc.toString(json);
 }
 
-void Distributed::addResult(const DistributedQueryResult& result) {
-  results_.push_back(result);
+void Distributed::addResult(DistributedQueryResult result) {
+  results_.push_back(std::move(result));
+}
+
+DistributedQueryResult Distributed::runQuery(
+    const DistributedQueryRequest& request, size_t& bytes) {
+  LOG(INFO) << "Executing distributed query: " << request.id << ": "
+            << request.query;
+
+  // Keep track of the request executing on this thread.
+  Distributed::setCurrentRequestId(request.id);
+
+  // Concurrent queries use separate connections, see SQLiteDBManager::get.
+  auto dbc = SQLiteDBManager::get();
+  TableColumns columns;
+  QueryData rows;
+  auto status = getQueryColumnsInternal(request.query, columns, dbc);
+  if (status.ok()) {
+    QueryLimits limits;
+    limits.max_rows = FLAGS_distributed_max_rows;
+    limits.max_bytes = FLAGS_distributed_max_bytes;
+    limits.timeout = std::chrono::seconds(FLAGS_distributed_query_timeout);
+    status = queryInternal(request.query, rows, dbc, limits, bytes);
+  }
+  dbc->clearAffectedTables();
+
+  if (!status.ok()) {
+    LOG(ERROR) << "Error executing distributed query: " << request.id << ": "
+               << status.getMessage();
+    // A partial result is not sent.
+    rows.clear();
+  }
+
+  ColumnNames names;
+  for (const auto& column : columns) {
+    names.push_back(std::get<0>(column));
+  }
+  Distributed::setCurrentRequestId("");
+  return DistributedQueryResult(request, rows, names, status);
 }
 
 Status Distributed::runQueries() {
-  while (getPendingQueryCount() > 0) {
-    auto request = popRequest();
-    LOG(INFO) << "Executing distributed query: " << request.id << ": "
-              << request.query;
-
-    // Keep track of the currently executing request
-    Distributed::setCurrentRequestId(request.id);
-
-    SQL sql(request.query);
-    if (!sql.getStatus().ok()) {
-      LOG(ERROR) << "Error executing distributed query: " << request.id << ": "
-                 << sql.getMessageString();
-    }
+  std::mutex requests_mutex;
+  std::mutex results_mutex;
+  auto worker = [this, &requests_mutex, &results_mutex]() {
+    while (true) {
+      DistributedQueryRequest request;
+      {
+        std::lock_guard<std::mutex> lock(requests_mutex);
+        if (getPendingQueryCount() == 0) {
+          break;
+        }
+        request = popRequest();
+      }
 
-    DistributedQueryResult result(
-        request, sql.rows(), sql.columns(), sql.getStatus());
-    addResult(result);
+      size_t bytes = 0;
+      auto result = runQuery(request, bytes);
+
+      // Write results as they complete, in chunks, instead of all at once.
+      std::vector<DistributedQueryResult> completed;
+      size_t completed_bytes = 0;
+      {
+        std::lock_guard<std::mutex> lock(results_mutex);
+        addResult(std::move(result));
+        results_bytes_ += bytes;
+        if (results_bytes_ < FLAGS_distributed_write_chunk_bytes) {
+          continue;
+        }
+        completed.swap(results_);
+        std::swap(completed_bytes, results_bytes_);
+      }
+
+      // Other queries may complete while the chunk is written.
+      auto status = writeResults(completed);
+      if (!status.ok()) {
+        LOG(ERROR) << "Error writing distributed query results: "
+                   << status.getMessage();
+
+        // Keep the results, they are written again with the next chunk.
+        std::lock_guard<std::mutex> lock(results_mutex);
+        results_.insert(results_.end(),
+                        std::make_move_iterator(completed.begin()),
+                        std::make_move_iterator(completed.end()));
+        results_bytes_ += completed_bytes;
+      }
+    }
+  };
+
+  auto workers = std::min<size_t>(
+      std::max<size_t>(1, FLAGS_distributed_concurrency),
+      getPendingQueryCount());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < workers; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
   }
   return flushCompleted();
 }
 
 Status Distributed::flushCompleted() {
-  if (getCompletedCount() == 0) {
+  auto s = writeResults(results_);
+  if (s.ok()) {
+    results_.clear();
+    results_bytes_ = 0;
+  }
+  return s;
+}
+
+Status Distributed::writeResults(
+    const std::vector<DistributedQueryResult>& results) {
+  if (results.empty()) {
     return Status(0, "OK");
   }
 
@@ -145,20 +275,16 @@ Status Distributed::flushCompleted() {
     return Status(1, "Missing distributed plugin " + distributed_plugin);
   }
 
-  std::string results;
-  auto s = serializeResults(results);
+  std::string json;
+  auto s = serializeResults(results, json);
   if (!s.ok()) {
     return s;
   }
 
   PluginResponse response;
-  s = Registry::call("distributed",
-                     {{"action", "writeResults"}, {"results", results}},
-                     response);
-  if (s.ok()) {
-    results_.clear();
-  }
-  return s;
+  return Registry::call("distributed",
+                        {{"action", "writeResults"}, {"results", json}},
+                        response);
 }
 
 Status Distributed::acceptWork(const std::string& work) {
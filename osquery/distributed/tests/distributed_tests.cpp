@@ -9,6 +9,8 @@
  */
 
 #include <iostream>
+#include <mutex>
+#include <set>
 
 #include <gtest/gtest.h>
 
@@ -28,6 +30,28 @@ DECLARE_string(distributed_tls_write_endpoint);
 
 namespace osquery {
 
+DECLARE_uint64(distributed_concurrency);
+DECLARE_uint64(distributed_max_rows);
+DECLARE_uint64(distributed_write_chunk_bytes);
+
+class MockDistributedPlugin : public DistributedPlugin {
+ public:
+  Status getQueries(std::string& json) override {
+    json = queries;
+    return Status(0, "OK");
+  }
+
+  Status writeResults(const std::string& json) override {
+    std::lock_guard<std::mutex> lock(mutex);
+    writes.push_back(json);
+    return Status(0, "OK");
+  }
+
+  std::string queries;
+  std::vector<std::string> writes;
+  std::mutex mutex;
+};
+
 class DistributedTests : public testing::Test {
  protected:
   void TearDown() override {
@@ -195,4 +219,70 @@ TEST_F(DistributedTests, test_workflow) {
   EXPECT_EQ(dist.getPendingQueryCount(), 0U);
   EXPECT_EQ(dist.results_.size(), 0U);
 }
+
+TEST_F(DistributedTests, test_query_limits) {
+  auto max_rows = FLAGS_distributed_max_rows;
+  FLAGS_distributed_max_rows = 1;
+
+  DistributedQueryRequest request;
+  request.id = "limited";
+  request.query = "select 1 as a union all select 2 as a";
+
+  auto dist = Distributed();
+  size_t bytes = 0;
+  auto result = dist.runQuery(request, bytes);
+  EXPECT_FALSE(result.status.ok());
+  EXPECT_EQ(result.status.getMessage(), "Query exceeded the row limit");
+  EXPECT_TRUE(result.results.empty());
+
+  // The failure is reported with its message.
+  dist.addResult(result);
+  std::string json;
+  ASSERT_TRUE(dist.serializeResults(json).ok());
+  auto doc = JSON::newObject();
+  ASSERT_TRUE(doc.fromString(json).ok());
+  EXPECT_EQ(doc.doc()["statuses"]["limited"].GetInt(), 1);
+  EXPECT_EQ(std::string(doc.doc()["messages"]["limited"].GetString()),
+            "Query exceeded the row limit");
+
+  FLAGS_distributed_max_rows = max_rows;
+}
+
+TEST_F(DistributedTests, test_concurrent_chunked_writes) {
+  auto& rf = RegistryFactory::get();
+  auto plugin = std::make_shared<MockDistributedPlugin>();
+  plugin->queries =
+      "{\"queries\": {\"q1\": \"select 1 as a\", \"q2\": \"select 2 as a\", "
+      "\"q3\": \"select 3 as a\"}}";
+  rf.registry("distributed")->add("mock", plugin);
+  auto active = rf.getActive("distributed");
+  ASSERT_TRUE(rf.setActive("distributed", "mock").ok());
+
+  auto concurrency = FLAGS_distributed_concurrency;
+  auto chunk_bytes = FLAGS_distributed_write_chunk_bytes;
+  FLAGS_distributed_concurrency = 2;
+  FLAGS_distributed_write_chunk_bytes = 1;
+
+  auto dist = Distributed();
+  ASSERT_TRUE(dist.pullUpdates().ok());
+  EXPECT_EQ(dist.getPendingQueryCount(), 3U);
+  EXPECT_TRUE(dist.runQueries().ok());
+  EXPECT_EQ(dist.getPendingQueryCount(), 0U);
+
+  // Each result was written on its own as soon as it completed.
+  std::set<std::string> ids;
+  ASSERT_EQ(plugin->writes.size(), 3U);
+  for (const auto& write : plugin->writes) {
+    auto doc = JSON::newObject();
+    ASSERT_TRUE(doc.fromString(write).ok());
+    const auto& queries = doc.doc()["queries"];
+    ASSERT_EQ(queries.MemberCount(), 1U);
+    ids.insert(queries.MemberBegin()->name.GetString());
+  }
+  EXPECT_EQ(ids, std::set<std::string>({"q1", "q2", "q3"}));
+
+  FLAGS_distributed_concurrency = concurrency;
+  FLAGS_distributed_write_chunk_bytes = chunk_bytes;
+  rf.setActive("distributed", active);
+}
 }
@@ -8,13 +8,20 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <set>
+
 #include <benchmark/benchmark.h>
 
+#include <boost/tokenizer.hpp>
+
 #include <osquery/config.h>
+#include <osquery/database.h>
 #include <osquery/events.h>
 #include <osquery/registry_factory.h>
 #include <osquery/tables.h>
 
+#include "osquery/core/conversions.h"
+#include "osquery/events/pathset.h"
 #include "osquery/tests/test_util.h"
 
 namespace osquery {
@@ -78,6 +85,19 @@ class BenchmarkEventSubscriber
     expire_time_ = et;
   }
 
+  void benchmarkRecord(size_t eid, EventTime t) {
+    recordEvents({eid}, t);
+  }
+
+  size_t benchmarkGetRecords(EventTime t) {
+    return getRecords({"60." + std::to_string(t / 60)}, false).size();
+  }
+
+  void clearRecords(EventTime t) {
+    deleteDatabaseValue(
+        kEvents, "records." + dbNamespace() + ".60." + std::to_string(t / 60));
+  }
+
   void benchmarkGet(int low, int high) {
     RowGenerator::pull_type generator(std::bind(
         &EventSubscriberPlugin::get, this, std::placeholders::_1, low, high));
@@ -155,6 +175,24 @@ BENCHMARK(EVENTS_retrieve_events)
     ->ArgPair(0, 1000)
     ->ArgPair(0, 10000);
 
+static void EVENTS_retrieve_recent_events(benchmark::State& state) {
+  auto sub = std::make_shared<BenchmarkEventSubscriber>();
+
+  // Spread events over many bins and select only the most-recent minute.
+  for (int i = 0; i < state.range(0); i++) {
+    sub->benchmarkAdd(i * 10);
+  }
+
+  auto stop = (state.range(0) - 1) * 10;
+  while (state.KeepRunning()) {
+    sub->benchmarkGet(stop - 60, stop);
+  }
+
+  sub->clearRows();
+}
+
+BENCHMARK(EVENTS_retrieve_recent_events)->Arg(1000)->Arg(10000);
+
 static void EVENTS_gentable(benchmark::State& state) {
   auto sub = std::make_shared<BenchmarkEventSubscriber>();
 
@@ -192,4 +230,184 @@ BENCHMARK(EVENTS_add_and_gentable)
     ->ArgPair(0, 100)
     ->ArgPair(0, 1000)
     ->ArgPair(0, 10000);
+
+/// The comma-joined "eid:time" record list used before binary records.
+static void legacyRecordEvent(const std::string& key,
+                              size_t eid,
+                              EventTime t) {
+  std::string record_value;
+  getDatabaseValue(kEvents, key, record_value);
+  if (!record_value.empty()) {
+    record_value += ",";
+  }
+  record_value += std::to_string(eid) + ":" + std::to_string(t);
+  setDatabaseValue(kEvents, key, record_value);
+}
+
+static size_t legacyGetRecords(const std::string& key) {
+  std::string record_value;
+  getDatabaseValue(kEvents, key, record_value);
+
+  std::vector<EventRecord> records;
+  for (const auto& record : split(record_value, ",")) {
+    auto vals = split(record, ":");
+    if (vals.size() == 2) {
+      records.push_back(std::make_pair(
+          tryTo<size_t>(vals[0]).takeOr(size_t{0}),
+          static_cast<EventTime>(tryTo<long long>(vals[1]).takeOr(0ll))));
+    }
+  }
+  return records.size();
+}
+
+static void EVENTS_record_legacy(benchmark::State& state) {
+  std::string key = "records.benchmark.legacy.60.0";
+  while (state.KeepRunning()) {
+    // Fill a single 60-second bin with range(0) records.
+    for (int i = 0; i < state.range(0); i++) {
+      legacyRecordEvent(key, i, 1);
+    }
+    benchmark::DoNotOptimize(legacyGetRecords(key));
+    deleteDatabaseValue(kEvents, key);
+  }
+}
+
+BENCHMARK(EVENTS_record_legacy)->Arg(100)->Arg(1000)->Arg(10000);
+
+static void EVENTS_record_binary(benchmark::State& state) {
+  auto sub = std::make_shared<BenchmarkEventSubscriber>();
+  while (state.KeepRunning()) {
+    // Fill a single 60-second bin with range(0) records.
+    for (int i = 0; i < state.range(0); i++) {
+      sub->benchmarkRecord(i, 1);
+    }
+    benchmark::DoNotOptimize(sub->benchmarkGetRecords(1));
+    sub->clearRecords(1);
+  }
+  sub->clearRows();
+}
+
+BENCHMARK(EVENTS_record_binary)->Arg(100)->Arg(1000)->Arg(10000);
+
+/// Synthetic exclude patterns, one of three shapes per index.
+static std::string benchmarkPattern(int i) {
+  switch (i % 3) {
+  case 0:
+    return "/home/user" + std::to_string(i) + "/%%";
+  case 1:
+    return "/var/lib/app" + std::to_string(i) + "/cache/%";
+  default:
+    return "/opt/pkg" + std::to_string(i) + "/bin/tool";
+  }
+}
+
+/// Synthetic event paths, every other path is excluded.
+static std::vector<std::string> benchmarkEventPaths(int patterns) {
+  std::vector<std::string> paths;
+  for (int i = 0; i < 1000; i++) {
+    auto index = std::to_string((i * 7919) % patterns);
+    paths.push_back((i % 2 == 0) ? "/home/user" + index + "/.cache/file"
+                                 : "/srv/data/" + index + "/file.log");
+  }
+  return paths;
+}
+
+/// The tokenized multiset path set used before the compiled matcher.
+class LegacyPathSet {
+ public:
+  using Path = std::vector<std::string>;
+
+  struct Compare {
+    bool operator()(const Path& lhs, const Path& rhs) const {
+      size_t psize = std::min(lhs.size(), rhs.size());
+      size_t ndx;
+      for (ndx = 0; ndx < psize; ++ndx) {
+        if (lhs[ndx] == "**" || rhs[ndx] == "**") {
+          return false;
+        }
+        if (lhs[ndx] == "*" || rhs[ndx] == "*") {
+          continue;
+        }
+        int rc = lhs[ndx].compare(rhs[ndx]);
+        if (rc != 0) {
+          return rc < 0;
+        }
+      }
+      if ((ndx == rhs.size() && rhs[ndx - 1] == "*") ||
+          (ndx == lhs.size() && lhs[ndx - 1] == "*")) {
+        return false;
+      }
+      return lhs.size() < rhs.size();
+    }
+  };
+
+  static Path createPath(const std::string& str) {
+    boost::char_separator<char> sep{"/"};
+    boost::tokenizer<boost::char_separator<char>> tokens(str, sep);
+    return Path(tokens.begin(), tokens.end());
+  }
+
+  void insert(std::string pattern) {
+    replaceGlobWildcards(pattern);
+    auto path = createPath(pattern);
+    auto wild = std::find(path.begin(), path.end(), "**");
+    if (wild != path.end()) {
+      paths_.insert(Path(path.begin(), wild));
+      path.erase(wild + 1, path.end());
+    }
+    WriteLock lock(mutex_);
+    paths_.insert(std::move(path));
+  }
+
+  bool find(const std::string& str) const {
+    auto path = createPath(str);
+    ReadLock lock(mutex_);
+    return paths_.find(path) != paths_.end();
+  }
+
+ private:
+  std::multiset<Path, Compare> paths_;
+  mutable Mutex mutex_;
+};
+
+/// Match the parent and the path, as the file event publishers did.
+static bool isExcluded(const LegacyPathSet& matcher, const std::string& path) {
+  auto parent = path.substr(0, path.rfind('/'));
+  return matcher.find(parent) || matcher.find(path);
+}
+
+/// Match the parent and the path, as the file event publishers do.
+static bool isExcluded(const PathMatcher& matcher, const std::string& path) {
+  auto parent = std::min(path.rfind('/'), path.size());
+  return matcher.find(path.data(), parent) || matcher.find(path);
+}
+
+template <typename Matcher>
+static void benchmarkExcludes(benchmark::State& state, Matcher& matcher) {
+  for (int i = 0; i < state.range(0); i++) {
+    matcher.insert(benchmarkPattern(i));
+  }
+
+  auto paths = benchmarkEventPaths(static_cast<int>(state.range(0)));
+  while (state.KeepRunning()) {
+    for (const auto& path : paths) {
+      benchmark::DoNotOptimize(isExcluded(matcher, path));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * paths.size());
+}
+
+static void EVENTS_exclude_paths_legacy(benchmark::State& state) {
+  LegacyPathSet matcher;
+  benchmarkExcludes(state, matcher);
+}
+
+BENCHMARK(EVENTS_exclude_paths_legacy)->Arg(100)->Arg(10000);
+
+static void EVENTS_exclude_paths_matcher(benchmark::State& state) {
+  PathMatcher matcher;
+  benchmarkExcludes(state, matcher);
+}
+
+BENCHMARK(EVENTS_exclude_paths_matcher)->Arg(100)->Arg(10000);
 } // namespace osquery
@@ -8,6 +8,8 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <algorithm>
+
 #include <fnmatch.h>
 
 #include <boost/filesystem.hpp>
@@ -330,11 +332,12 @@ bool FSEventsEventPublisher::shouldFire(
     return false;
   }
 
-  auto path = ec->path.substr(0, ec->path.rfind('/'));
+  auto parent = std::min(ec->path.rfind('/'), ec->path.size());
   // Need to have two finds,
   // what if somebody excluded an individual file inside a directory
   if (!exclude_paths_.empty() &&
-      (exclude_paths_.find(path) || exclude_paths_.find(ec->path))) {
+      (exclude_paths_.find(ec->path.data(), parent) ||
+       exclude_paths_.find(ec->path))) {
     return false;
   }
 
@@ -0,0 +1,126 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace osquery {
+
+/**
+ * @brief Size of a single binary event record: a (eid, time) pair.
+ *
+ * Event subscribers bin (EventID, EventTime) pairs into 60-second lists stored
+ * under "records.<namespace>.60.<bin>". Each record is two fixed-width 64-bit
+ * little-endian integers so new records can be appended to the list without
+ * reading it back, and the list can be decoded without tokenizing.
+ */
+constexpr size_t kEventRecordSize = 2 * sizeof(uint64_t);
+
+/// Append a little-endian 64-bit integer to an encoded record list.
+inline void encodeRecordInteger(uint64_t value, std::string& out) {
+  for (size_t i = 0; i < sizeof(uint64_t); i++) {
+    out.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+/// Read a little-endian 64-bit integer from an encoded record list.
+inline uint64_t decodeRecordInteger(const char* data) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(uint64_t); i++) {
+    value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i]))
+             << (i * 8);
+  }
+  return value;
+}
+
+/// Append a binary (eid, time) record to an encoded record list.
+inline void encodeEventRecord(uint64_t eid, uint64_t time, std::string& out) {
+  encodeRecordInteger(eid, out);
+  encodeRecordInteger(time, out);
+}
+
+/**
+ * @brief Iterate the (eid, time) records within an encoded record list.
+ *
+ * A trailing partial record, for example from an interrupted write, is not
+ * passed to the predicate.
+ *
+ * @param records The binary-encoded list value.
+ * @param predicate A callable accepting (uint64_t eid, uint64_t time).
+ * @return The number of trailing bytes that did not form a complete record.
+ */
+template <typename Predicate>
+inline size_t decodeEventRecords(const std::string& records,
+                                 Predicate predicate) {
+  const auto count = records.size() / kEventRecordSize;
+  const auto* data = records.data();
+  for (size_t i = 0; i < count; i++) {
+    const auto* record = data + (i * kEventRecordSize);
+    predicate(decodeRecordInteger(record),
+              decodeRecordInteger(record + sizeof(uint64_t)));
+  }
+  return records.size() % kEventRecordSize;
+}
+
+/**
+ * @brief Parse the "indexes.<namespace>.60" bin list into ascending bins.
+ *
+ * The list is stored as comma-separated bin numbers in ascending order so it
+ * may be binary searched. Lists written by older versions appended bins in
+ * recording order, these are sorted and de-duplicated here.
+ */
+inline std::vector<uint64_t> decodeEventBins(const std::string& content) {
+  std::vector<uint64_t> bins;
+  bins.reserve(std::count(content.begin(), content.end(), ',') + 1);
+
+  bool sorted = true;
+  size_t i = 0;
+  while (i < content.size()) {
+    uint64_t bin = 0;
+    size_t digits = 0;
+    for (; i < content.size() && content[i] != ','; i++, digits++) {
+      if (content[i] >= '0' && content[i] <= '9') {
+        bin = (bin * 10) + static_cast<uint64_t>(content[i] - '0');
+      }
+    }
+    i++;
+
+    if (digits == 0) {
+      continue;
+    }
+    if (!bins.empty() && bin <= bins.back()) {
+      sorted = false;
+    }
+    bins.push_back(bin);
+  }
+
+  if (!sorted) {
+    std::sort(bins.begin(), bins.end());
+    bins.erase(std::unique(bins.begin(), bins.end()), bins.end());
+  }
+  return bins;
+}
+
+/// Join ascending bins into a "indexes.<namespace>.60" bin list.
+inline std::string encodeEventBins(const std::vector<uint64_t>& bins) {
+  std::string content;
+  for (const auto& bin : bins) {
+    if (!content.empty()) {
+      content.push_back(',');
+    }
+    content += std::to_string(bin);
+  }
+  return content;
+}
+} // namespace osquery
@@ -8,9 +8,11 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <algorithm>
 #include <chrono>
 #include <exception>
 #include <thread>
+#include <tuple>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/classification.hpp>
@@ -26,6 +28,7 @@
 #include <osquery/system.h>
 
 #include "osquery/core/conversions.h"
+#include "osquery/events/event_records.h"
 
 namespace osquery {
 
@@ -50,6 +53,11 @@ FLAG(uint64, events_expiry, 3600, "Timeout to expire event subscriber results");
 // overriding in subclasses
 FLAG(uint64, events_max, 50000, "Maximum number of events per type to buffer");
 
+FLAG(bool,
+     events_binary_rows,
+     true,
+     "Store buffered event rows using a compact binary encoding");
+
 static inline EventTime timeFromRecord(const std::string& record) {
   // Convert a stored index "as string bytes" to a time value.
   return static_cast<EventTime>(tryTo<long long>(record).takeOr(0ll));
@@ -68,7 +76,7 @@ static inline void getOptimizeData(EventTime& o_time,
                                    std::string& query_name,
                                    const std::string& publisher) {
   // Read the optimization time for the current executing query.
-  getDatabaseValue(kPersistentSettings, kExecutingQuery, query_name);
+  query_name = Config::get().getExecutingQuery();
   if (query_name.empty()) {
     o_time = 0;
     o_eid = 0;
@@ -92,8 +100,7 @@ static inline void setOptimizeData(EventTime time,
                                    size_t eid,
                                    const std::string& publisher) {
   // Store the optimization time and eid.
-  std::string query_name;
-  getDatabaseValue(kPersistentSettings, kExecutingQuery, query_name);
+  auto query_name = Config::get().getExecutingQuery();
   if (query_name.empty()) {
     return;
   }
@@ -102,24 +109,62 @@ static inline void setOptimizeData(EventTime time,
   setDatabaseValue(kEvents, "optimize_eid." + query_name, toIndex(eid));
 }
 
+/**
+ * @brief Apply an 'eid' constraint to an EventID range.
+ *
+ * The eid column is TEXT and SQLite compares its constraints as strings. Only
+ * fully zero-padded expressions order the same as the numeric EventID, other
+ * expressions are left for SQLite to filter.
+ */
+static inline void applyEventIDConstraint(const Constraint& constraint,
+                                          EventRange& range) {
+  if (constraint.expr.size() != 10 ||
+      !std::all_of(constraint.expr.begin(),
+                   constraint.expr.end(),
+                   [](char c) { return c >= '0' && c <= '9'; })) {
+    return;
+  }
+
+  auto expr = tryTo<std::size_t>(constraint.expr).takeOr(std::size_t{0});
+  if (constraint.op == EQUALS) {
+    range.eid_start = std::max(range.eid_start, expr);
+    range.eid_stop =
+        (range.eid_stop == 0) ? expr : std::min(range.eid_stop, expr);
+  } else if (constraint.op == GREATER_THAN) {
+    range.eid_start = std::max(range.eid_start, expr + 1);
+  } else if (constraint.op == GREATER_THAN_OR_EQUALS) {
+    range.eid_start = std::max(range.eid_start, expr);
+  } else if (constraint.op == LESS_THAN && expr > 1) {
+    range.eid_stop =
+        (range.eid_stop == 0) ? expr - 1 : std::min(range.eid_stop, expr - 1);
+  } else if (constraint.op == LESS_THAN_OR_EQUALS && expr > 0) {
+    range.eid_stop =
+        (range.eid_stop == 0) ? expr : std::min(range.eid_stop, expr);
+  }
+}
+
 void EventSubscriberPlugin::genTable(RowYield& yield, QueryContext& context) {
-  // Stop is an unsigned (-1), our end of time equivalent.
-  EventTime start = 0, stop = 0;
+  // The optimize time and EventID are used until the rows are generated.
+  WriteLock optimize_lock(optimize_lock_);
+
+  // Stop is 0, our end of time equivalent.
+  EventRange range;
   if (context.constraints["time"].getAll().size() > 0) {
     // Use the 'time' constraint to optimize backing-store lookups.
     for (const auto& constraint : context.constraints["time"].getAll()) {
       EventTime expr = timeFromRecord(constraint.expr);
       if (constraint.op == EQUALS) {
-        stop = start = expr;
+        range.stop = range.start = expr;
         break;
       } else if (constraint.op == GREATER_THAN) {
-        start = std::max(start, expr + 1);
+        range.start = std::max(range.start, expr + 1);
       } else if (constraint.op == GREATER_THAN_OR_EQUALS) {
-        start = std::max(start, expr);
-      } else if (constraint.op == LESS_THAN) {
-        stop = std::min(stop, expr - 1);
-      } else if (constraint.op == LESS_THAN_OR_EQUALS) {
-        stop = std::min(stop, expr);
+        range.start = std::max(range.start, expr);
+      } else if (constraint.op == LESS_THAN && expr > 1) {
+        range.stop =
+            (range.stop == 0) ? expr - 1 : std::min(range.stop, expr - 1);
+      } else if (constraint.op == LESS_THAN_OR_EQUALS && expr > 0) {
+        range.stop = (range.stop == 0) ? expr : std::min(range.stop, expr);
       }
     }
   } else if (Initializer::isDaemon() && FLAGS_events_optimize) {
@@ -127,7 +172,7 @@ void EventSubscriberPlugin::genTable(RowYield& yield, QueryContext& context) {
     // allows optimization, only emit events since the last query.
     std::string query_name;
     getOptimizeData(optimize_time_, optimize_eid_, query_name, dbNamespace());
-    start = optimize_time_;
+    range.start = optimize_time_;
     optimize_time_ = getUnixTime() - 1;
 
     // Track the queries that have selected data.
@@ -136,7 +181,18 @@ void EventSubscriberPlugin::genTable(RowYield& yield, QueryContext& context) {
       queries_.insert(query_name);
     }
   }
-  get(yield, start, stop);
+
+  // Use the 'eid' constraint to skip records before reading their rows.
+  for (const auto& constraint : context.constraints["eid"].getAll()) {
+    applyEventIDConstraint(constraint, range);
+  }
+
+  // The query may ask for events by time, such as the newest first.
+  if (!context.orderBy.empty() && context.orderBy[0].first == "time") {
+    range.sorted = true;
+    range.descending = context.orderBy[0].second;
+  }
+  getEvents(yield, range);
 }
 
 EventContextID EventPublisherPlugin::numEvents() const {
@@ -192,37 +248,37 @@ std::vector<std::string> EventSubscriberPlugin::getIndexes(EventTime start,
     return indexes;
   }
 
-  std::vector<std::string> bins, expirations;
-  boost::split(bins, content, boost::is_any_of(","));
-  for (const auto& bin : bins) {
-    auto step = timeFromRecord(bin);
-    auto step_start = step * 60;
-    auto step_stop = (step + 1) * 60;
-    if (step_stop <= expire_time_) {
-      expirations.push_back(bin);
-    } else if (step_start < expire_time_ && sort) {
-      expireRecords("60", bin, false);
-    }
+  // Bins are ascending, bins ending before the expire time are a prefix.
+  auto bins = decodeEventBins(content);
+  auto expired = std::lower_bound(bins.begin(), bins.end(), expire_time_ / 60);
+  if (sort && expired != bins.end() && *expired * 60 < expire_time_) {
+    // The bin containing the expire time is partially expired.
+    expireRecords("60", std::to_string(*expired), false);
+  }
 
-    if (step >= l_start && (r_stop == 0 || step < r_stop) && sort) {
-      indexes.push_back("60." + bin);
+  // Return indexes in binning order.
+  if (sort) {
+    auto first = std::lower_bound(bins.begin(), bins.end(), l_start);
+    auto last = (r_stop == 0)
+                    ? bins.end()
+                    : std::lower_bound(first, bins.end(), r_stop);
+    indexes.reserve(std::distance(first, last));
+    for (auto bin = first; bin != last; ++bin) {
+      indexes.push_back("60." + std::to_string(*bin));
     }
   }
 
   // Rewrite the index lists and delete each expired item.
-  if (!expirations.empty()) {
-    expireIndexes("60", bins, expirations);
-  }
-
-  // Return indexes in binning order.
-  if (sort) {
-    std::sort(indexes.begin(),
-              indexes.end(),
-              [](const std::string& left, const std::string& right) {
-                auto n1 = timeFromRecord(left.substr(left.find('.') + 1));
-                auto n2 = timeFromRecord(right.substr(right.find('.') + 1));
-                return n1 < n2;
-              });
+  if (expired != bins.begin()) {
+    std::vector<std::string> persisting, expirations;
+    persisting.reserve(bins.size());
+    for (auto bin = bins.begin(); bin != bins.end(); ++bin) {
+      persisting.push_back(std::to_string(*bin));
+      if (bin < expired) {
+        expirations.push_back(persisting.back());
+      }
+    }
+    expireIndexes("60", persisting, expirations);
   }
 
   // Update the new time that events expire to now - expiry.
@@ -240,20 +296,21 @@ void EventSubscriberPlugin::expireRecords(const std::string& list_type,
   auto data_key = "data." + dbNamespace();
 
   // If the expirations is not removing all records, rewrite the persisting.
-  std::vector<std::string> persisting_records;
+  std::string persisting_records;
+  size_t persisting_count = 0;
   // Request all records within this list-size + bin offset.
   auto expired_records = getRecords({list_type + '.' + index}, false);
   if (all && expired_records.size() > 1) {
     deleteDatabaseRange(kEvents,
-                        data_key + '.' + expired_records.begin()->first,
-                        data_key + '.' + expired_records.rbegin()->first);
+                        data_key + '.' + toIndex(expired_records.begin()->first),
+                        data_key + '.' + toIndex(expired_records.rbegin()->first));
   } else {
     for (const auto& record : expired_records) {
       if (record.second <= expire_time_) {
-        deleteDatabaseValue(kEvents, data_key + '.' + record.first);
+        deleteDatabaseValue(kEvents, data_key + '.' + toIndex(record.first));
       } else {
-        persisting_records.push_back(record.first + ':' +
-                                     std::to_string(record.second));
+        encodeEventRecord(record.first, record.second, persisting_records);
+        persisting_count++;
       }
     }
   }
@@ -261,10 +318,10 @@ void EventSubscriberPlugin::expireRecords(const std::string& list_type,
   // Either drop or overwrite the record list.
   if (all) {
     deleteDatabaseValue(kEvents, record_key + "." + list_type + "." + index);
-  } else if (persisting_records.size() < expired_records.size()) {
-    auto new_records = boost::algorithm::join(persisting_records, ",");
-    setDatabaseValue(
-        kEvents, record_key + "." + list_type + "." + index, new_records);
+  } else if (persisting_count < expired_records.size()) {
+    setDatabaseValue(kEvents,
+                     record_key + "." + list_type + "." + index,
+                     persisting_records);
   }
 }
 
@@ -288,6 +345,9 @@ void EventSubscriberPlugin::expireIndexes(
         persisting_indexes.end());
   }
 
+  // The most-recently recorded bin may have been removed from the index.
+  record_bin_ = 0;
+
   // Update the list of indexes with the non-expired indexes.
   auto new_indexes = boost::algorithm::join(persisting_indexes, ",");
   setDatabaseValue(kEvents, index_key + "." + list_type, new_indexes);
@@ -363,7 +423,8 @@ void EventSubscriberPlugin::expireCheck() {
 
   // Decode the value into a row structure to extract the time.
   Row r;
-  if (!deserializeRowJSON(content, r) || r.count("time") == 0) {
+  auto dictionary = getColumnDictionary();
+  if (!deserializeEventRow(content, *dictionary, r) || r.count("time") == 0) {
     return;
   }
 
@@ -385,40 +446,40 @@ bool EventSubscriberPlugin::executedAllQueries() const {
 
 std::vector<EventRecord> EventSubscriberPlugin::getRecords(
     const std::vector<std::string>& indexes, bool optimize) {
+  return getRecords(indexes, EventRange(), optimize);
+}
+
+std::vector<EventRecord> EventSubscriberPlugin::getRecords(
+    const std::vector<std::string>& indexes,
+    const EventRange& range,
+    bool optimize) {
   auto record_key = "records." + dbNamespace();
 
   std::vector<EventRecord> records;
   for (const auto& index : indexes) {
-    std::vector<std::string> bin_records;
-    {
-      std::string record_value;
-      getDatabaseValue(kEvents, record_key + "." + index, record_value);
-      if (record_value.empty()) {
-        // There are actually no events in this bin, interesting error case.
-        continue;
-      }
-
-      // Each list is tokenized into a record=event_id:time.
-      bin_records = split(record_value, ",");
+    std::string record_value;
+    getDatabaseValue(kEvents, record_key + "." + index, record_value);
+    if (record_value.empty()) {
+      // There are actually no events in this bin, interesting error case.
+      continue;
     }
 
-    // Iterate over every 2 items: EID:TIME.
-    for (const auto& record : bin_records) {
-      const auto vals = split(record, ":");
-      if (vals.size() != 2) {
-        LOG(WARNING) << "Event records mismatch: " << record
-                     << " does not have a matching eid/event_time";
-        continue;
-      }
-      const auto eid = vals[0];
-      const EventTime et = timeFromRecord(vals[1]);
-      if (FLAGS_events_optimize && optimize && et <= optimize_time_ + 1) {
-        auto eidr = timeFromRecord(eid);
-        if (eidr <= optimize_eid_) {
-          continue;
-        }
-      }
-      records.push_back(std::make_pair(eid, et));
+    // Each list is a sequence of fixed-width binary (eid, time) records.
+    auto remainder = decodeEventRecords(
+        record_value, [&](uint64_t eid, uint64_t et) {
+          if (FLAGS_events_optimize && optimize && et <= optimize_time_ + 1 &&
+              eid <= optimize_eid_) {
+            return;
+          }
+          if (!range.contains(static_cast<size_t>(eid), et)) {
+            return;
+          }
+          records.push_back(std::make_pair(static_cast<size_t>(eid), et));
+        });
+
+    if (remainder != 0) {
+      LOG(WARNING) << "Event records mismatch: " << index << " has "
+                   << remainder << " trailing bytes";
     }
   }
 
@@ -426,48 +487,66 @@ std::vector<EventRecord> EventSubscriberPlugin::getRecords(
 }
 
 Status EventSubscriberPlugin::recordEvents(
-    const std::vector<std::string>& event_id_list, EventTime event_time) {
+    const std::vector<size_t>& event_id_list, EventTime event_time) {
   WriteLock lock(event_record_lock_);
 
-  DatabaseStringValueList database_data;
-  database_data.reserve(2U);
-
   // The list key includes the list type (bin size) and the list ID (bin).
   // The list_id is the MOST-Specific key ID, the bin for this list.
   // If the event time was 13 and the time_list is 5 seconds, lid = 2.
-  auto list_id = boost::lexical_cast<std::string>(event_time / 60);
-  std::string time_value = boost::lexical_cast<std::string>(event_time);
+  auto list_bin = event_time / 60;
+  auto list_id = std::to_string(list_bin);
 
   // The record is identified by the event type then module name.
-  // Append the record (eid, unix_time) to the list bin.
+  // Append the records (eid, unix_time) to the list bin.
   auto database_key = "records." + dbNamespace() + ".60." + list_id;
   auto index_key = "indexes." + dbNamespace() + ".60";
 
-  std::string record_value;
-  getDatabaseValue(kEvents, database_key, record_value);
+  if (record_bin_ != list_bin + 1) {
+    // This may be a new list_id for list_key, append the ID to the indirect
+    // lookup for this list_key. The most-recent bin is remembered so the
+    // index is only inspected when events cross into a different bin.
+    std::string index_value;
+    getDatabaseValue(kEvents, index_key, index_value);
+    auto bins = decodeEventBins(index_value);
+
+    // Keep the index ascending, new bins are almost always the last.
+    auto bin = std::lower_bound(bins.begin(), bins.end(), list_bin);
+    if (bin == bins.end() || *bin != list_bin) {
+      bins.insert(bin, list_bin);
+      auto status =
+          setDatabaseValue(kEvents, index_key, encodeEventBins(bins));
+      if (!status.ok()) {
+        LOG(ERROR) << "Could not put Event Records";
+        return status;
+      }
+    }
 
-  for (const auto& eid : event_id_list) {
-    if (record_value.length() == 0) {
-      // This is a new list_id for list_key, append the ID to the indirect
-      // lookup for this list_key.
-      std::string index_value;
-      getDatabaseValue(kEvents, index_key, index_value);
-      if (index_value.length() == 0) {
-        // A new index.
-        index_value = list_id;
-      } else {
-        index_value += "," + list_id;
+    // Appends within a bin are whole records, but a list written before a
+    // restart may end with a partial record. Drop it once before appending,
+    // otherwise every following record would be misaligned.
+    std::string record_list;
+    getDatabaseValue(kEvents, database_key, record_list);
+    auto remainder = record_list.size() % kEventRecordSize;
+    if (remainder != 0) {
+      LOG(WARNING) << "Event records mismatch: " << list_id << " has "
+                   << remainder << " trailing bytes, truncating";
+      record_list.resize(record_list.size() - remainder);
+      auto status = setDatabaseValue(kEvents, database_key, record_list);
+      if (!status.ok()) {
+        LOG(ERROR) << "Could not put Event Records";
+        return status;
       }
-      database_data.push_back(std::make_pair(index_key, index_value));
-      record_value = eid + ":" + time_value;
-    } else {
-      // Tokenize a record using ',' and the EID/time using ':'.
-      record_value += "," + eid + ":" + time_value;
     }
+    record_bin_ = list_bin + 1;
   }
 
-  database_data.push_back(std::make_pair(database_key, record_value));
-  auto status = setDatabaseBatch(kEvents, database_data);
+  std::string record_value;
+  record_value.reserve(event_id_list.size() * kEventRecordSize);
+  for (const auto& eid : event_id_list) {
+    encodeEventRecord(eid, event_time, record_value);
+  }
+
+  auto status = appendDatabaseValue(kEvents, database_key, record_value);
   if (!status.ok()) {
     LOG(ERROR) << "Could not put Event Records";
   }
@@ -484,69 +563,93 @@ size_t EventSubscriberPlugin::getEventsMax() {
 }
 
 const std::string EventSubscriberPlugin::getEventID() {
+  return toIndex(nextEventID());
+}
+
+size_t EventSubscriberPlugin::nextEventID() {
   Status status;
   // First get an event ID from the meta key.
   std::string eid_key = "eid." + dbNamespace();
 
-  {
-    WriteLock lock(event_id_lock_);
-    if (last_eid_ == 0) {
-      std::string last_eid_value;
-      status = getDatabaseValue(kEvents, eid_key, last_eid_value);
-      if (!status.ok() || last_eid_value.empty()) {
-        last_eid_value = "0";
-      }
-      last_eid_ = boost::lexical_cast<size_t>(last_eid_value);
-    }
-
-    if (last_eid_ % 10 == 0) {
-      status = setDatabaseValue(kEvents, eid_key, toIndex(last_eid_ + 10));
+  WriteLock lock(event_id_lock_);
+  if (last_eid_ == 0) {
+    std::string last_eid_value;
+    status = getDatabaseValue(kEvents, eid_key, last_eid_value);
+    if (!status.ok() || last_eid_value.empty()) {
+      last_eid_value = "0";
     }
-    last_eid_++;
+    last_eid_ = boost::lexical_cast<size_t>(last_eid_value);
   }
 
-  return toIndex(last_eid_);
+  if (last_eid_ % 10 == 0) {
+    status = setDatabaseValue(kEvents, eid_key, toIndex(last_eid_ + 10));
+  }
+  return ++last_eid_;
 }
 
 void EventSubscriberPlugin::get(RowYield& yield,
                                 EventTime start,
                                 EventTime stop) {
-  // Get the records for this time range.
-  auto indexes = getIndexes(start, stop);
-  auto records = getRecords(indexes);
+  EventRange range;
+  range.start = start;
+  range.stop = stop;
+  getEvents(yield, range);
+}
 
-  std::string events_key = "data." + dbNamespace();
-  std::vector<std::string> mapped_records;
-  for (const auto& record : records) {
-    if (record.second >= start && (record.second <= stop || stop == 0)) {
-      mapped_records.push_back(events_key + "." + record.first);
-    }
+void EventSubscriberPlugin::getEvents(RowYield& yield,
+                                      const EventRange& range) {
+  auto indexes = getIndexes(range.start, range.stop);
+  if (range.sorted && range.descending) {
+    std::reverse(indexes.begin(), indexes.end());
   }
 
-  if (FLAGS_events_optimize && !records.empty()) {
-    // If records were returned save the ordered-last as the optimization EID.
-    auto const eidr_exp = tryTo<unsigned long int>(records.back().first, 10);
-    if (eidr_exp.isValue()) {
-      optimize_eid_ = static_cast<size_t>(eidr_exp.get());
-    }
-  }
+  // Sorted records are read one bin at a time. Bins partition time, so sorting
+  // each bin's records orders all of them, and later bins are not read if the
+  // caller stops early. Otherwise the records are read in one pass.
+  auto batches = (range.sorted) ? indexes.size() : 1;
 
-  // Select mapped_records using event_ids as keys.
+  std::string events_key = "data." + dbNamespace();
+  auto dictionary = getColumnDictionary();
   std::string data_value;
-  for (const auto& record : mapped_records) {
-    Row r;
-    auto status = getDatabaseValue(kEvents, record, data_value);
-    if (data_value.length() == 0) {
-      // There is no record here, interesting error case.
-      continue;
+  size_t last_eid = optimize_eid_;
+  for (size_t batch = 0; batch < batches; batch++) {
+    // Get the records for this time range, filtered while they are decoded.
+    auto records = (range.sorted) ? getRecords({indexes[batch]}, range)
+                                  : getRecords(indexes, range);
+    if (range.sorted) {
+      auto older = [](const EventRecord& l, const EventRecord& r) {
+        return std::tie(l.second, l.first) < std::tie(r.second, r.first);
+      };
+      if (range.descending) {
+        std::sort(records.rbegin(), records.rend(), older);
+      } else {
+        std::sort(records.begin(), records.end(), older);
+      }
     }
-    status = deserializeRowJSON(data_value, r);
-    data_value.clear();
-    if (status.ok()) {
-      yield(r);
+
+    // Select rows using event_ids as keys.
+    for (const auto& record : records) {
+      last_eid = std::max(last_eid, record.first);
+      Row r;
+      getDatabaseValue(
+          kEvents, events_key + "." + toIndex(record.first), data_value);
+      if (data_value.length() == 0) {
+        // There is no record here, interesting error case.
+        continue;
+      }
+      auto status = deserializeEventRow(data_value, *dictionary, r);
+      data_value.clear();
+      if (status.ok()) {
+        yield(r);
+      }
     }
   }
 
+  if (FLAGS_events_optimize) {
+    // Save the last EventID read as the optimization EID.
+    optimize_eid_ = last_eid;
+  }
+
   auto expiry = getEventsExpiry();
   if (expiry > 0) {
     // Make sure the configured expiration is at least the minimum needed to
@@ -571,6 +674,11 @@ Status EventSubscriberPlugin::add(const Row& r) {
   return addBatch(batch, getUnixTime());
 }
 
+Status EventSubscriberPlugin::add(const Row& r, EventTime time) {
+  std::vector<Row> batch = {r};
+  return addBatch(batch, time);
+}
+
 Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list) {
   return addBatch(row_list, getUnixTime());
 }
@@ -580,38 +688,47 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
   DatabaseStringValueList database_data;
   database_data.reserve(row_list.size());
 
-  std::vector<std::string> event_id_list;
+  std::vector<size_t> event_id_list;
   event_id_list.reserve(row_list.size());
 
   auto event_time = custom_event_time != 0 ? custom_event_time : getUnixTime();
   auto event_time_str = std::to_string(event_time);
 
   for (auto& row : row_list) {
+    auto eid = nextEventID();
     row["time"] = event_time_str;
-    row["eid"] = getEventID();
+    row["eid"] = toIndex(eid);
 
     // Serialize and store the row data, for query-time retrieval.
     std::string serialized_row;
-    auto status = serializeRowJSON(row, serialized_row);
+    auto status = serializeEventRow(row, serialized_row);
     if (!status.ok()) {
       VLOG(1) << status.getMessage();
       continue;
     }
 
-    // Then remove the newline.
-    if (serialized_row.size() > 0 && serialized_row.back() == '\n') {
-      serialized_row.pop_back();
-    }
-
     // Logger plugins may request events to be forwarded directly.
     // If no active logger is marked 'usesLogEvent' then this is a no-op.
-    EventFactory::forwardEvent(serialized_row);
+    if (EventFactory::hasForwarders()) {
+      if (!isRowBinary(serialized_row)) {
+        EventFactory::forwardEvent(serialized_row);
+      } else {
+        std::string forwarded_row;
+        if (serializeRowJSON(row, forwarded_row).ok()) {
+          // Then remove the newline.
+          if (forwarded_row.size() > 0 && forwarded_row.back() == '\n') {
+            forwarded_row.pop_back();
+          }
+          EventFactory::forwardEvent(forwarded_row);
+        }
+      }
+    }
 
     // Store the event data in the batch
     database_data.push_back(std::make_pair(
         "data." + dbNamespace() + "." + row["eid"], serialized_row));
 
-    event_id_list.push_back(std::move(row["eid"]));
+    event_id_list.push_back(eid);
     event_count_++;
   }
 
@@ -634,6 +751,86 @@ Status EventSubscriberPlugin::addBatch(std::vector<Row>& row_list,
   return recordEvents(event_id_list, event_time);
 }
 
+std::shared_ptr<const ColumnDictionary>
+EventSubscriberPlugin::getColumnDictionary(const Row* row) {
+  WriteLock lock(column_dictionary_lock_);
+  auto dictionary_key = "columns." + dbNamespace();
+  if (column_dictionary_ == nullptr) {
+    auto dictionary = std::make_shared<ColumnDictionary>();
+
+    // Ordinals already assigned to stored rows are kept.
+    std::string content;
+    getDatabaseValue(kEvents, dictionary_key, content);
+    if (!content.empty()) {
+      for (const auto& name : split(content, ",")) {
+        dictionary->add(name);
+      }
+    }
+
+    // Seed the dictionary using the subscriber's table schema.
+    auto size = dictionary->names.size();
+    if (Registry::get().exists("table", getName())) {
+      auto plugin = Registry::get().plugin("table", getName());
+      auto table = std::dynamic_pointer_cast<TablePlugin>(plugin);
+      if (table != nullptr) {
+        for (const auto& column : table->columns()) {
+          dictionary->add(std::get<0>(column));
+        }
+      }
+    }
+
+    if (dictionary->names.size() != size) {
+      setDatabaseValue(kEvents, dictionary_key, join(dictionary->names, ","));
+    }
+    column_dictionary_ = dictionary;
+  }
+
+  if (row != nullptr) {
+    // Extend, using a copy, if the row includes columns outside the schema.
+    std::shared_ptr<ColumnDictionary> extended = nullptr;
+    for (const auto& column : *row) {
+      if (column_dictionary_->ordinals.count(column.first) > 0 ||
+          column.first.empty() ||
+          column.first.find(',') != std::string::npos) {
+        continue;
+      }
+
+      if (extended == nullptr) {
+        extended = std::make_shared<ColumnDictionary>(*column_dictionary_);
+      }
+      extended->add(column.first);
+    }
+
+    if (extended != nullptr) {
+      setDatabaseValue(kEvents, dictionary_key, join(extended->names, ","));
+      column_dictionary_ = extended;
+    }
+  }
+  return column_dictionary_;
+}
+
+Status EventSubscriberPlugin::serializeEventRow(const Row& row,
+                                                std::string& out) {
+  if (FLAGS_events_binary_rows) {
+    return serializeRowBinary(row, *getColumnDictionary(&row), out);
+  }
+
+  auto status = serializeRowJSON(row, out);
+  // Then remove the newline.
+  if (status.ok() && out.size() > 0 && out.back() == '\n') {
+    out.pop_back();
+  }
+  return status;
+}
+
+Status EventSubscriberPlugin::deserializeEventRow(
+    const std::string& data, const ColumnDictionary& dictionary, Row& r) {
+  if (isRowBinary(data)) {
+    return deserializeRowBinary(data, dictionary, r);
+  }
+  return deserializeRowJSON(data, r);
+}
+
 EventPublisherRef EventSubscriberPlugin::getPublisher() const {
   return EventFactory::getEventPublisher(getType());
 }
@@ -692,6 +889,10 @@ void EventFactory::addForwarder(const std::string& logger) {
   getInstance().loggers_.push_back(logger);
 }
 
+bool EventFactory::hasForwarders() {
+  return !getInstance().loggers_.empty();
+}
+
 void EventFactory::forwardEvent(const std::string& event) {
   for (const auto& logger : getInstance().loggers_) {
     Registry::call("logger", logger, {{"event", event}});
@@ -13,8 +13,11 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cctype>
 #include <chrono>
 #include <iostream>
+#include <thread>
 
 #include <boost/utility/string_ref.hpp>
 
@@ -54,6 +57,12 @@ FLAG(bool,
      false,
      "Configure the audit subsystem from scratch");
 
+/// Number of raw audit records buffered between the reader and the parser.
+HIDDEN_FLAG(uint64,
+            audit_queue_size,
+            4096,
+            "Number of audit records buffered before records are dropped");
+
 // External flags; they are used to determine which rules need to be installed
 DECLARE_bool(audit_allow_fim_events);
 DECLARE_bool(audit_allow_process_events);
@@ -69,6 +78,28 @@ bool IsSELinuxRecord(const audit_reply& reply) noexcept {
   return (selinux_event_set.find(reply.type) != selinux_event_set.end());
 }
 
+/// The context of the active AuditdNetlink, for the audit_queue_stats table.
+std::weak_ptr<AuditdContext> kActiveAuditdContext;
+
+/// Protect the active context.
+std::mutex kActiveAuditdContextMutex;
+
+/// Wake a consumer that may be sleeping on an empty ring.
+void NotifyConsumer(std::mutex& mutex, std::condition_variable& cv) {
+  // Taking the mutex orders this notification after the consumer's check.
+  { std::lock_guard<std::mutex> lock(mutex); }
+  cv.notify_one();
+}
+
+/// Record the largest size a ring has reached, only called by its producer.
+template <typename T>
+void UpdateMaxSize(const SpscRing<T>& ring, std::atomic<std::uint64_t>& max) {
+  auto size = ring.size();
+  if (size > max.load(std::memory_order_relaxed)) {
+    max.store(size, std::memory_order_relaxed);
+  }
+}
+
 bool ShouldHandle(const audit_reply& reply) noexcept {
   if (IsSELinuxRecord(reply)) {
     return FLAGS_audit_allow_selinux_events;
@@ -99,9 +130,18 @@ enum AuditStatus {
   AUDIT_IMMUTABLE = 2,
 };
 
+AuditdContext::AuditdContext(size_t capacity)
+    : unprocessed_records(capacity), processed_events(capacity * 4) {}
+
 AuditdNetlink::AuditdNetlink() {
   try {
-    auditd_context_ = std::make_shared<AuditdContext>();
+    auditd_context_ = std::make_shared<AuditdContext>(
+        static_cast<size_t>(std::max<std::uint64_t>(FLAGS_audit_queue_size, 1)));
+
+    {
+      std::lock_guard<std::mutex> lock(kActiveAuditdContextMutex);
+      kActiveAuditdContext = auditd_context_;
+    }
 
     Dispatcher::addService(
         std::make_shared<AuditdNetlinkReader>(auditd_context_));
@@ -119,25 +159,78 @@ AuditdNetlink::AuditdNetlink() {
 std::vector<AuditEventRecord> AuditdNetlink::getEvents() noexcept {
   std::vector<AuditEventRecord> record_list;
 
+  auto& context = *auditd_context_;
+  if (context.processed_events.empty()) {
+    std::unique_lock<std::mutex> queue_lock(context.processed_events_mutex);
+    context.processed_records_cv.wait_for(
+        queue_lock, std::chrono::seconds(1), [&context]() {
+          return !context.processed_events.empty();
+        });
+  }
+
+  drainEvents(context, record_list);
+  return record_list;
+}
+
+void AuditdNetlink::drainEvents(AuditdContext& context,
+                                std::vector<AuditEventRecord>& record_list) {
+  record_list.reserve(record_list.size() + context.processed_events.size());
+
+  AuditEventRecord* record = nullptr;
+  while ((record = context.processed_events.consumerSlot()) != nullptr) {
+    // Move the record out, an empty slot does not hold on to the text of a
+    // large record for the lifetime of the ring.
+    record_list.push_back(std::move(*record));
+    context.processed_events.pop();
+  }
+}
+
+std::vector<AuditdQueueStats> AuditdNetlink::getQueueStats() {
+  std::vector<AuditdQueueStats> stats;
+
+  AuditdContextRef context;
   {
-    std::unique_lock<std::mutex> queue_lock(
-        auditd_context_->processed_events_mutex);
+    std::lock_guard<std::mutex> lock(kActiveAuditdContextMutex);
+    context = kActiveAuditdContext.lock();
+  }
 
-    if (auditd_context_->processed_records_cv.wait_for(
-            queue_lock, std::chrono::seconds(1)) ==
-        std::cv_status::no_timeout) {
-      record_list = std::move(auditd_context_->processed_events);
-      auditd_context_->processed_events.clear();
-    }
+  if (context == nullptr) {
+    return stats;
   }
 
-  return record_list;
+  AuditdQueueStats kernel;
+  kernel.queue = "kernel";
+  kernel.capacity = context->kernel_backlog_limit;
+  kernel.size = context->kernel_backlog;
+  kernel.dropped = context->kernel_lost;
+  stats.push_back(std::move(kernel));
+
+  AuditdQueueStats records;
+  records.queue = "records";
+  records.capacity = context->unprocessed_records.capacity();
+  records.size = context->unprocessed_records.size();
+  records.max_size = context->records_max_size;
+  records.pushed = context->records_received;
+  records.dropped = context->records_dropped;
+  records.stalls = context->records_stalls;
+  stats.push_back(std::move(records));
+
+  AuditdQueueStats events;
+  events.queue = "events";
+  events.capacity = context->processed_events.capacity();
+  events.size = context->processed_events.size();
+  events.max_size = context->events_max_size;
+  events.pushed = context->events_parsed;
+  events.dropped = context->events_dropped;
+  events.stalls = context->events_stalls;
+  stats.push_back(std::move(events));
+
+  return stats;
 }
 
 AuditdNetlinkReader::AuditdNetlinkReader(AuditdContextRef context)
     : InternalRunnable("AuditdNetlinkReader"),
-      auditd_context_(std::move(context)),
-      read_buffer_(4096U) {}
+      auditd_context_(std::move(context)) {}
 
 void AuditdNetlinkReader::start() {
   int counter_to_next_status_request = 0;
@@ -211,10 +304,13 @@ bool AuditdNetlinkReader::acquireMessages() noexcept {
   bool reset_handle = false;
   size_t events_received = 0;
 
+  auto& context = *auditd_context_;
+  auto& ring = context.unprocessed_records;
+
   // Attempt to read as many messages as possible before we exit, and terminate
   // early if we have been asked to terminate
   for (events_received = 0;
-       !interrupted() && events_received < read_buffer_.size();
+       !interrupted() && events_received < ring.capacity();
        events_received++) {
     errno = 0;
     int poll_status = ::poll(fds, 1, 2000);
@@ -235,10 +331,31 @@ bool AuditdNetlinkReader::acquireMessages() noexcept {
       break;
     }
 
-    audit_reply reply = {};
+    // Receive directly into the next ring slot. If the parser has fallen
+    // behind, wake it and give it a moment to free a slot before dropping.
+    auto* reply = ring.producerSlot();
+    if (reply == nullptr) {
+      context.records_stalls++;
+      NotifyConsumer(context.unprocessed_records_mutex,
+                     context.unprocessed_records_cv);
+
+      auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+      while (reply == nullptr && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+        reply = ring.producerSlot();
+      }
+    }
+
+    bool dropped = (reply == nullptr);
+    if (dropped) {
+      // The record must still be read to keep the kernel backlog moving.
+      reply = &drop_buffer_;
+    }
+
     ssize_t len = recvfrom(audit_netlink_handle_,
-                           &reply.msg,
-                           sizeof(reply.msg),
+                           &reply->msg,
+                           sizeof(reply->msg),
                            0,
                            reinterpret_cast<struct sockaddr*>(&nladdr),
                            &nladdrlen);
@@ -261,8 +378,8 @@ bool AuditdNetlinkReader::acquireMessages() noexcept {
       break;
     }
 
-    if (!NLMSG_OK(&reply.msg.nlh, static_cast<unsigned int>(len))) {
-      if (len == sizeof(reply.msg)) {
+    if (!NLMSG_OK(&reply->msg.nlh, static_cast<unsigned int>(len))) {
+      if (len == sizeof(reply->msg)) {
         VLOG(1) << "Netlink event too big (EFBIG)";
       } else {
         VLOG(1) << "Broken netlink event (EBADE)";
@@ -272,22 +389,19 @@ bool AuditdNetlinkReader::acquireMessages() noexcept {
       break;
     }
 
-    read_buffer_[events_received] = reply;
+    if (dropped) {
+      context.records_dropped++;
+      continue;
+    }
+
+    ring.push();
+    context.records_received++;
+    UpdateMaxSize(ring, context.records_max_size);
   }
 
   if (events_received != 0) {
-    std::unique_lock<std::mutex> lock(
-        auditd_context_->unprocessed_records_mutex);
-
-    auditd_context_->unprocessed_records.reserve(
-        auditd_context_->unprocessed_records.size() + events_received);
-
-    auditd_context_->unprocessed_records.insert(
-        auditd_context_->unprocessed_records.end(),
-        read_buffer_.begin(),
-        std::next(read_buffer_.begin(), events_received));
-
-    auditd_context_->unprocessed_records_cv.notify_all();
+    NotifyConsumer(context.unprocessed_records_mutex,
+                   context.unprocessed_records_cv);
   }
 
   if (reset_handle) {
@@ -661,91 +775,97 @@ AuditdNetlinkParser::AuditdNetlinkParser(AuditdContextRef context)
       auditd_context_(std::move(context)) {}
 
 void AuditdNetlinkParser::start() {
-  while (!interrupted()) {
-    std::vector<audit_reply> queue;
-
-    {
-      std::unique_lock<std::mutex> lock(
-          auditd_context_->unprocessed_records_mutex);
+  auto& context = *auditd_context_;
 
-      while (auditd_context_->unprocessed_records.empty() && !interrupted()) {
-        auditd_context_->unprocessed_records_cv.wait_for(
-            lock, std::chrono::seconds(1));
-      }
-
-      queue = std::move(auditd_context_->unprocessed_records);
-      auditd_context_->unprocessed_records.clear();
+  while (!interrupted()) {
+    if (context.unprocessed_records.empty()) {
+      std::unique_lock<std::mutex> lock(context.unprocessed_records_mutex);
+      context.unprocessed_records_cv.wait_for(
+          lock, std::chrono::seconds(1), [this, &context]() {
+            return !context.unprocessed_records.empty() || interrupted();
+          });
+      continue;
     }
 
-    std::vector<AuditEventRecord> audit_event_record_queue;
-    audit_event_record_queue.reserve(queue.size());
-
-    for (auto& reply : queue) {
-      if (interrupted()) {
-        break;
-      }
-
-      AdjustAuditReply(reply);
-
-      // This record carries the process id of the controlling daemon; in case
-      // we lost control of the audit service, we are going to request a reset
-      // as soon as we finish processing the pending queue
-      if (reply.type == AUDIT_GET) {
-        reply.status = static_cast<struct audit_status*>(NLMSG_DATA(reply.nlh));
-        auto new_pid = static_cast<pid_t>(reply.status->pid);
-
-        if (new_pid != getpid()) {
-          VLOG(1) << "Audit control lost to pid: " << new_pid;
+    ProcessRecords(context);
+  }
+}
 
-          if (FLAGS_audit_persist) {
-            VLOG(1) << "Attempting to reacquire control of the audit service";
-            auditd_context_->acquire_handle = true;
-          }
+size_t AuditdNetlinkParser::ProcessRecords(AuditdContext& context) noexcept {
+  size_t consumed = 0;
+  size_t published = 0;
+
+  audit_reply* reply = nullptr;
+  while ((reply = context.unprocessed_records.consumerSlot()) != nullptr) {
+    AdjustAuditReply(*reply);
+
+    // This record carries the process id of the controlling daemon; in case
+    // we lost control of the audit service, we are going to request a reset
+    // as soon as we finish processing the pending queue
+    if (reply->type == AUDIT_GET) {
+      reply->status =
+          static_cast<struct audit_status*>(NLMSG_DATA(reply->nlh));
+      context.kernel_backlog = reply->status->backlog;
+      context.kernel_backlog_limit = reply->status->backlog_limit;
+      context.kernel_lost = reply->status->lost;
+
+      auto new_pid = static_cast<pid_t>(reply->status->pid);
+      if (new_pid != getpid()) {
+        VLOG(1) << "Audit control lost to pid: " << new_pid;
+
+        if (FLAGS_audit_persist) {
+          VLOG(1) << "Attempting to reacquire control of the audit service";
+          context.acquire_handle = true;
         }
-
-        continue;
       }
 
+    } else if (ShouldHandle(*reply)) {
       // We are not interested in all messages; only get the ones related to
-      // user events, syscalls and SELinux events
-      if (!ShouldHandle(reply)) {
-        continue;
+      // user events, syscalls and SELinux events.
+      auto* record = context.processed_events.producerSlot();
+      if (record == nullptr) {
+        // Apply backpressure: the reader drops records once both rings fill.
+        context.events_stalls++;
+        NotifyConsumer(context.processed_events_mutex,
+                       context.processed_records_cv);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        break;
       }
 
-      AuditEventRecord audit_event_record = {};
-      if (!ParseAuditReply(reply, audit_event_record)) {
+      if (!ParseAuditReply(*reply, *record)) {
         VLOG(1) << "Malformed audit record received";
-        continue;
+        context.events_dropped++;
+        // The slot is not published, do not let it hold the record's text.
+        *record = AuditEventRecord();
+      } else {
+        context.processed_events.push();
+        context.events_parsed++;
+        UpdateMaxSize(context.processed_events, context.events_max_size);
+        published++;
       }
-
-      audit_event_record_queue.push_back(audit_event_record);
     }
 
-    // Save the new records and notify the reader
-    if (!audit_event_record_queue.empty()) {
-      std::lock_guard<std::mutex> queue_lock(
-          auditd_context_->processed_events_mutex);
-
-      auditd_context_->processed_events.reserve(
-          auditd_context_->processed_events.size() +
-          audit_event_record_queue.size());
-
-      auditd_context_->processed_events.insert(
-          auditd_context_->processed_events.end(),
-          audit_event_record_queue.begin(),
-          audit_event_record_queue.end());
-
-      auditd_context_->processed_records_cv.notify_all();
-    }
+    context.unprocessed_records.pop();
+    consumed++;
+  }
 
-    queue.clear();
-    audit_event_record_queue.clear();
+  // Notify the reader of the processed events.
+  if (published != 0) {
+    NotifyConsumer(context.processed_events_mutex,
+                   context.processed_records_cv);
   }
+
+  return consumed;
 }
 
 bool AuditdNetlinkParser::ParseAuditReply(
     const audit_reply& reply, AuditEventRecord& event_record) noexcept {
-  event_record = {};
+  // Reset the record, keeping its storage if a ring slot is being reused.
+  event_record.type = 0;
+  event_record.time = 0;
+  event_record.audit_id.clear();
+  event_record.fields.clear();
+  event_record.raw_data.clear();
 
   if (FLAGS_audit_debug) {
     std::cout << reply.type << ", " << std::string(reply.message, reply.len)
@@ -762,10 +882,16 @@ bool AuditdNetlinkParser::ParseAuditReply(
     return false;
   }
 
-  event_record.time =
-      tryTo<unsigned long int>(message_view.substr(6, 10).to_string(), 10)
-          .takeOr(event_record.time);
-  event_record.audit_id = message_view.substr(6, preamble_end - 6).to_string();
+  // The header is "audit(<seconds>.<milliseconds>:<serial>): ".
+  auto seconds = message_view.substr(6, 10);
+  if (seconds.size() == 10 &&
+      std::all_of(seconds.begin(), seconds.end(), ::isdigit)) {
+    for (auto digit : seconds) {
+      event_record.time = event_record.time * 10 + (digit - '0');
+    }
+  }
+  auto audit_id = message_view.substr(6, preamble_end - 6);
+  event_record.audit_id.assign(audit_id.data(), audit_id.size());
 
   // SELinux doesn't output valid audit records; just save them as they are
   if (IsSELinuxRecord(reply)) {
@@ -774,41 +900,54 @@ bool AuditdNetlinkParser::ParseAuditReply(
   }
 
   // Tokenize the message
-  boost::string_ref field_view(message_view.substr(preamble_end + 3));
+  auto field_view = message_view.substr(preamble_end + 3);
+  event_record.fields.parse(field_view.data(), field_view.size());
+  return true;
+}
+
+void AuditFields::parse(const char* data, size_t size) {
+  text_.assign(data, size);
+  fields_.clear();
 
-  // The linear search will construct series of key value pairs.
-  std::string key, value;
-  key.reserve(20);
-  value.reserve(256);
+  // The linear search will find series of key value pairs. Keys and values
+  // are always contiguous, so only their ranges are recorded.
+  size_t key_start = 0;
+  size_t key_size = 0;
+  size_t value_start = 0;
 
   // There are several ways of representing value data (enclosed strings,
   // etc).
   bool found_assignment{false};
   bool found_enclose{false};
 
-  for (const auto& c : field_view) {
+  auto add_field = [this, &key_start, &key_size, &value_start](
+                       size_t value_end) {
+    // Multiple space tokens are supported.
+    if (key_size == 0) {
+      return;
+    }
+
+    // A repeated key is kept, lookups by key resolve to the first field.
+    fields_.push_back({static_cast<std::uint32_t>(key_start),
+                       static_cast<std::uint32_t>(key_size),
+                       static_cast<std::uint32_t>(value_start),
+                       static_cast<std::uint32_t>(value_end - value_start)});
+  };
+
+  for (size_t i = 0; i < text_.size(); i++) {
     // Iterate over each character in the audit message.
+    char c = text_[i];
     if ((found_enclose && c == '"') || (!found_enclose && c == ' ')) {
-      if (c == '"') {
-        value += c;
-      }
-
       // This is a terminating sequence, the end of an enclosure or space
-      // tok.
-      if (!key.empty()) {
-        // Multiple space tokens are supported.
-        event_record.fields.emplace(
-            std::make_pair(std::move(key), std::move(value)));
+      // tok. The closing quote is part of the value.
+      if (!found_assignment) {
+        value_start = i;
       }
+      add_field((c == '"') ? i + 1 : i);
 
       found_enclose = false;
       found_assignment = false;
-
-      key.clear();
-      value.clear();
-
-    } else if (!found_assignment && c == ' ') {
-      // A field tokenizer.
+      key_size = 0;
 
     } else if (found_assignment) {
       // Enclosure sequences appear immediately following assignment.
@@ -816,23 +955,52 @@ bool AuditdNetlinkParser::ParseAuditReply(
         found_enclose = true;
       }
 
-      value += c;
-
     } else if (c == '=') {
       found_assignment = true;
+      value_start = i + 1;
 
     } else {
-      key += c;
+      if (key_size == 0) {
+        key_start = i;
+      }
+      key_size++;
     }
   }
 
   // Last step, if there was no trailing tokenizer.
-  if (!key.empty()) {
-    event_record.fields.emplace(
-        std::make_pair(std::move(key), std::move(value)));
+  if (found_assignment) {
+    add_field(text_.size());
+  } else if (key_size != 0) {
+    // A trailing key without an assignment has an empty value.
+    value_start = text_.size();
+    add_field(text_.size());
   }
+}
 
-  return true;
+bool AuditFields::find(boost::string_ref key, boost::string_ref& value) const
+    noexcept {
+  for (const auto& field : fields_) {
+    if (view(field.key_offset, field.key_size) == key) {
+      value = view(field.value_offset, field.value_size);
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t AuditFields::count(boost::string_ref key) const noexcept {
+  size_t matches = 0;
+  for (const auto& field : fields_) {
+    if (view(field.key_offset, field.key_size) == key) {
+      matches++;
+    }
+  }
+  return matches;
+}
+
+std::string AuditFields::at(boost::string_ref key) const {
+  boost::string_ref value;
+  return find(key, value) ? value.to_string() : std::string();
 }
 
 void AuditdNetlinkParser::AdjustAuditReply(audit_reply& reply) noexcept {
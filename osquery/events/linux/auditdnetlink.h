@@ -15,16 +15,21 @@
 #include <atomic>
 #include <condition_variable>
 #include <future>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include <boost/algorithm/hex.hpp>
+#include <boost/utility/string_ref.hpp>
 
 #include <osquery/dispatcher.h>
 
+#include "osquery/events/linux/spscring.h"
+
 namespace osquery {
 
 /// Netlink status, used by AuditNetlink::acquireHandle()
@@ -33,6 +38,76 @@ enum class NetlinkStatus { ActiveMutable, ActiveImmutable, Disabled, Error };
 /// Contains an audit_rule_data structure
 using AuditRuleDataObject = std::vector<std::uint8_t>;
 
+/**
+ * @brief The key=value fields of an audit record.
+ *
+ * The record text is copied once and each field is stored as a pair of
+ * (offset, size) ranges within it, in the order they appear. Keys and values
+ * are read as string references into the text; a std::string is only created
+ * when a subscriber copies a value into its row. Copies and moves are safe
+ * because the ranges are relative to the owned text. As with the map that
+ * was used before, a key that repeats resolves to its first value.
+ */
+class AuditFields final {
+ public:
+  /// Replace the fields by tokenizing a record's key=value text.
+  void parse(const char* data, size_t size);
+
+  /// Remove every field, keeping the allocated storage.
+  void clear() noexcept {
+    text_.clear();
+    fields_.clear();
+  }
+
+  /// Number of fields, in record order.
+  size_t size() const noexcept {
+    return fields_.size();
+  }
+
+  bool empty() const noexcept {
+    return fields_.empty();
+  }
+
+  /// The key of the field at a position.
+  boost::string_ref key(size_t index) const noexcept {
+    return view(fields_[index].key_offset, fields_[index].key_size);
+  }
+
+  /// The value of the field at a position.
+  boost::string_ref value(size_t index) const noexcept {
+    return view(fields_[index].value_offset, fields_[index].value_size);
+  }
+
+  /// Find the first field with a key, returns false if it does not exist.
+  bool find(boost::string_ref key, boost::string_ref& value) const noexcept;
+
+  /// Number of fields with a key.
+  size_t count(boost::string_ref key) const noexcept;
+
+  /// Copy the value of the first field with a key, or an empty string.
+  std::string at(boost::string_ref key) const;
+
+ private:
+  struct Field {
+    std::uint32_t key_offset;
+    std::uint32_t key_size;
+    std::uint32_t value_offset;
+    std::uint32_t value_size;
+  };
+
+  boost::string_ref view(std::uint32_t offset, std::uint32_t size) const
+      noexcept {
+    return boost::string_ref(text_.data() + offset, size);
+  }
+
+ private:
+  /// The record text following the header.
+  std::string text_;
+
+  /// Field ranges within the text.
+  std::vector<Field> fields_;
+};
+
 /// A single, prepared audit event record.
 struct AuditEventRecord final {
   /// Record type (i.e.: AUDIT_SYSCALL, AUDIT_PATH, ...)
@@ -46,7 +121,7 @@ struct AuditEventRecord final {
 
   /// The field list for this record. Valid for everything except SELinux
   /// records
-  std::map<std::string, std::string> fields;
+  AuditFields fields;
 
   /// The raw message, only valid for SELinux records (because they have broken
   /// syntax)
@@ -56,32 +131,85 @@ struct AuditEventRecord final {
 static_assert(std::is_move_constructible<AuditEventRecord>::value,
               "not move constructible");
 
+/// Usage and loss counters for one audit queue, see audit_queue_stats.
+struct AuditdQueueStats final {
+  /// The queue: kernel, records, or events
+  std::string queue;
+
+  /// Number of slots, or the kernel backlog limit
+  std::uint64_t capacity{0};
+
+  /// Number of entries waiting to be read
+  std::uint64_t size{0};
+
+  /// Largest number of waiting entries seen
+  std::uint64_t max_size{0};
+
+  /// Number of entries added
+  std::uint64_t pushed{0};
+
+  /// Number of entries dropped
+  std::uint64_t dropped{0};
+
+  /// Number of times the producer waited for space
+  std::uint64_t stalls{0};
+};
+
 // This structure is used to share data between the reading and processing
-// services
+// services. Each queue is a lock-free ring with a single producer and a
+// single consumer; the mutexes are only used by an idle consumer to sleep.
 struct AuditdContext final {
-  /// Unprocessed audit records
-  std::vector<audit_reply> unprocessed_records;
-  static_assert(
-      std::is_move_constructible<decltype(unprocessed_records)>::value,
-      "not move constructible");
+  explicit AuditdContext(size_t capacity);
 
-  /// Mutex for the list of unprocessed records
+  /// Unprocessed audit records, written by the reader and read by the parser
+  SpscRing<audit_reply> unprocessed_records;
+
+  /// Mutex used by the parser to wait for unprocessed records
   std::mutex unprocessed_records_mutex;
 
-  /// Processed events condition variable
+  /// Unprocessed records condition variable
   std::condition_variable unprocessed_records_cv;
 
-  /// This queue contains processed events
-  std::vector<AuditEventRecord> processed_events;
+  /// Processed events, written by the parser and read by the publisher
+  SpscRing<AuditEventRecord> processed_events;
 
-  /// Processed events queue mutex.
+  /// Mutex used by the publisher to wait for processed events
   std::mutex processed_events_mutex;
 
-  /// Used to wake up the thread that processes the raw audit records
+  /// Used to wake up the thread that reads the processed events
   std::condition_variable processed_records_cv;
 
   /// When set to true, the audit handle is (re)acquired
   std::atomic_bool acquire_handle{true};
+
+  /// Records received from the netlink and added to the ring
+  std::atomic<std::uint64_t> records_received{0};
+
+  /// Records received while the ring was full
+  std::atomic<std::uint64_t> records_dropped{0};
+
+  /// Times the reader waited for the parser to free a slot
+  std::atomic<std::uint64_t> records_stalls{0};
+
+  /// Largest number of unprocessed records seen by the reader
+  std::atomic<std::uint64_t> records_max_size{0};
+
+  /// Events parsed and added to the ring
+  std::atomic<std::uint64_t> events_parsed{0};
+
+  /// Malformed records that could not be parsed
+  std::atomic<std::uint64_t> events_dropped{0};
+
+  /// Times the parser waited for the publisher to free a slot
+  std::atomic<std::uint64_t> events_stalls{0};
+
+  /// Largest number of processed events seen by the parser
+  std::atomic<std::uint64_t> events_max_size{0};
+
+  /// Kernel backlog, limit, and lost record count from the last audit status
+  std::atomic<std::uint64_t> kernel_backlog{0};
+  std::atomic<std::uint64_t> kernel_backlog_limit{0};
+  std::atomic<std::uint64_t> kernel_lost{0};
 };
 
 using AuditdContextRef = std::shared_ptr<AuditdContext>;
@@ -118,9 +246,6 @@ class AuditdNetlinkReader final : public InternalRunnable {
   /// Shared data
   AuditdContextRef auditd_context_;
 
-  /// Read buffer used when receiving events from the netlink
-  std::vector<audit_reply> read_buffer_;
-
   /// The set of rules we applied (and that we'll uninstall when exiting)
   std::vector<audit_rule_data> installed_rule_list_;
 
@@ -129,6 +254,9 @@ class AuditdNetlinkReader final : public InternalRunnable {
 
   /// Netlink handle.
   int audit_netlink_handle_{-1};
+
+  /// Receives a record that is dropped because the ring is full
+  audit_reply drop_buffer_;
 };
 
 /// This service parses the raw audit records
@@ -144,6 +272,9 @@ class AuditdNetlinkParser final : public InternalRunnable {
   /// Adjusts the internal pointers of the audit_reply object
   static void AdjustAuditReply(audit_reply& reply) noexcept;
 
+  /// Parses every queued record, returns the number of records consumed
+  static size_t ProcessRecords(AuditdContext& context) noexcept;
+
  private:
   /// Shared data
   AuditdContextRef auditd_context_;
@@ -158,21 +289,31 @@ class AuditdNetlink final : private boost::noncopyable {
   /// Prepares the raw audit event records stored in the given context.
   std::vector<AuditEventRecord> getEvents() noexcept;
 
+  /// Moves every processed event out of a context's ring.
+  static void drainEvents(AuditdContext& context,
+                          std::vector<AuditEventRecord>& record_list);
+
+  /// Usage counters for the active context's queues and the kernel backlog.
+  static std::vector<AuditdQueueStats> getQueueStats();
+
  private:
   /// Shared data
   AuditdContextRef auditd_context_;
 };
 
 /// Handle quote and hex-encoded audit field content.
-inline std::string DecodeAuditPathValues(const std::string& s) {
+inline std::string DecodeAuditPathValues(boost::string_ref s) {
   if (s.size() > 1 && s[0] == '"') {
-    return s.substr(1, s.size() - 2);
+    return s.substr(1, s.size() - 2).to_string();
   }
 
   try {
-    return boost::algorithm::unhex(s);
+    std::string decoded;
+    decoded.reserve(s.size() / 2);
+    boost::algorithm::unhex(s.begin(), s.end(), std::back_inserter(decoded));
+    return decoded;
   } catch (const boost::algorithm::hex_decode_error& e) {
-    return s;
+    return s.to_string();
   }
 }
 } // namespace osquery
@@ -8,7 +8,10 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <algorithm>
 #include <array>
+#include <cerrno>
+#include <cstdlib>
 
 #include <osquery/flags.h>
 #include <osquery/logger.h>
@@ -317,36 +320,52 @@ const AuditEventRecord* GetEventRecord(const AuditEvent& event,
 };
 
 bool GetStringFieldFromMap(std::string& value,
-                           const std::map<std::string, std::string>& fields,
-                           const std::string& name,
+                           const AuditFields& fields,
+                           boost::string_ref name,
                            const std::string& default_value) noexcept {
-  auto it = fields.find(name);
-  if (it == fields.end()) {
+  boost::string_ref field_value;
+  if (!fields.find(name, field_value)) {
     value = default_value;
     return false;
   }
 
-  value = it->second;
+  value.assign(field_value.data(), field_value.size());
   return true;
 }
 
 bool GetIntegerFieldFromMap(std::uint64_t& value,
-                            const std::map<std::string, std::string>& field_map,
-                            const std::string& field_name,
+                            const AuditFields& fields,
+                            boost::string_ref field_name,
                             std::size_t base,
                             std::uint64_t default_value) noexcept {
-  std::string string_value;
-  if (!GetStringFieldFromMap(string_value, field_map, field_name, "")) {
+  boost::string_ref string_value;
+  if (!fields.find(field_name, string_value)) {
     value = default_value;
     return false;
   }
-  auto exp = tryTo<std::uint64_t>(string_value, base);
-  value = exp.takeOr(std::move(default_value));
-  return exp.isValue();
+
+  // Numeric fields are short, convert them without a heap allocation.
+  std::array<char, 32> buffer;
+  if (string_value.empty() || string_value.size() >= buffer.size()) {
+    value = default_value;
+    return false;
+  }
+  std::copy(string_value.begin(), string_value.end(), buffer.begin());
+  buffer[string_value.size()] = '\0';
+
+  char* end = nullptr;
+  errno = 0;
+  auto converted = std::strtoull(buffer.data(), &end, static_cast<int>(base));
+  if (errno != 0 || end != buffer.data() + string_value.size()) {
+    value = default_value;
+    return false;
+  }
+  value = converted;
+  return true;
 }
 
 void CopyFieldFromMap(Row& row,
-                      const std::map<std::string, std::string>& fields,
+                      const AuditFields& fields,
                       const std::string& name,
                       const std::string& default_value) noexcept {
   GetStringFieldFromMap(row[name], fields, name, default_value);
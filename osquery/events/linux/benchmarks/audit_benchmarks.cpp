@@ -0,0 +1,164 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#include "osquery/events/linux/auditdnetlink.h"
+
+namespace osquery {
+
+/// Records captured from an execve, in the order the netlink delivers them.
+static const std::vector<std::pair<int, std::string>> kAuditRecords = {
+    {AUDIT_SYSCALL,
+     "audit(1502573850.697:38395): arch=c000003e syscall=59 success=yes "
+     "exit=0 a0=23eb8e0 a1=23ebbc0 a2=23c9860 a3=7ffe18d32ed0 items=2 "
+     "ppid=6882 pid=7841 auid=1000 uid=1000 gid=1000 euid=1000 suid=1000 "
+     "fsuid=1000 egid=1000 sgid=1000 fsgid=1000 tty=pts1 ses=2 comm=\"sh\" "
+     "exe=\"/usr/bin/bash\" key=(null)"},
+    {AUDIT_EXECVE,
+     "audit(1502573850.697:38395): argc=3 a0=\"sh\" a1=\"-c\" "
+     "a2=\"ls -la /tmp\""},
+    {AUDIT_CWD, "audit(1502573850.697:38395): cwd=\"/home/user\""},
+    {AUDIT_PATH,
+     "audit(1502573850.697:38395): item=0 name=\"/usr/bin/sh\" inode=2101749 "
+     "dev=fd:00 mode=0100755 ouid=0 ogid=0 rdev=00:00 "
+     "obj=system_u:object_r:shell_exec_t:s0 nametype=NORMAL"},
+    {AUDIT_PATH,
+     "audit(1502573850.697:38395): item=1 name=\"/lib64/ld-linux-x86-64.so.2\" "
+     "inode=33604032 dev=fd:00 mode=0100755 ouid=0 ogid=0 rdev=00:00 "
+     "obj=system_u:object_r:ld_so_t:s0 nametype=NORMAL"},
+    {AUDIT_EOE, "audit(1502573850.697:38395): "},
+    {AUDIT_SYSCALL,
+     "audit(1502573850.701:38396): arch=c000003e syscall=42 success=yes "
+     "exit=0 a0=3 a1=7ffd0f3e8a40 a2=10 a3=0 items=0 ppid=7841 pid=7842 "
+     "auid=1000 uid=1000 gid=1000 euid=1000 suid=1000 fsuid=1000 egid=1000 "
+     "sgid=1000 fsgid=1000 tty=pts1 ses=2 comm=\"curl\" exe=\"/usr/bin/curl\" "
+     "key=(null)"},
+    {AUDIT_SOCKADDR,
+     "audit(1502573850.701:38396): saddr=020001BBC0A801010000000000000000"},
+    {AUDIT_EOE, "audit(1502573850.701:38396): "},
+};
+
+/// Replay a captured record into a ring slot as the reader would receive it.
+static void replayAuditRecord(audit_reply& reply, size_t index) {
+  const auto& record = kAuditRecords[index % kAuditRecords.size()];
+  reply.msg.nlh.nlmsg_type = record.first;
+  reply.msg.nlh.nlmsg_len = record.second.size();
+  memcpy(reply.msg.data, record.second.data(), record.second.size());
+}
+
+static void AUDIT_ring_replay(benchmark::State& state) {
+  auto count = static_cast<size_t>(state.range(0));
+  AuditdContext context(count);
+  std::vector<AuditEventRecord> records;
+
+  while (state.KeepRunning()) {
+    for (size_t i = 0; i < count; i++) {
+      auto* reply = context.unprocessed_records.producerSlot();
+      replayAuditRecord(*reply, i);
+      context.unprocessed_records.push();
+    }
+
+    AuditdNetlinkParser::ProcessRecords(context);
+    records.clear();
+    AuditdNetlink::drainEvents(context, records);
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(AUDIT_ring_replay)->Arg(64)->Arg(1024)->Arg(4096);
+
+static void AUDIT_parse_reply(benchmark::State& state) {
+  std::vector<audit_reply> replies(kAuditRecords.size());
+  for (size_t i = 0; i < replies.size(); i++) {
+    replayAuditRecord(replies[i], i);
+    AuditdNetlinkParser::AdjustAuditReply(replies[i]);
+  }
+
+  // Parse into the same record, as the parser does with ring slots.
+  AuditEventRecord record;
+  while (state.KeepRunning()) {
+    for (const auto& reply : replies) {
+      AuditdNetlinkParser::ParseAuditReply(reply, record);
+      benchmark::DoNotOptimize(record.fields.size());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * replies.size());
+}
+
+BENCHMARK(AUDIT_parse_reply);
+
+static void AUDIT_parse_reply_map(benchmark::State& state) {
+  std::vector<audit_reply> replies(kAuditRecords.size());
+  for (size_t i = 0; i < replies.size(); i++) {
+    replayAuditRecord(replies[i], i);
+    AuditdNetlinkParser::AdjustAuditReply(replies[i]);
+  }
+
+  // Baseline: materialize every field into a map, as records used to.
+  AuditEventRecord record;
+  while (state.KeepRunning()) {
+    for (const auto& reply : replies) {
+      AuditdNetlinkParser::ParseAuditReply(reply, record);
+      std::map<std::string, std::string> fields;
+      for (size_t i = 0; i < record.fields.size(); i++) {
+        fields.emplace(record.fields.key(i).to_string(),
+                       record.fields.value(i).to_string());
+      }
+      benchmark::DoNotOptimize(fields.size());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * replies.size());
+}
+
+BENCHMARK(AUDIT_parse_reply_map);
+
+static void AUDIT_ring_replay_threads(benchmark::State& state) {
+  // The reader and parser run on separate threads, as in the publisher.
+  auto count = static_cast<size_t>(state.range(0));
+  AuditdContext context(1024);
+  std::vector<AuditEventRecord> records;
+
+  while (state.KeepRunning()) {
+    std::thread reader([&context, count]() {
+      for (size_t i = 0; i < count; i++) {
+        audit_reply* reply = nullptr;
+        while ((reply = context.unprocessed_records.producerSlot()) ==
+               nullptr) {
+          std::this_thread::yield();
+        }
+        replayAuditRecord(*reply, i);
+        context.unprocessed_records.push();
+      }
+    });
+
+    size_t consumed = 0;
+    while (consumed < count) {
+      consumed += AuditdNetlinkParser::ProcessRecords(context);
+      records.clear();
+      AuditdNetlink::drainEvents(context, records);
+    }
+    reader.join();
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(AUDIT_ring_replay_threads)->Arg(10000)->Arg(100000);
+} // namespace osquery
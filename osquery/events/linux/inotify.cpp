@@ -8,6 +8,7 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <algorithm>
 #include <sstream>
 
 #include <fnmatch.h>
@@ -329,11 +330,12 @@ bool INotifyEventPublisher::shouldFire(const INotifySubscriptionContextRef& sc,
   }
 
   // exclude paths should be applied at last
-  auto path = ec->path.substr(0, ec->path.rfind('/'));
+  auto parent = std::min(ec->path.rfind('/'), ec->path.size());
   // Need to have two finds,
   // what if somebody excluded an individual file inside a directory
   if (!exclude_paths_.empty() &&
-      (exclude_paths_.find(path) || exclude_paths_.find(ec->path))) {
+      (exclude_paths_.find(ec->path.data(), parent) ||
+       exclude_paths_.find(ec->path))) {
     return false;
   }
 
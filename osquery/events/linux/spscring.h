@@ -0,0 +1,112 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace osquery {
+
+/**
+ * @brief A fixed-capacity, lock-free, single-producer single-consumer ring.
+ *
+ * Slots are allocated once and reused; the producer writes directly into the
+ * next free slot and publishes it with push(), and the consumer reads the
+ * oldest slot in place and releases it with pop(). Exactly one thread may
+ * produce and one thread may consume at a time.
+ */
+template <typename T>
+class SpscRing final : private boost::noncopyable {
+ public:
+  /// Create a ring, the capacity is rounded up to a power of two.
+  explicit SpscRing(size_t capacity)
+      : slots_(roundCapacity(capacity)), mask_(slots_.size() - 1) {}
+
+  /// The number of slots.
+  size_t capacity() const noexcept {
+    return slots_.size();
+  }
+
+  /// The number of published slots, an estimate outside of either thread.
+  size_t size() const noexcept {
+    auto head = head_.load(std::memory_order_acquire);
+    auto tail = tail_.load(std::memory_order_acquire);
+    return (tail >= head) ? tail - head : 0;
+  }
+
+  bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  /// Producer: the next free slot, or nullptr if the ring is full.
+  T* producerSlot() noexcept {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == slots_.size()) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == slots_.size()) {
+        return nullptr;
+      }
+    }
+    return &slots_[tail & mask_];
+  }
+
+  /// Producer: publish the slot returned by producerSlot.
+  void push() noexcept {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  /// Consumer: the oldest published slot, or nullptr if the ring is empty.
+  T* consumerSlot() noexcept {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return nullptr;
+      }
+    }
+    return &slots_[head & mask_];
+  }
+
+  /// Consumer: release the slot returned by consumerSlot.
+  void pop() noexcept {
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+ private:
+  static size_t roundCapacity(size_t capacity) {
+    size_t rounded = 1;
+    while (rounded < capacity) {
+      rounded <<= 1;
+    }
+    return rounded;
+  }
+
+ private:
+  /// Preallocated slots.
+  std::vector<T> slots_;
+
+  /// Index mask, the capacity is a power of two.
+  const size_t mask_;
+
+  /// Consumer-owned: the next slot to read and the last tail it observed.
+  alignas(64) std::atomic<size_t> head_{0};
+  size_t cached_tail_{0};
+
+  /// Producer-owned: the next slot to write and the last head it observed.
+  alignas(64) std::atomic<size_t> tail_{0};
+  size_t cached_head_{0};
+};
+} // namespace osquery
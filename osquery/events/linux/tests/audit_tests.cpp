@@ -16,6 +16,7 @@
 #include <ctime>
 
 #include <sstream>
+#include <thread>
 
 #include <osquery/events.h>
 #include <osquery/flags.h>
@@ -75,10 +76,177 @@ TEST_F(AuditTests, test_handle_reply) {
   EXPECT_EQ("1440542781.644:403030", audit_event_record.audit_id);
   EXPECT_EQ(audit_event_record.fields.size(), 4U);
   EXPECT_EQ(audit_event_record.fields.count("argc"), 1U);
-  EXPECT_EQ(audit_event_record.fields["argc"], "3");
-  EXPECT_EQ(audit_event_record.fields["a0"], "\"H=1 \"");
-  EXPECT_EQ(audit_event_record.fields["a1"], "\"/bin/sh\"");
-  EXPECT_EQ(audit_event_record.fields["a2"], "c");
+  EXPECT_EQ(audit_event_record.fields.at("argc"), "3");
+  EXPECT_EQ(audit_event_record.fields.at("a0"), "\"H=1 \"");
+  EXPECT_EQ(audit_event_record.fields.at("a1"), "\"/bin/sh\"");
+  EXPECT_EQ(audit_event_record.fields.at("a2"), "c");
+}
+
+TEST_F(AuditTests, test_audit_fields) {
+  std::string text =
+      "a0=\"H=1 \" argc=3 flag  a1=2 a0=dup exe=\"/bin/sh\" trailing";
+
+  AuditFields fields;
+  fields.parse(text.data(), text.size());
+
+  // Fields are kept in record order, duplicates resolve to the first.
+  ASSERT_EQ(fields.size(), 7U);
+  EXPECT_EQ(fields.key(0), "a0");
+  EXPECT_EQ(fields.value(0), "\"H=1 \"");
+  EXPECT_EQ(fields.key(2), "flag");
+  EXPECT_EQ(fields.value(2), "");
+  EXPECT_EQ(fields.key(6), "trailing");
+  EXPECT_EQ(fields.at("a0"), "\"H=1 \"");
+  EXPECT_EQ(fields.count("a0"), 2U);
+  EXPECT_EQ(fields.at("a1"), "2");
+  EXPECT_EQ(fields.at("missing"), "");
+
+  // Copies do not refer to the original text.
+  auto copy = fields;
+  fields.clear();
+  EXPECT_TRUE(fields.empty());
+  EXPECT_EQ(copy.at("exe"), "\"/bin/sh\"");
+
+  boost::string_ref value;
+  ASSERT_TRUE(copy.find("argc", value));
+  EXPECT_EQ(value, "3");
+  EXPECT_FALSE(copy.find("arg", value));
+}
+
+TEST_F(AuditTests, test_spsc_ring) {
+  // Capacity is rounded up to a power of two.
+  SpscRing<int> ring(3);
+  ASSERT_EQ(ring.capacity(), 4U);
+  EXPECT_TRUE(ring.empty());
+  EXPECT_EQ(ring.consumerSlot(), nullptr);
+
+  for (int i = 0; i < 4; i++) {
+    auto* slot = ring.producerSlot();
+    ASSERT_NE(slot, nullptr);
+    *slot = i;
+    ring.push();
+  }
+  EXPECT_EQ(ring.size(), 4U);
+  EXPECT_EQ(ring.producerSlot(), nullptr);
+
+  // Freeing one slot allows the producer to wrap around.
+  EXPECT_EQ(*ring.consumerSlot(), 0);
+  ring.pop();
+  auto* slot = ring.producerSlot();
+  ASSERT_NE(slot, nullptr);
+  *slot = 4;
+  ring.push();
+
+  for (int i = 1; i <= 4; i++) {
+    auto* value = ring.consumerSlot();
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, i);
+    ring.pop();
+  }
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST_F(AuditTests, test_spsc_ring_threads) {
+  SpscRing<size_t> ring(64);
+  const size_t count = 100000;
+
+  std::thread producer([&ring, count]() {
+    for (size_t i = 0; i < count; i++) {
+      size_t* slot = nullptr;
+      while ((slot = ring.producerSlot()) == nullptr) {
+        std::this_thread::yield();
+      }
+      *slot = i;
+      ring.push();
+    }
+  });
+
+  // Every value must arrive exactly once and in order.
+  size_t expected = 0;
+  while (expected < count) {
+    auto* value = ring.consumerSlot();
+    if (value == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(*value, expected);
+    ring.pop();
+    expected++;
+  }
+  producer.join();
+  EXPECT_TRUE(ring.empty());
+}
+
+/// Write an audit record into a ring slot as if it was read from the netlink.
+static void setAuditReply(audit_reply& reply,
+                          int type,
+                          const std::string& message) {
+  reply.msg.nlh.nlmsg_type = type;
+  reply.msg.nlh.nlmsg_len = message.size();
+  memcpy(reply.msg.data, message.data(), message.size());
+}
+
+TEST_F(AuditTests, test_process_records) {
+  AuditdContext context(2);
+  ASSERT_EQ(context.unprocessed_records.capacity(), 2U);
+  ASSERT_EQ(context.processed_events.capacity(), 8U);
+
+  auto* reply = context.unprocessed_records.producerSlot();
+  ASSERT_NE(reply, nullptr);
+  setAuditReply(*reply,
+                AUDIT_SYSCALL,
+                "audit(1440542781.644:403030): arch=c000003e syscall=59");
+  context.unprocessed_records.push();
+
+  reply = context.unprocessed_records.producerSlot();
+  ASSERT_NE(reply, nullptr);
+  setAuditReply(*reply, AUDIT_CWD, "malformed");
+  context.unprocessed_records.push();
+
+  EXPECT_EQ(AuditdNetlinkParser::ProcessRecords(context), 2U);
+  EXPECT_TRUE(context.unprocessed_records.empty());
+  EXPECT_EQ(context.events_parsed, 1U);
+  EXPECT_EQ(context.events_dropped, 1U);
+
+  std::vector<AuditEventRecord> records;
+  AuditdNetlink::drainEvents(context, records);
+  ASSERT_EQ(records.size(), 1U);
+  EXPECT_EQ(records[0].type, AUDIT_SYSCALL);
+  EXPECT_EQ(records[0].time, 1440542781UL);
+  EXPECT_EQ(records[0].audit_id, "1440542781.644:403030");
+  EXPECT_EQ(records[0].fields.at("syscall"), "59");
+  EXPECT_TRUE(context.processed_events.empty());
+}
+
+TEST_F(AuditTests, test_process_records_backpressure) {
+  AuditdContext context(1);
+  const std::string message = "audit(1440542781.644:403030): syscall=59";
+
+  // Fill the processed events ring without draining it.
+  size_t capacity = context.processed_events.capacity();
+  for (size_t i = 0; i < capacity; i++) {
+    auto* reply = context.unprocessed_records.producerSlot();
+    ASSERT_NE(reply, nullptr);
+    setAuditReply(*reply, AUDIT_SYSCALL, message);
+    context.unprocessed_records.push();
+    EXPECT_EQ(AuditdNetlinkParser::ProcessRecords(context), 1U);
+  }
+
+  // The next record stays queued until the events are read.
+  auto* reply = context.unprocessed_records.producerSlot();
+  ASSERT_NE(reply, nullptr);
+  setAuditReply(*reply, AUDIT_SYSCALL, message);
+  context.unprocessed_records.push();
+  EXPECT_EQ(AuditdNetlinkParser::ProcessRecords(context), 0U);
+  EXPECT_EQ(context.events_stalls, 1U);
+  EXPECT_EQ(context.unprocessed_records.size(), 1U);
+
+  std::vector<AuditEventRecord> records;
+  AuditdNetlink::drainEvents(context, records);
+  EXPECT_EQ(records.size(), capacity);
+  EXPECT_EQ(AuditdNetlinkParser::ProcessRecords(context), 1U);
+  EXPECT_EQ(context.events_parsed, capacity + 1);
+  EXPECT_EQ(context.events_max_size, capacity);
 }
 
 TEST_F(AuditTests, test_audit_value_decode) {
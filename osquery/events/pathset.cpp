@@ -0,0 +1,144 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <osquery/filesystem.h>
+
+#include "osquery/events/pathset.h"
+
+namespace osquery {
+
+namespace {
+
+using ChildList = std::vector<std::pair<std::string, uint32_t>>;
+
+/// Find the first child not ordered before the component.
+ChildList::const_iterator findChild(const ChildList& children,
+                                    const char* component,
+                                    size_t size) {
+  auto less = [component](const ChildList::value_type& child, size_t length) {
+    return child.first.compare(0, std::string::npos, component, length) < 0;
+  };
+  return std::lower_bound(children.begin(), children.end(), size, less);
+}
+} // namespace
+
+PathMatcher::PathMatcher() : nodes_(1) {}
+
+uint32_t PathMatcher::addChild(uint32_t node, const std::string& component) {
+  auto child = static_cast<uint32_t>(nodes_.size());
+  if (component == "*") {
+    if (nodes_[node].star == 0) {
+      nodes_[node].star = child;
+      nodes_.emplace_back();
+    }
+    return nodes_[node].star;
+  }
+
+  auto& children = nodes_[node].children;
+  auto it = findChild(children, component.data(), component.size());
+  if (it != children.end() && it->first == component) {
+    return it->second;
+  }
+
+  // Add the child before growing the nodes, which invalidates children.
+  children.emplace(it, component, child);
+  nodes_.emplace_back();
+  return child;
+}
+
+void PathMatcher::insert(const std::string& str) {
+  auto pattern = str;
+  replaceGlobWildcards(pattern);
+
+  WriteLock lock(mutex_);
+  if (pattern == "/") {
+    root_ = true;
+    return;
+  }
+
+  uint32_t node = 0;
+  bool star = false;
+  for (size_t start = 0; start < pattern.size();) {
+    auto stop = std::min(pattern.find('/', start), pattern.size());
+    if (stop > start) {
+      auto component = pattern.substr(start, stop - start);
+      if (component == "**") {
+        // The remainder of the pattern is not used.
+        nodes_[node].prefix = true;
+        return;
+      }
+      star = (component == "*");
+      node = addChild(node, component);
+    }
+    start = stop + 1;
+  }
+
+  // A trailing '*' also matches deeper paths.
+  if (star) {
+    nodes_[node].prefix = true;
+  } else {
+    nodes_[node].terminal = true;
+  }
+}
+
+bool PathMatcher::match(uint32_t node,
+                        const char* path,
+                        const char* end) const {
+  const auto& current = nodes_[node];
+  if (current.prefix) {
+    return true;
+  }
+
+  while (path < end && *path == '/') {
+    path++;
+  }
+  if (path == end) {
+    return current.terminal;
+  }
+
+  auto next = static_cast<const char*>(std::memchr(path, '/', end - path));
+  if (next == nullptr) {
+    next = end;
+  }
+
+  auto size = static_cast<size_t>(next - path);
+  auto it = findChild(current.children, path, size);
+  if (it != current.children.end() &&
+      it->first.compare(0, std::string::npos, path, size) == 0 &&
+      match(it->second, next, end)) {
+    return true;
+  }
+  return current.star != 0 && match(current.star, next, end);
+}
+
+bool PathMatcher::find(const char* path, size_t size) const {
+  ReadLock lock(mutex_);
+  if (root_ && size == 1 && path[0] == '/') {
+    return true;
+  }
+  return match(0, path, path + size);
+}
+
+void PathMatcher::clear() {
+  WriteLock lock(mutex_);
+  nodes_.assign(1, Node());
+  root_ = false;
+}
+
+bool PathMatcher::empty() const {
+  ReadLock lock(mutex_);
+  const auto& root = nodes_.front();
+  return !root_ && !root.terminal && !root.prefix && root.star == 0 &&
+         root.children.empty();
+}
+} // namespace osquery
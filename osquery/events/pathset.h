@@ -10,150 +10,78 @@
 
 #pragma once
 
-#include <mutex>
-#include <set>
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/noncopyable.hpp>
-#include <boost/tokenizer.hpp>
 
-#include <osquery/core.h>
-#include <osquery/filesystem.h>
+#include <osquery/mutex.h>
 
 namespace osquery {
 
 /**
- * @brief multiset based implementation for path search.
+ * @brief A set of path patterns compiled into a trie of path components.
  *
- * 'multiset' is used because with patterns we can serach for equivalent keys.
- * Since  '/This/Path/is' ~= '/This/Path/%' ~= '/This/Path/%%' (equivalent).
+ * Patterns use the file_paths wildcards, '%' or '*' and '%%' or '**', which
+ * only apply to whole components:
+ *  - '/This/Path/%' matches any single component after '/This/Path/'. As a
+ *    trailing component it also matches any deeper path.
+ *  - '/This/Path/%%' matches '/This/Path' and any path below it.
+ *  - Partial patterns such as '/This/Path/xyz%' are matched literally.
  *
- * multiset is protected by lock. It is threadsafe.
- *
- * PathSet can take any of the two policies -
- * 1. patternedPath - Path can contain pattern '%' and '%%'.
- *                    Path components containing only '%' and '%%' are supported
- *                    e.g. '/This/Path/%'.
- *                    Path components containing partial patterns are not
- *                    supported e.g. '/This/Path/xyz%' ('xyz%' will not be
- *                    treated as pattern).
+ * Matching walks the raw path in place and does not allocate. The matcher is
+ * protected by a lock and is thread safe.
  */
-template <typename PathType>
-class PathSet : private boost::noncopyable {
+class PathMatcher : private boost::noncopyable {
  public:
-  void insert(const std::string& str) {
-    auto pattern = str;
-    replaceGlobWildcards(pattern);
-    auto vpath = PathType::createVPath(pattern);
-
-    WriteLock lock(mset_lock_);
-    for (auto& path : vpath) {
-      paths_.insert(std::move(path));
-    }
-  }
+  PathMatcher();
 
-  bool find(const std::string& str) const {
-    auto path = PathType::createPath(str);
+  /// Compile a pattern into the set.
+  void insert(const std::string& pattern);
 
-    ReadLock lock(mset_lock_);
-    if (paths_.find(path) != paths_.end()) {
-      return true;
-    }
-    return false;
+  /// Return true if the path matches any pattern.
+  bool find(const std::string& path) const {
+    return find(path.data(), path.size());
   }
 
-  void clear() {
-    WriteLock lock(mset_lock_);
-    paths_.clear();
-  }
+  /// Return true if the first size characters of path match any pattern.
+  bool find(const char* path, size_t size) const;
 
-  bool empty() const {
-    ReadLock lock(mset_lock_);
-    return paths_.empty();
-  }
+  void clear();
+
+  bool empty() const;
 
  private:
-  typedef typename PathType::Path Path;
-  typedef typename PathType::Compare Compare;
-  std::multiset<Path, Compare> paths_;
-  mutable Mutex mset_lock_;
-};
+  struct Node {
+    /// Literal components, sorted by name, and the index of their node.
+    std::vector<std::pair<std::string, uint32_t>> children;
 
-class patternedPath {
- public:
-  typedef boost::tokenizer<boost::char_separator<char>> tokenizer;
-  typedef std::vector<std::string> Path;
-  typedef std::vector<Path> VPath;
-  struct Compare {
-    bool operator()(const Path& lhs, const Path& rhs) const {
-      size_t psize = (lhs.size() < rhs.size()) ? lhs.size() : rhs.size();
-      unsigned ndx;
-      for (ndx = 0; ndx < psize; ++ndx) {
-        if (lhs[ndx] == "**" || rhs[ndx] == "**") {
-          return false;
-        }
-
-        if (lhs[ndx] == "*" || rhs[ndx] == "*") {
-          continue;
-        }
-
-        int rc = lhs[ndx].compare(rhs[ndx]);
-
-        if (rc > 0) {
-          return false;
-        }
-
-        if (rc < 0) {
-          return true;
-        }
-      }
-
-      if ((ndx == rhs.size() && rhs[ndx - 1] == "*") ||
-          (ndx == lhs.size() && lhs[ndx - 1] == "*")) {
-        return false;
-      }
-
-      return (lhs.size() < rhs.size());
-    }
+    /// The node for a '*' component, 0 if there is none.
+    uint32_t star{0};
+
+    /// A pattern ends at this node.
+    bool terminal{false};
+
+    /// A pattern matches this node and every path below it.
+    bool prefix{false};
   };
 
-  static Path createPath(const std::string& str) {
-    boost::char_separator<char> sep{"/"};
-    tokenizer tokens(str, sep);
-    Path path;
+  /// Return the child node for a component, creating it if needed.
+  uint32_t addChild(uint32_t node, const std::string& component);
 
-    if (str == "/") {
-      path.push_back("");
-    }
+  /// Match the remaining components of a path starting at a node.
+  bool match(uint32_t node, const char* path, const char* end) const;
 
-    for (std::string component : tokens) {
-      path.push_back(std::move(component));
-    }
-    return path;
-  }
+ private:
+  /// Nodes of the trie, the root is the first node.
+  std::vector<Node> nodes_;
 
-  static VPath createVPath(const std::string& str) {
-    boost::char_separator<char> sep{"/"};
-    tokenizer tokens(str, sep);
-    VPath vpath;
-    Path path;
-
-    if (str == "/") {
-      path.push_back("");
-    }
-
-    for (std::string component : tokens) {
-      if (component == "**") {
-        vpath.push_back(path);
-        path.push_back(std::move(component));
-        break;
-      }
-      path.push_back(std::move(component));
-    }
-    vpath.push_back(std::move(path));
-    return vpath;
-  }
-};
+  /// Set when the root path '/' is a pattern.
+  bool root_{false};
 
+  /// Protects the trie.
+  mutable Mutex mutex_;
+};
 } // namespace osquery
@@ -23,6 +23,7 @@
 #include <osquery/system.h>
 #include <osquery/tables.h>
 
+#include "osquery/events/event_records.h"
 #include "osquery/tests/test_util.h"
 
 namespace osquery {
@@ -221,16 +222,128 @@ TEST_F(EventsDatabaseTests, test_record_range) {
   EXPECT_EQ(33U, records.size()); // (61) 110 - 139 + 3601, 7201
 }
 
+TEST_F(EventsDatabaseTests, test_record_index_order) {
+  auto sub = std::make_shared<DBFakeEventSubscriber>();
+  auto status = sub->testAdd((2 * 3600) + 1);
+  status = sub->testAdd(61);
+  status = sub->testAdd(1);
+  status = sub->testAdd((1 * 3600) + 1);
+  status = sub->testAdd(62);
+
+  // Bins are indexed in ascending order regardless of recording order.
+  std::string index_key = "indexes.DBFakePublisher.DBFakeSubscriber.60";
+  std::string content;
+  getDatabaseValue(kEvents, index_key, content);
+  EXPECT_EQ("0,1,60,120", content);
+
+  auto indexes = sub->getIndexes(61, 3601);
+  auto output = boost::algorithm::join(indexes, ", ");
+  EXPECT_EQ("60.1, 60.60", output);
+
+  // An unordered index from an older version is searched in order.
+  setDatabaseValue(kEvents, index_key, "120,1,0,60,1");
+  indexes = sub->getIndexes(0, 0);
+  output = boost::algorithm::join(indexes, ", ");
+  EXPECT_EQ("60.0, 60.1, 60.60, 60.120", output);
+
+  // Recording into a new bin rewrites the index in order.
+  sub->record_bin_ = 0;
+  status = sub->testAdd(121);
+  getDatabaseValue(kEvents, index_key, content);
+  EXPECT_EQ("0,1,2,60,120", content);
+}
+
+TEST_F(EventsDatabaseTests, test_record_range_pushdown) {
+  auto sub = std::make_shared<DBFakeEventSubscriber>();
+  sub->setEventsExpiry(0);
+  auto status = sub->testAdd(1);
+  status = sub->testAdd(2);
+  status = sub->testAdd(11);
+  status = sub->testAdd(61);
+  status = sub->testAdd((1 * 3600) + 1);
+  status = sub->testAdd((2 * 3600) + 1);
+
+  // Records are filtered by time and EventID while they are decoded.
+  EventRange range;
+  range.start = 2;
+  range.stop = 61;
+  auto records = sub->getRecords(sub->getIndexes(range.start, range.stop),
+                                 range);
+  ASSERT_EQ(3U, records.size()); // 2, 11, 61
+  EXPECT_EQ(2U, records.front().second);
+  EXPECT_EQ(61U, records.back().second);
+
+  range.eid_start = records[1].first;
+  records = sub->getRecords(sub->getIndexes(range.start, range.stop), range);
+  EXPECT_EQ(2U, records.size()); // 11, 61
+
+  // An upper time bound is applied to the table.
+  QueryContext context;
+  context.constraints["time"].add(Constraint(LESS_THAN, "62"));
+  auto results = genRows(sub.get(), context);
+  EXPECT_EQ(4U, results.size()); // 1, 2, 11, 61
+
+  context.constraints["time"].add(Constraint(GREATER_THAN, "1"));
+  results = genRows(sub.get(), context);
+  EXPECT_EQ(3U, results.size()); // 2, 11, 61
+
+  // Zero-padded EventID constraints are pushed down.
+  QueryContext eid_context;
+  eid_context.constraints["eid"].add(
+      Constraint(GREATER_THAN_OR_EQUALS, results[1].at("eid")));
+  results = genRows(sub.get(), eid_context);
+  ASSERT_EQ(4U, results.size()); // 11, 61, 3601, 7201
+  EXPECT_EQ("11", results.front().at("time"));
+
+  // Other EventID expressions are left for SQLite to filter.
+  QueryContext text_context;
+  text_context.constraints["eid"].add(Constraint(GREATER_THAN, "4"));
+  results = genRows(sub.get(), text_context);
+  EXPECT_EQ(6U, results.size());
+}
+
+TEST_F(EventsDatabaseTests, test_gentable_ordered) {
+  auto sub = std::make_shared<DBFakeEventSubscriber>();
+  sub->setEventsExpiry(0);
+  // Records within a bin are stored in the order they were added.
+  auto status = sub->testAdd(5);
+  status = sub->testAdd(3);
+  status = sub->testAdd(61);
+  status = sub->testAdd(122);
+  status = sub->testAdd(62);
+
+  QueryContext context;
+  context.orderBy.push_back(std::make_pair("time", true));
+  auto results = genRows(sub.get(), context);
+  ASSERT_EQ(5U, results.size());
+  EXPECT_EQ("122", results[0].at("time"));
+  EXPECT_EQ("62", results[1].at("time"));
+  EXPECT_EQ("61", results[2].at("time"));
+  EXPECT_EQ("5", results[3].at("time"));
+  EXPECT_EQ("3", results[4].at("time"));
+
+  QueryContext ascending;
+  ascending.orderBy.push_back(std::make_pair("time", false));
+  results = genRows(sub.get(), ascending);
+  ASSERT_EQ(5U, results.size());
+  EXPECT_EQ("3", results[0].at("time"));
+  EXPECT_EQ("5", results[1].at("time"));
+  EXPECT_EQ("122", results[4].at("time"));
+}
+
 TEST_F(EventsDatabaseTests, test_record_corruption) {
   auto sub = std::make_shared<DBFakeEventSubscriber>();
 
   std::string corrupted_index = "60.25440186";
   std::string key =
       "records.DBFakePublisher.DBFakeSubscriber." + corrupted_index;
-  std::string value =
-      "0002985852:1526411162,0002985853:1526411162,00??E/"
-      "?:1526411170,0002985912:1526411170,0002??E/"
-      "?526411178,0002985921:1526411178,0002985922:1526411178";
+
+  std::string value;
+  for (size_t eid = 2985852; eid < 2985858; eid++) {
+    encodeEventRecord(eid, 1526411162, value);
+  }
+  // Truncate a trailing record, as if a write was interrupted.
+  value += "00??E/";
 
   // Set some corrupted values in the DB
   auto s = setDatabaseValue(kEvents, key, value);
@@ -238,6 +351,37 @@ TEST_F(EventsDatabaseTests, test_record_corruption) {
 
   // We should gracefully skip over corrupted record entries
   EXPECT_EQ(6U, records.size());
+  EXPECT_EQ(2985852U, records.front().first);
+  EXPECT_EQ(1526411162U, records.front().second);
+}
+
+TEST_F(EventsDatabaseTests, test_record_append_after_corruption) {
+  auto sub = std::make_shared<DBFakeEventSubscriber>();
+
+  std::string key = "records.DBFakePublisher.DBFakeSubscriber.60.25440187";
+  std::string value;
+  for (size_t eid = 1; eid < 4; eid++) {
+    encodeEventRecord(eid, 1526411225, value);
+  }
+  value += "00??E/";
+  ASSERT_TRUE(setDatabaseValue(kEvents, key, value).ok());
+  ASSERT_TRUE(setDatabaseValue(
+                  kEvents, "indexes.DBFakePublisher.DBFakeSubscriber.60",
+                  "25440187")
+                  .ok());
+
+  // The partial record is dropped before new records are appended.
+  EXPECT_TRUE(sub->testAdd(1526411225, 2).ok());
+  auto records = sub->getRecords({"60.25440187"});
+  ASSERT_EQ(5U, records.size());
+  EXPECT_EQ(3U, records[2].first);
+  for (const auto& record : records) {
+    EXPECT_EQ(1526411225U, record.second);
+  }
+
+  std::string stored;
+  getDatabaseValue(kEvents, key, stored);
+  EXPECT_EQ(5 * kEventRecordSize, stored.size());
 }
 
 TEST_F(EventsDatabaseTests, test_record_expiration) {
@@ -341,7 +485,7 @@ TEST_F(EventsDatabaseTests, test_optimize) {
   FLAGS_events_optimize = true;
 
   // Must also define an executing query.
-  setDatabaseValue(kPersistentSettings, kExecutingQuery, "events_db_test");
+  Config::get().recordQueryStart("events_db_test");
 
   auto t = getUnixTime();
   auto results = genRows(sub.get());
@@ -366,8 +510,9 @@ TEST_F(EventsDatabaseTests, test_optimize) {
   getDatabaseValue("events", "optimize.events_db_test", content);
   EXPECT_EQ(std::to_string(sub->optimize_time_), content);
 
-  // Restore the tool type.
+  // Restore the tool type and clear the executing query.
   kToolType = default_type;
+  Config::get().recordQueryPerformance("events_db_test", {}, {}, 0, 0);
 }
 
 TEST_F(EventsDatabaseTests, test_expire_check) {
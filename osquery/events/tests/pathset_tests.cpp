@@ -0,0 +1,78 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <gtest/gtest.h>
+
+#include "osquery/events/pathset.h"
+
+namespace osquery {
+
+class PathMatcherTests : public testing::Test {};
+
+TEST_F(PathMatcherTests, test_literal) {
+  PathMatcher matcher;
+  EXPECT_TRUE(matcher.empty());
+
+  matcher.insert("/etc/ssl/openssl.cnf");
+  matcher.insert("/etc/");
+  EXPECT_FALSE(matcher.empty());
+  EXPECT_TRUE(matcher.find("/etc/ssl/openssl.cnf"));
+  EXPECT_TRUE(matcher.find("/etc"));
+  EXPECT_TRUE(matcher.find("/etc/"));
+  EXPECT_FALSE(matcher.find("/etc/ssl"));
+  EXPECT_FALSE(matcher.find("/etc/ssl/openssl.cnf.bak"));
+  EXPECT_FALSE(matcher.find("/"));
+
+  // A length limits the path, such as to match the parent directory.
+  std::string path = "/etc/passwd";
+  EXPECT_TRUE(matcher.find(path.data(), path.rfind('/')));
+  EXPECT_FALSE(matcher.find(path));
+
+  matcher.clear();
+  EXPECT_TRUE(matcher.empty());
+  EXPECT_FALSE(matcher.find("/etc"));
+}
+
+TEST_F(PathMatcherTests, test_root) {
+  PathMatcher matcher;
+  matcher.insert("/");
+  EXPECT_FALSE(matcher.empty());
+  EXPECT_TRUE(matcher.find("/"));
+  EXPECT_FALSE(matcher.find("/etc"));
+}
+
+TEST_F(PathMatcherTests, test_wildcards) {
+  PathMatcher matcher;
+  matcher.insert("/etc/ssh/%%");
+  matcher.insert("/var/%/cache");
+  matcher.insert("/opt/%");
+  matcher.insert("/srv/data%");
+
+  // A double wildcard matches the directory and everything below it.
+  EXPECT_TRUE(matcher.find("/etc/ssh"));
+  EXPECT_TRUE(matcher.find("/etc/ssh/ssh_config"));
+  EXPECT_TRUE(matcher.find("/etc/ssh/a/b/c"));
+  EXPECT_FALSE(matcher.find("/etc/sshd"));
+
+  // A single wildcard matches one component.
+  EXPECT_TRUE(matcher.find("/var/lib/cache"));
+  EXPECT_FALSE(matcher.find("/var/lib/log"));
+  EXPECT_FALSE(matcher.find("/var/lib/app/cache"));
+
+  // A trailing single wildcard also matches deeper paths.
+  EXPECT_TRUE(matcher.find("/opt/pkg"));
+  EXPECT_TRUE(matcher.find("/opt/pkg/bin/tool"));
+  EXPECT_FALSE(matcher.find("/opt"));
+
+  // Partial wildcards are literal.
+  EXPECT_FALSE(matcher.find("/srv/data1"));
+  EXPECT_TRUE(matcher.find("/srv/data*"));
+}
+} // namespace osquery
@@ -78,6 +78,11 @@ CLI_FLAG(string,
          "",
          "Comma-separated list of required extensions");
 
+HIDDEN_FLAG(uint64,
+            extensions_table_batch,
+            1024,
+            "Rows read from an extension table cursor in each call");
+
 /**
  * @brief Alias the extensions_socket (used by core) to a simple 'socket'.
  *
@@ -660,6 +665,62 @@ Status callExtension(const std::string& extension_path,
   return status;
 }
 
+Status callExtensionTable(const RouteUUID uuid,
+                          const std::string& table,
+                          const QueryContext& context,
+                          TableRows& results) {
+  if (FLAGS_disable_extensions) {
+    return Status(1, "Extensions disabled");
+  }
+  return callExtensionTable(getExtensionSocket(uuid), table, context, results);
+}
+
+Status callExtensionTable(const std::string& extension_path,
+                          const std::string& table,
+                          const QueryContext& context,
+                          TableRows& results) {
+  // Make sure the extension path exists, and is writable.
+  auto status = extensionPathActive(extension_path);
+  if (!status.ok()) {
+    return status;
+  }
+
+  try {
+    ExtensionClient client(extension_path);
+    status = client.generateTable(table, context, results);
+  } catch (const std::exception& e) {
+    return Status(1, "Extension call failed: " + std::string(e.what()));
+  }
+
+  return status;
+}
+
+Status callExtensionTable(const RouteUUID uuid,
+                          const std::string& table,
+                          const QueryContext& context,
+                          const TableColumns& columns,
+                          TableRowsYield& yield) {
+  if (FLAGS_disable_extensions) {
+    return Status(1, "Extensions disabled");
+  }
+
+  // Make sure the extension path exists, and is writable.
+  auto extension_path = getExtensionSocket(uuid);
+  auto status = extensionPathActive(extension_path);
+  if (!status.ok()) {
+    return status;
+  }
+
+  try {
+    ExtensionClient client(extension_path);
+    status = client.streamTable(table, context, columns, yield);
+  } catch (const std::exception& e) {
+    return Status(1, "Extension call failed: " + std::string(e.what()));
+  }
+
+  return status;
+}
+
 Status startExtensionWatcher(const std::string& manager_path,
                              size_t interval,
                              bool fatal) {
@@ -12,6 +12,7 @@
 #include <osquery/filesystem.h>
 #include <osquery/system.h>
 
+#include <thrift/TApplicationException.h>
 #include <thrift/concurrency/ThreadManager.h>
 #include <thrift/protocol/TBinaryProtocol.h>
 #include <thrift/server/TThreadedServer.h>
@@ -64,6 +65,26 @@ class ExtensionHandler : virtual public extensions::ExtensionIf,
   using ExtensionInterface::shutdown;
   void shutdown() override;
 
+  using ExtensionInterface::generateTable;
+  void generateTable(extensions::ExtensionTableResponse& _return,
+                     const std::string& table,
+                     const extensions::ExtensionQueryContext& context) override;
+
+  using ExtensionInterface::openTable;
+  void openTable(extensions::ExtensionTableResponse& _return,
+                 const std::string& table,
+                 const extensions::ExtensionQueryContext& context,
+                 const int64_t batch) override;
+
+  using ExtensionInterface::nextRows;
+  void nextRows(extensions::ExtensionTableResponse& _return,
+                const extensions::ExtensionTableCursor cursor,
+                const int64_t batch) override;
+
+  using ExtensionInterface::closeTable;
+  void closeTable(extensions::ExtensionStatus& _return,
+                  const extensions::ExtensionTableCursor cursor) override;
+
  protected:
   /// UUID accessor.
   RouteUUID getUUID() const;
@@ -107,6 +128,10 @@ class ExtensionManagerHandler : virtual public extensions::ExtensionManagerIf,
 
  public:
   using ExtensionHandler::call;
+  using ExtensionHandler::closeTable;
+  using ExtensionHandler::generateTable;
+  using ExtensionHandler::nextRows;
+  using ExtensionHandler::openTable;
   using ExtensionHandler::ping;
   using ExtensionHandler::shutdown;
 };
@@ -129,6 +154,173 @@ struct ImplExtensionClient {
   std::shared_ptr<TPlatformSocket> socket;
 };
 
+namespace {
+
+/// Translate a QueryContext to an ExtensionQueryContext.
+void setThriftContext(const QueryContext& context,
+                      extensions::ExtensionQueryContext& request) {
+  for (const auto& column : context.constraints) {
+    auto& list = request.constraints[column.first];
+    list.affinity = columnTypeName(column.second.affinity);
+    for (const auto& constraint : column.second.getAll()) {
+      extensions::ExtensionConstraint item;
+      item.op = constraint.op;
+      item.expr = constraint.expr;
+      list.constraints.push_back(std::move(item));
+    }
+  }
+
+  if (context.colsUsed) {
+    std::set<std::string> columns(context.colsUsed->begin(),
+                                  context.colsUsed->end());
+    request.__set_colsUsed(columns);
+  }
+
+  for (const auto& order : context.orderBy) {
+    extensions::ExtensionOrderBy item;
+    item.name = order.first;
+    item.desc = order.second;
+    request.orderBy.push_back(std::move(item));
+  }
+}
+
+/// Translate an ExtensionQueryContext to a QueryContext.
+void setContextFromThrift(const extensions::ExtensionQueryContext& request,
+                          QueryContext& context) {
+  for (const auto& column : request.constraints) {
+    auto& list = context.constraints[column.first];
+    list.affinity = columnTypeName(column.second.affinity);
+    for (const auto& constraint : column.second.constraints) {
+      list.add(Constraint(static_cast<unsigned char>(constraint.op),
+                          constraint.expr));
+    }
+  }
+
+  if (request.__isset.colsUsed) {
+    context.colsUsed =
+        UsedColumns(request.colsUsed.begin(), request.colsUsed.end());
+  }
+
+  for (const auto& order : request.orderBy) {
+    context.orderBy.push_back(std::make_pair(order.name, order.desc));
+  }
+}
+
+/// Translate typed rows to columns, each cell is sent in its column's type.
+void setThriftColumns(const TableRows& rows,
+                      extensions::ExtensionTableResponse& response) {
+  response.rows = static_cast<int64_t>(rows.rows());
+  response.columns.resize(rows.columns());
+  for (size_t column = 0; column < rows.columns(); column++) {
+    auto& values = response.columns[column];
+    values.name = rows.name(column);
+    values.type = columnTypeName(rows.type(column));
+
+    auto type = rows.type(column);
+    for (size_t row = 0; row < rows.rows(); row++) {
+      size_t source_size = 0;
+      const auto* source = rows.getSource(row, column, source_size);
+      if (source != nullptr) {
+        values.sources[static_cast<int64_t>(row)].assign(source, source_size);
+      }
+
+      auto null = rows.isNull(row, column);
+      if (null) {
+        if (values.nulls.empty()) {
+          values.nulls.resize(rows.rows(), false);
+        }
+        values.nulls[row] = true;
+      }
+
+      // NULL cells use a placeholder, keeping each list aligned to the rows.
+      if (type == INTEGER_TYPE || type == BIGINT_TYPE ||
+          type == UNSIGNED_BIGINT_TYPE) {
+        values.integers.push_back((null) ? 0 : rows.getInteger(row, column));
+      } else if (type == DOUBLE_TYPE) {
+        values.doubles.push_back((null) ? 0 : rows.getDouble(row, column));
+      } else if (null) {
+        values.texts.emplace_back();
+      } else {
+        size_t size = 0;
+        const auto* text = rows.getText(row, column, size);
+        values.texts.emplace_back(text, size);
+      }
+    }
+  }
+}
+
+/// Add the rows within a typed column response, matching columns by name.
+Status setColumnsFromThrift(const extensions::ExtensionTableResponse& response,
+                            TableRows& results) {
+  if (response.rows < 0) {
+    return Status(1, "Invalid table response row count");
+  }
+
+  auto rows = static_cast<size_t>(response.rows);
+  for (const auto& values : response.columns) {
+    auto type = columnTypeName(values.type);
+    size_t size = values.texts.size();
+    if (type == INTEGER_TYPE || type == BIGINT_TYPE ||
+        type == UNSIGNED_BIGINT_TYPE) {
+      size = values.integers.size();
+    } else if (type == DOUBLE_TYPE) {
+      size = values.doubles.size();
+    }
+
+    if (size != rows ||
+        (!values.nulls.empty() && values.nulls.size() != rows)) {
+      return Status(1, "Invalid table response column: " + values.name);
+    }
+  }
+
+  // Cells are set by row, the typed buffer is stored in row-major order.
+  std::vector<std::pair<size_t, ColumnType>> columns;
+  for (const auto& values : response.columns) {
+    columns.push_back(std::make_pair(results.column(values.name),
+                                     columnTypeName(values.type)));
+  }
+
+  for (size_t row = 0; row < rows; row++) {
+    results.addRow();
+    for (size_t i = 0; i < columns.size(); i++) {
+      const auto& values = response.columns[i];
+      auto ordinal = columns[i].first;
+      if (ordinal >= results.columns()) {
+        continue;
+      }
+
+      if (!values.sources.empty()) {
+        // Converting the source again sets the same number and source.
+        auto source = values.sources.find(static_cast<int64_t>(row));
+        if (source != values.sources.end()) {
+          results.setText(ordinal, source->second);
+          continue;
+        }
+      }
+
+      if (!values.nulls.empty() && values.nulls[row]) {
+        continue;
+      }
+
+      switch (columns[i].second) {
+      case INTEGER_TYPE:
+      case BIGINT_TYPE:
+      case UNSIGNED_BIGINT_TYPE:
+        results.setInteger(ordinal, values.integers[row]);
+        break;
+      case DOUBLE_TYPE:
+        results.setDouble(ordinal, values.doubles[row]);
+        break;
+      default:
+        results.setText(ordinal, values.texts[row]);
+        break;
+      }
+    }
+  }
+  return Status(0, "OK");
+}
+} // namespace
+
 void ExtensionHandler::ping(extensions::ExtensionStatus& _return) {
   auto s = ExtensionInterface::ping();
   _return.code = (int)extensions::ExtensionCode::EXT_SUCCESS;
@@ -162,6 +354,81 @@ void ExtensionHandler::call(extensions::ExtensionResponse& _return,
 
 void ExtensionHandler::shutdown() {}
 
+void ExtensionHandler::generateTable(
+    extensions::ExtensionTableResponse& _return,
+    const std::string& table,
+    const extensions::ExtensionQueryContext& context) {
+  QueryContext query_context;
+  setContextFromThrift(context, query_context);
+
+  std::unique_ptr<TableRows> rows;
+  auto s = ExtensionInterface::generateTable(table, query_context, rows);
+  _return.status.code = s.getCode();
+  _return.status.message = s.getMessage();
+  _return.status.uuid = getUUID();
+
+  if (s.ok()) {
+    setThriftColumns(*rows, _return);
+  }
+}
+
+void ExtensionHandler::openTable(
+    extensions::ExtensionTableResponse& _return,
+    const std::string& table,
+    const extensions::ExtensionQueryContext& context,
+    const int64_t batch) {
+  auto query_context = std::make_unique<QueryContext>();
+  setContextFromThrift(context, *query_context);
+
+  std::unique_ptr<TableRows> rows;
+  TableCursorID cursor = 0;
+  bool done = false;
+  auto s = ExtensionInterface::openTable(table,
+                                         std::move(query_context),
+                                         static_cast<size_t>(batch),
+                                         rows,
+                                         cursor,
+                                         done);
+  _return.status.code = s.getCode();
+  _return.status.message = s.getMessage();
+  _return.status.uuid = getUUID();
+
+  if (s.ok()) {
+    setThriftColumns(*rows, _return);
+    _return.cursor = static_cast<int64_t>(cursor);
+    _return.done = done;
+  }
+}
+
+void ExtensionHandler::nextRows(extensions::ExtensionTableResponse& _return,
+                                const extensions::ExtensionTableCursor cursor,
+                                const int64_t batch) {
+  std::unique_ptr<TableRows> rows;
+  bool done = false;
+  auto s = ExtensionInterface::nextRows(static_cast<TableCursorID>(cursor),
+                                        static_cast<size_t>(batch),
+                                        rows,
+                                        done);
+  _return.status.code = s.getCode();
+  _return.status.message = s.getMessage();
+  _return.status.uuid = getUUID();
+
+  if (s.ok()) {
+    setThriftColumns(*rows, _return);
+    _return.cursor = cursor;
+    _return.done = done;
+  }
+}
+
+void ExtensionHandler::closeTable(
+    extensions::ExtensionStatus& _return,
+    const extensions::ExtensionTableCursor cursor) {
+  auto s = ExtensionInterface::closeTable(static_cast<TableCursorID>(cursor));
+  _return.code = s.getCode();
+  _return.message = s.getMessage();
+  _return.uuid = getUUID();
+}
+
 RouteUUID ExtensionHandler::getUUID() const {
   return uuid_;
 }
@@ -381,6 +648,85 @@ Status ExtensionClient::call(const std::string& registry,
   return Status(er.status.code, er.status.message);
 }
 
+Status ExtensionClient::generateColumns(const std::string& table,
+                                        const QueryContext& context,
+                                        TableRows& results,
+                                        bool& supported) {
+  extensions::ExtensionQueryContext request;
+  setThriftContext(context, request);
+
+  extensions::ExtensionTableResponse er;
+  auto client = manager() ? client_->em : client_->e;
+  try {
+    client->generateTable(er, table, request);
+  } catch (const apache::thrift::TApplicationException& e) {
+    if (e.getType() != apache::thrift::TApplicationException::UNKNOWN_METHOD) {
+      throw;
+    }
+    supported = false;
+    return Status(1, "Extension does not implement generateTable");
+  }
+
+  supported = true;
+  if (er.status.code != (int)extensions::ExtensionCode::EXT_SUCCESS) {
+    return Status(er.status.code, er.status.message);
+  }
+  return setColumnsFromThrift(er, results);
+}
+
+Status ExtensionClient::openTable(const std::string& table,
+                                  const QueryContext& context,
+                                  size_t batch,
+                                  TableRows& results,
+                                  TableCursorID& cursor,
+                                  bool& done,
+                                  bool& supported) {
+  extensions::ExtensionQueryContext request;
+  setThriftContext(context, request);
+
+  extensions::ExtensionTableResponse er;
+  auto client = manager() ? client_->em : client_->e;
+  try {
+    client->openTable(er, table, request, static_cast<int64_t>(batch));
+  } catch (const apache::thrift::TApplicationException& e) {
+    if (e.getType() != apache::thrift::TApplicationException::UNKNOWN_METHOD) {
+      throw;
+    }
+    supported = false;
+    return Status(1, "Extension does not implement openTable");
+  }
+
+  supported = true;
+  if (er.status.code != (int)extensions::ExtensionCode::EXT_SUCCESS) {
+    return Status(er.status.code, er.status.message);
+  }
+  cursor = static_cast<TableCursorID>(er.cursor);
+  done = er.done;
+  return setColumnsFromThrift(er, results);
+}
+
+Status ExtensionClient::nextRows(TableCursorID cursor,
+                                 size_t batch,
+                                 TableRows& results,
+                                 bool& done) {
+  extensions::ExtensionTableResponse er;
+  auto client = manager() ? client_->em : client_->e;
+  client->nextRows(
+      er, static_cast<int64_t>(cursor), static_cast<int64_t>(batch));
+  if (er.status.code != (int)extensions::ExtensionCode::EXT_SUCCESS) {
+    return Status(er.status.code, er.status.message);
+  }
+  done = er.done;
+  return setColumnsFromThrift(er, results);
+}
+
+Status ExtensionClient::closeTable(TableCursorID cursor) {
+  extensions::ExtensionStatus status;
+  auto client = manager() ? client_->em : client_->e;
+  client->closeTable(status, static_cast<int64_t>(cursor));
+  return Status(status.code, status.message);
+}
+
 void ExtensionClient::shutdown() {
   auto client = manager() ? client_->em : client_->e;
   client->shutdown();
@@ -8,8 +8,10 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -25,10 +27,38 @@ using chrono_clock = std::chrono::high_resolution_clock;
 
 namespace osquery {
 
+DECLARE_uint64(extensions_table_batch);
+
 const std::vector<std::string> kSDKVersionChanges = {
     {"1.7.7"},
 };
 
+/// Seconds an open table cursor is kept without being read.
+const size_t kTableCursorExpiry{300};
+
+struct ExtensionTableCursor : private boost::noncopyable {
+  /// The table generating the rows.
+  std::shared_ptr<TablePlugin> plugin;
+
+  /// The query context, generator tables keep a reference.
+  std::unique_ptr<QueryContext> context;
+
+  /// Generator tables produce rows as each batch is read.
+  std::unique_ptr<RowGenerator::pull_type> generator;
+
+  /// The rows of other tables, generated when the cursor is opened.
+  std::unique_ptr<TableRows> rows;
+
+  /// The next row read from rows.
+  size_t row{0};
+
+  /// The last time in seconds the cursor was read.
+  size_t used{0};
+
+  /// A cursor is read by one caller at a time.
+  Mutex mutex;
+};
+
 Status ExtensionInterface::ping() {
   // Need to translate return code into 0 and extract the UUID.
   assert(uuid_ < INT_MAX);
@@ -57,6 +87,161 @@ void ExtensionInterface::shutdown() {
   Initializer::requestShutdown(EXIT_SUCCESS);
 }
 
+Status ExtensionInterface::generateTable(const std::string& table,
+                                         QueryContext& context,
+                                         std::unique_ptr<TableRows>& results) {
+  auto item = RegistryFactory::get().getAlias("table", table);
+  if (!RegistryFactory::get().exists("table", item, true)) {
+    return Status(1, "Cannot generate unknown table: " + table);
+  }
+
+  auto plugin = std::dynamic_pointer_cast<TablePlugin>(
+      RegistryFactory::get().plugin("table", item));
+  if (plugin == nullptr) {
+    return Status(1, "Cannot generate table: " + table);
+  }
+
+  results = std::make_unique<TableRows>(plugin->columns());
+  if (plugin->usesTypedRows()) {
+    plugin->generateTypedRows(context, *results);
+  } else if (plugin->usesGenerator()) {
+    RowGenerator::pull_type generator(std::bind(&TablePlugin::generator,
+                                                plugin,
+                                                std::placeholders::_1,
+                                                std::ref(context)));
+    for (const auto& row : generator) {
+      results->addRow(row);
+    }
+  } else {
+    results->append(plugin->generate(context));
+  }
+  return Status(0, "OK");
+}
+
+Status ExtensionInterface::openTable(const std::string& table,
+                                     std::unique_ptr<QueryContext> context,
+                                     size_t batch,
+                                     std::unique_ptr<TableRows>& results,
+                                     TableCursorID& cursor,
+                                     bool& done) {
+  auto item = RegistryFactory::get().getAlias("table", table);
+  if (!RegistryFactory::get().exists("table", item, true)) {
+    return Status(1, "Cannot open unknown table: " + table);
+  }
+
+  auto state = std::make_shared<ExtensionTableCursor>();
+  state->plugin = std::dynamic_pointer_cast<TablePlugin>(
+      RegistryFactory::get().plugin("table", item));
+  if (state->plugin == nullptr) {
+    return Status(1, "Cannot open table: " + table);
+  }
+
+  state->context = std::move(context);
+  try {
+    if (state->plugin->usesGenerator()) {
+      // The generator runs until its first row.
+      state->generator = std::make_unique<RowGenerator::pull_type>(
+          std::bind(&TablePlugin::generator,
+                    state->plugin,
+                    std::placeholders::_1,
+                    std::ref(*state->context)));
+    } else {
+      auto status = generateTable(item, *state->context, state->rows);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+  } catch (const std::exception& e) {
+    return Status(1, "Cannot generate table " + table + ": " + e.what());
+  }
+
+  auto now = getUnixTime();
+  {
+    WriteLock lock(cursors_mutex_);
+    // Remove cursors left open by callers that stopped reading.
+    for (auto it = cursors_.begin(); it != cursors_.end();) {
+      if (it->second->used + kTableCursorExpiry < now) {
+        it = cursors_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    cursor = next_cursor_++;
+    state->used = now;
+    cursors_[cursor] = state;
+  }
+  return readCursor(cursor, state, batch, results, done);
+}
+
+Status ExtensionInterface::nextRows(TableCursorID cursor,
+                                    size_t batch,
+                                    std::unique_ptr<TableRows>& results,
+                                    bool& done) {
+  std::shared_ptr<ExtensionTableCursor> state;
+  {
+    ReadLock lock(cursors_mutex_);
+    auto it = cursors_.find(cursor);
+    if (it == cursors_.end()) {
+      return Status(1, "Unknown table cursor: " + std::to_string(cursor));
+    }
+    state = it->second;
+  }
+  return readCursor(cursor, state, batch, results, done);
+}
+
+Status ExtensionInterface::closeTable(TableCursorID cursor) {
+  WriteLock lock(cursors_mutex_);
+  if (cursors_.erase(cursor) == 0) {
+    return Status(1, "Unknown table cursor: " + std::to_string(cursor));
+  }
+  return Status(0, "OK");
+}
+
+Status ExtensionInterface::readCursor(
+    TableCursorID id,
+    const std::shared_ptr<ExtensionTableCursor>& cursor,
+    size_t batch,
+    std::unique_ptr<TableRows>& results,
+    bool& done) {
+  batch = std::max(batch, size_t{1});
+  Status status(0, "OK");
+  {
+    WriteLock lock(cursor->mutex);
+    cursor->used = getUnixTime();
+    if (cursor->generator != nullptr) {
+      results = std::make_unique<TableRows>(cursor->plugin->columns());
+      auto& generator = *cursor->generator;
+      try {
+        while (generator && results->rows() < batch) {
+          results->addRow(generator.get());
+          generator();
+        }
+        done = !generator;
+      } catch (const std::exception& e) {
+        // The generator cannot be resumed, the cursor is closed.
+        status = Status(1, "Table generator failed: " + std::string(e.what()));
+        results = nullptr;
+        done = true;
+      }
+    } else {
+      std::vector<size_t> rows;
+      auto end = std::min(cursor->row + batch, cursor->rows->rows());
+      for (; cursor->row < end; cursor->row++) {
+        rows.push_back(cursor->row);
+      }
+      results = cursor->rows->select(rows);
+      done = (cursor->row == cursor->rows->rows());
+    }
+  }
+
+  if (done) {
+    WriteLock lock(cursors_mutex_);
+    cursors_.erase(id);
+  }
+  return status;
+}
+
 ExtensionList ExtensionManagerInterface::extensions() {
   refresh();
 
@@ -182,6 +367,75 @@ bool ExtensionManagerInterface::exists(const std::string& name) {
   return false;
 }
 
+Status ExtensionClient::generateTable(const std::string& table,
+                                      const QueryContext& context,
+                                      TableRows& results) {
+  bool supported = true;
+  auto status = generateColumns(table, context, results, supported);
+  if (supported) {
+    return status;
+  }
+
+  // Extensions built with an earlier SDK only implement call.
+  PluginRequest request = {{"action", "generate"}};
+  TablePlugin::setRequestFromContext(context, request);
+  PluginResponse response;
+  status = call("table", table, request, response);
+  if (status.ok()) {
+    results.append(response);
+  }
+  return status;
+}
+
+Status ExtensionClient::streamTable(const std::string& table,
+                                    const QueryContext& context,
+                                    const TableColumns& columns,
+                                    TableRowsYield& yield) {
+  /// Close the cursor if the generator is destroyed before the last row.
+  struct CursorGuard {
+    ExtensionClient* client;
+    TableCursorID cursor{0};
+    bool open{false};
+
+    ~CursorGuard() {
+      if (open) {
+        try {
+          client->closeTable(cursor);
+        } catch (const std::exception& /* e */) {
+          // The extension may have exited, its cursors are closed with it.
+        }
+      }
+    }
+  } guard{this};
+
+  auto batch = static_cast<size_t>(FLAGS_extensions_table_batch);
+  auto rows = std::make_unique<TableRows>(columns);
+  bool done = false;
+  bool supported = true;
+  auto status = openTable(
+      table, context, batch, *rows, guard.cursor, done, supported);
+  if (!supported) {
+    // Extensions built with an earlier SDK return every row at once.
+    status = generateTable(table, context, *rows);
+    done = true;
+  }
+
+  while (status.ok()) {
+    guard.open = !done;
+    if (rows->rows() > 0) {
+      // The batch is read in place by the caller, values are not converted.
+      yield(std::shared_ptr<const TableRows>(std::move(rows)));
+    }
+
+    if (done) {
+      break;
+    }
+    rows = std::make_unique<TableRows>(columns);
+    status = nextRows(guard.cursor, batch, *rows, done);
+  }
+  return status;
+}
+
 void removeStalePaths(const std::string& manager) {
   std::vector<std::string> paths;
   // Attempt to remove all stale extension sockets.
@@ -35,6 +35,12 @@ enum class ExtensionCode {
   EXT_FATAL = 2,
 };
 
+/// Unique ID for each open table cursor.
+using TableCursorID = uint64_t;
+
+/// The state of an open table cursor, see ExtensionInterface::openTable.
+struct ExtensionTableCursor;
+
 using OptionList = std::map<std::string, Option>;
 using ExtensionRouteTable = std::map<std::string, PluginResponse>;
 using ExtensionRegistry = std::map<std::string, ExtensionRouteTable>;
@@ -99,9 +105,73 @@ class ExtensionInterface : public ExtensionAPI {
                       PluginResponse& response) override;
   virtual void shutdown() override;
 
+  /**
+   * @brief Generate a table's rows as typed columns.
+   *
+   * This serves the typed generateTable call. Tables using typed rows fill
+   * the results directly, the rows of other tables are converted once.
+   *
+   * @param table The table name or alias.
+   * @param context The query context sent by the caller.
+   * @param results [output] The rows, using the table's columns.
+   */
+  Status generateTable(const std::string& table,
+                       QueryContext& context,
+                       std::unique_ptr<TableRows>& results);
+
+  /**
+   * @brief Open a cursor over a table's rows and read the first batch.
+   *
+   * Generator tables produce rows as each batch is read. Other tables are
+   * generated when the cursor is opened and their rows are read in batches.
+   * Cursors are closed when their last row is read, by closeTable, when the
+   * table's generator fails, or when they have not been read for
+   * kTableCursorExpiry seconds.
+   *
+   * @param table The table name or alias.
+   * @param context The query context sent by the caller.
+   * @param batch The most rows to read.
+   * @param results [output] The rows, using the table's columns.
+   * @param cursor [output] The cursor ID used to read more rows.
+   * @param done [output] Set if the table has no more rows.
+   */
+  Status openTable(const std::string& table,
+                   std::unique_ptr<QueryContext> context,
+                   size_t batch,
+                   std::unique_ptr<TableRows>& results,
+                   TableCursorID& cursor,
+                   bool& done);
+
+  /// Read the next batch of rows from an open cursor, see openTable.
+  Status nextRows(TableCursorID cursor,
+                  size_t batch,
+                  std::unique_ptr<TableRows>& results,
+                  bool& done);
+
+  /// Close a cursor before its last row was read.
+  Status closeTable(TableCursorID cursor);
+
+ private:
+  /// Read a batch of rows from a cursor, closing it after the last row.
+  Status readCursor(TableCursorID id,
+                    const std::shared_ptr<ExtensionTableCursor>& cursor,
+                    size_t batch,
+                    std::unique_ptr<TableRows>& results,
+                    bool& done);
+
  protected:
   /// Transient UUID assigned to the extension after registering.
   std::atomic<RouteUUID> uuid_;
+
+ private:
+  /// Open table cursors by ID.
+  std::map<TableCursorID, std::shared_ptr<ExtensionTableCursor>> cursors_;
+
+  /// The ID assigned to the next table cursor.
+  TableCursorID next_cursor_{1};
+
+  /// Mutex for table cursor accessors.
+  Mutex cursors_mutex_;
 };
 
 /**
@@ -369,6 +439,74 @@ class ExtensionClient : public ExtensionClientCore, public ExtensionAPI {
 
   /// Request that the extension stop.
   void shutdown() override;
+
+  /**
+   * @brief Generate an extension's table rows as typed columns.
+   *
+   * The query context is sent as a structure and the rows are returned as a
+   * column header and typed column values. Extensions built without the
+   * generateTable call are asked to generate the rows using call.
+   *
+   * @param table The extension's table name.
+   * @param context The query context.
+   * @param results [output] Rows are added using the columns' names.
+   */
+  Status generateTable(const std::string& table,
+                       const QueryContext& context,
+                       TableRows& results);
+
+  /**
+   * @brief Stream an extension's table rows through a table cursor.
+   *
+   * Rows are read in batches of --extensions_table_batch and each typed
+   * batch is passed to the yield function. If the caller stops reading, the
+   * cursor is closed when the generator is destroyed. Extensions built
+   * without table cursors generate every row using generateTable.
+   *
+   * @param table The extension's table name.
+   * @param context The query context.
+   * @param columns The table's columns, used to read each batch.
+   * @param yield Called with each batch of rows.
+   */
+  Status streamTable(const std::string& table,
+                     const QueryContext& context,
+                     const TableColumns& columns,
+                     TableRowsYield& yield);
+
+ protected:
+  /**
+   * @brief Call generateTable, see ExtensionClient::generateTable.
+   *
+   * @param supported [output] false if the extension does not implement the
+   * generateTable call.
+   */
+  Status generateColumns(const std::string& table,
+                         const QueryContext& context,
+                         TableRows& results,
+                         bool& supported);
+
+  /**
+   * @brief Call openTable, see ExtensionInterface::openTable.
+   *
+   * @param supported [output] false if the extension does not implement the
+   * openTable call.
+   */
+  Status openTable(const std::string& table,
+                   const QueryContext& context,
+                   size_t batch,
+                   TableRows& results,
+                   TableCursorID& cursor,
+                   bool& done,
+                   bool& supported);
+
+  /// Call nextRows, see ExtensionInterface::nextRows.
+  Status nextRows(TableCursorID cursor,
+                  size_t batch,
+                  TableRows& results,
+                  bool& done);
+
+  /// Call closeTable, see ExtensionInterface::closeTable.
+  Status closeTable(TableCursorID cursor);
 };
 
 /// Internal accessor for a client to an extension manager (from an extension).
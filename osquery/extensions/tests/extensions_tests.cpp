@@ -28,6 +28,8 @@
 
 namespace osquery {
 
+DECLARE_uint64(extensions_table_batch);
+
 const int kDelay = 20;
 const int kTimeout = 3000;
 
@@ -255,6 +257,228 @@ TEST_F(ExtensionsTest, test_extension_broadcast) {
   rf.allowDuplicates(false);
 }
 
+class TypedExtensionTable : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("id", BIGINT_TYPE, ColumnOptions::INDEX),
+        std::make_tuple("name", TEXT_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("load", DOUBLE_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+  QueryData generate(QueryContext& context) override {
+    QueryData results;
+    for (const auto& id : context.constraints["id"].getAll(EQUALS)) {
+      results.push_back({{"id", id}, {"name", "item" + id}});
+    }
+    return results;
+  }
+};
+
+class GeneratorExtensionTable : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("id", BIGINT_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("load", DOUBLE_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+  bool usesGenerator() const override {
+    return true;
+  }
+
+  void generator(RowYield& yield, QueryContext& context) override {
+    (void)context;
+    for (size_t i = 0; i < 10; i++) {
+      Row r = {{"id", std::to_string(i)}, {"load", "1e-9"}};
+      yield(r);
+    }
+  }
+};
+
+class FailingExtensionTable : public GeneratorExtensionTable {
+ private:
+  void generator(RowYield& yield, QueryContext& context) override {
+    (void)context;
+    for (size_t i = 0; i < 2; i++) {
+      Row r = {{"id", std::to_string(i)}};
+      yield(r);
+    }
+    throw std::runtime_error("generator failed");
+  }
+};
+
+TEST_F(ExtensionsTest, test_extension_table_cursor) {
+  auto& rf = RegistryFactory::get();
+  rf.registry("table")->add("cursor_extension_table",
+                            std::make_shared<GeneratorExtensionTable>());
+  rf.registry("table")->add("typed_extension_table",
+                            std::make_shared<TypedExtensionTable>());
+
+  // Generator rows are produced as each batch is read.
+  ExtensionInterface extension;
+  std::unique_ptr<TableRows> rows;
+  TableCursorID cursor = 0;
+  bool done = false;
+  auto status = extension.openTable("cursor_extension_table",
+                                    std::make_unique<QueryContext>(),
+                                    4,
+                                    rows,
+                                    cursor,
+                                    done);
+  EXPECT_TRUE(status.ok());
+  EXPECT_FALSE(done);
+  ASSERT_EQ(4U, rows->rows());
+  EXPECT_EQ(3, rows->getInteger(3, 0));
+
+  status = extension.nextRows(cursor, 4, rows, done);
+  EXPECT_TRUE(status.ok());
+  ASSERT_EQ(4U, rows->rows());
+  EXPECT_EQ(4, rows->getInteger(0, 0));
+
+  // A cursor may be closed before its last row.
+  EXPECT_TRUE(extension.closeTable(cursor).ok());
+  EXPECT_FALSE(extension.nextRows(cursor, 4, rows, done).ok());
+
+  // Other tables are generated when opened, then read in batches.
+  auto context = std::make_unique<QueryContext>();
+  context->constraints["id"].affinity = BIGINT_TYPE;
+  for (const auto& id : {"1", "2", "3"}) {
+    context->constraints["id"].add(Constraint(EQUALS, id));
+  }
+  status = extension.openTable(
+      "typed_extension_table", std::move(context), 2, rows, cursor, done);
+  EXPECT_TRUE(status.ok());
+  EXPECT_FALSE(done);
+  EXPECT_EQ(2U, rows->rows());
+
+  status = extension.nextRows(cursor, 2, rows, done);
+  EXPECT_TRUE(status.ok());
+  EXPECT_TRUE(done);
+  ASSERT_EQ(1U, rows->rows());
+  EXPECT_EQ(3, rows->getInteger(0, 0));
+
+  // The cursor was closed after its last row.
+  EXPECT_FALSE(extension.closeTable(cursor).ok());
+
+  // A generator that throws fails the read and closes its cursor.
+  rf.registry("table")->add("failing_extension_table",
+                            std::make_shared<FailingExtensionTable>());
+  status = extension.openTable("failing_extension_table",
+                               std::make_unique<QueryContext>(),
+                               1,
+                               rows,
+                               cursor,
+                               done);
+  EXPECT_TRUE(status.ok());
+  EXPECT_FALSE(done);
+  ASSERT_EQ(1U, rows->rows());
+
+  status = extension.nextRows(cursor, 1, rows, done);
+  EXPECT_FALSE(status.ok());
+  EXPECT_TRUE(done);
+  EXPECT_FALSE(extension.closeTable(cursor).ok());
+
+  rf.registry("table")->remove("cursor_extension_table");
+  rf.registry("table")->remove("typed_extension_table");
+  rf.registry("table")->remove("failing_extension_table");
+}
+
+TEST_F(ExtensionsTest, test_extension_table) {
+  auto status = startExtensionManager(socket_path);
+  EXPECT_TRUE(status.ok());
+  EXPECT_TRUE(socketExistsLocal(socket_path));
+
+  auto& rf = RegistryFactory::get();
+  rf.allowDuplicates(true);
+  status = startExtension(socket_path, "test", "0.1", "0.0.0", "0.0.0");
+  EXPECT_TRUE(status.ok());
+
+  RouteUUID uuid;
+  try {
+    uuid = (RouteUUID)stoi(status.getMessage(), nullptr, 0);
+  } catch (const std::exception& /* e */) {
+    EXPECT_TRUE(false);
+    return;
+  }
+
+  auto ext_socket = socket_path + "." + std::to_string(uuid);
+  EXPECT_TRUE(socketExistsLocal(ext_socket));
+
+  // The table is added after the broadcast, it is only called by name.
+  rf.registry("table")->add("typed_extension_table",
+                            std::make_shared<TypedExtensionTable>());
+
+  QueryContext context;
+  context.constraints["id"].affinity = BIGINT_TYPE;
+  context.constraints["id"].add(Constraint(EQUALS, "2"));
+  context.constraints["id"].add(Constraint(EQUALS, "3"));
+
+  // Columns are matched by name, the caller's column order may differ.
+  TableRows rows({
+      std::make_tuple("name", TEXT_TYPE, ColumnOptions::DEFAULT),
+      std::make_tuple("id", BIGINT_TYPE, ColumnOptions::INDEX),
+      std::make_tuple("load", DOUBLE_TYPE, ColumnOptions::DEFAULT),
+  });
+  status = callExtensionTable(
+      ext_socket, "typed_extension_table", context, rows);
+  EXPECT_TRUE(status.ok());
+  ASSERT_EQ(2U, rows.rows());
+  EXPECT_EQ(2, rows.getInteger(0, 1));
+  EXPECT_EQ(3, rows.getInteger(1, 1));
+
+  size_t size = 0;
+  const auto* name = rows.getText(1, 0, size);
+  EXPECT_EQ("item3", std::string(name, size));
+  EXPECT_TRUE(rows.isNull(0, 2));
+
+  // Unknown tables return the extension's error.
+  TableRows missing({});
+  status = callExtensionTable(ext_socket, "missing_table", context, missing);
+  EXPECT_FALSE(status.ok());
+
+  // Rows are streamed in batches, and the reader may stop early.
+  rf.registry("table")->add("cursor_extension_table",
+                            std::make_shared<GeneratorExtensionTable>());
+  auto batch = FLAGS_extensions_table_batch;
+  FLAGS_extensions_table_batch = 4;
+
+  TableColumns columns = {
+      std::make_tuple("id", BIGINT_TYPE, ColumnOptions::DEFAULT),
+      std::make_tuple("load", DOUBLE_TYPE, ColumnOptions::DEFAULT),
+  };
+  for (size_t limit : {3, 10}) {
+    std::vector<long long> ids;
+    {
+      ExtensionClient client(ext_socket);
+      TableRowsGenerator::pull_type generator([&](TableRowsYield& yield) {
+        client.streamTable("cursor_extension_table", {}, columns, yield);
+      });
+      for (; generator && ids.size() < limit; generator()) {
+        auto rows = generator.get();
+        EXPECT_GE(4U, rows->rows());
+        for (size_t i = 0; i < rows->rows() && ids.size() < limit; i++) {
+          ids.push_back(rows->getInteger(i, 0));
+
+          // Typed values and their source text are kept.
+          EXPECT_EQ(1e-9, rows->getDouble(i, 1));
+          EXPECT_EQ("1e-9", rows->getRow(i).at("load"));
+        }
+      }
+    }
+    ASSERT_EQ(limit, ids.size());
+    EXPECT_EQ(static_cast<long long>(limit - 1), ids.back());
+  }
+
+  FLAGS_extensions_table_batch = batch;
+  rf.registry("table")->remove("cursor_extension_table");
+  rf.registry("table")->remove("typed_extension_table");
+  rf.removeBroadcast(uuid);
+  rf.allowDuplicates(false);
+}
+
 TEST_F(ExtensionsTest, test_extension_module_search) {
   createMockFileStructure();
   tearDownMockFileStructure();
@@ -22,6 +22,7 @@
 #include <unistd.h>
 #endif
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -347,6 +348,35 @@ bool platformChmod(const std::string& path, mode_t perms);
  */
 std::vector<std::string> platformGlob(const std::string& find_path);
 
+#ifndef WIN32
+/**
+ * @brief Walk every directory below a set of directories in one pass.
+ *
+ * This expands a recursive glob without repeating the glob for each level.
+ * Entries are read relative to their directory's descriptor, and as with
+ * platformGlob, names starting with '.' are skipped and directories, including
+ * symlinks to directories, are marked with a trailing '/'.
+ *
+ * A directory is not entered if its device and inode are those of a directory
+ * above it, which stops symlink and bind mount loops.
+ *
+ * Wide trees are read by a pool of threads. The callback is always called on
+ * the calling thread, with the paths of a directory as soon as it is read.
+ *
+ * @param roots The directories to walk, each with a trailing '/'.
+ * @param max_depth The number of levels read below the roots.
+ * @param directories Only pass directories to the callback.
+ * @param threads The most threads reading directories.
+ * @param callback Called for each path, return false to stop the walk.
+ */
+void platformWalkDirectories(
+    const std::vector<std::string>& roots,
+    size_t max_depth,
+    bool directories,
+    size_t threads,
+    const std::function<bool(const std::string& path)>& callback);
+#endif
+
 /**
  * @brief Checks to see if the current user has the permissions to perform a
  *        specified operation on a file.
@@ -46,6 +46,11 @@ HIDDEN_FLAG(bool, allow_unsafe, false, "Allow unsafe executable permissions");
 /// Disable forensics (atime/mtime preserving) file reads.
 HIDDEN_FLAG(bool, disable_forensic, true, "Disable atime/mtime preservation");
 
+HIDDEN_FLAG(uint32,
+            glob_threads,
+            4,
+            "Threads used to walk the directories of recursive globs");
+
 static const size_t kMaxRecursiveGlobs = 64;
 
 Status writeTextFile(const fs::path& path,
@@ -270,6 +275,7 @@ Status removePath(const fs::path& path) {
   return Status(0, std::to_string(removed_files));
 }
 
+#ifdef WIN32
 static bool checkForLoops(std::set<int>& dsym_inos, std::string path) {
   if (path.empty() || path.back() != '/') {
     return false;
@@ -294,21 +300,41 @@ static bool checkForLoops(std::set<int>& dsym_inos, std::string path) {
   }
   return false;
 }
+#endif
 
 static void genGlobs(std::string path,
-                     std::vector<std::string>& results,
+                     const GlobCallback& callback,
                      GlobLimits limits) {
   // Use our helped escape/replace for wildcards.
   replaceGlobWildcards(path, limits);
+
+  // Pass results based on settings/requested glob limitations.
+  auto limited = [&callback, limits](const std::string& found) {
+    bool folder = (found.back() == '/' || found.back() == '\\');
+    if ((folder && (limits & GLOB_FOLDERS)) ||
+        (!folder && (limits & GLOB_FILES))) {
+      return callback(found);
+    }
+    return true;
+  };
+
+  auto glob_results = platformGlob(path);
+
+  // A recursive pattern ends with a double star, allowing a trailing slash.
+  size_t wild = path.rfind("**");
+  bool recursive = !(glob_results.empty() || wild > path.size() ||
+                     wild + 3 < path.size());
+
+#ifdef WIN32
   // inodes of directory symlinks for loop detection
   std::set<int> dsym_inos;
 
   // Generate a glob set and recurse for double star.
-  for (size_t glob_index = 0; ++glob_index < kMaxRecursiveGlobs;) {
-    auto glob_results = platformGlob(path);
-
+  for (size_t glob_index = 1; glob_index < kMaxRecursiveGlobs; glob_index++) {
     for (auto& result_path : glob_results) {
-      results.push_back(result_path);
+      if (!limited(result_path)) {
+        return;
+      }
 
       if (checkForLoops(dsym_inos, result_path)) {
         glob_index = kMaxRecursiveGlobs;
@@ -316,27 +342,33 @@ static void genGlobs(std::string path,
     }
 
     // The end state is a non-recursive ending or empty set of matches.
-    size_t wild = path.rfind("**");
-    // Allow a trailing slash after the double wild indicator.
-    if (glob_results.size() == 0 || wild > path.size() ||
-        wild + 3 < path.size()) {
+    if (!recursive || glob_results.empty()) {
       break;
     }
 
     path += "/**";
+    glob_results = platformGlob(path);
+  }
+#else
+  std::vector<std::string> roots;
+  for (auto& result_path : glob_results) {
+    if (!limited(result_path)) {
+      return;
+    }
+    if (recursive && result_path.back() == '/') {
+      roots.push_back(std::move(result_path));
+    }
   }
 
-  // Prune results based on settings/requested glob limitations.
-  auto end = std::remove_if(
-      results.begin(), results.end(), [limits](const std::string& found) {
-        return !(((found[found.length() - 1] == '/' ||
-                   found[found.length() - 1] == '\\') &&
-                  limits & GLOB_FOLDERS) ||
-                 ((found[found.length() - 1] != '/' &&
-                   found[found.length() - 1] != '\\') &&
-                  limits & GLOB_FILES));
-      });
-  results.erase(end, results.end());
+  // Walk below the directories matching the first level, once.
+  if (!roots.empty()) {
+    platformWalkDirectories(roots,
+                            kMaxRecursiveGlobs - 2,
+                            path.back() == '/',
+                            FLAGS_glob_threads,
+                            limited);
+  }
+#endif
 }
 
 Status resolveFilePattern(const fs::path& fs_path,
@@ -347,7 +379,19 @@ Status resolveFilePattern(const fs::path& fs_path,
 Status resolveFilePattern(const fs::path& fs_path,
                           std::vector<std::string>& results,
                           GlobLimits setting) {
-  genGlobs(fs_path.string(), results, setting);
+  genGlobs(fs_path.string(),
+           ([&results](const std::string& path) {
+             results.push_back(path);
+             return true;
+           }),
+           setting);
+  return Status(0, "OK");
+}
+
+Status resolveFilePattern(const fs::path& fs_path,
+                          const GlobCallback& callback,
+                          GlobLimits setting) {
+  genGlobs(fs_path.string(), callback, setting);
   return Status(0, "OK");
 }
 
@@ -405,8 +449,7 @@ inline Status listInAbsoluteDirectory(const fs::path& path,
     return Status(1, "Path not a directory: " + path.parent_path().string());
   }
 
-  genGlobs(path.string(), results, limits);
-  return Status(0, "OK");
+  return resolveFilePattern(path, results, limits);
 }
 
 Status listFilesInDirectory(const fs::path& path,
@@ -0,0 +1,69 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <osquery/filesystem.h>
+
+#include "osquery/filesystem/linux/proc.h"
+#include "osquery/tests/test_util.h"
+
+namespace fs = boost::filesystem;
+
+namespace osquery {
+
+/// Create a /proc-like tree of processes, a quarter of descriptors sockets.
+static std::string benchmarkProcTree(size_t processes, size_t descriptors) {
+  auto root = fs::path(kTestWorkingDirectory) / "benchmark-proc";
+  removePath(root);
+
+  size_t inode = 0;
+  for (size_t pid = 1; pid <= processes; pid++) {
+    auto fd = root / std::to_string(pid) / "fd";
+    fs::create_directories(fd);
+    for (size_t i = 0; i < descriptors; i++) {
+      auto link = (i % 4 == 0) ? "socket:[" + std::to_string(++inode) + "]"
+                               : "/var/log/benchmark." + std::to_string(i);
+      symlink(link.c_str(), (fd / std::to_string(i)).c_str());
+    }
+  }
+  return root.string();
+}
+
+/// Read the sweep anew, the previous per-table path read every descriptor.
+static void PROC_sweep_fresh(benchmark::State& state) {
+  auto root = benchmarkProcTree(500, 100);
+  while (state.KeepRunning()) {
+    ProcessDescriptorSweep sweep;
+    procSweepDescriptors(root, state.range(0), sweep);
+    benchmark::DoNotOptimize(sweep.sockets.size());
+  }
+  removePath(root);
+}
+
+BENCHMARK(PROC_sweep_fresh)->Arg(1)->Arg(4)->Arg(8);
+
+/// Tables after the first in a schedule step use the shared sweep.
+static void PROC_sweep_cached(benchmark::State& state) {
+  auto root = benchmarkProcTree(500, 100);
+  procGetDescriptorSweep(1, root);
+  while (state.KeepRunning()) {
+    auto sweep = procGetDescriptorSweep(1, root);
+    benchmark::DoNotOptimize(sweep->sockets.size());
+  }
+  removePath(root);
+}
+
+BENCHMARK(PROC_sweep_cached);
+} // namespace osquery
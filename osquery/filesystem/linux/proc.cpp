@@ -8,18 +8,37 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <dirent.h>
+#include <fcntl.h>
 #include <linux/limits.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 #include <boost/filesystem.hpp>
 
 #include <osquery/filesystem.h>
+#include <osquery/flags.h>
 #include <osquery/logger.h>
 
 #include "osquery/core/conversions.h"
 #include "osquery/filesystem/linux/proc.h"
 
 namespace osquery {
+
+HIDDEN_FLAG(uint32,
+            proc_sweep_threads,
+            4,
+            "Threads used to read the descriptors of every process");
+
+DECLARE_bool(disable_caching);
+
+/// The number of processes each sweep thread takes at a time.
+const size_t kProcSweepRange{16};
+
 const std::vector<std::string> kUserNamespaceList = {
     "cgroup", "ipc", "mnt", "net", "pid", "user", "uts"};
 
@@ -302,6 +321,133 @@ Status procGetSocketInodeToProcessInfoMap(const std::string& pid,
       pid, result, callback);
 }
 
+/// Read the descriptor links of one process, relative to its fd directory.
+static void procSweepProcess(const std::string& root,
+                             const std::string& pid,
+                             ProcessDescriptorSweep& sweep) {
+  auto dir = opendir((root + "/" + pid + "/fd").c_str());
+  if (dir == nullptr) {
+    // The process exited or is not readable.
+    return;
+  }
+
+  auto& descriptors = sweep.descriptors[pid];
+  char link[PATH_MAX] = {0};
+  while (auto entry = readdir(dir)) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+
+    auto size = readlinkat(dirfd(dir), entry->d_name, link, sizeof(link) - 1);
+    if (size < 0) {
+      continue;
+    }
+
+    std::string fd(entry->d_name);
+    std::string target(link, static_cast<size_t>(size));
+    if (target.compare(0, 8, "socket:[") == 0 && target.back() == ']') {
+      sweep.sockets[target.substr(8, target.size() - 9)] = {pid, fd};
+    }
+    descriptors.emplace(std::move(fd), std::move(target));
+  }
+  closedir(dir);
+}
+
+Status procSweepDescriptors(const std::string& root,
+                            size_t threads,
+                            ProcessDescriptorSweep& sweep) {
+  sweep.descriptors.clear();
+  sweep.sockets.clear();
+
+  std::vector<std::string> pids;
+  auto dir = opendir(root.c_str());
+  if (dir == nullptr) {
+    return Status(1, "Cannot read processes from " + root);
+  }
+  while (auto entry = readdir(dir)) {
+    if (std::atoll(entry->d_name) > 0) {
+      pids.push_back(entry->d_name);
+    }
+  }
+  closedir(dir);
+
+  // Each thread takes the next range of pids when it finishes one, so a few
+  // processes with many descriptors do not stall the sweep.
+  threads = std::max<size_t>(1, std::min(threads, pids.size()));
+  std::vector<ProcessDescriptorSweep> partials(threads);
+  std::atomic<size_t> next{0};
+  auto worker = [&root, &pids, &next](ProcessDescriptorSweep& partial) {
+    size_t start;
+    while ((start = next.fetch_add(kProcSweepRange)) < pids.size()) {
+      auto stop = std::min(start + kProcSweepRange, pids.size());
+      for (size_t i = start; i < stop; i++) {
+        procSweepProcess(root, pids[i], partial);
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; i++) {
+    workers.emplace_back(worker, std::ref(partials[i]));
+  }
+  worker(partials[0]);
+  for (auto& thread : workers) {
+    thread.join();
+  }
+
+  // Each process was read by one thread, the partial results do not overlap.
+  for (auto& partial : partials) {
+    if (sweep.descriptors.empty()) {
+      sweep.descriptors = std::move(partial.descriptors);
+      sweep.sockets = std::move(partial.sockets);
+      continue;
+    }
+    for (auto& descriptors : partial.descriptors) {
+      sweep.descriptors.emplace(descriptors.first,
+                                std::move(descriptors.second));
+    }
+    for (auto& socket : partial.sockets) {
+      sweep.sockets.emplace(socket.first, std::move(socket.second));
+    }
+  }
+  return Status(0);
+}
+
+std::shared_ptr<const ProcessDescriptorSweep> procGetDescriptorSweep(
+    size_t step, const std::string& root) {
+  static std::mutex mutex;
+  static size_t sweep_step{0};
+  static std::string sweep_root;
+  static std::shared_ptr<const ProcessDescriptorSweep> sweep{nullptr};
+
+  auto read = [&root]() {
+    auto fresh = std::make_shared<ProcessDescriptorSweep>();
+    auto status = procSweepDescriptors(root, FLAGS_proc_sweep_threads, *fresh);
+    if (!status.ok()) {
+      VLOG(1) << "Failed to read process descriptors: " << status.what();
+    }
+    return fresh;
+  };
+
+  if (step == 0 || FLAGS_disable_caching) {
+    return read();
+  }
+
+  // Hold the lock while reading, concurrent queries in the step wait for it.
+  std::lock_guard<std::mutex> lock(mutex);
+  if (sweep != nullptr && step == sweep_step && root == sweep_root) {
+    return sweep;
+  } else if (step < sweep_step) {
+    // The query started in an earlier step, its sweep is not shared.
+    return read();
+  }
+
+  sweep = read();
+  sweep_step = step;
+  sweep_root = root;
+  return sweep;
+}
+
 Status procProcesses(std::set<std::string>& processes) {
   auto callback = [](const std::string& pid,
                      std::set<std::string>& _processes) -> bool {
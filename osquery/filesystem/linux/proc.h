@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <memory>
 #include <unordered_map>
 
 #include <arpa/inet.h>
@@ -127,6 +128,44 @@ Status procGetSocketList(int family,
 Status procGetSocketInodeToProcessInfoMap(const std::string& pid,
                                           SocketInodeToProcessInfoMap& result);
 
+/// The open descriptors of every process, read in one sweep of /proc.
+struct ProcessDescriptorSweep {
+  /// The descriptors of each process, a map of fd to link, indexed by pid.
+  std::map<std::string, std::map<std::string, std::string>> descriptors;
+
+  /// The process and descriptor owning each socket, indexed by inode.
+  SocketInodeToProcessInfoMap sockets;
+};
+
+/**
+ * @brief Read the descriptors of every process under a proc root.
+ *
+ * The processes are split into small pid ranges, which several threads take
+ * in turn. Each thread reads its descriptor links with readlinkat relative to
+ * the process's fd directory, and the results are merged when all finish.
+ *
+ * @param root The proc root, such as kLinuxProcPath.
+ * @param threads The number of threads reading descriptors.
+ * @param sweep The output parameter, cleared beforehand.
+ */
+Status procSweepDescriptors(const std::string& root,
+                            size_t threads,
+                            ProcessDescriptorSweep& sweep);
+
+/**
+ * @brief Get a descriptor sweep of /proc shared within a schedule step.
+ *
+ * Tables reading the descriptors of every process, such as
+ * process_open_files and process_open_sockets, read them once for each
+ * schedule step. Concurrent callers in the same step wait for one sweep.
+ * A step of 0, used outside the schedule, always reads a new sweep.
+ *
+ * @param step The schedule step, TablePlugin::kCacheStep.
+ * @param root The proc root, a different root replaces the shared sweep.
+ */
+std::shared_ptr<const ProcessDescriptorSweep> procGetDescriptorSweep(
+    size_t step, const std::string& root = kLinuxProcPath);
+
 /**
  * @brief Enumerate all pids in the system by listing pid numbers under /proc
  * and execute a callback for each one of them. The callback will receive the
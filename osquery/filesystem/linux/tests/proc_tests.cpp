@@ -0,0 +1,80 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <osquery/filesystem.h>
+
+#include "osquery/filesystem/linux/proc.h"
+#include "osquery/tests/test_util.h"
+
+namespace fs = boost::filesystem;
+
+namespace osquery {
+
+class ProcTests : public testing::Test {
+ protected:
+  void SetUp() override {
+    root_ = (fs::path(kTestWorkingDirectory) / "proc-tests").string();
+    removePath(root_);
+
+    // Processes 1 to 40 each have a file and a socket descriptor.
+    for (size_t pid = 1; pid <= 40; pid++) {
+      auto fd = fs::path(root_) / std::to_string(pid) / "fd";
+      fs::create_directories(fd);
+      symlink("/dev/null", (fd / "0").c_str());
+      auto socket = "socket:[" + std::to_string(1000 + pid) + "]";
+      symlink(socket.c_str(), (fd / "3").c_str());
+    }
+    fs::create_directories(fs::path(root_) / "self" / "fd");
+  }
+
+  void TearDown() override {
+    removePath(root_);
+  }
+
+ protected:
+  std::string root_;
+};
+
+TEST_F(ProcTests, test_sweep_descriptors) {
+  for (size_t threads : {1, 4}) {
+    ProcessDescriptorSweep sweep;
+    ASSERT_TRUE(procSweepDescriptors(root_, threads, sweep).ok());
+
+    // Only numeric process directories are read.
+    ASSERT_EQ(40U, sweep.descriptors.size());
+    EXPECT_EQ("/dev/null", sweep.descriptors.at("7").at("0"));
+    EXPECT_EQ("socket:[1007]", sweep.descriptors.at("7").at("3"));
+
+    ASSERT_EQ(40U, sweep.sockets.size());
+    EXPECT_EQ("12", sweep.sockets.at("1012").pid);
+    EXPECT_EQ("3", sweep.sockets.at("1012").fd);
+  }
+}
+
+TEST_F(ProcTests, test_descriptor_sweep_step) {
+  auto first = procGetDescriptorSweep(10, root_);
+  ASSERT_NE(nullptr, first);
+  EXPECT_EQ(40U, first->sockets.size());
+
+  // Queries within a step share the sweep.
+  EXPECT_EQ(first, procGetDescriptorSweep(10, root_));
+
+  // The next step, and queries outside the schedule, read a new sweep.
+  auto next = procGetDescriptorSweep(11, root_);
+  EXPECT_NE(first, next);
+  EXPECT_NE(next, procGetDescriptorSweep(0, root_));
+}
+} // namespace osquery
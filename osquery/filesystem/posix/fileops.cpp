@@ -8,6 +8,7 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <dirent.h>
 #include <glob.h>
 #include <pwd.h>
 #include <stdio.h>
@@ -18,9 +19,21 @@
 #include <sys/time.h>
 #include <sys/types.h>
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include <boost/optional.hpp>
 
 #include <osquery/filesystem.h>
+#include <osquery/logger.h>
 
 #include "osquery/core/process.h"
 #include "osquery/filesystem/fileops.h"
@@ -301,6 +314,323 @@ std::vector<std::string> platformGlob(const std::string& find_path) {
   return results;
 }
 
+namespace {
+
+/// Pending directories that start the walk's thread pool.
+const size_t kWalkParallelDirectories{32};
+
+/// Directories read by the pool that may wait for the calling thread.
+const size_t kWalkMaxOutput{64};
+
+/// The directory entry buffer size.
+const size_t kWalkBufferSize{32 * 1024};
+
+/// A directory being walked, linked to the directories above it.
+struct WalkAncestor {
+  dev_t device;
+  ino_t inode;
+  std::shared_ptr<const WalkAncestor> parent;
+};
+
+/// A directory waiting to be read.
+struct WalkItem {
+  std::string path;
+  size_t depth;
+  std::shared_ptr<const WalkAncestor> parent;
+};
+
+using WalkAncestorRef = std::shared_ptr<const WalkAncestor>;
+
+/// The directories above a path, so links to them are not entered.
+WalkAncestorRef getWalkAncestors(
+    std::string path, std::map<std::string, WalkAncestorRef>& known) {
+  while (!path.empty() && path.back() == '/') {
+    path.pop_back();
+  }
+
+  auto slash = path.rfind('/');
+  if (slash == std::string::npos) {
+    return nullptr;
+  }
+
+  auto parent = path.substr(0, slash + 1);
+  auto it = known.find(parent);
+  if (it != known.end()) {
+    return it->second;
+  }
+
+  WalkAncestorRef ancestor = nullptr;
+  struct stat parent_stat;
+  if (::stat(parent.c_str(), &parent_stat) == 0) {
+    ancestor = std::make_shared<const WalkAncestor>(
+        WalkAncestor{parent_stat.st_dev,
+                     parent_stat.st_ino,
+                     (slash == 0) ? nullptr : getWalkAncestors(parent, known)});
+  }
+  known[parent] = ancestor;
+  return ancestor;
+}
+
+#ifdef __linux__
+/// The getdents64 record, not all C libraries declare it.
+struct LinuxDirent64 {
+  ino64_t d_ino;
+  off64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+#endif
+
+/// Call a function with the name and type of each entry of a directory.
+template <typename Function>
+void readDirectoryEntries(int fd, Function&& function) {
+#ifdef __linux__
+  // Read many entries per system call, without the DIR stream's allocation.
+  std::vector<uint64_t> buffer(kWalkBufferSize / sizeof(uint64_t));
+  auto data = reinterpret_cast<char*>(buffer.data());
+  while (true) {
+    auto bytes = syscall(SYS_getdents64, fd, data, kWalkBufferSize);
+    if (bytes <= 0) {
+      break;
+    }
+    for (long offset = 0; offset < bytes;) {
+      auto entry = reinterpret_cast<const LinuxDirent64*>(data + offset);
+      function(entry->d_name, entry->d_type);
+      offset += entry->d_reclen;
+    }
+  }
+#else
+  // The DIR stream takes ownership of a duplicated descriptor.
+  auto dir = fdopendir(dup(fd));
+  if (dir == nullptr) {
+    return;
+  }
+  while (auto entry = readdir(dir)) {
+    function(entry->d_name, entry->d_type);
+  }
+  closedir(dir);
+#endif
+}
+
+class DirectoryWalker : private boost::noncopyable {
+ public:
+  DirectoryWalker(size_t max_depth,
+                  bool directories,
+                  size_t threads,
+                  const std::function<bool(const std::string&)>& callback)
+      : max_depth_(max_depth),
+        directories_(directories),
+        threads_(threads),
+        callback_(callback) {}
+
+  void walk(const std::vector<std::string>& roots);
+
+ private:
+  /// Read one directory, returning its paths and queueing its directories.
+  std::vector<std::string> read(const WalkItem& item,
+                                std::vector<WalkItem>& children);
+
+  /// Read queued directories on a pool thread until the walk finishes.
+  void help();
+
+  /// Queue directories and start the pool if many are pending.
+  void queue(std::vector<WalkItem>& children);
+
+ private:
+  size_t max_depth_;
+  bool directories_;
+  size_t threads_;
+  const std::function<bool(const std::string&)>& callback_;
+
+  /// Directories to read, the newest first to bound the queue.
+  std::vector<WalkItem> pending_;
+
+  /// Paths read by the pool threads, for the calling thread, at most
+  /// kWalkMaxOutput directories so a slow callback pauses the pool.
+  std::deque<std::vector<std::string>> output_;
+
+  /// Directories being read.
+  size_t active_{0};
+
+  /// Set when the callback stops the walk.
+  bool stop_{false};
+
+  std::vector<std::thread> pool_;
+  std::mutex mutex_;
+  std::condition_variable pending_cv_;
+  std::condition_variable output_cv_;
+  std::condition_variable space_cv_;
+};
+
+std::vector<std::string> DirectoryWalker::read(
+    const WalkItem& item, std::vector<WalkItem>& children) {
+  std::vector<std::string> paths;
+  auto fd = ::open(item.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return paths;
+  }
+
+  struct stat dir_stat;
+  if (::fstat(fd, &dir_stat) != 0) {
+    ::close(fd);
+    return paths;
+  }
+
+  for (auto parent = item.parent; parent != nullptr; parent = parent->parent) {
+    if (parent->device == dir_stat.st_dev && parent->inode == dir_stat.st_ino) {
+      LOG(WARNING) << "Symlink loop detected possibly involving: " << item.path;
+      ::close(fd);
+      return paths;
+    }
+  }
+
+  auto self = std::make_shared<const WalkAncestor>(
+      WalkAncestor{dir_stat.st_dev, dir_stat.st_ino, item.parent});
+  auto depth = item.depth + 1;
+  readDirectoryEntries(fd, [&](const char* name, unsigned char type) {
+    if (name[0] == '.') {
+      return;
+    }
+
+    bool directory = (type == DT_DIR);
+    if (type == DT_LNK || type == DT_UNKNOWN) {
+      // Follow symlinks, relative to the directory.
+      struct stat entry_stat;
+      directory = ::fstatat(fd, name, &entry_stat, 0) == 0 &&
+                  S_ISDIR(entry_stat.st_mode);
+    }
+
+    auto path = item.path + name;
+    if (directory) {
+      path += '/';
+      if (depth < max_depth_) {
+        children.push_back(WalkItem{path, depth, self});
+      }
+    }
+    if (directory || !directories_) {
+      paths.push_back(std::move(path));
+    }
+  });
+  ::close(fd);
+  return paths;
+}
+
+void DirectoryWalker::queue(std::vector<WalkItem>& children) {
+  for (auto& child : children) {
+    pending_.push_back(std::move(child));
+  }
+  children.clear();
+
+  if (pool_.empty() && threads_ > 1 &&
+      pending_.size() >= kWalkParallelDirectories) {
+    for (size_t i = 1; i < threads_; i++) {
+      pool_.emplace_back(&DirectoryWalker::help, this);
+    }
+  }
+  pending_cv_.notify_all();
+}
+
+void DirectoryWalker::help() {
+  std::vector<WalkItem> children;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    pending_cv_.wait(lock, [this]() {
+      return stop_ || !pending_.empty() || active_ == 0;
+    });
+    if (stop_ || pending_.empty()) {
+      return;
+    }
+
+    auto item = std::move(pending_.back());
+    pending_.pop_back();
+    active_++;
+    lock.unlock();
+
+    auto paths = read(item, children);
+
+    lock.lock();
+    queue(children);
+    if (!paths.empty()) {
+      // The directory stays active until its paths are queued, so the walk
+      // does not finish while a thread waits for space.
+      space_cv_.wait(lock, [this]() {
+        return stop_ || output_.size() < kWalkMaxOutput;
+      });
+      output_.push_back(std::move(paths));
+    }
+    active_--;
+    output_cv_.notify_one();
+  }
+}
+
+void DirectoryWalker::walk(const std::vector<std::string>& roots) {
+  std::map<std::string, WalkAncestorRef> known;
+  for (const auto& root : roots) {
+    pending_.push_back(WalkItem{root, 0, getWalkAncestors(root, known)});
+  }
+
+  std::vector<WalkItem> children;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    std::vector<std::string> paths;
+    if (!output_.empty()) {
+      // Pass on the paths read by the pool first.
+      paths = std::move(output_.front());
+      output_.pop_front();
+      space_cv_.notify_one();
+    } else if (!pending_.empty()) {
+      auto item = std::move(pending_.back());
+      pending_.pop_back();
+      active_++;
+      lock.unlock();
+
+      paths = read(item, children);
+
+      lock.lock();
+      active_--;
+      queue(children);
+    } else if (active_ == 0) {
+      break;
+    } else {
+      output_cv_.wait(lock);
+      continue;
+    }
+
+    // The callback runs without the lock, the pool keeps reading.
+    lock.unlock();
+    for (const auto& path : paths) {
+      if (!callback_(path)) {
+        lock.lock();
+        stop_ = true;
+        break;
+      }
+    }
+    if (!stop_) {
+      lock.lock();
+    }
+  }
+
+  stop_ = true;
+  pending_cv_.notify_all();
+  space_cv_.notify_all();
+  lock.unlock();
+  for (auto& thread : pool_) {
+    thread.join();
+  }
+}
+} // namespace
+
+void platformWalkDirectories(
+    const std::vector<std::string>& roots,
+    size_t max_depth,
+    bool directories,
+    size_t threads,
+    const std::function<bool(const std::string& path)>& callback) {
+  DirectoryWalker walker(max_depth, directories, threads, callback);
+  walker.walk(roots);
+}
+
 int platformAccess(const std::string& path, mode_t mode) {
   return ::access(path.c_str(), mode);
 }
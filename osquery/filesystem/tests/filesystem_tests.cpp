@@ -325,6 +325,62 @@ TEST_F(FilesystemTests, test_wildcard_double_folders) {
                            .string()));
 }
 
+TEST_F(FilesystemTests, test_wildcard_double_callback) {
+  // Paths are passed as they are found, the callback may stop the walk.
+  size_t count = 0;
+  auto status = resolveFilePattern(
+      kFakeDirectory + "/%%",
+      ([&count](const std::string& path) { return ++count < 3; }));
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(3U, count);
+
+  std::set<std::string> folders;
+  resolveFilePattern(kFakeDirectory + "/%%",
+                     ([&folders](const std::string& path) {
+                       folders.insert(path);
+                       return true;
+                     }),
+                     GLOB_FOLDERS);
+  EXPECT_EQ(10U, folders.size());
+}
+
+#ifndef WIN32
+TEST_F(FilesystemTests, test_wildcard_double_loop) {
+  // A symlink to a directory above it is listed but not entered.
+  auto loop = kFakeDirectory + "/deep1/deep2/loop";
+  ASSERT_EQ(0, symlink(kFakeDirectory.c_str(), loop.c_str()));
+
+  std::vector<std::string> results;
+  auto status = resolveFilePattern(kFakeDirectory + "/%%", results);
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(21U, results.size());
+  EXPECT_TRUE(contains(results, loop + "/"));
+  EXPECT_FALSE(contains(results, loop + "/deep1/"));
+  removePath(loop);
+}
+
+TEST_F(FilesystemTests, test_wildcard_double_slow_callback) {
+  // A wide tree is read by the pool, which waits for a slow callback.
+  fs::path root(kTestWorkingDirectory + "wide-glob");
+  for (size_t i = 0; i < 200; i++) {
+    auto dir = root / std::to_string(i);
+    fs::create_directories(dir);
+    writeTextFile(dir / "file", "content");
+  }
+
+  std::set<std::string> paths;
+  auto status = resolveFilePattern(root.string() + "/%%",
+                                   ([&paths](const std::string& path) {
+                                     sleepFor(1);
+                                     paths.insert(path);
+                                     return true;
+                                   }));
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(400U, paths.size());
+  removePath(root);
+}
+#endif
+
 TEST_F(FilesystemTests, test_wildcard_end_last_component) {
   std::vector<std::string> results;
   auto status = resolveFilePattern(kFakeDirectory + "/%11/%sh", results);
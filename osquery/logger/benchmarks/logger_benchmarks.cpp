@@ -10,14 +10,23 @@
 
 #include <benchmark/benchmark.h>
 
+#include <boost/filesystem/operations.hpp>
+
 #include <osquery/core.h>
+#include <osquery/filesystem.h>
 #include <osquery/flags.h>
 #include <osquery/logger.h>
 #include <osquery/registry_factory.h>
 
+#include "osquery/logger/plugins/filesystem_logger.h"
+#include "osquery/tests/test_util.h"
+
+namespace fs = boost::filesystem;
+
 namespace osquery {
 
 DECLARE_bool(disable_logging);
+DECLARE_uint64(logger_buffer_size);
 
 class DummyLoggerPlugin : public LoggerPlugin {
  public:
@@ -84,4 +93,48 @@ static void LOGGER_logstring_plugin(benchmark::State& state) {
 }
 
 BENCHMARK(LOGGER_logstring_plugin);
+
+/// A typical differential result line.
+const std::string kBenchmarkResultLine =
+    "{\"name\":\"process_events\",\"hostIdentifier\":\"benchmark\","
+    "\"calendarTime\":\"Mon Jan  1 00:00:00 2018 UTC\",\"unixTime\":"
+    "1514764800,\"epoch\":0,\"counter\":1,\"columns\":{\"pid\":\"1\","
+    "\"path\":\"/usr/bin/benchmark\",\"cmdline\":\"benchmark --flag\"},"
+    "\"action\":\"added\"}";
+
+static void LOGGER_filesystem_legacy(benchmark::State& state) {
+  auto path = fs::path(kTestWorkingDirectory) / "benchmark.results.log";
+  fs::create_directories(path.parent_path());
+
+  while (state.KeepRunning()) {
+    writeTextFile(path, kBenchmarkResultLine + '\n', 0640);
+  }
+
+  state.SetBytesProcessed(state.iterations() *
+                          (kBenchmarkResultLine.size() + 1));
+  fs::remove(path);
+}
+
+BENCHMARK(LOGGER_filesystem_legacy);
+
+static void LOGGER_filesystem_writer(benchmark::State& state) {
+  auto path = fs::path(kTestWorkingDirectory) / "benchmark.results.log";
+  fs::create_directories(path.parent_path());
+
+  auto buffer_size = FLAGS_logger_buffer_size;
+  FLAGS_logger_buffer_size = static_cast<uint64_t>(state.range(0));
+  {
+    FilesystemLogWriter writer(path, 0640);
+    while (state.KeepRunning()) {
+      writer.write(kBenchmarkResultLine);
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() *
+                          (kBenchmarkResultLine.size() + 1));
+  FLAGS_logger_buffer_size = buffer_size;
+  fs::remove(path);
+}
+
+BENCHMARK(LOGGER_filesystem_writer)->Arg(0)->Arg(4096)->Arg(64 * 1024);
 }
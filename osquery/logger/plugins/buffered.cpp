@@ -10,6 +10,8 @@
 
 #include <algorithm>
 #include <chrono>
+#include <iomanip>
+#include <sstream>
 #include <thread>
 
 #include <boost/property_tree/json_parser.hpp>
@@ -21,6 +23,7 @@
 #include <osquery/system.h>
 
 #include "osquery/config/parsers/decorators.h"
+#include "osquery/core/conversions.h"
 #include "osquery/core/json.h"
 #include "osquery/logger/plugins/buffered.h"
 
@@ -33,10 +36,19 @@ FLAG(uint64,
      1000000,
      "Maximum number of logs in buffered output plugins (0 = unlimited)");
 
+HIDDEN_FLAG(uint64,
+            buffered_log_send_latency,
+            5000,
+            "Target milliseconds per buffered log send, slower sends shrink "
+            "the batch size (0 = always send max lines)");
+
 const std::chrono::seconds BufferedLogForwarder::kLogPeriod{
     std::chrono::seconds(4)};
 const size_t BufferedLogForwarder::kMaxLogLines{1024};
 
+/// Width of the zero-padded counter in an index, the digits of a size_t.
+const size_t kIndexWidth{20};
+
 Status BufferedLogForwarder::setUp() {
   // initialize buffer_count_ by scanning the DB
   std::vector<std::string> indexes;
@@ -46,55 +58,153 @@ Status BufferedLogForwarder::setUp() {
     return Status(1, "Error scanning for buffered log count");
   }
 
+  // Continue the time and counter after any buffered logs. New indexes must
+  // sort after the lines being sent, which are removed as a range.
+  for (const auto& index : indexes) {
+    auto counter = index.rfind('_');
+    if (counter == std::string::npos || counter == 0) {
+      continue;
+    }
+    auto time = index.rfind('_', counter - 1);
+    if (time == std::string::npos) {
+      continue;
+    }
+
+    auto counter_value = tryTo<size_t>(index.substr(counter + 1));
+    if (counter_value && *counter_value > log_index_) {
+      log_index_ = *counter_value;
+    }
+    auto time_value =
+        tryTo<size_t>(index.substr(time + 1, counter - time - 1));
+    if (time_value && *time_value > log_time_) {
+      log_time_ = *time_value;
+    }
+  }
+
   RecursiveLock lock(count_mutex_);
   buffer_count_ = indexes.size();
   return Status(0);
 }
 
+BufferedLogForwarder::LogBatch BufferedLogForwarder::readBatch(
+    const std::string& results_after,
+    const std::string& statuses_after,
+    size_t limit) {
+  // An index is never empty, start after the index by appending a NULL.
+  auto start = [](const std::string& after) {
+    return (after.empty()) ? after : after + '\0';
+  };
+
+  // Results are read first, statuses fill the remainder of the batch.
+  LogBatch batch;
+  auto status = scanDatabaseValues(kLogs,
+                                   batch.results,
+                                   genIndexPrefix(true),
+                                   start(results_after),
+                                   limit);
+  if (status.ok() && batch.results.size() < limit) {
+    status = scanDatabaseValues(kLogs,
+                                batch.statuses,
+                                genIndexPrefix(false),
+                                start(statuses_after),
+                                limit - batch.results.size());
+  }
+
+  if (!status.ok()) {
+    VLOG(1) << "Error reading buffered logs: " << status.getMessage();
+  }
+  batch.full = (batch.size() >= limit);
+  return batch;
+}
+
+Status BufferedLogForwarder::sendLines(DatabaseStringValueList& lines,
+                                       const std::string& log_type) {
+  std::vector<std::string> log_data;
+  log_data.reserve(lines.size());
+  for (auto& line : lines) {
+    log_data.push_back(std::move(line.second));
+  }
+
+  auto status = send(log_data, log_type);
+  if (!status.ok()) {
+    VLOG(1) << "Error sending " << log_type
+            << " to logger: " << status.getMessage();
+  }
+  return status;
+}
+
+void BufferedLogForwarder::adaptBatchSize(size_t lines,
+                                          std::chrono::milliseconds elapsed) {
+  auto target = std::chrono::milliseconds(FLAGS_buffered_log_send_latency);
+  if (target.count() == 0 || lines == 0) {
+    return;
+  }
+
+  if (elapsed > target) {
+    // Halve the batch, down to a 16th of the max, while the endpoint is slow.
+    auto minimum = std::max<size_t>(1, max_log_lines_ / 16);
+    batch_size_ = std::max(minimum, std::min(batch_size_, lines) / 2);
+  } else if (elapsed < target / 2 && lines >= batch_size_) {
+    batch_size_ = std::min(max_log_lines_, batch_size_ * 2);
+  }
+}
+
 void BufferedLogForwarder::check() {
-  // Get a list of all the buffered log items, with a max of 1024 lines.
-  std::vector<std::string> indexes;
-  auto status = scanDatabaseKeys(kLogs, indexes, index_name_, max_log_lines_);
-
-  // For each index, accumulate the log line into the result or status set.
-  std::vector<std::string> results, statuses;
-  iterate(indexes, ([&results, &statuses, this](std::string& index) {
-            std::string value;
-            auto& target = isResultIndex(index) ? results : statuses;
-            if (getDatabaseValue(kLogs, index, value)) {
-              target.emplace_back(std::move(value));
-            }
-          }));
+  // Use the batch read while the previous batch was sent, if there is one.
+  LogBatch batch;
+  if (next_batch_.valid()) {
+    batch = next_batch_.get();
+  } else {
+    batch = readBatch("", "", batch_size_);
+  }
+
+  // A full batch means more lines may be buffered, read the next batch while
+  // this one is sent.
+  backlog_ = batch.full;
+  if (backlog_) {
+    auto last = [](const DatabaseStringValueList& lines) {
+      return (lines.empty()) ? std::string() : lines.back().first;
+    };
+    next_batch_ = std::async(std::launch::async,
+                             &BufferedLogForwarder::readBatch,
+                             this,
+                             last(batch.results),
+                             last(batch.statuses),
+                             batch_size_);
+  }
 
   // If any results/statuses were found in the flushed buffer, send.
-  if (results.size() > 0) {
-    status = send(results, "result");
-    if (!status.ok()) {
-      VLOG(1) << "Error sending results to logger: " << status.getMessage();
-    } else {
-      // Clear the results logs once they were sent.
-      iterate(indexes, ([this](std::string& index) {
-                if (!isResultIndex(index)) {
-                  return;
-                }
-                deleteValueWithCount(kLogs, index);
-              }));
-    }
+  auto started = std::chrono::steady_clock::now();
+  bool results_sent =
+      !batch.results.empty() && sendLines(batch.results, "result").ok();
+  bool statuses_sent =
+      !batch.statuses.empty() && sendLines(batch.statuses, "status").ok();
+  adaptBatchSize(batch.size(),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - started));
+
+  // The read ahead overlaps the send, wait for it before writing.
+  if (next_batch_.valid()) {
+    next_batch_.wait();
   }
 
-  if (statuses.size() > 0) {
-    status = send(statuses, "status");
-    if (!status.ok()) {
-      VLOG(1) << "Error sending status to logger: " << status.getMessage();
-    } else {
-      // Clear the status logs once they were sent.
-      iterate(indexes, ([this](std::string& index) {
-                if (!isStatusIndex(index)) {
-                  return;
-                }
-                deleteValueWithCount(kLogs, index);
-              }));
-    }
+  // Only the keys that were read are removed. Writers create an index before
+  // storing its line, so a line within the batch's range may be stored after
+  // the batch was read.
+  if (results_sent) {
+    deleteLinesWithCount(kLogs, batch.results);
+  }
+
+  if (statuses_sent) {
+    deleteLinesWithCount(kLogs, batch.statuses);
+  }
+
+  bool failed = (!batch.results.empty() && !results_sent) ||
+                (!batch.statuses.empty() && !statuses_sent);
+  if (failed) {
+    // The unsent lines are read again, discard the batch read after them.
+    next_batch_ = std::future<LogBatch>();
+    backlog_ = false;
   }
 
   // Purge any logs exceeding the max after our send attempt
@@ -157,6 +267,9 @@ void BufferedLogForwarder::purge() {
                    });
   indexes.erase(indexes.begin() + purge_count, indexes.end());
 
+  // The batch read ahead may include purged lines, read it again.
+  next_batch_ = std::future<LogBatch>();
+
   // Now only indexes of logs to be deleted remain
   iterate(indexes, [this](const std::string& index) {
     if (!deleteValueWithCount(kLogs, index).ok()) {
@@ -169,8 +282,11 @@ void BufferedLogForwarder::start() {
   while (!interrupted()) {
     check();
 
-    // Cool off and time wait the configured period.
-    pause(std::chrono::milliseconds(log_period_));
+    // Keep sending while full batches are buffered, otherwise cool off and
+    // time wait the configured period.
+    if (!backlog_) {
+      pause(std::chrono::milliseconds(log_period_));
+    }
   }
 }
 
@@ -258,10 +374,19 @@ std::string BufferedLogForwarder::genIndexPrefix(bool results) {
 
 std::string BufferedLogForwarder::genIndex(bool results, size_t time) {
   if (time == 0) {
+    // Do not let a clock change order new indexes before buffered ones.
     time = getUnixTime();
+    auto last = log_time_.load();
+    while (time > last && !log_time_.compare_exchange_weak(last, time)) {
+    }
+    time = std::max(time, last);
   }
-  return genIndexPrefix(results) + std::to_string(time) + '_' +
-         std::to_string(++log_index_);
+
+  // The counter is zero-padded so indexes sort in the order they were made.
+  std::stringstream index;
+  index << genIndexPrefix(results) << time << '_' << std::setfill('0')
+        << std::setw(kIndexWidth) << ++log_index_;
+  return index.str();
 }
 
 Status BufferedLogForwarder::addValueWithCount(const std::string& domain,
@@ -275,6 +400,22 @@ Status BufferedLogForwarder::addValueWithCount(const std::string& domain,
   return status;
 }
 
+Status BufferedLogForwarder::deleteLinesWithCount(
+    const std::string& domain, const DatabaseStringValueList& lines) {
+  std::vector<std::string> keys;
+  keys.reserve(lines.size());
+  for (const auto& line : lines) {
+    keys.push_back(line.first);
+  }
+
+  Status status = deleteDatabaseBatch(domain, keys);
+  if (status.ok()) {
+    RecursiveLock lock(count_mutex_);
+    buffer_count_ -= std::min(buffer_count_, keys.size());
+  }
+  return status;
+}
+
 Status BufferedLogForwarder::deleteValueWithCount(const std::string& domain,
                                                   const std::string& key) {
   Status status = deleteDatabaseValue(domain, key);
@@ -10,13 +10,16 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <future>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include <osquery/database.h>
 #include <osquery/dispatcher.h>
 #include <osquery/logger.h>
 
@@ -61,7 +64,8 @@ class BufferedLogForwarder : public InternalRunnable {
       : InternalRunnable(service_name),
         log_period_(kLogPeriod),
         max_log_lines_(kMaxLogLines),
-        index_name_(name) {}
+        index_name_(name),
+        batch_size_(max_log_lines_) {}
 
   template <class Rep, class Period>
   explicit BufferedLogForwarder(
@@ -72,7 +76,8 @@ class BufferedLogForwarder : public InternalRunnable {
         log_period_(
             std::chrono::duration_cast<std::chrono::seconds>(log_period)),
         max_log_lines_(kMaxLogLines),
-        index_name_(name) {}
+        index_name_(name),
+        batch_size_(max_log_lines_) {}
 
   template <class Rep, class Period>
   explicit BufferedLogForwarder(
@@ -84,7 +89,8 @@ class BufferedLogForwarder : public InternalRunnable {
         log_period_(
             std::chrono::duration_cast<std::chrono::seconds>(log_period)),
         max_log_lines_(max_log_lines),
-        index_name_(name) {}
+        index_name_(name),
+        batch_size_(max_log_lines_) {}
 
  public:
   /// A simple wait lock, and flush based on settings.
@@ -134,9 +140,14 @@ class BufferedLogForwarder : public InternalRunnable {
   /**
    * @brief Check for new logs and send.
    *
-   * Scan the logs domain for up to max_log_lines_ log lines.
-   * Sort those lines into status and request types then forward (send) each
-   * set. On success, clear the data and indexes. Calls purge upon completion.
+   * Read a batch of up to max_log_lines_ result and status lines, in index
+   * order, then forward (send) each set. On success, delete the contiguous
+   * range of indexes that was sent. Calls purge upon completion.
+   *
+   * If the batch was full, the next batch is read while this one is sent and
+   * used by the following check. The batch size shrinks when sends are slower
+   * than buffered_log_send_latency and grows back to max_log_lines_ when they
+   * are fast.
    */
   void check();
 
@@ -145,7 +156,7 @@ class BufferedLogForwarder : public InternalRunnable {
    *
    * Uses the buffered_log_max flag to determine the maximum number of buffered
    * logs. If this number is exceeded, the logs with the oldest timestamp are
-   * purged. Order of purging for logs with the same timestamp is undefined.
+   * purged. Logs with the same timestamp are purged in the order buffered.
    */
   void purge();
 
@@ -172,6 +183,36 @@ class BufferedLogForwarder : public InternalRunnable {
 
   std::string genIndex(bool results, size_t time = 0);
 
+  /// Result and status lines read from the backing store in index order.
+  struct LogBatch {
+    DatabaseStringValueList results;
+    DatabaseStringValueList statuses;
+
+    /// Set if the read stopped at the limit, more lines may be buffered.
+    bool full{false};
+
+    size_t size() const {
+      return results.size() + statuses.size();
+    }
+  };
+
+  /**
+   * @brief Read up to limit lines, results first, after the given indexes.
+   *
+   * @param results_after Read result lines with indexes after this index.
+   * @param statuses_after Read status lines with indexes after this index.
+   * @param limit The maximum number of lines to read.
+   */
+  LogBatch readBatch(const std::string& results_after,
+                     const std::string& statuses_after,
+                     size_t limit);
+
+  /// Move the line values into a send.
+  Status sendLines(DatabaseStringValueList& lines, const std::string& log_type);
+
+  /// Resize the batch after sending lines, given how long the send took.
+  void adaptBatchSize(size_t lines, std::chrono::milliseconds elapsed);
+
   /**
    * @brief Add a database value while maintaining count
    *
@@ -187,6 +228,13 @@ class BufferedLogForwarder : public InternalRunnable {
   Status deleteValueWithCount(const std::string& domain,
                               const std::string& key);
 
+  /**
+   * @brief Delete the database values of sent lines while maintaining count
+   *
+   */
+  Status deleteLinesWithCount(const std::string& domain,
+                              const DatabaseStringValueList& lines);
+
  protected:
   /// Seconds between flushing logs
   std::chrono::seconds log_period_;
@@ -207,10 +255,28 @@ class BufferedLogForwarder : public InternalRunnable {
   /// Hold an incrementing index for buffering logs
   std::atomic<size_t> log_index_{0};
 
+  /// The newest time used in an index, indexes never move backward in time
+  std::atomic<size_t> log_time_{0};
+
+  /// The number of lines to read and send per check
+  size_t batch_size_;
+
+  /// The next batch, read while the previous batch was sent
+  std::future<LogBatch> next_batch_;
+
+  /// Set when the last check sent a full batch and more lines may be waiting
+  bool backlog_{false};
+
   /// Stores the count of buffered logs
   size_t buffer_count_{0};
 
   /// Protects the count of buffered logs
   RecursiveMutex count_mutex_;
+
+ private:
+  FRIEND_TEST(BufferedLogForwarderTests, test_index_order);
+  FRIEND_TEST(BufferedLogForwarderTests, test_batch_delete);
+  FRIEND_TEST(BufferedLogForwarderTests, test_read_ahead);
+  FRIEND_TEST(BufferedLogForwarderTests, test_batch_size);
 };
 }
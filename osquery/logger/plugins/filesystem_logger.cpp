@@ -9,13 +9,23 @@
  */
 
 #include <exception>
+#include <map>
+#include <memory>
 
+#if !defined(WIN32)
+#include <unistd.h>
+#endif
+
+#include <boost/filesystem/operations.hpp>
+
+#include <osquery/dispatcher.h>
 #include <osquery/filesystem.h>
 #include <osquery/flags.h>
 #include <osquery/logger.h>
 #include <osquery/registry_factory.h>
 
 #include "osquery/core/flagalias.h"
+#include "osquery/logger/plugins/filesystem_logger.h"
 
 namespace fs = boost::filesystem;
 
@@ -36,13 +46,183 @@ FLAG_ALIAS(std::string, osquery_log_dir, logger_path);
 
 FLAG(int32, logger_mode, 0640, "Decimal mode for log files (default '0640')");
 
+FLAG(uint64,
+     logger_buffer_size,
+     0,
+     "Bytes of results to buffer before writing log files (default 0 writes "
+     "each line)");
+
+FLAG(uint64,
+     logger_flush_interval,
+     1,
+     "Seconds buffered results may wait before they are written (default 1)");
+
+FLAG(bool,
+     logger_fsync,
+     false,
+     "Sync log files to disk each time buffered results are written");
+
+FLAG(bool,
+     logger_rotate,
+     false,
+     "Rotate the results and snapshots log files");
+
+FLAG(uint64,
+     logger_rotate_size,
+     25 * 1024 * 1024,
+     "Size in bytes of a results log file before it is rotated");
+
+FLAG(uint64,
+     logger_rotate_max_files,
+     25,
+     "Number of rotated results log files to keep");
+
 const std::string kFilesystemLoggerFilename = "osqueryd.results.log";
 const std::string kFilesystemLoggerSnapshots = "osqueryd.snapshots.log";
 
-class FilesystemLoggerPlugin : public LoggerPlugin {
+FilesystemLogWriter::FilesystemLogWriter(fs::path path, int permissions)
+    : path_(std::move(path)),
+      permissions_(permissions),
+      last_flush_(std::chrono::steady_clock::now()) {}
+
+FilesystemLogWriter::~FilesystemLogWriter() {
+  flush();
+}
+
+Status FilesystemLogWriter::open() {
+  if (file_ != nullptr) {
+    return Status(0, "OK");
+  }
+
+  file_ = std::make_unique<PlatformFile>(
+      path_, PF_OPEN_ALWAYS | PF_WRITE | PF_APPEND, permissions_);
+  if (!file_->isValid()) {
+    file_.reset();
+    return Status(1, "Could not create file: " + path_.string());
+  }
+
+  // If the file existed with different permissions before our open
+  // they must be restricted.
+  if (!platformChmod(path_.string(), permissions_)) {
+    file_.reset();
+    return Status(1,
+                  "Failed to change permissions for file: " + path_.string());
+  }
+
+  size_ = file_->size();
+  return Status(0, "OK");
+}
+
+Status FilesystemLogWriter::write(const std::string& line) {
+  buffer_.append(line);
+  buffer_.push_back('\n');
+
+  auto interval = std::chrono::seconds(FLAGS_logger_flush_interval);
+  if (buffer_.size() >= FLAGS_logger_buffer_size ||
+      std::chrono::steady_clock::now() - last_flush_ >= interval) {
+    return flush();
+  }
+  return Status(0, "OK");
+}
+
+Status FilesystemLogWriter::flush() {
+  last_flush_ = std::chrono::steady_clock::now();
+  if (buffer_.empty()) {
+    return Status(0, "OK");
+  }
+
+  auto status = reopenIfMissing();
+  if (!status.ok()) {
+    return status;
+  }
+
+  auto bytes = file_->write(buffer_.data(), buffer_.size());
+  if (bytes < 0 || static_cast<size_t>(bytes) != buffer_.size()) {
+    // Drop the partial write, the next write reopens the file.
+    if (bytes > 0) {
+      buffer_.erase(0, static_cast<size_t>(bytes));
+    }
+    file_.reset();
+    return Status(1, "Failed to write contents to file: " + path_.string());
+  }
+  size_ += buffer_.size();
+  buffer_.clear();
+
+  if (FLAGS_logger_fsync) {
+#if defined(WIN32)
+    ::FlushFileBuffers(file_->nativeHandle());
+#else
+    ::fsync(file_->nativeHandle());
+#endif
+  }
+
+  if (FLAGS_logger_rotate && size_ >= FLAGS_logger_rotate_size) {
+    return rotate();
+  }
+  return Status(0, "OK");
+}
+
+Status FilesystemLogWriter::reopenIfMissing() {
+  if (file_ != nullptr) {
+    // An external rotation may have moved the file away from the handle.
+    boost::system::error_code ec;
+    if (fs::exists(path_, ec)) {
+      return Status(0, "OK");
+    }
+    file_.reset();
+  }
+  return open();
+}
+
+Status FilesystemLogWriter::rotate() {
+  file_.reset();
+
+  // Shift each rotated file, the oldest is replaced.
+  auto rotated = [this](size_t n) {
+    return fs::path(path_.string() + "." + std::to_string(n));
+  };
+  if (FLAGS_logger_rotate_max_files > 0) {
+    for (auto n = FLAGS_logger_rotate_max_files - 1; n > 0; n--) {
+      boost::system::error_code ec;
+      if (!fs::exists(rotated(n), ec)) {
+        continue;
+      }
+
+      // A failed shift loses at most one older file, keep rotating.
+      fs::rename(rotated(n), rotated(n + 1), ec);
+      if (ec) {
+        LOG(WARNING) << "Failed to rotate " << rotated(n).string() << ": "
+                     << ec.message();
+      }
+    }
+  }
+
+  boost::system::error_code ec;
+  if (FLAGS_logger_rotate_max_files > 0) {
+    fs::rename(path_, rotated(1), ec);
+  } else {
+    fs::remove(path_, ec);
+  }
+
+  // The log file is reopened even if it was not moved, so lines still go to
+  // the log and rotation is attempted again after the next flush.
+  auto status = open();
+  if (ec) {
+    return Status(1,
+                  "Failed to rotate " + path_.string() + ": " + ec.message());
+  }
+  return status;
+}
+
+class FilesystemLoggerPlugin
+    : public LoggerPlugin,
+      public std::enable_shared_from_this<FilesystemLoggerPlugin> {
  public:
   Status setUp() override;
 
+  /// Write the buffered results and snapshots to their log files.
+  void flush();
+
   /// Log results (differential) to a distinct path.
   Status logString(const std::string& s) override;
 
@@ -68,11 +248,27 @@ class FilesystemLoggerPlugin : public LoggerPlugin {
                          const std::string& filename,
                          bool empty = false);
 
+ private:
+  /// A log file's writer and the lock serializing its writes.
+  struct LogFile {
+    Mutex mutex;
+    std::unique_ptr<FilesystemLogWriter> writer;
+  };
+
+  /// Find or create the log file for a results or snapshots filename.
+  LogFile& getLogFile(const std::string& filename);
+
  private:
   /// The folder where Glog and the result/snapshot files are written.
   fs::path log_path_;
 
-  /// Filesystem writer mutex.
+  /// Long-lived writers for each results and snapshots log file, by filename.
+  std::map<std::string, std::unique_ptr<LogFile>> files_;
+
+  /// Set when the buffered writers flushing service is started.
+  bool flusher_started_{false};
+
+  /// Protects the set of log files, each file has its own write lock.
   Mutex mutex_;
 
  private:
@@ -81,6 +277,30 @@ class FilesystemLoggerPlugin : public LoggerPlugin {
 
 REGISTER(FilesystemLoggerPlugin, "logger", "filesystem");
 
+/// Periodically write the filesystem logger's buffered lines.
+class FilesystemLogFlusher : public InternalRunnable {
+ public:
+  explicit FilesystemLogFlusher(std::weak_ptr<FilesystemLoggerPlugin> logger)
+      : InternalRunnable("FilesystemLogFlusher"), logger_(std::move(logger)) {}
+
+ protected:
+  void start() override {
+    while (!interrupted()) {
+      pause(std::chrono::seconds(FLAGS_logger_flush_interval));
+
+      // The service stops once the plugin is removed from the registry.
+      auto logger = logger_.lock();
+      if (logger == nullptr) {
+        break;
+      }
+      logger->flush();
+    }
+  }
+
+ private:
+  std::weak_ptr<FilesystemLoggerPlugin> logger_;
+};
+
 Status FilesystemLoggerPlugin::setUp() {
   log_path_ = fs::path(FLAGS_logger_path);
 
@@ -88,10 +308,52 @@ Status FilesystemLoggerPlugin::setUp() {
   // Glog 0.3.4 does not support a logfile mode.
   // FLAGS_logfile_mode = FLAGS_logger_mode;
 
+  {
+    WriteLock lock(mutex_);
+    if (!flusher_started_ && FLAGS_logger_buffer_size > 0 &&
+        FLAGS_logger_flush_interval > 0) {
+      flusher_started_ = true;
+      Dispatcher::addService(
+          std::make_shared<FilesystemLogFlusher>(shared_from_this()));
+    }
+  }
+
   // Ensure that we create the results log here.
   return logStringToFile("", kFilesystemLoggerFilename, true);
 }
 
+void FilesystemLoggerPlugin::flush() {
+  ReadLock lock(mutex_);
+  for (auto& file : files_) {
+    WriteLock file_lock(file.second->mutex);
+    try {
+      file.second->writer->flush();
+    } catch (const std::exception& /* e */) {
+      continue;
+    }
+  }
+}
+
+FilesystemLoggerPlugin::LogFile& FilesystemLoggerPlugin::getLogFile(
+    const std::string& filename) {
+  {
+    ReadLock lock(mutex_);
+    auto it = files_.find(filename);
+    if (it != files_.end()) {
+      return *it->second;
+    }
+  }
+
+  WriteLock lock(mutex_);
+  auto& file = files_[filename];
+  if (file == nullptr) {
+    file = std::make_unique<LogFile>();
+    file->writer = std::make_unique<FilesystemLogWriter>(log_path_ / filename,
+                                                         FLAGS_logger_mode);
+  }
+  return *file;
+}
+
 Status FilesystemLoggerPlugin::logString(const std::string& s) {
   return logStringToFile(s, kFilesystemLoggerFilename);
 }
@@ -99,16 +361,14 @@ Status FilesystemLoggerPlugin::logString(const std::string& s) {
 Status FilesystemLoggerPlugin::logStringToFile(const std::string& s,
                                                const std::string& filename,
                                                bool empty) {
-  WriteLock lock(mutex_);
-  Status status;
+  // Results and snapshots are written without waiting on each other.
+  auto& file = getLogFile(filename);
+  WriteLock lock(file.mutex);
   try {
-    status = writeTextFile((log_path_ / filename).string(),
-                           (empty) ? "" : s + '\n',
-                           FLAGS_logger_mode);
+    return (empty) ? file.writer->open() : file.writer->write(s);
   } catch (const std::exception& e) {
     return Status(1, e.what());
   }
-  return status;
 }
 
 Status FilesystemLoggerPlugin::logStatus(
@@ -0,0 +1,92 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <osquery/core.h>
+
+#include "osquery/filesystem/fileops.h"
+
+namespace osquery {
+
+/**
+ * @brief A long-lived, buffered, append-only writer for a log file.
+ *
+ * The filesystem logger writes each result line through one of these writers
+ * instead of opening, writing, and closing the file per line. Lines are kept
+ * in a userspace buffer and written when the buffer reaches the
+ * logger_buffer_size, when logger_flush_interval elapses, or when flush is
+ * called. The default logger_buffer_size is 0, which writes each line as it
+ * is logged. When logger_rotate is set the file is rotated to '.1' through
+ * '.logger_rotate_max_files' once it reaches logger_rotate_size.
+ *
+ * The writer is not thread safe, the owner serializes access.
+ */
+class FilesystemLogWriter : private boost::noncopyable {
+ public:
+  /**
+   * @brief Create a writer, the file is opened on the first write or flush.
+   *
+   * @param path The log file path.
+   * @param permissions The mode applied to the log file when it is opened.
+   */
+  FilesystemLogWriter(boost::filesystem::path path, int permissions);
+
+  /// Flush any buffered lines.
+  ~FilesystemLogWriter();
+
+  /// Buffer a line, a newline is appended, and flush if needed.
+  Status write(const std::string& line);
+
+  /// Write the buffered lines, apply the fsync policy, and rotate if needed.
+  Status flush();
+
+  /// Open or create the log file without writing content.
+  Status open();
+
+  /// The number of bytes waiting to be written.
+  size_t buffered() const {
+    return buffer_.size();
+  }
+
+ private:
+  /// Close the file and shift existing rotations, then reopen.
+  Status rotate();
+
+  /// Reopen the file if it was moved or removed outside of osquery.
+  Status reopenIfMissing();
+
+ private:
+  /// The log file path.
+  boost::filesystem::path path_;
+
+  /// The file mode applied when the file is opened.
+  int permissions_{0};
+
+  /// The append-mode handle, nullptr until opened.
+  std::unique_ptr<PlatformFile> file_;
+
+  /// The size of the file, used to decide when to rotate.
+  size_t size_{0};
+
+  /// Lines waiting to be written.
+  std::string buffer_;
+
+  /// When the buffer was last written.
+  std::chrono::steady_clock::time_point last_flush_;
+};
+} // namespace osquery
@@ -8,6 +8,7 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
@@ -17,6 +18,7 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <osquery/database.h>
 #include <osquery/dispatcher.h>
 #include <osquery/logger.h>
 #include <osquery/system.h>
@@ -31,6 +33,7 @@ namespace pt = boost::property_tree;
 namespace osquery {
 
 DECLARE_uint64(buffered_log_max);
+DECLARE_uint64(buffered_log_send_latency);
 
 // Check that the string matches the StatusLogLine
 MATCHER_P(MatchesStatus, expected, "") {
@@ -103,10 +106,10 @@ class MockBufferedLogForwarder : public BufferedLogForwarder {
 TEST_F(BufferedLogForwarderTests, test_index) {
   MockBufferedLogForwarder runner;
   if (!isPlatform(PlatformType::TYPE_WINDOWS)) {
-    EXPECT_THAT(runner.genResultIndex(), ContainsRegex("mock_r_[0-9]+_1"));
-    EXPECT_THAT(runner.genStatusIndex(), ContainsRegex("mock_s_[0-9]+_2"));
-    EXPECT_THAT(runner.genResultIndex(), ContainsRegex("mock_r_[0-9]+_3"));
-    EXPECT_THAT(runner.genStatusIndex(), ContainsRegex("mock_s_[0-9]+_4"));
+    EXPECT_THAT(runner.genResultIndex(), ContainsRegex("mock_r_[0-9]+_0+1$"));
+    EXPECT_THAT(runner.genStatusIndex(), ContainsRegex("mock_s_[0-9]+_0+2$"));
+    EXPECT_THAT(runner.genResultIndex(), ContainsRegex("mock_r_[0-9]+_0+3$"));
+    EXPECT_THAT(runner.genStatusIndex(), ContainsRegex("mock_s_[0-9]+_0+4$"));
   }
 
   EXPECT_TRUE(runner.isResultIndex(runner.genResultIndex()));
@@ -360,4 +363,113 @@ TEST_F(BufferedLogForwarderTests, test_purge_max) {
 
   runner.check();
 }
+
+TEST_F(BufferedLogForwarderTests, test_index_order) {
+  MockBufferedLogForwarder runner("mock_order");
+  std::vector<std::string> indexes;
+  for (size_t i = 0; i < 12; ++i) {
+    indexes.push_back(runner.genResultIndex(100));
+  }
+
+  // Indexes made in the same second still sort in the order they were made.
+  EXPECT_TRUE(std::is_sorted(indexes.begin(), indexes.end()));
+
+  // A forwarder set up over buffered logs continues after them, even when
+  // they were buffered with a later time.
+  runner.logString("foo", getUnixTime() + 100);
+  std::vector<std::string> buffered;
+  scanDatabaseKeys(kLogs, buffered, "mock_order_");
+  ASSERT_EQ(buffered.size(), 1U);
+
+  MockBufferedLogForwarder restarted("mock_order");
+  ASSERT_TRUE(restarted.setUp().ok());
+  EXPECT_GT(restarted.genResultIndex(), buffered[0]);
+  deleteDatabaseValue(kLogs, buffered[0]);
+}
+
+TEST_F(BufferedLogForwarderTests, test_batch_delete) {
+  StrictMock<MockBufferedLogForwarder> runner("mock_delete");
+  runner.logString("foo");
+  auto late = runner.genResultIndex();
+  runner.logString("bar");
+  runner.logStatus({makeStatusLogLine(O_INFO, "foo", 1, "foo status")});
+
+  // A line indexed between the lines read is stored while they are sent.
+  EXPECT_CALL(runner, send(ElementsAre("foo", "bar"), "result"))
+      .WillOnce(Invoke([&runner, &late](std::vector<std::string>&,
+                                        const std::string&) {
+        runner.addValueWithCount(kLogs, late, "baz");
+        return Status(0);
+      }));
+  EXPECT_CALL(runner, send(ElementsAre(_), "status"))
+      .WillOnce(Return(Status(0)));
+  runner.check();
+
+  // Only the sent lines were cleared, and the count follows them.
+  std::vector<std::string> indexes;
+  scanDatabaseKeys(kLogs, indexes, "mock_delete_");
+  EXPECT_EQ(indexes, std::vector<std::string>{late});
+  EXPECT_EQ(runner.buffer_count_, 1U);
+
+  EXPECT_CALL(runner, send(ElementsAre("baz"), "result"))
+      .WillOnce(Return(Status(0)));
+  runner.check();
+  EXPECT_EQ(runner.buffer_count_, 0U);
+}
+
+TEST_F(BufferedLogForwarderTests, test_read_ahead) {
+  StrictMock<MockBufferedLogForwarder> runner("mock_ahead", kLogPeriod, 2);
+  runner.logString("1");
+  runner.logString("2");
+  runner.logString("3");
+  runner.logString("4");
+  runner.logString("5");
+
+  EXPECT_CALL(runner, send(ElementsAre("1", "2"), "result"))
+      .WillOnce(Return(Status(0)));
+  runner.check();
+  EXPECT_TRUE(runner.backlog_);
+  EXPECT_TRUE(runner.next_batch_.valid());
+
+  // The next batch was read while the first was sent.
+  EXPECT_CALL(runner, send(ElementsAre("3", "4"), "result"))
+      .WillOnce(Return(Status(0)));
+  runner.check();
+
+  // Lines added after a read ahead are sent after the lines read.
+  runner.logString("6");
+  EXPECT_CALL(runner, send(ElementsAre("5"), "result"))
+      .WillOnce(Return(Status(0)));
+  runner.check();
+  EXPECT_FALSE(runner.backlog_);
+
+  EXPECT_CALL(runner, send(ElementsAre("6"), "result"))
+      .WillOnce(Return(Status(0)));
+  runner.check();
+  runner.check();
+}
+
+TEST_F(BufferedLogForwarderTests, test_batch_size) {
+  auto latency = FLAGS_buffered_log_send_latency;
+  FLAGS_buffered_log_send_latency = 100;
+
+  StrictMock<MockBufferedLogForwarder> runner("mock_batch", kLogPeriod, 64);
+  EXPECT_EQ(runner.batch_size_, 64U);
+
+  // Slow sends halve the batch, down to a 16th of the max lines.
+  runner.adaptBatchSize(64, std::chrono::milliseconds(200));
+  EXPECT_EQ(runner.batch_size_, 32U);
+  runner.adaptBatchSize(32, std::chrono::milliseconds(200));
+  runner.adaptBatchSize(16, std::chrono::milliseconds(200));
+  runner.adaptBatchSize(8, std::chrono::milliseconds(200));
+  EXPECT_EQ(runner.batch_size_, 4U);
+
+  // Fast sends of full batches grow it back.
+  runner.adaptBatchSize(4, std::chrono::milliseconds(10));
+  EXPECT_EQ(runner.batch_size_, 8U);
+  runner.adaptBatchSize(2, std::chrono::milliseconds(10));
+  EXPECT_EQ(runner.batch_size_, 8U);
+
+  FLAGS_buffered_log_send_latency = latency;
+}
 }
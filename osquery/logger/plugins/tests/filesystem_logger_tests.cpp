@@ -16,6 +16,7 @@
 #include <osquery/registry_factory.h>
 
 #include "osquery/core/conversions.h"
+#include "osquery/logger/plugins/filesystem_logger.h"
 #include "osquery/tests/test_util.h"
 
 namespace fs = boost::filesystem;
@@ -24,6 +25,11 @@ namespace osquery {
 
 DECLARE_string(logger_path);
 DECLARE_bool(disable_logging);
+DECLARE_uint64(logger_buffer_size);
+DECLARE_uint64(logger_flush_interval);
+DECLARE_bool(logger_rotate);
+DECLARE_uint64(logger_rotate_size);
+DECLARE_uint64(logger_rotate_max_files);
 
 class FilesystemLoggerTests : public testing::Test {
  public:
@@ -38,10 +44,15 @@ class FilesystemLoggerTests : public testing::Test {
     // Backup the logging status, then disable.
     logging_status_ = FLAGS_disable_logging;
     FLAGS_disable_logging = false;
+
+    // Write each line as it is logged, unless a test enables buffering.
+    buffer_size_ = FLAGS_logger_buffer_size;
+    FLAGS_logger_buffer_size = 0;
   }
 
   void TearDown() override {
     FLAGS_disable_logging = logging_status_;
+    FLAGS_logger_buffer_size = buffer_size_;
   }
 
   std::string getContent() {
@@ -52,6 +63,9 @@ class FilesystemLoggerTests : public testing::Test {
   /// Save the status of logging before running tests, restore afterward.
   bool logging_status_{true};
 
+  /// Save the results buffer size before running tests, restore afterward.
+  uint64_t buffer_size_{0};
+
   /// Results log path.
   std::string results_path_;
 };
@@ -78,6 +92,111 @@ TEST_F(FilesystemLoggerTests, test_log_string) {
   EXPECT_EQ(content, "{\"json\": true}\n");
 }
 
+TEST_F(FilesystemLoggerTests, test_buffered_writer) {
+  auto path = fs::path(FLAGS_logger_path) / "buffered.log";
+  fs::remove(path);
+
+  FLAGS_logger_buffer_size = 64;
+  auto interval = FLAGS_logger_flush_interval;
+  FLAGS_logger_flush_interval = 3600;
+
+  {
+    FilesystemLogWriter writer(path, 0640);
+    ASSERT_TRUE(writer.open());
+    EXPECT_TRUE(writer.write("{\"line\": 1}"));
+    EXPECT_EQ(12U, writer.buffered());
+
+    // Lines stay buffered until the buffer size is reached.
+    std::string content;
+    EXPECT_TRUE(readFile(path, content));
+    EXPECT_EQ("", content);
+
+    std::string line(60, 'A');
+    EXPECT_TRUE(writer.write(line));
+    EXPECT_EQ(0U, writer.buffered());
+    EXPECT_TRUE(readFile(path, content));
+    EXPECT_EQ("{\"line\": 1}\n" + line + "\n", content);
+
+    // An explicit flush writes a partial buffer.
+    EXPECT_TRUE(writer.write("{\"line\": 3}"));
+    EXPECT_TRUE(writer.flush());
+    EXPECT_TRUE(readFile(path, content));
+    EXPECT_EQ(85U, content.size());
+
+    // Destroying the writer flushes the buffer.
+    EXPECT_TRUE(writer.write("{\"line\": 4}"));
+  }
+
+  std::string content;
+  EXPECT_TRUE(readFile(path, content));
+  EXPECT_EQ(97U, content.size());
+
+  FLAGS_logger_flush_interval = interval;
+  fs::remove(path);
+}
+
+TEST_F(FilesystemLoggerTests, test_writer_reopen) {
+  if (isPlatform(PlatformType::TYPE_WINDOWS)) {
+    // Open files cannot be moved on windows.
+    return;
+  }
+
+  auto path = fs::path(FLAGS_logger_path) / "reopened.log";
+  auto moved = fs::path(path.string() + ".moved");
+  fs::remove(path);
+
+  FilesystemLogWriter writer(path, 0640);
+  EXPECT_TRUE(writer.write("{\"line\": 1}"));
+
+  // The writer reopens the file if it is moved away, as logrotate would.
+  fs::rename(path, moved);
+  EXPECT_TRUE(writer.write("{\"line\": 2}"));
+
+  std::string content;
+  EXPECT_TRUE(readFile(path, content));
+  EXPECT_EQ("{\"line\": 2}\n", content);
+  EXPECT_TRUE(readFile(moved, content));
+  EXPECT_EQ("{\"line\": 1}\n", content);
+
+  fs::remove(path);
+  fs::remove(moved);
+}
+
+TEST_F(FilesystemLoggerTests, test_rotate) {
+  auto path = fs::path(FLAGS_logger_path) / "rotated.log";
+  auto rotated = [&path](size_t n) {
+    return fs::path(path.string() + "." + std::to_string(n));
+  };
+  for (size_t n = 0; n <= 3; n++) {
+    fs::remove((n == 0) ? path : rotated(n));
+  }
+
+  FLAGS_logger_rotate = true;
+  auto rotate_size = FLAGS_logger_rotate_size;
+  auto max_files = FLAGS_logger_rotate_max_files;
+  FLAGS_logger_rotate_size = 10;
+  FLAGS_logger_rotate_max_files = 2;
+
+  FilesystemLogWriter writer(path, 0640);
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_TRUE(writer.write("line " + std::to_string(i) + " rotates"));
+  }
+
+  // Each line fills the file, the two most-recent are kept.
+  std::string content;
+  EXPECT_TRUE(readFile(rotated(1), content));
+  EXPECT_EQ("line 3 rotates\n", content);
+  EXPECT_TRUE(readFile(rotated(2), content));
+  EXPECT_EQ("line 2 rotates\n", content);
+  EXPECT_FALSE(fs::exists(rotated(3)));
+  EXPECT_TRUE(readFile(path, content));
+  EXPECT_EQ("", content);
+
+  FLAGS_logger_rotate = false;
+  FLAGS_logger_rotate_size = rotate_size;
+  FLAGS_logger_rotate_max_files = max_files;
+}
+
 class FilesystemTestLoggerPlugin : public LoggerPlugin {
  public:
   Status logString(const std::string& s) override {
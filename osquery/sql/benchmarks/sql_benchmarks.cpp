@@ -290,6 +290,49 @@ BENCHMARK(SQL_virtual_table_internal_wide_yield)
     ->ArgPair(0, 100)
     ->ArgPair(0, 1000);
 
+class BenchmarkWideTableTypedPlugin : public BenchmarkWideTablePlugin {
+ public:
+  bool usesTypedRows() const override {
+    return true;
+  }
+
+  void generateTypedRows(QueryContext& ctx, TableRows& results) override {
+    for (size_t k = 0; k < kWideCount; k++) {
+      results.addRow();
+      for (size_t i = 0; i < 20; i++) {
+        results.setInteger(i, 0);
+      }
+    }
+  }
+};
+
+static void SQL_virtual_table_internal_wide_typed(benchmark::State& state) {
+  auto tables = RegistryFactory::get().registry("table");
+  tables->add("wide_benchmark_typed",
+              std::make_shared<BenchmarkWideTableTypedPlugin>());
+
+  PluginResponse res;
+  Registry::call("table", "wide_benchmark_typed", {{"action", "columns"}}, res);
+
+  // Attach a sample virtual table.
+  auto dbc = SQLiteDBManager::getUnique();
+  attachTableInternal(
+      "wide_benchmark_typed", columnDefinition(res, false, false), dbc, false);
+
+  kWideCount = state.range(1);
+  while (state.KeepRunning()) {
+    QueryData results;
+    queryInternal("select * from wide_benchmark_typed", results, dbc);
+    dbc->clearAffectedTables();
+  }
+}
+
+BENCHMARK(SQL_virtual_table_internal_wide_typed)
+    ->ArgPair(0, 1)
+    ->ArgPair(0, 10)
+    ->ArgPair(0, 100)
+    ->ArgPair(0, 1000);
+
 static void SQL_select_metadata(benchmark::State& state) {
   auto dbc = SQLiteDBManager::getUnique();
   while (state.KeepRunning()) {
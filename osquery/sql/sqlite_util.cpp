@@ -170,8 +170,13 @@ Status SQLiteSQLPlugin::getQueryTables(const std::string& query,
   return Status(0);
 }
 
-SQLInternal::SQLInternal(const std::string& query, bool use_cache) {
-  auto dbc = SQLiteDBManager::get();
+SQLInternal::SQLInternal(const std::string& query, bool use_cache)
+    : SQLInternal(query, nullptr, use_cache) {}
+
+SQLInternal::SQLInternal(const std::string& query,
+                         const SQLiteDBInstanceRef& instance,
+                         bool use_cache) {
+  auto dbc = (instance != nullptr) ? instance : SQLiteDBManager::get();
   dbc->useCache(use_cache);
   status_ = queryInternal(query, results_, dbc);
 
@@ -203,7 +208,9 @@ Status SQLiteSQLPlugin::attach(const std::string& name) {
   auto dbc = SQLiteDBManager::getConnection(true);
 
   // Attach as an extension, allowing read/write tables
-  return attachTableInternal(name, statement, dbc, is_extension);
+  status = attachTableInternal(name, statement, dbc, is_extension);
+  SQLiteDBManager::instance().generation_++;
+  return status;
 }
 
 void SQLiteSQLPlugin::detach(const std::string& name) {
@@ -212,6 +219,7 @@ void SQLiteSQLPlugin::detach(const std::string& name) {
     return;
   }
   detachTableInternal(name, dbc);
+  SQLiteDBManager::instance().generation_++;
 }
 
 SQLiteDBInstance::SQLiteDBInstance(sqlite3*& db, Mutex& mtx)
@@ -302,6 +310,7 @@ void SQLiteDBInstance::clearAffectedTables() {
     table.second->constraints.clear();
     table.second->cache.clear();
     table.second->colsUsed.clear();
+    table.second->orderBy.clear();
   }
   // Since the affected tables are cleared, there are no more affected tables.
   // There is no concept of compounding tables between queries.
@@ -338,6 +347,7 @@ void SQLiteDBManager::resetPrimary() {
     sqlite3_close(self.db_);
     self.db_ = nullptr;
   }
+  self.generation_++;
 }
 
 void SQLiteDBManager::setDisabledTables(const std::string& list) {
@@ -496,6 +506,90 @@ Status queryInternal(const std::string& q,
   return Status(0, "OK");
 }
 
+namespace {
+
+/// State shared by a limited query's row callback and progress handler.
+struct LimitedQuery {
+  QueryData* results{nullptr};
+  QueryLimits limits;
+  std::chrono::steady_clock::time_point deadline;
+  size_t bytes{0};
+
+  /// Set to the limit reached when the query is stopped.
+  Status limit;
+};
+} // namespace
+
+static int limitedProgressCallback(void* argument) {
+  auto query = static_cast<LimitedQuery*>(argument);
+  if (std::chrono::steady_clock::now() > query->deadline) {
+    query->limit = Status(1, "Query exceeded the time limit");
+    return 1;
+  }
+  return 0;
+}
+
+static int limitedQueryCallback(void* argument,
+                                int argc,
+                                char* argv[],
+                                char* column[]) {
+  auto query = static_cast<LimitedQuery*>(argument);
+  auto rc = queryDataCallback(query->results, argc, argv, column);
+  if (rc != 0) {
+    return rc;
+  }
+
+  const auto& limits = query->limits;
+  for (const auto& field : query->results->back()) {
+    query->bytes += field.first.size() + field.second.size();
+  }
+
+  if (limits.max_rows > 0 && query->results->size() > limits.max_rows) {
+    query->limit = Status(1, "Query exceeded the row limit");
+  } else if (limits.max_bytes > 0 && query->bytes > limits.max_bytes) {
+    query->limit = Status(1, "Query exceeded the byte limit");
+  } else {
+    return 0;
+  }
+
+  // The row over the limit is not kept.
+  query->results->pop_back();
+  return 1;
+}
+
+Status queryInternal(const std::string& q,
+                     QueryData& results,
+                     const SQLiteDBInstanceRef& instance,
+                     const QueryLimits& limits,
+                     size_t& bytes) {
+  LimitedQuery query;
+  query.results = &results;
+  query.limits = limits;
+
+  auto lock = instance->attachLock();
+  if (limits.timeout.count() > 0) {
+    // Virtual table scans and long joins are checked between VM steps.
+    query.deadline = std::chrono::steady_clock::now() + limits.timeout;
+    sqlite3_progress_handler(
+        instance->db(), 1000, limitedProgressCallback, &query);
+  }
+
+  char* err = nullptr;
+  sqlite3_exec(instance->db(), q.c_str(), limitedQueryCallback, &query, &err);
+  sqlite3_progress_handler(instance->db(), 0, nullptr, nullptr);
+  sqlite3_db_release_memory(instance->db());
+  bytes = query.bytes;
+  if (err != nullptr) {
+    auto error_string = std::string(err);
+    sqlite3_free(err);
+    if (!query.limit.ok()) {
+      return query.limit;
+    }
+    return Status(1, "Error running query: " + error_string);
+  }
+  return Status(0, "OK");
+}
+
 Status getQueryColumnsInternal(const std::string& q,
                                TableColumns& columns,
                                const SQLiteDBInstanceRef& instance) {
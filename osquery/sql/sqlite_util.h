@@ -11,6 +11,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <map>
 #include <mutex>
 #include <unordered_set>
@@ -175,6 +176,18 @@ class SQLiteDBManager : private boost::noncopyable {
   /// See `get` but always return a transient DB connection (for testing).
   static SQLiteDBInstanceRef getUnique();
 
+  /**
+   * @brief The generation of the attached virtual table set.
+   *
+   * Long-lived transient connections, such as those held by scheduler
+   * workers, compare this against the generation they were created with.
+   * It advances when tables are attached or detached through the registry
+   * and when the primary connection is reset.
+   */
+  static size_t generation() {
+    return instance().generation_;
+  }
+
   /**
    * @brief Reset the primary database connection.
    *
@@ -218,6 +231,9 @@ class SQLiteDBManager : private boost::noncopyable {
   /// Member variable to hold set of disabled tables.
   std::unordered_set<std::string> disabled_tables_;
 
+  /// Advanced when the set of attached virtual tables changes.
+  std::atomic<size_t> generation_{0};
+
   /// Parse a comma-delimited set of tables names, passed in as a flag.
   void setDisabledTables(const std::string& s);
 
@@ -317,6 +333,38 @@ Status queryInternal(const std::string& q,
                      QueryData& results,
                      const SQLiteDBInstanceRef& instance);
 
+/// Bounds applied to the execution and results of a single query.
+struct QueryLimits {
+  /// Stop once this many rows are read, 0 is unlimited.
+  size_t max_rows{0};
+
+  /// Stop once the column names and values read use this many bytes.
+  size_t max_bytes{0};
+
+  /// Stop once the query runs this long, 0 is unlimited.
+  std::chrono::milliseconds timeout{0};
+};
+
+/**
+ * @brief SQLite Internal: Execute a query within limits
+ *
+ * The query is stopped, and a failure is returned, as soon as any limit is
+ * reached. Rows read before a limit was reached are left in results.
+ *
+ * @param q the query to execute
+ * @param results The QueryData struct to emit rows into.
+ * @param instance the SQLite3 database to execute query q against
+ * @param limits the row, byte, and time limits
+ * @param bytes output, the column names and values bytes read
+ *
+ * @return A status indicating SQL query results or the limit reached.
+ */
+Status queryInternal(const std::string& q,
+                     QueryData& results,
+                     const SQLiteDBInstanceRef& instance,
+                     const QueryLimits& limits,
+                     size_t& bytes);
+
 /**
  * @brief SQLite Intern: Analyze a query, providing information about the
  * result columns
@@ -349,6 +397,17 @@ class SQLInternal : public SQL {
    */
   explicit SQLInternal(const std::string& query, bool use_cache = false);
 
+  /**
+   * @brief Instantiate an instance of the class using a specific connection.
+   *
+   * @param query An osquery SQL query.
+   * @param instance The SQLite connection, or nullptr for a managed one.
+   * @param use_cache [optional] Set true to use the query cache.
+   */
+  SQLInternal(const std::string& query,
+              const SQLiteDBInstanceRef& instance,
+              bool use_cache = false);
+
  public:
   /**
    * @brief Check if the SQL query's results use event-based tables.
@@ -92,6 +92,47 @@ TEST_F(SQLiteUtilTests, test_direct_query_execution) {
   EXPECT_EQ(results, getTestDBExpectedResults());
 }
 
+TEST_F(SQLiteUtilTests, test_query_limits) {
+  auto dbc = getTestDBC();
+  QueryData results;
+  size_t bytes = 0;
+  auto status = queryInternal(kTestQuery, results, dbc, QueryLimits(), bytes);
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(results, getTestDBExpectedResults());
+  // Two rows of "username" and "age" columns.
+  EXPECT_EQ(bytes, 34U);
+
+  // A query reaching a limit stops with the rows read before it.
+  QueryLimits limits;
+  limits.max_rows = 1;
+  results.clear();
+  status = queryInternal(kTestQuery, results, dbc, limits, bytes);
+  EXPECT_FALSE(status.ok());
+  EXPECT_EQ(status.getMessage(), "Query exceeded the row limit");
+  EXPECT_EQ(results.size(), 1U);
+
+  limits.max_rows = 0;
+  limits.max_bytes = 20;
+  results.clear();
+  status = queryInternal(kTestQuery, results, dbc, limits, bytes);
+  EXPECT_EQ(status.getMessage(), "Query exceeded the byte limit");
+  EXPECT_EQ(results.size(), 1U);
+
+  // Long running queries are interrupted.
+  limits.max_bytes = 0;
+  limits.timeout = std::chrono::milliseconds(10);
+  results.clear();
+  status = queryInternal(
+      "with recursive c(x) as (select 1 union all select x + 1 from c "
+      "where x < 1000000000) select count(*) from c",
+      results,
+      dbc,
+      limits,
+      bytes);
+  EXPECT_EQ(status.getMessage(), "Query exceeded the time limit");
+  EXPECT_TRUE(results.empty());
+}
+
 TEST_F(SQLiteUtilTests, test_passing_callback_no_data_param) {
   char* err = nullptr;
   auto dbc = getTestDBC();
@@ -15,6 +15,7 @@
 #include <osquery/registry.h>
 #include <osquery/sql.h>
 
+#include "osquery/core/table_cache.h"
 #include "osquery/sql/virtual_table.h"
 
 namespace osquery {
@@ -488,6 +489,10 @@ class tableCacheTablePlugin : public TablePlugin {
 };
 
 TEST_F(VirtualTableTests, test_table_results_cache) {
+  // Results are shared between queries only within a schedule step.
+  auto backup_step = TablePlugin::kCacheStep;
+  TablePlugin::kCacheStep = 0;
+
   // Get a database connection.
   auto tables = RegistryFactory::get().registry("table");
   auto cache = std::make_shared<tableCacheTablePlugin>();
@@ -539,6 +544,74 @@ TEST_F(VirtualTableTests, test_table_results_cache) {
 
   // The table should NOT have used the cache.
   EXPECT_EQ(cache->generates_, 4U);
+  TablePlugin::kCacheStep = backup_step;
+}
+
+class tickCacheTablePlugin : public TablePlugin {
+ public:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("i", INTEGER_TYPE, ColumnOptions::INDEX),
+        std::make_tuple("d", TEXT_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+  TableAttributes attributes() const override {
+    return TableAttributes::CACHEABLE;
+  }
+
+  QueryData generate(QueryContext& ctx) override {
+    generates_++;
+    QueryData results;
+    for (size_t i = 0; i < 3; i++) {
+      results.push_back({{"i", std::to_string(i)}, {"d", "data"}});
+    }
+    return results;
+  }
+
+  size_t generates_{0};
+};
+
+TEST_F(VirtualTableTests, test_tick_cache) {
+  auto backup_step = TablePlugin::kCacheStep;
+  TablePlugin::kCacheStep = 100;
+  TableTickCache::get().clear();
+
+  auto tables = RegistryFactory::get().registry("table");
+  auto cache = std::make_shared<tickCacheTablePlugin>();
+  tables->add("tick_cache", cache);
+  auto dbc = SQLiteDBManager::getUnique();
+  attachTableInternal("tick_cache", cache->columnDefinition(false), dbc, false);
+  dbc->useCache(true);
+
+  QueryData results;
+  queryInternal("SELECT * FROM tick_cache", results, dbc);
+  dbc->clearAffectedTables();
+  EXPECT_EQ(results.size(), 3U);
+  EXPECT_EQ(cache->generates_, 1U);
+
+  // A constrained query in the same step filters the earlier scan.
+  results.clear();
+  queryInternal("SELECT * FROM tick_cache WHERE i = 1", results, dbc);
+  dbc->clearAffectedTables();
+  ASSERT_EQ(results.size(), 1U);
+  EXPECT_EQ(results[0]["i"], "1");
+  EXPECT_EQ(cache->generates_, 1U);
+
+  // The next step generates the table again.
+  TablePlugin::kCacheStep = 101;
+  results.clear();
+  queryInternal("SELECT * FROM tick_cache WHERE i = 2", results, dbc);
+  dbc->clearAffectedTables();
+  EXPECT_EQ(results.size(), 1U);
+  EXPECT_EQ(cache->generates_, 2U);
+
+  auto stats = TableTickCache::get().stats();
+  EXPECT_EQ(stats["tick_cache"].hits, 1U);
+  EXPECT_EQ(stats["tick_cache"].misses, 2U);
+
+  TableTickCache::get().clear();
+  TablePlugin::kCacheStep = backup_step;
 }
 
 class yieldTablePlugin : public TablePlugin {
@@ -586,6 +659,69 @@ TEST_F(VirtualTableTests, test_yield_generator) {
   EXPECT_EQ(results[0]["index"], "10");
 }
 
+class orderedTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("time", INTEGER_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("i", INTEGER_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+  TableAttributes attributes() const override {
+    return TableAttributes::EVENT_BASED;
+  }
+
+ public:
+  bool usesGenerator() const override {
+    return true;
+  }
+
+  void generator(RowYield& yield, QueryContext& qc) override {
+    order = qc.orderBy;
+    bool descending = !order.empty() && order[0].second;
+    for (size_t i = 0; i < 10; i++) {
+      Row r;
+      r["time"] = std::to_string((descending) ? 9 - i : i);
+      r["i"] = std::to_string(i % 3);
+      generated++;
+      yield(r);
+    }
+  }
+
+  ColumnOrdering order;
+  size_t generated{0};
+};
+
+TEST_F(VirtualTableTests, test_order_by_consumed) {
+  auto table = std::make_shared<orderedTablePlugin>();
+  auto table_registry = RegistryFactory::get().registry("table");
+  table_registry->add("ordered", table);
+
+  auto dbc = SQLiteDBManager::getUnique();
+  attachTableInternal("ordered", table->columnDefinition(false), dbc, false);
+
+  // Only event subscribers produce rows in time order, SQLite sorts the rows
+  // of other event-based tables.
+  QueryData results;
+  queryInternal(
+      "SELECT time FROM ordered ORDER BY time DESC LIMIT 2", results, dbc);
+  dbc->clearAffectedTables();
+  ASSERT_EQ(results.size(), 2U);
+  EXPECT_EQ(results[0]["time"], "9");
+  EXPECT_EQ(results[1]["time"], "8");
+  EXPECT_TRUE(table->order.empty());
+  EXPECT_EQ(table->generated, 10U);
+
+  // Other orderings are left for SQLite to sort.
+  results.clear();
+  queryInternal("SELECT i FROM ordered ORDER BY i DESC", results, dbc);
+  dbc->clearAffectedTables();
+  ASSERT_EQ(results.size(), 10U);
+  EXPECT_EQ(results[0]["i"], "2");
+  EXPECT_TRUE(table->order.empty());
+}
+
 class likeTablePlugin : public TablePlugin {
  private:
   TableColumns columns() const override {
@@ -12,12 +12,15 @@
 #include <unordered_set>
 
 #include <osquery/core.h>
+#include <osquery/events.h>
+#include <osquery/extensions.h>
 #include <osquery/flags.h>
 #include <osquery/logger.h>
 #include <osquery/registry_factory.h>
 #include <osquery/system.h>
 
 #include "osquery/core/process.h"
+#include "osquery/core/table_cache.h"
 #include "osquery/sql/virtual_table.h"
 
 namespace osquery {
@@ -327,6 +330,22 @@ int xDestroy(sqlite3_vtab* p) {
   return SQLITE_OK;
 }
 
+/// Read the current batch of a streamed table, skipping empty batches.
+static void readBatch(BaseCursor* pCur) {
+  pCur->batch_offset += pCur->n;
+  pCur->row = 0;
+  pCur->n = 0;
+  pCur->typed = nullptr;
+  for (auto& batches = *pCur->batches; batches; batches()) {
+    if (batches.get()->rows() > 0) {
+      pCur->typed = batches.get();
+      pCur->n = pCur->typed->rows();
+      return;
+    }
+  }
+  pCur->batches = nullptr;
+}
+
 int xNext(sqlite3_vtab_cursor* cur) {
   BaseCursor* pCur = (BaseCursor*)cur;
   if (pCur->uses_generator) {
@@ -336,6 +355,11 @@ int xNext(sqlite3_vtab_cursor* cur) {
     }
   }
   pCur->row++;
+  if (pCur->batches != nullptr && pCur->row >= pCur->n) {
+    // The next batch is requested only once the current one was read.
+    (*pCur->batches)();
+    readBatch(pCur);
+  }
   return SQLITE_OK;
 }
 
@@ -343,6 +367,12 @@ int xRowid(sqlite3_vtab_cursor* cur, sqlite_int64* pRowid) {
   *pRowid = 0;
 
   const BaseCursor* pCur = (BaseCursor*)cur;
+  if (pCur->typed != nullptr) {
+    // Typed tables do not provide a rowid column.
+    *pRowid = pCur->batch_offset + pCur->row;
+    return SQLITE_OK;
+  }
+
   auto data_it = std::next(pCur->data.begin(), pCur->row);
   if (data_it >= pCur->data.end()) {
     return SQLITE_ERROR;
@@ -676,6 +706,65 @@ int xCreate(sqlite3* db,
   return rc;
 }
 
+/// The columns of a table's rows, column aliases are recorded after them.
+static TableColumns getRowColumns(const VirtualTableContent& content) {
+  TableColumns columns;
+  for (const auto& column : content.columns) {
+    if (content.aliases.count(std::get<0>(column)) == 0) {
+      columns.push_back(column);
+    }
+  }
+  return columns;
+}
+
+static int xColumnTyped(const BaseCursor* pCur,
+                        const VirtualTable* pVtab,
+                        sqlite3_context* ctx,
+                        size_t col) {
+  const auto& rows = *pCur->typed;
+  if (pCur->row >= rows.rows()) {
+    // Request row index greater than row set size.
+    return SQLITE_ERROR;
+  }
+
+  if (col >= rows.columns()) {
+    // Column aliases are recorded after the table's columns.
+    const auto& column_name = std::get<0>(pVtab->content->columns[col]);
+    auto alias = pVtab->content->aliases.find(column_name);
+    if (alias == pVtab->content->aliases.end() ||
+        alias->second >= rows.columns()) {
+      sqlite3_result_null(ctx);
+      return SQLITE_OK;
+    }
+    col = alias->second;
+  }
+
+  if (rows.isNull(pCur->row, col)) {
+    sqlite3_result_null(ctx);
+    return SQLITE_OK;
+  }
+
+  switch (rows.type(col)) {
+  case INTEGER_TYPE:
+    sqlite3_result_int(ctx, static_cast<int>(rows.getInteger(pCur->row, col)));
+    break;
+  case BIGINT_TYPE:
+  case UNSIGNED_BIGINT_TYPE:
+    sqlite3_result_int64(ctx, rows.getInteger(pCur->row, col));
+    break;
+  case DOUBLE_TYPE:
+    sqlite3_result_double(ctx, rows.getDouble(pCur->row, col));
+    break;
+  default: {
+    size_t size = 0;
+    const auto* text = rows.getText(pCur->row, col, size);
+    sqlite3_result_text(ctx, text, static_cast<int>(size), SQLITE_STATIC);
+    break;
+  }
+  }
+  return SQLITE_OK;
+}
+
 int xColumn(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col) {
   BaseCursor* pCur = (BaseCursor*)cur;
   const auto* pVtab = (VirtualTable*)cur->pVtab;
@@ -683,6 +772,9 @@ int xColumn(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col) {
     // Requested column index greater than column set size.
     return SQLITE_ERROR;
   }
+  if (pCur->typed != nullptr) {
+    return xColumnTyped(pCur, pVtab, ctx, static_cast<size_t>(col));
+  }
   if (!pCur->uses_generator && pCur->row >= pCur->data.size()) {
     // Request row index greater than row set size.
     return SQLITE_ERROR;
@@ -759,6 +851,24 @@ static inline bool sensibleComparison(ColumnType type, unsigned char op) {
   return true;
 }
 
+/**
+ * @brief Check if a table can produce rows in the order a query requested.
+ *
+ * Event subscribers store records in time bins, they can read the bins in
+ * either direction and sort the records within each bin. Extension tables
+ * may also be event-based but make no promise about their row order.
+ */
+static bool canConsumeOrderBy(const VirtualTableContent& content,
+                              const ColumnOrdering& ordering) {
+  if (!(content.attributes & TableAttributes::EVENT_BASED) ||
+      ordering.size() != 1 || ordering[0].first != "time") {
+    return false;
+  }
+
+  return Registry::get().registry("table")->isInternal(content.name) &&
+         EventFactory::exists(content.name);
+}
+
 static int xBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
   auto* pVtab = (VirtualTable*)tab;
   const auto& columns = pVtab->content->columns;
@@ -865,6 +975,25 @@ static int xBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
     }
   }
 
+  // Let the table produce the rows in order, if it is able to.
+  ColumnOrdering ordering;
+  for (size_t i = 0; i < static_cast<size_t>(pIdxInfo->nOrderBy); ++i) {
+    const auto& order_info = pIdxInfo->aOrderBy[i];
+    if (order_info.iColumn < 0 ||
+        static_cast<size_t>(order_info.iColumn) >= columns.size()) {
+      ordering.clear();
+      break;
+    }
+    ordering.push_back(std::make_pair(std::get<0>(columns[order_info.iColumn]),
+                                      order_info.desc != 0));
+  }
+
+  if (!ordering.empty() && canConsumeOrderBy(*pVtab->content, ordering)) {
+    pIdxInfo->orderByConsumed = 1;
+  } else {
+    ordering.clear();
+  }
+
   pIdxInfo->idxNum = static_cast<int>(kConstraintIndexID++);
 #if defined(DEBUG)
   plan("Recording constraint set for table: " + pVtab->content->name +
@@ -875,6 +1004,7 @@ static int xBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
   // Add the constraint set to the table's tracked constraints.
   pVtab->content->constraints[pIdxInfo->idxNum] = std::move(constraints);
   pVtab->content->colsUsed[pIdxInfo->idxNum] = std::move(colsUsed);
+  pVtab->content->orderBy[pIdxInfo->idxNum] = std::move(ordering);
   pIdxInfo->estimatedCost = cost;
   return SQLITE_OK;
 }
@@ -895,6 +1025,8 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
 
   pCur->row = 0;
   pCur->n = 0;
+  pCur->batches = nullptr;
+  pCur->batch_offset = 0;
   QueryContext context(content);
 
   // The SQLite instance communicates to the TablePlugin via the context.
@@ -983,6 +1115,10 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
     context.colsUsed = content->colsUsed[idxNum];
   }
 
+  if (content->orderBy.count(idxNum) > 0) {
+    context.orderBy = content->orderBy[idxNum];
+  }
+
   if (!user_based_satisfied) {
     LOG(WARNING) << "The " << pVtab->content->name
                  << " table returns data based on the current user by default, "
@@ -1005,13 +1141,15 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
 
   // Reset the virtual table contents.
   pCur->data.clear();
+  pCur->typed = nullptr;
   options.clear();
 
   // Generate the row data set.
   plan("Scanning rows for cursor (" + std::to_string(pCur->id) + ")");
+  std::shared_ptr<TablePlugin> table = nullptr;
   if (Registry::get().exists("table", pVtab->content->name, true)) {
     auto plugin = Registry::get().plugin("table", pVtab->content->name);
-    auto table = std::dynamic_pointer_cast<TablePlugin>(plugin);
+    table = std::dynamic_pointer_cast<TablePlugin>(plugin);
     if (table->usesGenerator()) {
       pCur->uses_generator = true;
       pCur->generator = std::make_unique<RowGenerator::pull_type>(
@@ -1024,6 +1162,81 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
       }
       return SQLITE_OK;
     }
+  }
+
+  // Extension tables are generated using the extension's table calls.
+  std::map<std::string, RouteUUID> external;
+  if (table == nullptr) {
+    external = Registry::get().registry("table")->getExternal();
+  }
+  auto route = external.find(pVtab->content->name);
+  if (route != external.end() &&
+      !(content->attributes & TableAttributes::CACHEABLE)) {
+    // Rows are read in typed batches from a table cursor, each is read in
+    // place before the next is requested.
+    auto uuid = route->second;
+    auto name = route->first;
+    auto columns = getRowColumns(*content);
+    pCur->batches = std::make_unique<TableRowsGenerator::pull_type>(
+        [uuid, name, columns, context = std::move(context)](
+            TableRowsYield& yield) {
+          auto status = callExtensionTable(uuid, name, context, columns, yield);
+          if (!status.ok()) {
+            VLOG(1) << "Cannot read extension table " << name << ": "
+                    << status.getMessage();
+          }
+        });
+    readBatch(pCur);
+    return SQLITE_OK;
+  }
+
+  // Scheduled queries within the same step share cacheable table results.
+  TableTickCache::Claim claim;
+  TableCacheResults cached;
+  if (TableTickCache::get().lookup(
+          TablePlugin::kCacheStep, *content, context, cached, claim)) {
+    if (cached.typed != nullptr) {
+      pCur->typed = std::move(cached.typed);
+      pCur->n = pCur->typed->rows();
+    } else {
+      pCur->data = *cached.rows;
+      pCur->n = pCur->data.size();
+    }
+    return SQLITE_OK;
+  }
+
+  if (table != nullptr && table->usesTypedRows()) {
+    auto typed = std::make_shared<TableRows>(table->columns());
+    table->generateTypedRows(context, *typed);
+    pCur->n = typed->rows();
+    pCur->typed = typed;
+    if (claim) {
+      TableTickCache::get().store(claim, {nullptr, std::move(typed)});
+    }
+    return SQLITE_OK;
+  }
+
+  if (route != external.end()) {
+    // Cacheable extension tables are read at once, as typed columns.
+    auto typed = std::make_shared<TableRows>(getRowColumns(*content));
+    auto status =
+        callExtensionTable(route->second, route->first, context, *typed);
+    if (!status.ok()) {
+      VLOG(1) << "Cannot generate extension table " << route->first << ": "
+              << status.getMessage();
+      pCur->n = 0;
+      return SQLITE_OK;
+    }
+
+    pCur->n = typed->rows();
+    pCur->typed = typed;
+    if (claim) {
+      TableTickCache::get().store(claim, {nullptr, std::move(typed)});
+    }
+    return SQLITE_OK;
+  }
+
+  if (table != nullptr) {
     pCur->data = table->generate(context);
   } else {
     PluginRequest request = {{"action", "generate"}};
@@ -1031,6 +1244,11 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
     Registry::call("table", pVtab->content->name, request, pCur->data);
   }
 
+  if (claim) {
+    TableTickCache::get().store(
+        claim, {std::make_shared<const QueryData>(pCur->data), nullptr});
+  }
+
   // Set the number of rows.
   pCur->n = pCur->data.size();
   return SQLITE_OK;
@@ -54,6 +54,15 @@ struct BaseCursor : private boost::noncopyable {
   /// Does the backing local table use a generator type.
   bool uses_generator{false};
 
+  /// Typed table data generated from last access, if the table uses them.
+  std::shared_ptr<const TableRows> typed{nullptr};
+
+  /// Batches of typed rows, read in turn into typed, for streamed tables.
+  std::unique_ptr<TableRowsGenerator::pull_type> batches{nullptr};
+
+  /// The number of rows in batches read before the current batch.
+  size_t batch_offset{0};
+
   /// Current cursor position.
   size_t row{0};
 
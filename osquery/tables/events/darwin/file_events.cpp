@@ -39,6 +39,11 @@ class FileEventSubscriber : public EventSubscriber<FSEventsEventPublisher> {
   /// Walk the configuration's file paths, create subscriptions.
   void configure() override;
 
+  /// Deliver events waiting for a hash before the subscriber stops.
+  void tearDown() override {
+    drainFileEventHashes(this);
+  }
+
   /**
    * @brief This exports a single Callback for INotifyEventPublisher events.
    *
@@ -49,6 +54,10 @@ class FileEventSubscriber : public EventSubscriber<FSEventsEventPublisher> {
    */
   Status Callback(const FSEventsEventContextRef& ec,
                   const FSEventsSubscriptionContextRef& sc);
+
+ private:
+  /// Hash the event's target path, then add the row.
+  void hashAndAdd(const std::string& path, Row r);
 };
 
 /**
@@ -77,6 +86,28 @@ void FileEventSubscriber::configure() {
   });
 }
 
+void FileEventSubscriber::hashAndAdd(const std::string& path, Row r) {
+  // The row is added after the hash window, keep the time of the event.
+  auto time = getUnixTime();
+
+  // The hashing service keeps the subscriber only while it is registered.
+  auto plugin = RegistryFactory::get().plugin("event_subscriber", getName());
+  if (plugin.get() != this) {
+    hashFileEventRow(path, r);
+    add(r, time);
+    return;
+  }
+
+  std::weak_ptr<FileEventSubscriber> subscriber =
+      std::dynamic_pointer_cast<FileEventSubscriber>(plugin);
+  hashFileEvent(path, std::move(r), this, [subscriber, time](Row& row) {
+    auto self = subscriber.lock();
+    if (self != nullptr) {
+      self->add(row, time);
+    }
+  });
+}
+
 Status FileEventSubscriber::Callback(const FSEventsEventContextRef& ec,
                                      const FSEventsSubscriptionContextRef& sc) {
   if (ec->action.empty()) {
@@ -103,9 +134,14 @@ Status FileEventSubscriber::Callback(const FSEventsEventContextRef& ec,
   r["category"] = sc->category;
   r["transaction_id"] = INTEGER(ec->transaction_id);
 
-  // Add hashing and 'join' against the file table for stat-information.
-  decorateFileEvent(
-      ec->path, (ec->action == "CREATED" || ec->action == "UPDATED"), r);
+  // Add the stat-information columns shared with the file table.
+  decorateFileEvent(ec->path, false, r);
+
+  if (ec->action == "CREATED" || ec->action == "UPDATED") {
+    // Repeated writes to the same path are hashed once, then added.
+    hashAndAdd(ec->path, std::move(r));
+    return Status(0, "OK");
+  }
 
   add(r);
   return Status(0, "OK");
@@ -8,40 +8,197 @@
  *  You may select, at your option, one of the above-listed licenses.
  */
 
+#include <algorithm>
+#include <iterator>
+
 #include <osquery/events.h>
-#include <osquery/sql.h>
+#include <osquery/flags.h>
 
+#include "osquery/core/hash_cache.h"
 #include "osquery/core/hashing.h"
 #include "osquery/tables/events/event_utils.h"
+#include "osquery/tables/utility/file.h"
 
 namespace osquery {
 
+DECLARE_bool(disable_hash_cache);
+
+HIDDEN_FLAG(uint64,
+            file_events_hash_window,
+            1000,
+            "Milliseconds to coalesce file event hashing for the same path");
+
+HIDDEN_FLAG(uint64,
+            file_events_hash_queue_max,
+            10000,
+            "Maximum file event rows waiting to be hashed, others hash inline");
+
 const std::set<std::string> kCommonFileColumns = {
     "inode", "uid", "gid", "mode", "size", "atime", "mtime", "ctime",
 };
 
+/// The running hash service, created when the first event is hashed.
+static std::shared_ptr<FileHashQueue> kFileHashQueue;
+
+/// Protects the creation of kFileHashQueue.
+static Mutex kFileHashQueueMutex;
+
 void decorateFileEvent(const std::string& path, bool hash, Row& r) {
-  auto results = SQL::selectAllFrom("file", "path", EQUALS, path);
-  if (results.size() == 1) {
-    auto& row = results.at(0);
-    for (const auto& key : kCommonFileColumns) {
-      if (row.count(key) > 0) {
-        r[key] = row.at(key);
-      }
-    }
-  }
+  tables::genCommonFileColumns(path, r);
 
   if (hash) {
-    auto hashes = hashMultiFromFile(
-        HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
-    r["md5"] = std::move(hashes.md5);
-    r["sha1"] = std::move(hashes.sha1);
-    r["sha256"] = std::move(hashes.sha256);
-    // Hashed determines the success/status of hashing, -1 failed, 1 success.
-    r["hashed"] = (r.at("md5").empty()) ? "-1" : "1";
+    hashFileEventRow(path, r);
   } else {
     // Alternatively if hashing wasn't needed hashed is a 0.
     r["hashed"] = "0";
   }
 }
+
+void hashFileEventRow(const std::string& path, Row& r) {
+  MultiHashes hashes;
+  if (!FLAGS_disable_hash_cache) {
+    // Events that do not change content, such as attribute changes, and paths
+    // already hashed before a restart are not hashed again.
+    FileHashCache::get().load(path, hashes, true);
+  } else {
+    hashes = hashMultiFromFile(
+        HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
+  }
+  r["md5"] = std::move(hashes.md5);
+  r["sha1"] = std::move(hashes.sha1);
+  r["sha256"] = std::move(hashes.sha256);
+  // Hashed determines the success/status of hashing, -1 failed, 1 success.
+  r["hashed"] = (r.at("md5").empty()) ? "-1" : "1";
+}
+
+void hashFileEvent(const std::string& path,
+                   Row r,
+                   const void* owner,
+                   FileEventHashCallback callback) {
+  std::shared_ptr<FileHashQueue> queue;
+  {
+    WriteLock lock(kFileHashQueueMutex);
+    if (kFileHashQueue == nullptr) {
+      kFileHashQueue = std::make_shared<FileHashQueue>();
+      if (!Dispatcher::addService(kFileHashQueue).ok()) {
+        kFileHashQueue = nullptr;
+      }
+    }
+    queue = kFileHashQueue;
+  }
+
+  if (queue == nullptr || !queue->enqueue(path, r, owner, callback)) {
+    hashFileEventRow(path, r);
+    callback(r);
+  }
+}
+
+void drainFileEventHashes(const void* owner) {
+  std::shared_ptr<FileHashQueue> queue;
+  {
+    WriteLock lock(kFileHashQueueMutex);
+    queue = kFileHashQueue;
+  }
+
+  if (queue != nullptr) {
+    queue->drain(owner);
+  }
+}
+
+bool FileHashQueue::enqueue(const std::string& path,
+                            Row r,
+                            const void* owner,
+                            FileEventHashCallback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stopping_) {
+    return false;
+  }
+
+  if (FLAGS_file_events_hash_queue_max > 0 &&
+      pending_rows_ >= FLAGS_file_events_hash_queue_max) {
+    // The service is not keeping up, the caller hashes the row itself.
+    overflows_++;
+    return false;
+  }
+
+  auto& rows = pending_[path];
+  rows.push_back({std::move(r), owner, std::move(callback)});
+  pending_rows_++;
+  if (pending_.size() == 1 && rows.size() == 1) {
+    condition_.notify_one();
+  }
+  return true;
+}
+
+void FileHashQueue::flush() {
+  std::lock_guard<std::mutex> deliver_lock(deliver_mutex_);
+  PendingRows pending;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending.swap(pending_);
+    pending_rows_ = 0;
+  }
+  deliver(pending);
+}
+
+void FileHashQueue::drain(const void* owner) {
+  std::lock_guard<std::mutex> deliver_lock(deliver_mutex_);
+  PendingRows pending;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = pending_.begin(); it != pending_.end();) {
+      auto& rows = it->second;
+      auto owned = std::stable_partition(
+          rows.begin(), rows.end(), [owner](const PendingRow& row) {
+            return row.owner != owner;
+          });
+      if (owned != rows.end()) {
+        auto& drained = pending[it->first];
+        std::move(owned, rows.end(), std::back_inserter(drained));
+        pending_rows_ -= std::distance(owned, rows.end());
+        rows.erase(owned, rows.end());
+      }
+      it = (rows.empty()) ? pending_.erase(it) : std::next(it);
+    }
+  }
+  deliver(pending);
+}
+
+void FileHashQueue::deliver(PendingRows& pending) {
+  for (auto& path_rows : pending) {
+    Row hashes;
+    hashFileEventRow(path_rows.first, hashes);
+    hashed_++;
+
+    for (auto& pending_row : path_rows.second) {
+      for (const auto& column : hashes) {
+        pending_row.row[column.first] = column.second;
+      }
+      pending_row.callback(pending_row.row);
+    }
+  }
+}
+
+void FileHashQueue::start() {
+  while (!interrupted()) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock,
+                      [this]() { return stopping_ || !pending_.empty(); });
+    }
+
+    // Let repeated writes to the same paths accumulate before hashing.
+    pause(std::chrono::milliseconds(FLAGS_file_events_hash_window));
+    flush();
+  }
+
+  // Events queued before stopping are still delivered.
+  flush();
+}
+
+void FileHashQueue::stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stopping_ = true;
+  condition_.notify_one();
 }
+} // namespace osquery
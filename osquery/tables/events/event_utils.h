@@ -10,9 +10,16 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <vector>
 
+#include <osquery/dispatcher.h>
 #include <osquery/tables.h>
 
 namespace osquery {
@@ -20,6 +27,9 @@ namespace osquery {
 /// List of columns decorated for file events.
 extern const std::set<std::string> kCommonFileColumns;
 
+/// Called with a file event row once its hash columns are set.
+using FileEventHashCallback = std::function<void(Row&)>;
+
 /**
  * @brief A helper function for each platform's implementation of file_events.
  *
@@ -31,4 +41,118 @@ extern const std::set<std::string> kCommonFileColumns;
  * @param r The output parameter row structure.
  */
 void decorateFileEvent(const std::string& path, bool hash, Row& r);
-}
+
+/**
+ * @brief Hash a decorated file event's target path asynchronously.
+ *
+ * The row is passed to the callback from the hashing service once the md5,
+ * sha1, sha256, and hashed columns are set. If the service is not running, or
+ * too many rows are waiting for it, the path is hashed and the callback is
+ * called before returning.
+ *
+ * The owner, usually the subscriber, must call drainFileEventHashes before it
+ * is torn down. The callback is not called for the owner after that returns.
+ *
+ * @param path The target path from the file event.
+ * @param r The row, already decorated with decorateFileEvent.
+ * @param owner Identifies the rows queued by a subscriber.
+ * @param callback Receives the hashed row, usually to add it.
+ */
+void hashFileEvent(const std::string& path,
+                   Row r,
+                   const void* owner,
+                   FileEventHashCallback callback);
+
+/// Hash and deliver the rows queued by an owner, before it is torn down.
+void drainFileEventHashes(const void* owner);
+
+/// Set the md5, sha1, sha256, and hashed columns from a path's content.
+void hashFileEventRow(const std::string& path, Row& r);
+
+/**
+ * @brief A service that hashes file event paths once per batch window.
+ *
+ * Editors, builds, and package upgrades write the same file many times in a
+ * short period. Events for a path are queued and the path is hashed once, when
+ * the batch window ends, for all of the events queued for it.
+ */
+class FileHashQueue : public InternalRunnable {
+ public:
+  FileHashQueue() : InternalRunnable("FileHashQueue") {}
+
+  /**
+   * @brief Queue a row for hashing.
+   *
+   * At most file_events_hash_queue_max rows wait to be hashed. Once that
+   * many are queued further rows are refused and counted as overflows.
+   *
+   * @return false if the queue is stopping or full and the row was not queued.
+   */
+  bool enqueue(const std::string& path,
+               Row r,
+               const void* owner,
+               FileEventHashCallback callback);
+
+  /// Hash each queued path and run the callbacks for its rows.
+  void flush();
+
+  /**
+   * @brief Hash and deliver the rows queued by an owner.
+   *
+   * This waits for a flush that is running callbacks on the service thread.
+   * Once it returns no callback for the owner is pending or running.
+   */
+  void drain(const void* owner);
+
+  /// The number of paths hashed.
+  size_t hashed() const {
+    return hashed_;
+  }
+
+  /// The number of rows refused because the queue was full.
+  size_t overflows() const {
+    return overflows_;
+  }
+
+ protected:
+  void start() override;
+
+  void stop() override;
+
+ private:
+  struct PendingRow {
+    Row row;
+    const void* owner;
+    FileEventHashCallback callback;
+  };
+
+  using PendingRows = std::map<std::string, std::vector<PendingRow>>;
+
+  /// Hash each path and run the callbacks for its rows.
+  void deliver(PendingRows& pending);
+
+  /// Rows waiting for a hash, keyed by path.
+  PendingRows pending_;
+
+  /// The number of rows in pending_, across every path.
+  size_t pending_rows_{0};
+
+  /// Protects pending_, pending_rows_ and stopping_.
+  std::mutex mutex_;
+
+  /// Held while callbacks run, so a drain waits for them.
+  std::mutex deliver_mutex_;
+
+  /// Wakes the service when the first row is queued.
+  std::condition_variable condition_;
+
+  /// Set when the service is interrupted, rows are then hashed inline.
+  bool stopping_{false};
+
+  /// The number of paths hashed.
+  std::atomic<size_t> hashed_{0};
+
+  /// The number of rows refused because the queue was full.
+  std::atomic<size_t> overflows_{0};
+};
+} // namespace osquery
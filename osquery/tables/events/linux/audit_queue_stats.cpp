@@ -0,0 +1,37 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <osquery/tables.h>
+
+#include "osquery/events/linux/auditdnetlink.h"
+
+namespace osquery {
+namespace tables {
+
+QueryData genAuditQueueStats(QueryContext& context) {
+  QueryData results;
+
+  // There are no rows unless the audit publisher is running.
+  for (const auto& stats : AuditdNetlink::getQueueStats()) {
+    Row r;
+    r["queue"] = stats.queue;
+    r["capacity"] = BIGINT(stats.capacity);
+    r["size"] = BIGINT(stats.size);
+    r["max_size"] = BIGINT(stats.max_size);
+    r["pushed"] = BIGINT(stats.pushed);
+    r["dropped"] = BIGINT(stats.dropped);
+    r["stalls"] = BIGINT(stats.stalls);
+    results.push_back(std::move(r));
+  }
+
+  return results;
+}
+} // namespace tables
+} // namespace osquery
@@ -36,6 +36,11 @@ class FileEventSubscriber : public EventSubscriber<INotifyEventPublisher> {
   /// Walk the configuration's file paths, create subscriptions.
   void configure() override;
 
+  /// Deliver events waiting for a hash before the subscriber stops.
+  void tearDown() override {
+    drainFileEventHashes(this);
+  }
+
   /**
    * @brief This exports a single Callback for INotifyEventPublisher events.
    *
@@ -45,6 +50,10 @@ class FileEventSubscriber : public EventSubscriber<INotifyEventPublisher> {
    * @return Was the callback successful.
    */
   Status Callback(const ECRef& ec, const SCRef& sc);
+
+ private:
+  /// Hash the event's target path, then add the row.
+  void hashAndAdd(const std::string& path, Row r);
 };
 
 /**
@@ -84,6 +93,28 @@ void FileEventSubscriber::configure() {
   });
 }
 
+void FileEventSubscriber::hashAndAdd(const std::string& path, Row r) {
+  // The row is added after the hash window, keep the time of the event.
+  auto time = getUnixTime();
+
+  // The hashing service keeps the subscriber only while it is registered.
+  auto plugin = RegistryFactory::get().plugin("event_subscriber", getName());
+  if (plugin.get() != this) {
+    hashFileEventRow(path, r);
+    add(r, time);
+    return;
+  }
+
+  std::weak_ptr<FileEventSubscriber> subscriber =
+      std::dynamic_pointer_cast<FileEventSubscriber>(plugin);
+  hashFileEvent(path, std::move(r), this, [subscriber, time](Row& row) {
+    auto self = subscriber.lock();
+    if (self != nullptr) {
+      self->add(row, time);
+    }
+  });
+}
+
 Status FileEventSubscriber::Callback(const ECRef& ec, const SCRef& sc) {
   if (ec->action.empty()) {
     return Status(0);
@@ -95,13 +126,15 @@ Status FileEventSubscriber::Callback(const ECRef& ec, const SCRef& sc) {
   r["category"] = sc->category;
   r["transaction_id"] = INTEGER(ec->event->cookie);
 
-  if ((sc->mask & kFileAccessMasks) != kFileAccessMasks) {
-    // Add hashing and 'join' against the file table for stat-information.
-    decorateFileEvent(
-        ec->path, (ec->action == "CREATED" || ec->action == "UPDATED"), r);
-  } else {
-    // The access event on Linux would generate additional events if hashed.
-    decorateFileEvent(ec->path, false, r);
+  // Add the stat-information columns shared with the file table.
+  decorateFileEvent(ec->path, false, r);
+
+  // The access event on Linux would generate additional events if hashed.
+  if ((sc->mask & kFileAccessMasks) != kFileAccessMasks &&
+      (ec->action == "CREATED" || ec->action == "UPDATED")) {
+    // Repeated writes to the same path are hashed once, then added.
+    hashAndAdd(ec->path, std::move(r));
+    return Status(0, "OK");
   }
 
   // A callback is somewhat useless unless it changes the EventSubscriber
@@ -143,17 +143,18 @@ Status AuditProcessEventSubscriber::ProcessEvents(
     // build the command line from the AUDIT_EXECVE record
     row["cmdline"] = "";
 
-    for (const auto& arg : execve_event_record->fields) {
-      if (arg.first == "argc") {
+    const auto& execve_fields = execve_event_record->fields;
+    for (size_t i = 0; i < execve_fields.size(); i++) {
+      if (execve_fields.key(i) == "argc") {
         continue;
       }
 
-      // Amalgamate all the "arg*" fields.
+      // Amalgamate all the "arg*" fields, they are in argument order.
       if (row.at("cmdline").size() > 0) {
         row["cmdline"] += " ";
       }
 
-      row["cmdline"] += DecodeAuditPathValues(arg.second);
+      row["cmdline"] += DecodeAuditPathValues(execve_fields.value(i));
     }
 
     // There may be a better way to calculate actual size from audit.
@@ -182,10 +182,13 @@ Status SocketEventSubscriber::ProcessEvents(
     CopyFieldFromMap(row, syscall_event_record->fields, "pid");
     GetStringFieldFromMap(row["fd"], syscall_event_record->fields, "a0");
 
-    row["path"] = DecodeAuditPathValues(syscall_event_record->fields.at("exe"));
+    boost::string_ref value;
+    syscall_event_record->fields.find("exe", value);
+    row["path"] = DecodeAuditPathValues(value);
     row["fd"] = syscall_event_record->fields.at("a0");
-    row["success"] =
-        (syscall_event_record->fields.at("success") == "yes") ? "1" : "0";
+    value.clear();
+    syscall_event_record->fields.find("success", value);
+    row["success"] = (value == "yes") ? "1" : "0";
     row["uptime"] = std::to_string(tables::getUptime());
 
     // Set some sane defaults and then attempt to parse the sockaddr value
@@ -12,6 +12,7 @@
 
 #include <osquery/config.h>
 #include <osquery/events.h>
+#include <osquery/filesystem.h>
 #include <osquery/flags.h>
 #include <osquery/logger.h>
 #include <osquery/registry.h>
@@ -21,9 +22,12 @@
 #include "osquery/tables/events/event_utils.h"
 #include "osquery/tests/test_util.h"
 
+namespace fs = boost::filesystem;
+
 namespace osquery {
 
 DECLARE_bool(registry_exceptions);
+DECLARE_uint64(file_events_hash_queue_max);
 
 class FileEventSubscriber;
 
@@ -73,6 +77,124 @@ TEST_F(FileEventsTableTests, test_table_empty) {
   EXPECT_EQ(results.size(), 0U);
 }
 
+TEST_F(FileEventsTableTests, test_decorate_file_event) {
+  auto path =
+      (fs::path(kTestWorkingDirectory) / "file-events-decorate.txt").string();
+  ASSERT_TRUE(writeTextFile(path, "decorated").ok());
+
+  // The decorated columns match the file table.
+  Row r;
+  decorateFileEvent(path, false, r);
+  auto results = SQL::selectAllFrom("file", "path", EQUALS, path);
+  ASSERT_EQ(1U, results.size());
+  for (const auto& column : kCommonFileColumns) {
+    EXPECT_EQ(results[0].at(column), r[column]) << column;
+  }
+  EXPECT_EQ("9", r["size"]);
+  EXPECT_EQ("0", r["hashed"]);
+
+  decorateFileEvent(path, true, r);
+  EXPECT_EQ("1", r["hashed"]);
+  EXPECT_EQ(32U, r["md5"].size());
+
+  // Missing paths are not decorated.
+  Row missing;
+  decorateFileEvent(path + ".missing", false, missing);
+  EXPECT_EQ(0U, missing.count("inode"));
+  removePath(path);
+}
+
+TEST_F(FileEventsTableTests, test_hash_queue) {
+  auto path =
+      (fs::path(kTestWorkingDirectory) / "file-events-hash.txt").string();
+  ASSERT_TRUE(writeTextFile(path, "hashed").ok());
+
+  // Repeated events for the same path are hashed once.
+  FileHashQueue queue;
+  std::vector<Row> rows;
+  for (size_t i = 0; i < 100; i++) {
+    Row r;
+    r["transaction_id"] = INTEGER(i);
+    EXPECT_TRUE(queue.enqueue(path, std::move(r), this, [&rows](Row& row) {
+      rows.push_back(row);
+    }));
+  }
+  EXPECT_TRUE(rows.empty());
+
+  queue.flush();
+  EXPECT_EQ(1U, queue.hashed());
+  ASSERT_EQ(100U, rows.size());
+  for (size_t i = 0; i < rows.size(); i++) {
+    EXPECT_EQ(std::to_string(i), rows[i]["transaction_id"]);
+    EXPECT_EQ("1", rows[i]["hashed"]);
+    EXPECT_EQ(rows[0]["sha256"], rows[i]["sha256"]);
+  }
+
+  // Once the queue is stopped rows are not accepted.
+  queue.interrupt();
+  EXPECT_FALSE(queue.enqueue(path, Row(), this, [](Row& row) {}));
+  removePath(path);
+}
+
+TEST_F(FileEventsTableTests, test_hash_queue_drain) {
+  auto path =
+      (fs::path(kTestWorkingDirectory) / "file-events-drain.txt").string();
+  ASSERT_TRUE(writeTextFile(path, "drained").ok());
+
+  FileHashQueue queue;
+  int first = 0;
+  int second = 0;
+  std::vector<Row> first_rows;
+  std::vector<Row> second_rows;
+  for (size_t i = 0; i < 4; i++) {
+    queue.enqueue(path, Row(), &first, [&first_rows](Row& row) {
+      first_rows.push_back(row);
+    });
+    queue.enqueue(path, Row(), &second, [&second_rows](Row& row) {
+      second_rows.push_back(row);
+    });
+  }
+
+  // Only the rows of the drained owner are delivered.
+  queue.drain(&first);
+  ASSERT_EQ(4U, first_rows.size());
+  EXPECT_EQ("1", first_rows[0]["hashed"]);
+  EXPECT_TRUE(second_rows.empty());
+
+  // Nothing is left for a drained owner.
+  queue.flush();
+  EXPECT_EQ(4U, first_rows.size());
+  EXPECT_EQ(4U, second_rows.size());
+  removePath(path);
+}
+
+TEST_F(FileEventsTableTests, test_hash_queue_max) {
+  auto queue_max = FLAGS_file_events_hash_queue_max;
+  FLAGS_file_events_hash_queue_max = 2;
+
+  // Rows past the maximum are refused, the caller hashes them inline.
+  FileHashQueue queue;
+  size_t delivered = 0;
+  auto callback = [&delivered](Row& row) { delivered++; };
+  EXPECT_TRUE(queue.enqueue("/a", Row(), this, callback));
+  EXPECT_TRUE(queue.enqueue("/b", Row(), this, callback));
+  EXPECT_FALSE(queue.enqueue("/a", Row(), this, callback));
+  EXPECT_EQ(1U, queue.overflows());
+
+  // Delivered rows make room for new ones.
+  queue.drain(this);
+  EXPECT_EQ(2U, delivered);
+  EXPECT_TRUE(queue.enqueue("/a", Row(), this, callback));
+  EXPECT_TRUE(queue.enqueue("/b", Row(), this, callback));
+  EXPECT_FALSE(queue.enqueue("/c", Row(), this, callback));
+  queue.flush();
+  EXPECT_EQ(4U, delivered);
+  EXPECT_TRUE(queue.enqueue("/c", Row(), this, callback));
+  EXPECT_EQ(2U, queue.overflows());
+
+  FLAGS_file_events_hash_queue_max = queue_max;
+}
+
 class FileEventsTestsConfigPlugin : public ConfigPlugin {
  public:
   Status genConfig(std::map<std::string, std::string>& config) override {
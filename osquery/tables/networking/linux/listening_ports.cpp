@@ -0,0 +1,75 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <osquery/filesystem.h>
+#include <osquery/logger.h>
+#include <osquery/tables.h>
+
+#include "osquery/filesystem/linux/proc.h"
+#include "osquery/tables/networking/linux/sock_diag.h"
+
+namespace osquery {
+namespace tables {
+
+QueryData genListeningPorts(QueryContext& context) {
+  QueryData results;
+
+  std::set<std::string> pids;
+  auto status = procProcesses(pids);
+  if (!status.ok()) {
+    VLOG(1) << "Failed to acquire pid list: " << status.what();
+    return results;
+  }
+
+  // Only listening sockets are read, filtered by state in the kernel.
+  SocketInfoList socket_list;
+  genSocketList(pids, true, socket_list);
+
+  // Finding the owner of a socket reads every process's descriptors, shared
+  // within a schedule step. Skip this unless the owning pid or fd is selected.
+  bool owners = context.isAnyColumnUsed({"pid", "fd"});
+  std::shared_ptr<const ProcessDescriptorSweep> sweep;
+  if (owners) {
+    sweep = procGetDescriptorSweep(TablePlugin::kCacheStep);
+  }
+
+  for (const auto& info : socket_list) {
+    Row r;
+    if (owners) {
+      auto proc_it = sweep->sockets.find(info.socket);
+      if (proc_it != sweep->sockets.end()) {
+        r["pid"] = proc_it->second.pid;
+        r["fd"] = proc_it->second.fd;
+      } else {
+        r["pid"] = "-1";
+        r["fd"] = "-1";
+      }
+    }
+
+    if (info.family == AF_UNIX) {
+      r["port"] = "0";
+      r["path"] = info.unix_socket_path;
+      r["socket"] = "0";
+    } else {
+      r["address"] = info.local_address;
+      r["port"] = std::to_string(info.local_port);
+      r["socket"] = info.socket;
+    }
+
+    r["protocol"] = std::to_string(info.protocol);
+    r["family"] = std::to_string(info.family);
+    r["net_namespace"] = std::to_string(info.net_ns);
+    results.push_back(std::move(r));
+  }
+
+  return results;
+}
+} // namespace tables
+} // namespace osquery
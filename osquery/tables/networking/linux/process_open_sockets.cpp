@@ -14,6 +14,7 @@
 
 #include "osquery/core/conversions.h"
 #include "osquery/filesystem/linux/proc.h"
+#include "osquery/tables/networking/linux/sock_diag.h"
 
 namespace osquery {
 namespace tables {
@@ -44,100 +45,54 @@ QueryData genOpenSockets(QueryContext& context) {
     }
   }
 
-  /* Data for this table is fetched from 3 different sources and correlated.
+  /* Data for this table is fetched from 2 different sources and correlated.
    *
    * 1. Collect all sockets associated with each pid by going through all files
    * under /proc/<pid>/fd and search for links of the type socket:[<inode>].
    * Extract the inode and fd (filename) and index it by inode number. The inode
    * can then be used to correlate pid and fd with the socket information
-   * collected on step 3. The map generated in this step will only contain
+   * collected on step 2. The map generated in this step will only contain
    * sockets associated with pids in the list, so it will also be used to filter
    * the sockets later if pid_filter is set.
    *
-   * 2. Collect the inode for the network namespace associated with each pid.
-   * Every time a new namespace is found execute step 3 to get socket basic
-   * information.
-   *
-   * 3. Collect basic socket information for all sockets under a specifc network
-   * namespace. This is done by reading through files under /proc/<pid>/net for
-   * the first pid we find in a certain namespace. Notice this will collect
-   * information for all sockets on the namespace not only for sockets
-   * associated with the specific pid, therefore only needs to be run once. From
-   * this step we collect the inodes of each of the sockets, and will use that
-   * to correlate the socket information with the information collect on steps
-   * 1 and 2.
+   * 2. Collect basic socket information for all sockets in the network
+   * namespaces of the pids. Sockets in osquery's namespace are read using
+   * sock_diag, other namespaces are read from /proc/<pid>/net for the first
+   * pid found in the namespace. From this step we collect the inodes of each
+   * of the sockets, and will use that to correlate the socket information
+   * with the information collected on step 1.
    */
-
-  /* Use a set to record the namespaces already processed */
-  std::set<ino_t> netns_list;
+  /* Step 1 */
   SocketInodeToProcessInfoMap inode_proc_map;
-  SocketInfoList socket_list;
-  for (const auto& pid : pids) {
-    /* Step 1 */
-    status = procGetSocketInodeToProcessInfoMap(pid, inode_proc_map);
-    if (!status.ok()) {
-      VLOG(1) << "Results for process_open_sockets might be incomplete. Failed "
-                 "to acquire socket inode to process map for pid "
-              << pid << ": " << status.what();
-    }
-
-    /* Step 2 */
-    ino_t ns;
-    ProcessNamespaceList namespaces;
-    status = procGetProcessNamespaces(pid, namespaces, {"net"});
-    if (status.ok()) {
-      ns = namespaces["net"];
-    } else {
-      /* If namespaces are not available we allways set ns to 0 and step 3 will
-       * run once for the first pid in the list.
-       */
-      ns = 0;
-      VLOG(1) << "Results for the process_open_sockets might be incomplete."
-                 "Failed to acquire network namespace information for process "
-                 "with pid "
-              << pid << ": " << status.what();
-    }
-
-    if (netns_list.count(ns) == 0) {
-      netns_list.insert(ns);
-
-      /* Step 3 */
-      for (const auto& pair : kLinuxProtocolNames) {
-        status = procGetSocketList(AF_INET, pair.first, ns, pid, socket_list);
-        if (!status.ok()) {
-          VLOG(1)
-              << "Results for process_open_sockets might be incomplete. Failed "
-                 "to acquire basic socket information for AF_INET "
-              << pair.second << ": " << status.what();
-        }
-
-        status = procGetSocketList(AF_INET6, pair.first, ns, pid, socket_list);
-        if (!status.ok()) {
-          VLOG(1)
-              << "Results for process_open_sockets might be incomplete. Failed "
-                 "to acquire basic socket information for AF_INET6 "
-              << pair.second << ": " << status.what();
-        }
-      }
-      status = procGetSocketList(AF_UNIX, IPPROTO_IP, ns, pid, socket_list);
+  std::shared_ptr<const ProcessDescriptorSweep> sweep;
+  if (pid_filter) {
+    for (const auto& pid : pids) {
+      status = procGetSocketInodeToProcessInfoMap(pid, inode_proc_map);
       if (!status.ok()) {
-        VLOG(1)
-            << "Results for process_open_sockets might be incomplete. Failed "
-               "to acquire basic socket information for AF_UNIX: "
-            << status.what();
+        VLOG(1) << "Results for process_open_sockets might be incomplete. "
+                   "Failed to acquire socket inode to process map for pid "
+                << pid << ": " << status.what();
       }
     }
+  } else {
+    // Every process's descriptors are read once for each schedule step.
+    sweep = procGetDescriptorSweep(TablePlugin::kCacheStep);
   }
+  const auto& owners = (pid_filter) ? inode_proc_map : sweep->sockets;
+
+  /* Step 2 */
+  SocketInfoList socket_list;
+  genSocketList(pids, false, socket_list);
 
   /* Finally correlate all the information. Go through all the sockets
-   * collected on step 3 and correlate that with the pid and fd collected from
+   * collected on step 2 and correlate that with the pid and fd collected from
    * step 1. If filtering only take sockets for which the inode is available on
    * the inode to process information map.
    */
   for (const auto& info : socket_list) {
     Row r;
-    auto proc_it = inode_proc_map.find(info.socket);
-    if (proc_it != inode_proc_map.end()) {
+    auto proc_it = owners.find(info.socket);
+    if (proc_it != owners.end()) {
       r["pid"] = proc_it->second.pid;
       r["fd"] = proc_it->second.fd;
     } else if (!pid_filter) {
@@ -0,0 +1,341 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/unix_diag.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <functional>
+
+#include <osquery/logger.h>
+
+#include "osquery/tables/networking/linux/inet_diag.h"
+#include "osquery/tables/networking/linux/sock_diag.h"
+
+namespace osquery {
+
+namespace {
+
+/// The receive buffer size, each read returns several sockets.
+const size_t kSockDiagBufferSize{32 * 1024};
+
+/// Handle one SOCK_DIAG_BY_FAMILY response message.
+using SockDiagCallback = std::function<void(const struct nlmsghdr*)>;
+
+/// A NETLINK_SOCK_DIAG socket, closed when released.
+class SockDiagSocket : private boost::noncopyable {
+ public:
+  SockDiagSocket()
+      : fd_(socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG)) {
+  }
+
+  ~SockDiagSocket() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  /// Send a dump request and call the callback for each response message.
+  Status dump(void* request, size_t size, const SockDiagCallback& callback);
+
+ private:
+  int fd_{-1};
+
+  /// The sequence number of the last request.
+  __u32 sequence_{0};
+};
+
+Status SockDiagSocket::dump(void* request,
+                            size_t size,
+                            const SockDiagCallback& callback) {
+  if (fd_ < 0) {
+    return Status(1, "Cannot open sock_diag socket: " + std::to_string(errno));
+  }
+
+  auto header = static_cast<struct nlmsghdr*>(request);
+  header->nlmsg_len = static_cast<__u32>(size);
+  header->nlmsg_type = SOCK_DIAG_BY_FAMILY;
+  header->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  header->nlmsg_seq = ++sequence_;
+
+  struct sockaddr_nl address = {};
+  address.nl_family = AF_NETLINK;
+  if (sendto(fd_,
+             request,
+             size,
+             0,
+             reinterpret_cast<struct sockaddr*>(&address),
+             sizeof(address)) < 0) {
+    return Status(1,
+                  "Cannot send sock_diag request: " + std::to_string(errno));
+  }
+
+  // Use an aligned buffer, messages are read in place.
+  std::vector<uint64_t> buffer(kSockDiagBufferSize / sizeof(uint64_t));
+  while (true) {
+    auto bytes = recv(fd_, buffer.data(), kSockDiagBufferSize, 0);
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    } else if (bytes <= 0) {
+      return Status(1,
+                    "Cannot read sock_diag response: " + std::to_string(errno));
+    }
+
+    auto remaining = static_cast<int>(bytes);
+    auto message = reinterpret_cast<const struct nlmsghdr*>(buffer.data());
+    for (; NLMSG_OK(message, remaining);
+         message = NLMSG_NEXT(message, remaining)) {
+      if (message->nlmsg_seq != sequence_) {
+        // A response to an earlier request that stopped with an error.
+        continue;
+      } else if (message->nlmsg_type == NLMSG_DONE) {
+        return Status(0);
+      } else if (message->nlmsg_type == NLMSG_ERROR) {
+        auto error = static_cast<const struct nlmsgerr*>(NLMSG_DATA(message));
+        return Status(1, "sock_diag error: " + std::to_string(-error->error));
+      } else if (message->nlmsg_type == SOCK_DIAG_BY_FAMILY) {
+        callback(message);
+      }
+    }
+  }
+}
+
+Status sockDiagGetInet(SockDiagSocket& diag,
+                       int family,
+                       int protocol,
+                       uint32_t states,
+                       ino_t net_ns,
+                       SocketInfoList& result) {
+  struct {
+    struct nlmsghdr header;
+    struct inet_diag_req_v2 request;
+  } message = {};
+  message.request.sdiag_family = static_cast<__u8>(family);
+  message.request.sdiag_protocol = static_cast<__u8>(protocol);
+  message.request.idiag_states = states;
+  if (protocol == IPPROTO_RAW) {
+    // Raw sockets are selected by their protocol, IPPROTO_RAW selects all.
+    message.request.pad = IPPROTO_RAW;
+  }
+
+  auto callback = [family, protocol, net_ns, &result](
+                      const struct nlmsghdr* header) {
+    if (header->nlmsg_len < NLMSG_LENGTH(sizeof(struct inet_diag_msg))) {
+      return;
+    }
+
+    auto msg = static_cast<const struct inet_diag_msg*>(NLMSG_DATA(header));
+    SocketInfo socket_info = {};
+    socket_info.socket = std::to_string(msg->idiag_inode);
+    socket_info.net_ns = net_ns;
+    socket_info.family = family;
+    socket_info.protocol = protocol;
+
+    char address[INET6_ADDRSTRLEN] = {0};
+    inet_ntop(family, msg->id.idiag_src, address, sizeof(address));
+    socket_info.local_address = address;
+    socket_info.local_port = ntohs(msg->id.idiag_sport);
+    inet_ntop(family, msg->id.idiag_dst, address, sizeof(address));
+    socket_info.remote_address = address;
+    socket_info.remote_port = ntohs(msg->id.idiag_dport);
+
+    if (protocol == IPPROTO_TCP) {
+      socket_info.state = (msg->idiag_state == 0 ||
+                           msg->idiag_state >= tcp_states.size())
+                              ? "UNKNOWN"
+                              : tcp_states[msg->idiag_state];
+    }
+    result.push_back(std::move(socket_info));
+  };
+
+  return diag.dump(&message, sizeof(message), callback);
+}
+
+Status sockDiagGetUnix(SockDiagSocket& diag,
+                       uint32_t states,
+                       ino_t net_ns,
+                       SocketInfoList& result) {
+  struct {
+    struct nlmsghdr header;
+    struct unix_diag_req request;
+  } message = {};
+  message.request.sdiag_family = AF_UNIX;
+  message.request.udiag_states = states;
+  message.request.udiag_show = UDIAG_SHOW_NAME;
+
+  auto callback = [net_ns, &result](const struct nlmsghdr* header) {
+    if (header->nlmsg_len < NLMSG_LENGTH(sizeof(struct unix_diag_msg))) {
+      return;
+    }
+
+    auto msg = static_cast<const struct unix_diag_msg*>(NLMSG_DATA(header));
+    SocketInfo socket_info = {};
+    socket_info.socket = std::to_string(msg->udiag_ino);
+    socket_info.net_ns = net_ns;
+    socket_info.family = AF_UNIX;
+
+    // The socket's name follows as an attribute.
+    auto size = static_cast<int>(header->nlmsg_len -
+                                 NLMSG_LENGTH(sizeof(struct unix_diag_msg)));
+    auto attribute = reinterpret_cast<const struct rtattr*>(msg + 1);
+    for (; RTA_OK(attribute, size); attribute = RTA_NEXT(attribute, size)) {
+      if (attribute->rta_type != UNIX_DIAG_NAME ||
+          RTA_PAYLOAD(attribute) == 0) {
+        continue;
+      }
+
+      auto name = static_cast<const char*>(RTA_DATA(attribute));
+      std::string path(name, RTA_PAYLOAD(attribute));
+      if (path[0] == '\0') {
+        // Abstract names are shown with '@' for each NUL, as in /proc/net/unix.
+        std::replace(path.begin(), path.end(), '\0', '@');
+        socket_info.unix_socket_path = std::move(path);
+      } else {
+        socket_info.unix_socket_path = path.c_str();
+      }
+    }
+    result.push_back(std::move(socket_info));
+  };
+
+  return diag.dump(&message, sizeof(message), callback);
+}
+
+/// Check if a socket is listening or bound without a peer.
+bool isListeningSocket(const SocketInfo& socket_info) {
+  if (socket_info.family == AF_UNIX) {
+    return !socket_info.unix_socket_path.empty();
+  } else if (socket_info.protocol == IPPROTO_TCP) {
+    return socket_info.state == "LISTEN";
+  }
+  return socket_info.remote_port == 0;
+}
+
+/// The sockets of one network namespace, using a pid within it.
+void genNamespaceSockets(const std::string& pid,
+                         ino_t net_ns,
+                         bool use_diag,
+                         bool listening,
+                         SocketInfoList& result) {
+  SockDiagSocket diag;
+  auto read = [&](int family, int protocol, uint32_t states) {
+    if (use_diag) {
+      SocketInfoList sockets;
+      Status status;
+      if (family == AF_UNIX) {
+        status = sockDiagGetUnix(diag, states, net_ns, sockets);
+      } else {
+        status =
+            sockDiagGetInet(diag, family, protocol, states, net_ns, sockets);
+      }
+
+      if (status.ok()) {
+        result.insert(result.end(), sockets.begin(), sockets.end());
+        return;
+      }
+      VLOG(1) << "Cannot use sock_diag for family " << family
+              << " and protocol " << protocol << ": " << status.what();
+    }
+
+    auto status = procGetSocketList(family, protocol, net_ns, pid, result);
+    if (!status.ok()) {
+      VLOG(1) << "Socket results might be incomplete. Failed to acquire basic "
+                 "socket information for family "
+              << family << " and protocol " << protocol << ": "
+              << status.what();
+    }
+  };
+
+  for (const auto& pair : kLinuxProtocolNames) {
+    uint32_t states = kSockDiagAllStates;
+    if (listening) {
+      states = (pair.first == IPPROTO_TCP) ? (1U << TCP_LISTEN)
+                                           : (1U << TCP_CLOSE);
+    }
+    read(AF_INET, pair.first, states);
+    read(AF_INET6, pair.first, states);
+  }
+
+  // Named UNIX sockets are kept in every state. Connections accepted on a
+  // listening path share its name and are reported like the /proc parser.
+  read(AF_UNIX, IPPROTO_IP, kSockDiagAllStates);
+}
+} // namespace
+
+Status sockDiagGetSocketList(int family,
+                             int protocol,
+                             uint32_t states,
+                             ino_t net_ns,
+                             SocketInfoList& result) {
+  SockDiagSocket diag;
+  SocketInfoList sockets;
+  Status status;
+  switch (family) {
+  case AF_INET:
+  case AF_INET6:
+    status = sockDiagGetInet(diag, family, protocol, states, net_ns, sockets);
+    break;
+  case AF_UNIX:
+    status = sockDiagGetUnix(diag, states, net_ns, sockets);
+    break;
+  default:
+    return Status(1, "Invalid family " + std::to_string(family));
+  }
+
+  if (status.ok()) {
+    result.insert(result.end(), sockets.begin(), sockets.end());
+  }
+  return status;
+}
+
+void genSocketList(const std::set<std::string>& pids,
+                   bool listening,
+                   SocketInfoList& result) {
+  // A netlink socket reads from the namespace it was created in.
+  ino_t self_ns = 0;
+  auto self_status =
+      procGetNamespaceInode(self_ns, "net", kLinuxProcPath + "/self/ns");
+
+  SocketInfoList sockets;
+  std::set<ino_t> netns_list;
+  for (const auto& pid : pids) {
+    ino_t ns = 0;
+    ProcessNamespaceList namespaces;
+    auto status = procGetProcessNamespaces(pid, namespaces, {"net"});
+    if (status.ok()) {
+      ns = namespaces["net"];
+    } else {
+      // Without namespaces, the sockets are read once using the first pid.
+      VLOG(1) << "Socket results might be incomplete. Failed to acquire "
+                 "network namespace information for process with pid "
+              << pid << ": " << status.what();
+    }
+
+    if (netns_list.count(ns) == 0) {
+      netns_list.insert(ns);
+      auto use_diag = self_status.ok() && ns == self_ns;
+      genNamespaceSockets(pid, ns, use_diag, listening, sockets);
+    }
+  }
+
+  for (auto& socket_info : sockets) {
+    if (!listening || isListeningSocket(socket_info)) {
+      result.push_back(std::move(socket_info));
+    }
+  }
+}
+} // namespace osquery
@@ -0,0 +1,63 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#pragma once
+
+#include <set>
+#include <string>
+
+#include <osquery/status.h>
+
+#include "osquery/filesystem/linux/proc.h"
+
+namespace osquery {
+
+/// A sock_diag state mask selecting sockets in every state.
+const uint32_t kSockDiagAllStates{0xFFFFFFFF};
+
+/**
+ * @brief Read the sockets of osquery's network namespace using sock_diag.
+ *
+ * A NETLINK_SOCK_DIAG dump is filtered by state in the kernel, unlike the
+ * /proc/<pid>/net files, which list every socket as text. The results match
+ * the fields parsed by procGetSocketList.
+ *
+ * The output parameter result is used as-is, and only added to when the dump
+ * completes. Kernels without a diag module for the family and protocol
+ * return an error, the caller should then use procGetSocketList.
+ *
+ * @param family The socket family. One of AF_INET, AF_INET6 or AF_UNIX.
+ * @param protocol The socket protocol, IPPROTO_IP for AF_UNIX.
+ * @param states A mask of the socket states to include, such as TCP_LISTEN.
+ * @param net_ns The network namespace inode reported for the sockets.
+ * @param result The output parameter.
+ */
+Status sockDiagGetSocketList(int family,
+                             int protocol,
+                             uint32_t states,
+                             ino_t net_ns,
+                             SocketInfoList& result);
+
+/**
+ * @brief Read the sockets of the network namespaces used by a set of pids.
+ *
+ * Sockets in osquery's network namespace are read with sock_diag, others are
+ * read from the /proc/<pid>/net files of the first pid in the namespace.
+ *
+ * @param pids The processes whose network namespaces are read.
+ * @param listening Only include listening and bound sockets: TCP sockets in
+ * the LISTEN state, unconnected datagram sockets, and named UNIX sockets in
+ * any state, including connections accepted on a named path.
+ * @param result The output parameter.
+ */
+void genSocketList(const std::set<std::string>& pids,
+                   bool listening,
+                   SocketInfoList& result);
+} // namespace osquery
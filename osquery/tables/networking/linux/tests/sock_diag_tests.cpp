@@ -0,0 +1,147 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "osquery/tables/networking/linux/sock_diag.h"
+#include "osquery/tests/test_util.h"
+
+namespace osquery {
+
+class SockDiagTests : public testing::Test {
+ protected:
+  void TearDown() override {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  /// Find a socket by its local port.
+  const SocketInfo* findPort(const SocketInfoList& sockets,
+                             std::uint16_t port) {
+    for (const auto& socket_info : sockets) {
+      if (socket_info.local_port == port) {
+        return &socket_info;
+      }
+    }
+    return nullptr;
+  }
+
+ protected:
+  int fd_{-1};
+};
+
+TEST_F(SockDiagTests, test_inet_listening) {
+  fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(fd_, 0);
+
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(0, bind(fd_, (struct sockaddr*)&address, sizeof(address)));
+  ASSERT_EQ(0, listen(fd_, 1));
+
+  socklen_t size = sizeof(address);
+  ASSERT_EQ(0, getsockname(fd_, (struct sockaddr*)&address, &size));
+  auto port = ntohs(address.sin_port);
+
+  // Only listening sockets are returned.
+  SocketInfoList sockets;
+  auto status = sockDiagGetSocketList(
+      AF_INET, IPPROTO_TCP, 1U << TCP_ESTABLISHED, 0, sockets);
+  ASSERT_TRUE(status.ok()) << status.what();
+  EXPECT_EQ(nullptr, findPort(sockets, port));
+
+  status = sockDiagGetSocketList(
+      AF_INET, IPPROTO_TCP, 1U << TCP_LISTEN, 0, sockets);
+  ASSERT_TRUE(status.ok()) << status.what();
+  const auto* diag = findPort(sockets, port);
+  ASSERT_NE(nullptr, diag);
+  EXPECT_EQ("LISTEN", diag->state);
+
+  // The fields match those read from /proc.
+  SocketInfoList proc_sockets;
+  ASSERT_TRUE(
+      procGetSocketList(AF_INET, IPPROTO_TCP, 0, "self", proc_sockets).ok());
+  const auto* proc = findPort(proc_sockets, port);
+  ASSERT_NE(nullptr, proc);
+  EXPECT_EQ(proc->socket, diag->socket);
+  EXPECT_EQ(proc->local_address, diag->local_address);
+  EXPECT_EQ(proc->remote_address, diag->remote_address);
+  EXPECT_EQ(proc->remote_port, diag->remote_port);
+  EXPECT_EQ(proc->state, diag->state);
+}
+
+TEST_F(SockDiagTests, test_unix_abstract) {
+  fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(fd_, 0);
+
+  struct sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  std::string name = "osquery.sock_diag." + std::to_string(getpid());
+  memcpy(address.sun_path + 1, name.data(), name.size());
+  auto size = static_cast<socklen_t>(sizeof(sa_family_t) + 1 + name.size());
+  ASSERT_EQ(0, bind(fd_, (struct sockaddr*)&address, size));
+  ASSERT_EQ(0, listen(fd_, 1));
+
+  SocketInfoList sockets;
+  auto status = sockDiagGetSocketList(
+      AF_UNIX, IPPROTO_IP, 1U << TCP_LISTEN, 0, sockets);
+  ASSERT_TRUE(status.ok()) << status.what();
+
+  // Abstract names are shown as in /proc/net/unix.
+  bool found = false;
+  for (const auto& socket_info : sockets) {
+    if (socket_info.unix_socket_path == "@" + name) {
+      found = true;
+    }
+  }
+  EXPECT_TRUE(found);
+}
+
+TEST_F(SockDiagTests, test_unix_listening_accepted) {
+  fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(fd_, 0);
+
+  struct sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  std::string name = "osquery.sock_diag.accept." + std::to_string(getpid());
+  memcpy(address.sun_path + 1, name.data(), name.size());
+  auto size = static_cast<socklen_t>(sizeof(sa_family_t) + 1 + name.size());
+  ASSERT_EQ(0, bind(fd_, (struct sockaddr*)&address, size));
+  ASSERT_EQ(0, listen(fd_, 1));
+
+  auto client = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(client, 0);
+  ASSERT_EQ(0, connect(client, (struct sockaddr*)&address, size));
+  auto accepted = accept(fd_, nullptr, nullptr);
+  ASSERT_GE(accepted, 0);
+
+  SocketInfoList sockets;
+  genSocketList({std::to_string(getpid())}, true, sockets);
+  close(accepted);
+  close(client);
+
+  // The accepted connection shares the listening name and is reported.
+  size_t count = 0;
+  for (const auto& socket_info : sockets) {
+    if (socket_info.unix_socket_path == "@" + name) {
+      count++;
+    }
+  }
+  EXPECT_EQ(2U, count);
+}
+} // namespace osquery
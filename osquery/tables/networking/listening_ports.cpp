@@ -11,6 +11,9 @@
 #include <osquery/sql.h>
 #include <osquery/tables.h>
 
+// Linux reads listening sockets directly, see linux/listening_ports.cpp.
+#ifndef __linux__
+
 namespace {
 const std::string kAF_UNIX = "1";
 const std::string kAF_INET = "2";
@@ -65,13 +68,6 @@ QueryData genListeningPorts(QueryContext& context) {
       r["fd"] = "0";
     }
 
-    // When running under linux, we also have the user namespace
-    // column available. It can be used with the docker_containers
-    // table
-    if (isPlatform(PlatformType::TYPE_LINUX)) {
-      r["net_namespace"] = socket.at("net_namespace");
-    }
-
     results.push_back(r);
   }
 
@@ -79,3 +75,5 @@ QueryData genListeningPorts(QueryContext& context) {
 }
 } // namespace tables
 } // namespace osquery
+
+#endif
@@ -467,7 +467,7 @@ void genProcResourceUsage(const QueryContext& context, int pid, Row& r) {
   }
 }
 
-QueryData genProcesses(QueryContext& context) {
+static QueryData genProcessRows(QueryContext& context) {
   QueryData results;
 
   auto pidlist = getProcList(context);
@@ -502,6 +502,10 @@ QueryData genProcesses(QueryContext& context) {
   return results;
 }
 
+void genProcesses(QueryContext& context, TableRows& results) {
+  results.append(genProcessRows(context));
+}
+
 QueryData genProcessEnvs(QueryContext& context) {
   QueryData results;
 
@@ -183,7 +183,7 @@ void genProcess(struct procstat* pstat,
   results.push_back(r);
 }
 
-QueryData genProcesses(QueryContext& context) {
+static QueryData genProcessRows(QueryContext& context) {
   QueryData results;
   struct kinfo_proc* procs = nullptr;
   struct procstat* pstat = nullptr;
@@ -197,6 +197,10 @@ QueryData genProcesses(QueryContext& context) {
   return results;
 }
 
+void genProcesses(QueryContext& context, TableRows& results) {
+  results.append(genProcessRows(context));
+}
+
 QueryData genProcessEnvs(QueryContext& context) {
   QueryData results;
   struct kinfo_proc* procs = nullptr;
@@ -13,6 +13,8 @@
 #include <osquery/tables.h>
 #include <osquery/filesystem.h>
 
+#include "osquery/filesystem/linux/proc.h"
+
 namespace osquery {
 namespace tables {
 
@@ -40,18 +42,21 @@ void genDescriptors(const std::string& process,
 QueryData genOpenFiles(QueryContext& context) {
   QueryData results;
 
-  std::set<std::string> pids;
   if (context.constraints["pid"].exists(EQUALS)) {
-    pids = context.constraints["pid"].getAll(EQUALS);
-  } else {
-    osquery::procProcesses(pids);
+    auto pids = context.constraints["pid"].getAll(EQUALS);
+    for (const auto& process : pids) {
+      std::map<std::string, std::string> descriptors;
+      if (osquery::procDescriptors(process, descriptors).ok()) {
+        genDescriptors(process, descriptors, results);
+      }
+    }
+    return results;
   }
 
-  for (const auto& process : pids) {
-    std::map<std::string, std::string> descriptors;
-    if (osquery::procDescriptors(process, descriptors).ok()) {
-      genDescriptors(process, descriptors, results);
-    }
+  // Every process's descriptors are read once for each schedule step.
+  auto sweep = procGetDescriptorSweep(TablePlugin::kCacheStep);
+  for (const auto& process : sweep->descriptors) {
+    genDescriptors(process.first, process.second, results);
   }
 
   return results;
@@ -10,6 +10,7 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
 
 #include <stdlib.h>
 #include <sys/stat.h>
@@ -23,6 +24,7 @@
 #include <osquery/core.h>
 #include <osquery/filesystem.h>
 #include <osquery/logger.h>
+#include <osquery/mutex.h>
 #include <osquery/tables.h>
 
 #include "osquery/core/conversions.h"
@@ -222,15 +224,31 @@ struct SimpleProcStat : private boost::noncopyable {
   std::string system_time;
   std::string start_time;
 
+  /// The executable name within /proc/<pid>/stat, this changes with exec.
+  std::string comm;
+
+  /// The unscaled start time in clock ticks since boot.
+  std::string start_ticks;
+
   /// For errors processing proc data.
   Status status;
 
-  explicit SimpleProcStat(const std::string& pid);
+  /**
+   * @brief Parse a process's stat and status.
+   *
+   * Either may be skipped if none of their fields are needed. The row is
+   * dropped if neither can be read, as the process most likely exited.
+   */
+  explicit SimpleProcStat(const std::string& pid,
+                          bool read_stat = true,
+                          bool read_status = true);
 };
 
-SimpleProcStat::SimpleProcStat(const std::string& pid) {
+SimpleProcStat::SimpleProcStat(const std::string& pid,
+                               bool read_stat,
+                               bool read_status) {
   std::string content;
-  if (readFile(getProcAttr("stat", pid), content).ok()) {
+  if (read_stat && readFile(getProcAttr("stat", pid), content).ok()) {
     auto start = content.find_last_of(")");
     // Start parsing stats from ") <MODE>..."
     if (start == std::string::npos || content.size() <= start + 2) {
@@ -238,6 +256,11 @@ SimpleProcStat::SimpleProcStat(const std::string& pid) {
       return;
     }
 
+    auto comm_start = content.find('(');
+    if (comm_start != std::string::npos && comm_start < start) {
+      this->comm = content.substr(comm_start + 1, start - comm_start - 1);
+    }
+
     auto details = osquery::split(content.substr(start + 2), " ");
     if (details.size() <= 19) {
       status = Status(1, "Invalid /proc/stat content");
@@ -251,8 +274,16 @@ SimpleProcStat::SimpleProcStat(const std::string& pid) {
     this->system_time = details.at(12);
     this->nice = details.at(16);
     this->threads = details.at(17);
+    this->start_ticks = details.at(19);
     auto st = tryTo<long>(details.at(19));
     this->start_time = INTEGER((st) ? st.take() / 100 : -1);
+  } else if (read_stat && !read_status) {
+    status = Status(1, "Cannot read /proc/stat");
+    return;
+  }
+
+  if (!read_status) {
+    return;
   }
 
   // /proc/N/status may be not available, or readable by this user.
@@ -391,65 +422,243 @@ int getOnDisk(const std::string& pid, std::string& path) {
   }
 }
 
-void genProcess(const std::string& pid, QueryData& results) {
-  // Parse the process stat and status.
-  SimpleProcStat proc_stat(pid);
-  // Parse the process io
-  SimpleProcIo proc_io(pid);
+/**
+ * @brief Process details that do not change for the life of an executable.
+ *
+ * The on_disk check, which may read and search the process maps, is kept
+ * between scans, keyed by pid, and is reused while the pid's start time and
+ * exe link are unchanged. The cmdline is not cached, a process may rewrite it
+ * with setproctitle or exec a binary with the same name.
+ */
+struct ProcessCacheEntry {
+  std::string start_ticks;
+  std::string comm;
+
+  bool has_path{false};
+  std::string exe_link;
+  std::string path;
+  int on_disk{-1};
+};
+
+/// Cached process details by pid.
+static std::unordered_map<std::string, ProcessCacheEntry> kProcessCache;
+
+/// Protect the process cache from concurrent table scans.
+static Mutex kProcessCacheMutex;
+
+/// Column ordinals within the processes table, resolved once per query.
+struct ProcessColumns {
+  ProcessColumns(const QueryContext& context, const TableRows& results)
+      : pid(results.column("pid")),
+        name(results.column("name")),
+        path(results.column("path")),
+        cmdline(results.column("cmdline")),
+        state(results.column("state")),
+        cwd(results.column("cwd")),
+        root(results.column("root")),
+        uid(results.column("uid")),
+        gid(results.column("gid")),
+        euid(results.column("euid")),
+        egid(results.column("egid")),
+        suid(results.column("suid")),
+        sgid(results.column("sgid")),
+        on_disk(results.column("on_disk")),
+        wired_size(results.column("wired_size")),
+        resident_size(results.column("resident_size")),
+        total_size(results.column("total_size")),
+        user_time(results.column("user_time")),
+        system_time(results.column("system_time")),
+        disk_bytes_read(results.column("disk_bytes_read")),
+        disk_bytes_written(results.column("disk_bytes_written")),
+        start_time(results.column("start_time")),
+        parent(results.column("parent")),
+        pgroup(results.column("pgroup")),
+        threads(results.column("threads")),
+        nice(results.column("nice")) {
+    reads_cmdline = context.isColumnUsed("cmdline");
+    reads_exe = context.isAnyColumnUsed({"path", "on_disk"});
+    reads_cwd = context.isColumnUsed("cwd");
+    reads_root = context.isColumnUsed("root");
+    reads_io = context.isAnyColumnUsed(
+        {"disk_bytes_read", "disk_bytes_written"});
+    reads_status = context.isAnyColumnUsed({"name",
+                                            "uid",
+                                            "gid",
+                                            "euid",
+                                            "egid",
+                                            "suid",
+                                            "sgid",
+                                            "resident_size",
+                                            "total_size"});
+    // The cache is validated using the start time and name within stat.
+    reads_stat = reads_exe ||
+                 context.isAnyColumnUsed({"state",
+                                          "parent",
+                                          "pgroup",
+                                          "nice",
+                                          "threads",
+                                          "user_time",
+                                          "system_time",
+                                          "start_time"});
+  }
+
+  size_t pid;
+  size_t name;
+  size_t path;
+  size_t cmdline;
+  size_t state;
+  size_t cwd;
+  size_t root;
+  size_t uid;
+  size_t gid;
+  size_t euid;
+  size_t egid;
+  size_t suid;
+  size_t sgid;
+  size_t on_disk;
+  size_t wired_size;
+  size_t resident_size;
+  size_t total_size;
+  size_t user_time;
+  size_t system_time;
+  size_t disk_bytes_read;
+  size_t disk_bytes_written;
+  size_t start_time;
+  size_t parent;
+  size_t pgroup;
+  size_t threads;
+  size_t nice;
+
+  /// Which /proc files are needed for the selected columns.
+  bool reads_stat{true};
+  bool reads_status{true};
+  bool reads_io{true};
+  bool reads_cmdline{true};
+  bool reads_exe{true};
+  bool reads_cwd{true};
+  bool reads_root{true};
+};
+
+/// Copy the cached details for a pid if the process has not been replaced.
+static void getCachedProcess(const std::string& pid,
+                             const SimpleProcStat& proc_stat,
+                             ProcessCacheEntry& entry) {
+  entry.start_ticks = proc_stat.start_ticks;
+  entry.comm = proc_stat.comm;
+
+  ReadLock lock(kProcessCacheMutex);
+  auto it = kProcessCache.find(pid);
+  if (it != kProcessCache.end() &&
+      it->second.start_ticks == proc_stat.start_ticks &&
+      it->second.comm == proc_stat.comm) {
+    entry = it->second;
+  }
+}
+
+/// Save updated details for a pid.
+static void setCachedProcess(const std::string& pid,
+                             const ProcessCacheEntry& entry) {
+  WriteLock lock(kProcessCacheMutex);
+  kProcessCache[pid] = entry;
+}
 
+/// Remove cached details for pids that were not found in a full scan.
+static void expireCachedProcesses(const std::set<std::string>& pidlist) {
+  WriteLock lock(kProcessCacheMutex);
+  for (auto it = kProcessCache.begin(); it != kProcessCache.end();) {
+    if (pidlist.count(it->first) == 0) {
+      it = kProcessCache.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void genProcess(const std::string& pid,
+                const ProcessColumns& c,
+                TableRows& results) {
+  // Parse the process stat and status.
+  SimpleProcStat proc_stat(pid, c.reads_stat, c.reads_status);
   if (!proc_stat.status.ok()) {
     VLOG(1) << proc_stat.status.getMessage() << " for pid " << pid;
     return;
   }
 
-  Row r;
-  r["pid"] = pid;
-  r["parent"] = proc_stat.parent;
-  r["path"] = readProcLink("exe", pid);
-  r["name"] = proc_stat.name;
-  r["pgroup"] = proc_stat.group;
-  r["state"] = proc_stat.state;
-  r["nice"] = proc_stat.nice;
-  r["threads"] = proc_stat.threads;
-  // Read/parse cmdline arguments.
-  r["cmdline"] = readProcCMDLine(pid);
-  r["cwd"] = readProcLink("cwd", pid);
-  r["root"] = readProcLink("root", pid);
-  r["uid"] = proc_stat.real_uid;
-  r["euid"] = proc_stat.effective_uid;
-  r["suid"] = proc_stat.saved_uid;
-  r["gid"] = proc_stat.real_gid;
-  r["egid"] = proc_stat.effective_gid;
-  r["sgid"] = proc_stat.saved_gid;
-
-  r["on_disk"] = INTEGER(getOnDisk(pid, r["path"]));
+  ProcessCacheEntry entry;
+  if (c.reads_exe) {
+    getCachedProcess(pid, proc_stat, entry);
+
+    // The link is always read, it changes if the binary is deleted.
+    auto exe_link = readProcLink("exe", pid);
+    if (!entry.has_path || exe_link != entry.exe_link) {
+      // The path may be trimmed if it only collides with a " (deleted)" suffix.
+      entry.path = exe_link;
+      entry.on_disk = getOnDisk(pid, entry.path);
+      entry.exe_link = std::move(exe_link);
+      entry.has_path = true;
+      setCachedProcess(pid, entry);
+    }
+  }
+
+  results.addRow();
+  results.setText(c.pid, pid);
+  results.setText(c.parent, proc_stat.parent);
+  results.setText(c.name, proc_stat.name);
+  results.setText(c.pgroup, proc_stat.group);
+  results.setText(c.state, proc_stat.state);
+  results.setText(c.nice, proc_stat.nice);
+  results.setText(c.threads, proc_stat.threads);
+  if (c.reads_cmdline) {
+    results.setText(c.cmdline, readProcCMDLine(pid));
+  }
+  if (c.reads_cwd) {
+    results.setText(c.cwd, readProcLink("cwd", pid));
+  }
+  if (c.reads_root) {
+    results.setText(c.root, readProcLink("root", pid));
+  }
+  results.setText(c.uid, proc_stat.real_uid);
+  results.setText(c.euid, proc_stat.effective_uid);
+  results.setText(c.suid, proc_stat.saved_uid);
+  results.setText(c.gid, proc_stat.real_gid);
+  results.setText(c.egid, proc_stat.effective_gid);
+  results.setText(c.sgid, proc_stat.saved_gid);
+
+  if (c.reads_exe) {
+    results.setInteger(c.on_disk, entry.on_disk);
+    results.setText(c.path, entry.path);
+  }
 
   // size/memory information
-  r["wired_size"] = "0"; // No support for unpagable counters in linux.
-  r["resident_size"] = proc_stat.resident_size;
-  r["total_size"] = proc_stat.total_size;
+  results.setInteger(c.wired_size, 0); // No unpagable counters in linux.
+  results.setText(c.resident_size, proc_stat.resident_size);
+  results.setText(c.total_size, proc_stat.total_size);
 
   // time information
   auto usr_time = std::strtoull(proc_stat.user_time.data(), nullptr, 10);
-  r["user_time"] = std::to_string(usr_time * kMSIn1CLKTCK);
+  results.setInteger(c.user_time, usr_time * kMSIn1CLKTCK);
   auto sys_time = std::strtoull(proc_stat.system_time.data(), nullptr, 10);
-  r["system_time"] = std::to_string(sys_time * kMSIn1CLKTCK);
-  r["start_time"] = proc_stat.start_time;
+  results.setInteger(c.system_time, sys_time * kMSIn1CLKTCK);
+  results.setText(c.start_time, proc_stat.start_time);
+
+  if (!c.reads_io) {
+    return;
+  }
 
+  // Parse the process io
+  SimpleProcIo proc_io(pid);
   if (!proc_io.status.ok()) {
     // /proc/<pid>/io can require root to access, so don't fail if we can't
     VLOG(1) << proc_io.status.getMessage();
   } else {
-    r["disk_bytes_read"] = proc_io.read_bytes;
+    results.setText(c.disk_bytes_read, proc_io.read_bytes);
     long long write_bytes = tryTo<long long>(proc_io.write_bytes).takeOr(0ll);
     long long cancelled_write_bytes =
         tryTo<long long>(proc_io.cancelled_write_bytes).takeOr(0ll);
 
-    r["disk_bytes_written"] =
-        std::to_string(write_bytes - cancelled_write_bytes);
+    results.setInteger(c.disk_bytes_written,
+                       write_bytes - cancelled_write_bytes);
   }
-
-  results.push_back(r);
 }
 
 void genNamespaces(const std::string& pid, QueryData& results) {
@@ -470,15 +679,18 @@ void genNamespaces(const std::string& pid, QueryData& results) {
   results.push_back(r);
 }
 
-QueryData genProcesses(QueryContext& context) {
-  QueryData results;
+void genProcesses(QueryContext& context, TableRows& results) {
+  ProcessColumns columns(context, results);
 
   auto pidlist = getProcList(context);
   for (const auto& pid : pidlist) {
-    genProcess(pid, results);
+    genProcess(pid, columns, results);
   }
 
-  return results;
+  if (!context.hasConstraint("pid", EQUALS)) {
+    // A full scan found every running process.
+    expireCachedProcesses(pidlist);
+  }
 }
 
 QueryData genProcessEnvs(QueryContext& context) {
@@ -22,6 +22,7 @@
 #include <osquery/tables.h>
 
 #include "osquery/core/conversions.h"
+#include "osquery/core/hashing.h"
 #include "osquery/tests/test_util.h"
 
 namespace osquery {
@@ -75,6 +76,23 @@ TEST_F(SystemsTablesTests, test_processes) {
   }
 }
 
+TEST_F(SystemsTablesTests, test_processes_columns_used) {
+  // Cached process details must match between scans and column selections.
+  SQL all("select * from osquery_info join processes using (pid)");
+  ASSERT_EQ(all.rows().size(), 1U);
+
+  SQL some(
+      "select pid, cmdline, path, on_disk from osquery_info join processes "
+      "using (pid)");
+  ASSERT_EQ(some.rows().size(), 1U);
+  EXPECT_EQ(some.rows()[0].at("cmdline"), all.rows()[0].at("cmdline"));
+  EXPECT_EQ(some.rows()[0].at("path"), all.rows()[0].at("path"));
+  EXPECT_EQ(some.rows()[0].at("on_disk"), all.rows()[0].at("on_disk"));
+
+  SQL pids("select pid from processes");
+  EXPECT_GT(pids.rows().size(), 1U);
+}
+
 TEST_F(SystemsTablesTests, test_users) {
   {
     SQL results("select uid, uuid, username from users limit 1");
@@ -316,5 +334,35 @@ TEST_F(HashTableTest, test_cache_updates) {
   EXPECT_NE(rows[0].at("md5"), contentMd5);
   EXPECT_EQ(rows[0].at("md5"), badContentMd5);
 }
+
+TEST_F(HashTableTest, test_directory_hashes) {
+  removePath(tmpPath);
+  boost::filesystem::create_directories(tmpPath);
+
+  // Mix small files with one large enough to hash each digest in a lane.
+  std::map<std::string, std::string> files;
+  for (size_t i = 0; i < 16; i++) {
+    files[(tmpPath / std::to_string(i)).string()] =
+        content[i % 2] + std::to_string(i);
+  }
+  files[(tmpPath / "large").string()] = std::string(3 * 1024 * 1024 + 7, 'A');
+  for (const auto& file : files) {
+    writeTextFile(file.first, file.second);
+  }
+
+  SQL results("select path, md5, sha1, sha256 from hash where directory = '" +
+              tmpPath.string() + "'");
+  auto rows = results.rows();
+  ASSERT_EQ(rows.size(), files.size());
+  for (const auto& row : rows) {
+    const auto& data = files.at(row.at("path"));
+    EXPECT_EQ(row.at("md5"),
+              hashFromBuffer(HASH_TYPE_MD5, data.data(), data.size()));
+    EXPECT_EQ(row.at("sha1"),
+              hashFromBuffer(HASH_TYPE_SHA1, data.data(), data.size()));
+    EXPECT_EQ(row.at("sha256"),
+              hashFromBuffer(HASH_TYPE_SHA256, data.data(), data.size()));
+  }
+}
 } // namespace tables
 } // namespace osquery
@@ -271,7 +271,7 @@ void genProcess(const WmiResultItem& result, QueryData& results_data) {
   results_data.push_back(r);
 }
 
-QueryData genProcesses(QueryContext& context) {
+static QueryData genProcessRows(QueryContext& context) {
   QueryData results;
 
   std::string query = "SELECT * FROM Win32_Process";
@@ -313,6 +313,10 @@ QueryData genProcesses(QueryContext& context) {
   return results;
 }
 
+void genProcesses(QueryContext& context, TableRows& results) {
+  results.append(genProcessRows(context));
+}
+
 QueryData genProcessMemoryMap(QueryContext& context) {
   QueryData results;
 
@@ -17,6 +17,7 @@
 #include <osquery/tables.h>
 
 #include "osquery/filesystem/fileops.h"
+#include "osquery/tables/utility/file.h"
 
 namespace fs = boost::filesystem;
 
@@ -40,101 +41,205 @@ const std::map<fs::file_type, std::string> kTypeNames{
 
 #endif
 
-void genFileInfo(const fs::path& path,
-                 const fs::path& parent,
-                 const std::string& pattern,
-                 QueryData& results) {
-  // Must provide the path, filename, directory separate from boost path->string
-  // helpers to match any explicit (query-parsed) predicate constraints.
-
-  Row r;
-  r["path"] = path.string();
-  r["filename"] = path.filename().string();
-  r["directory"] = parent.string();
-  r["symlink"] = "0";
+/// Column ordinals within the file table, resolved once per query.
+struct FileColumns {
+  explicit FileColumns(const TableRows& results)
+      : path(results.column("path")),
+        directory(results.column("directory")),
+        filename(results.column("filename")),
+        inode(results.column("inode")),
+        uid(results.column("uid")),
+        gid(results.column("gid")),
+        mode(results.column("mode")),
+        device(results.column("device")),
+        size(results.column("size")),
+        block_size(results.column("block_size")),
+        atime(results.column("atime")),
+        mtime(results.column("mtime")),
+        ctime(results.column("ctime")),
+        btime(results.column("btime")),
+        hard_links(results.column("hard_links")),
+        symlink(results.column("symlink")),
+        type(results.column("type")),
+        attributes(results.column("attributes")),
+        volume_serial(results.column("volume_serial")),
+        file_id(results.column("file_id")) {}
+
+  size_t path;
+  size_t directory;
+  size_t filename;
+  size_t inode;
+  size_t uid;
+  size_t gid;
+  size_t mode;
+  size_t device;
+  size_t size;
+  size_t block_size;
+  size_t atime;
+  size_t mtime;
+  size_t ctime;
+  size_t btime;
+  size_t hard_links;
+  size_t symlink;
+  size_t type;
+  size_t attributes;
+  size_t volume_serial;
+  size_t file_id;
+};
 
 #if !defined(WIN32)
 
+/// The link and target metadata for a path.
+struct FileStat {
+  struct stat link_stat;
   struct stat file_stat;
+};
+
+#else
+
+using FileStat = WINDOWS_STAT;
+
+#endif
+
+/// Read the metadata reported by the file table, false if it is not readable.
+static bool statFile(const fs::path& path, FileStat& info) {
+#if !defined(WIN32)
 
   // On POSIX systems, first check the link state.
-  struct stat link_stat;
-  if (lstat(path.string().c_str(), &link_stat) < 0) {
+  if (lstat(path.string().c_str(), &info.link_stat) < 0) {
     // Path was not real, had too may links, or could not be accessed.
-    return;
+    return false;
   }
-  if (S_ISLNK(link_stat.st_mode)) {
-    r["symlink"] = "1";
+
+  if (stat(path.string().c_str(), &info.file_stat)) {
+    info.file_stat = info.link_stat;
+  }
+  return true;
+
+#else
+
+  auto rtn = platformStat(path, &info);
+  if (!rtn.ok()) {
+    VLOG(1) << "PlatformStat failed with " << rtn.getMessage();
+    return false;
   }
+  return true;
 
-  if (stat(path.string().c_str(), &file_stat)) {
-    file_stat = link_stat;
+#endif
+}
+
+bool genCommonFileColumns(const std::string& path, Row& r) {
+  FileStat info;
+  if (!statFile(path, info)) {
+    return false;
   }
 
+#if !defined(WIN32)
+  const auto& file_stat = info.file_stat;
+  r["mode"] = lsperms(file_stat.st_mode);
   r["inode"] = BIGINT(file_stat.st_ino);
   r["uid"] = BIGINT(file_stat.st_uid);
   r["gid"] = BIGINT(file_stat.st_gid);
-  r["mode"] = lsperms(file_stat.st_mode);
-  r["device"] = BIGINT(file_stat.st_rdev);
   r["size"] = BIGINT(file_stat.st_size);
-  r["block_size"] = INTEGER(file_stat.st_blksize);
-  r["hard_links"] = INTEGER(file_stat.st_nlink);
-
   r["atime"] = BIGINT(file_stat.st_atime);
   r["mtime"] = BIGINT(file_stat.st_mtime);
   r["ctime"] = BIGINT(file_stat.st_ctime);
+#else
+  r["mode"] = TEXT(info.mode);
+  r["inode"] = BIGINT(info.inode);
+  r["uid"] = BIGINT(info.uid);
+  r["gid"] = BIGINT(info.gid);
+  r["size"] = BIGINT(info.size);
+  r["atime"] = BIGINT(info.atime);
+  r["mtime"] = BIGINT(info.mtime);
+  r["ctime"] = BIGINT(info.ctime);
+#endif
+  return true;
+}
+
+void genFileInfo(const fs::path& path,
+                 const fs::path& parent,
+                 const std::string& pattern,
+                 const FileColumns& c,
+                 TableRows& results) {
+  // Must provide the path, filename, directory separate from boost path->string
+  // helpers to match any explicit (query-parsed) predicate constraints.
+  FileStat info;
+  if (!statFile(path, info)) {
+    return;
+  }
+
+#if !defined(WIN32)
+
+  const auto& link_stat = info.link_stat;
+  const auto& file_stat = info.file_stat;
+
+  results.addRow();
+  results.setText(c.path, path.string());
+  results.setText(c.filename, path.filename().string());
+  results.setText(c.directory, parent.string());
+  results.setInteger(c.symlink, S_ISLNK(link_stat.st_mode) ? 1 : 0);
+
+  results.setInteger(c.inode, file_stat.st_ino);
+  results.setInteger(c.uid, file_stat.st_uid);
+  results.setInteger(c.gid, file_stat.st_gid);
+  results.setText(c.mode, lsperms(file_stat.st_mode));
+  results.setInteger(c.device, file_stat.st_rdev);
+  results.setInteger(c.size, file_stat.st_size);
+  results.setInteger(c.block_size, file_stat.st_blksize);
+  results.setInteger(c.hard_links, file_stat.st_nlink);
+
+  results.setInteger(c.atime, file_stat.st_atime);
+  results.setInteger(c.mtime, file_stat.st_mtime);
+  results.setInteger(c.ctime, file_stat.st_ctime);
 
 #if defined(__linux__)
   // No 'birth' or create time in Linux or Windows.
-  r["btime"] = "0";
+  results.setInteger(c.btime, 0);
 #else
-  r["btime"] = BIGINT(file_stat.st_birthtimespec.tv_sec);
+  results.setInteger(c.btime, file_stat.st_birthtimespec.tv_sec);
 #endif
 
   // Type booleans
   boost::system::error_code ec;
   auto status = fs::status(path, ec);
   if (kTypeNames.count(status.type())) {
-    r["type"] = kTypeNames.at(status.type());
+    results.setText(c.type, kTypeNames.at(status.type()));
   } else {
-    r["type"] = "unknown";
+    results.setText(c.type, "unknown");
   }
 
 #else
 
-  WINDOWS_STAT file_stat;
-
-  auto rtn = platformStat(path, &file_stat);
-  if (!rtn.ok()) {
-    VLOG(1) << "PlatformStat failed with " << rtn.getMessage();
-    return;
-  }
-
-  r["symlink"] = INTEGER(file_stat.symlink);
-  r["inode"] = BIGINT(file_stat.inode);
-  r["uid"] = BIGINT(file_stat.uid);
-  r["gid"] = BIGINT(file_stat.gid);
-  r["mode"] = TEXT(file_stat.mode);
-  r["device"] = BIGINT(file_stat.device);
-  r["size"] = BIGINT(file_stat.size);
-  r["block_size"] = INTEGER(file_stat.block_size);
-  r["hard_links"] = INTEGER(file_stat.hard_links);
-  r["atime"] = BIGINT(file_stat.atime);
-  r["mtime"] = BIGINT(file_stat.mtime);
-  r["ctime"] = BIGINT(file_stat.ctime);
-  r["btime"] = BIGINT(file_stat.btime);
-  r["type"] = TEXT(file_stat.type);
-  r["attributes"] = TEXT(file_stat.attributes);
-  r["file_id"] = TEXT(file_stat.file_id);
-  r["volume_serial"] = TEXT(file_stat.volume_serial);
+  const auto& file_stat = info;
+
+  results.addRow();
+  results.setText(c.path, path.string());
+  results.setText(c.filename, path.filename().string());
+  results.setText(c.directory, parent.string());
+  results.setInteger(c.symlink, file_stat.symlink);
+  results.setInteger(c.inode, file_stat.inode);
+  results.setInteger(c.uid, file_stat.uid);
+  results.setInteger(c.gid, file_stat.gid);
+  results.setText(c.mode, TEXT(file_stat.mode));
+  results.setInteger(c.device, file_stat.device);
+  results.setInteger(c.size, file_stat.size);
+  results.setInteger(c.block_size, file_stat.block_size);
+  results.setInteger(c.hard_links, file_stat.hard_links);
+  results.setInteger(c.atime, file_stat.atime);
+  results.setInteger(c.mtime, file_stat.mtime);
+  results.setInteger(c.ctime, file_stat.ctime);
+  results.setInteger(c.btime, file_stat.btime);
+  results.setText(c.type, TEXT(file_stat.type));
+  results.setText(c.attributes, TEXT(file_stat.attributes));
+  results.setText(c.file_id, TEXT(file_stat.file_id));
+  results.setText(c.volume_serial, TEXT(file_stat.volume_serial));
 
 #endif
-
-  results.push_back(r);
 }
 
-QueryData genFile(QueryContext& context) {
-  QueryData results;
+void genFile(QueryContext& context, TableRows& results) {
+  FileColumns columns(results);
 
   // Resolve file paths for EQUALS and LIKE operations.
   auto paths = context.constraints["path"].getAll(EQUALS);
@@ -143,21 +248,19 @@ QueryData genFile(QueryContext& context) {
       LIKE,
       paths,
       ([&](const std::string& pattern, std::set<std::string>& out) {
-        std::vector<std::string> patterns;
-        auto status =
-            resolveFilePattern(pattern, patterns, GLOB_ALL | GLOB_NO_CANON);
-        if (status.ok()) {
-          for (const auto& resolved : patterns) {
-            out.insert(resolved);
-          }
-        }
-        return status;
+        // Paths are added as the pattern is resolved.
+        return resolveFilePattern(pattern,
+                                  ([&out](const std::string& resolved) {
+                                    out.insert(resolved);
+                                    return true;
+                                  }),
+                                  GLOB_ALL | GLOB_NO_CANON);
       }));
 
   // Iterate through each of the resolved/supplied paths.
   for (const auto& path_string : paths) {
     fs::path path = path_string;
-    genFileInfo(path, path.parent_path(), "", results);
+    genFileInfo(path, path.parent_path(), "", columns, results);
   }
 
   // Resolve directories for EQUALS and LIKE operations.
@@ -167,15 +270,13 @@ QueryData genFile(QueryContext& context) {
       LIKE,
       directories,
       ([&](const std::string& pattern, std::set<std::string>& out) {
-        std::vector<std::string> patterns;
-        auto status =
-            resolveFilePattern(pattern, patterns, GLOB_FOLDERS | GLOB_NO_CANON);
-        if (status.ok()) {
-          for (const auto& resolved : patterns) {
-            out.insert(resolved);
-          }
-        }
-        return status;
+        // Paths are added as the pattern is resolved.
+        return resolveFilePattern(pattern,
+                                  ([&out](const std::string& resolved) {
+                                    out.insert(resolved);
+                                    return true;
+                                  }),
+                                  GLOB_FOLDERS | GLOB_NO_CANON);
       }));
 
   // Now loop through constraints using the directory column constraint.
@@ -188,14 +289,12 @@ QueryData genFile(QueryContext& context) {
       // Iterate over the directory and generate info for each regular file.
       fs::directory_iterator begin(directory_string), end;
       for (; begin != end; ++begin) {
-        genFileInfo(begin->path(), directory_string, "", results);
+        genFileInfo(begin->path(), directory_string, "", columns, results);
       }
     } catch (const fs::filesystem_error& /* e */) {
       continue;
     }
   }
-
-  return results;
 }
 }
 } // namespace osquery
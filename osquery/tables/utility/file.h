@@ -0,0 +1,33 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+#pragma once
+
+#include <string>
+
+#include <osquery/tables.h>
+
+namespace osquery {
+namespace tables {
+
+/**
+ * @brief Set the stat-based `file` table columns for a single path.
+ *
+ * This reads the path's metadata the same way the `file` table does, without
+ * a SQL query, and sets the inode, uid, gid, mode, size, atime, mtime, and
+ * ctime columns. It is used to decorate file events.
+ *
+ * @param path The target path.
+ * @param r The output row, only decorated if the path could be read.
+ * @return true if the path could be read.
+ */
+bool genCommonFileColumns(const std::string& path, Row& r);
+} // namespace tables
+} // namespace osquery
@@ -22,6 +22,7 @@
 #include <osquery/tables.h>
 
 #include "osquery/core/process.h"
+#include "osquery/core/table_cache.h"
 
 namespace osquery {
 
@@ -240,7 +241,9 @@ QueryData genOsquerySchedule(QueryContext& context) {
         // Set default (0) values for each query if it has not yet executed.
         r["executions"] = "0";
         r["output_size"] = "0";
+        r["output_rows"] = "0";
         r["wall_time"] = "0";
+        r["wall_time_ns"] = "0";
         r["user_time"] = "0";
         r["system_time"] = "0";
         r["average_memory"] = "0";
@@ -252,7 +255,9 @@ QueryData genOsquerySchedule(QueryContext& context) {
               r["executions"] = BIGINT(perf.executions);
               r["last_executed"] = BIGINT(perf.last_executed);
               r["output_size"] = BIGINT(perf.output_size);
+              r["output_rows"] = BIGINT(perf.output_rows);
               r["wall_time"] = BIGINT(perf.wall_time);
+              r["wall_time_ns"] = BIGINT(perf.wall_time_ns);
               r["user_time"] = BIGINT(perf.user_time);
               r["system_time"] = BIGINT(perf.system_time);
               r["average_memory"] = BIGINT(perf.average_memory);
@@ -263,5 +268,17 @@ QueryData genOsquerySchedule(QueryContext& context) {
       true);
   return results;
 }
+
+QueryData genOsqueryTableCache(QueryContext& context) {
+  QueryData results;
+  for (const auto& table : TableTickCache::get().stats()) {
+    Row r;
+    r["name"] = table.first;
+    r["hits"] = BIGINT(table.second.hits);
+    r["misses"] = BIGINT(table.second.misses);
+    results.push_back(r);
+  }
+  return results;
+}
 } // namespace tables
 } // namespace osquery
@@ -0,0 +1,43 @@
+/**
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under both the Apache 2.0 license (found in the
+ *  LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ *  in the COPYING file in the root directory of this source tree).
+ *  You may select, at your option, one of the above-listed licenses.
+ */
+
+// Sanity check integration test for audit_queue_stats
+// Spec file: specs/linux/audit_queue_stats.table
+
+#include <osquery/tests/integration/tables/helper.h>
+
+namespace osquery {
+
+class auditQueueStats : public IntegrationTableTest {};
+
+TEST_F(auditQueueStats, test_sanity) {
+  // 1. Query data
+  // QueryData data = execute_query("select * from audit_queue_stats");
+  // 2. Check size before validation
+  // ASSERT_GE(data.size(), 0ul);
+  // ASSERT_EQ(data.size(), 1ul);
+  // ASSERT_EQ(data.size(), 0ul);
+  // 3. Build validation map
+  // See IntegrationTableTest.cpp for avaialbe flags
+  // Or use custom DataCheck object
+  // ValidatatioMap row_map = {
+  //      {"queue", NormalType}
+  //      {"capacity", IntType}
+  //      {"size", IntType}
+  //      {"max_size", IntType}
+  //      {"pushed", IntType}
+  //      {"dropped", IntType}
+  //      {"stalls", IntType}
+  //}
+  // 4. Perform validation
+  // validate_rows(data, row_map);
+}
+
+} // namespace osquery
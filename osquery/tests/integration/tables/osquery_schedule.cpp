@@ -36,7 +36,9 @@ TEST_F(osquerySchedule, test_sanity) {
   //      {"last_executed", IntType}
   //      {"blacklisted", IntType}
   //      {"output_size", IntType}
+  //      {"output_rows", IntType}
   //      {"wall_time", IntType}
+  //      {"wall_time_ns", IntType}
   //      {"user_time", IntType}
   //      {"system_time", IntType}
   //      {"average_memory", IntType}
@@ -478,6 +478,20 @@ QueryData genRows(EventSubscriberPlugin* sub) {
   return results;
 }
 
+QueryData genRows(EventSubscriberPlugin* sub, QueryContext& context) {
+  RowGenerator::pull_type generator(std::bind(&EventSubscriberPlugin::genTable,
+                                              sub,
+                                              std::placeholders::_1,
+                                              std::ref(context)));
+
+  QueryData results;
+  while (generator) {
+    results.push_back(generator.get());
+    generator();
+  }
+  return results;
+}
+
 void createMockFileStructure() {
   fs::create_directories(kFakeDirectory + "/toplevel/");
   fs::create_directories(kFakeDirectory + "/toplevel/secondlevel1");
@@ -158,6 +158,9 @@ std::vector<SplitStringTestData> generateSplitStringTestData();
 // Helper function to generate all rows from a generator-based table.
 QueryData genRows(EventSubscriberPlugin* sub);
 
+// Helper function to generate the rows matching a query context's constraints.
+QueryData genRows(EventSubscriberPlugin* sub, QueryContext& context);
+
 // generate a small directory structure for testing
 void createMockFileStructure();
 
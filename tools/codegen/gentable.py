@@ -206,6 +206,7 @@ class TableState(Singleton):
         self.has_options = False
         self.has_column_aliases = False
         self.generator = False
+        self.typed = False
 
     def columns(self):
         return [i for i in self.schema if isinstance(i, Column)]
@@ -242,6 +243,10 @@ class TableState(Singleton):
                 print(lightred(
                     "Table cannot use a generator and be marked cacheable: %s" % (path)))
                 exit(1)
+        if self.typed and self.generator:
+            print(lightred(
+                "Table cannot use a generator and typed rows: %s" % (path)))
+            exit(1)
         if self.table_name == "" or self.function == "":
             print(lightred("Invalid table spec: %s" % (path)))
             exit(1)
@@ -287,6 +292,7 @@ class TableState(Singleton):
             has_options=self.has_options,
             has_column_aliases=self.has_column_aliases,
             generator=self.generator,
+            typed=self.typed,
             attribute_set=[TABLE_ATTRIBUTES[attr] for attr in self.attributes if attr in TABLE_ATTRIBUTES],
         )
 
@@ -393,7 +399,7 @@ def fuzz_paths(paths):
     table.fuzz_paths = paths
 
 
-def implementation(impl_string, generator=False):
+def implementation(impl_string, generator=False, typed=False):
     """
     define the path to the implementation file and the function which
     implements the virtual table. You should use the following format:
@@ -401,6 +407,9 @@ def implementation(impl_string, generator=False):
       # the path is "osquery/table/implementations/foo.cpp"
       # the function is "QueryData genFoo();"
       implementation("foo@genFoo")
+
+    Tables using typed=True implement
+    "void genFoo(QueryContext& context, TableRows& results);"
     """
     logging.debug("- implementation")
     filename, function = impl_string.split("@")
@@ -415,6 +424,7 @@ def implementation(impl_string, generator=False):
     table.function = function
     table.class_name = class_name
     table.generator = generator
+    table.typed = typed
 
     '''Check if the table has a subscriber attribute, if so, enforce time.'''
     if "event_subscriber" in table.attributes: